@@ -0,0 +1,537 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     at45db_model.c
+*    \brief    AT45DB flash model for the host builds, connected to the host SPI functions
+*    Created:  19/10/2026
+*/
+/*
+ * The model decodes the SPI byte stream sent by flash_mem.c, so the firmware
+ * driver runs unmodified. Its contents live in an image file mapped in memory
+ * (FLASH_SIZE bytes, a blank image is created if needed), together with the two
+ * internal SRAM buffers. Like on the chip, erase and program operations start
+ * when chip select is deasserted and keep the device busy for their typical
+ * duration. Time is simulated (see host_time.c): each SPI byte takes 1us (8MHz bus) and polling
+ * the status register while busy jumps to the end of the operation, which
+ * keeps waitForFlash() loops out of host profiles. Accessing the device while
+ * it is busy (other than reading its status or writing the buffer not being
+ * programmed) is counted as a violation.
+ * A power cut can be scheduled at the end of a given transaction (chip select
+ * deassertion): the internal buffers are lost and a page program started by
+ * that transaction is torn, the page being erased and only its first half
+ * programmed. Erase operations are considered complete.
+ */
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include "at45db_model.h"
+#include "node_mgmt.h"
+#include "flash_mem.h"
+#include "host_time.h"
+#include "defines.h"
+
+/* Simulated durations in ns, typical figures of the AT45DB041D datasheet */
+#define AT45DB_SPI_BYTE_TIME        1000ULL
+#define AT45DB_PAGE_TO_BUF_TIME     200000ULL
+#define AT45DB_ERASE_PROGRAM_TIME   17000000ULL
+#define AT45DB_PAGE_ERASE_TIME      15000000ULL
+#define AT45DB_BLOCK_ERASE_TIME     45000000ULL
+// For 256 pages, sector and chip erase durations scale with the number of pages erased
+#define AT45DB_SECTOR_ERASE_TIME    1600000000ULL
+#define AT45DB_SECTOR_ERASE_PAGES   256
+
+/* Status register: ready bit, density code from the device ID, standard page size */
+#define AT45DB_STATUS_READY         0x80
+#define AT45DB_STATUS_DENSITY       ((uint8_t)((((MAN_FAM_DEN_VAL & 0x1F) * 2) - 1) << 2))
+
+/* Opcodes not defined in flash_mem.h */
+#define AT45DB_OPCODE_CHIP_ERASE    0xC7
+#define AT45DB_OPCODE_LENGTH        4
+#define AT45DB_MAX_VIOLATION_PRINTS 10
+
+/* Device contents */
+static uint8_t* flash_image = MAP_FAILED;
+static uint8_t flash_buffers[2][BYTES_PER_PAGE];
+/* Current transaction */
+static uint8_t chip_selected = FALSE;
+static uint8_t opcode[AT45DB_OPCODE_LENGTH];
+static uint8_t opcode_length;
+static uint16_t page_address;
+static uint16_t byte_address;
+/* Operation in progress: end time, buffer being programmed (0 if none) */
+static uint64_t busy_until;
+static uint8_t busy_buffer;
+/* Page being programmed, for power cuts */
+static uint16_t busy_page;
+static uint8_t busy_programming;
+/* Scheduled power cut: transaction number (0 if none), tear mode, callback */
+static uint32_t power_cut_transaction;
+static uint8_t power_cut_tear;
+static void (*power_cut_callback)(void);
+static at45dbStats_t stats;
+
+
+/*! \fn     at45dbViolation(const char* reason)
+*   \brief  Count and report an access the real device wouldn't accept
+*   \param  reason  Description of the violation
+*/
+static void at45dbViolation(const char* reason)
+{
+    if (stats.violations++ < AT45DB_MAX_VIOLATION_PRINTS)
+    {
+        fprintf(stderr, "at45db: %s (opcode 0x%02x, page %u)\n", reason, opcode[0], page_address);
+    }
+}
+
+/*! \fn     at45dbStartBusy(uint64_t duration, uint8_t buffer)
+*   \brief  Start an internal operation
+*   \param  duration    Its duration in ns
+*   \param  buffer      Internal buffer it reads from, 0 if none
+*/
+static void at45dbStartBusy(uint64_t duration, uint8_t buffer)
+{
+    busy_until = hostTimeGet() + duration;
+    busy_buffer = buffer;
+    busy_programming = FALSE;
+}
+
+/*! \fn     at45dbErasePages(uint16_t first_page, uint16_t nb_pages)
+*   \brief  Erase a range of pages
+*   \param  first_page  First page
+*   \param  nb_pages    Number of pages
+*/
+static void at45dbErasePages(uint16_t first_page, uint16_t nb_pages)
+{
+    if ((uint32_t)first_page + nb_pages > PAGE_COUNT)
+    {
+        at45dbViolation("erase out of the memory");
+        return;
+    }
+    memset(&flash_image[(uint32_t)first_page * BYTES_PER_PAGE], 0xFF, (uint32_t)nb_pages * BYTES_PER_PAGE);
+}
+
+/*! \fn     at45dbEndTransaction(void)
+*   \brief  Chip select deasserted: start the operation of the current command
+*/
+static void at45dbEndTransaction(void)
+{
+    // Incomplete commands are ignored by the device
+    if (opcode_length < AT45DB_OPCODE_LENGTH)
+    {
+        return;
+    }
+    
+    switch (opcode[0])
+    {
+        case FLASH_OPCODE_MAINP_TO_BUF:
+        {
+            memcpy(flash_buffers[0], &flash_image[(uint32_t)page_address * BYTES_PER_PAGE], BYTES_PER_PAGE);
+            stats.page_to_buffer++;
+            at45dbStartBusy(AT45DB_PAGE_TO_BUF_TIME, 0);
+            break;
+        }
+        case FLASH_OPCODE_MMP_PROG_TBUF:
+        case FLASH_OPCODE_BUF_TO_PAGE:
+        case FLASH_OPCODE_BUF2_TO_PAGE:
+        {
+            uint8_t buffer = (opcode[0] == FLASH_OPCODE_BUF2_TO_PAGE)? 2 : 1;
+            memcpy(&flash_image[(uint32_t)page_address * BYTES_PER_PAGE], flash_buffers[buffer-1], BYTES_PER_PAGE);
+            stats.page_programs++;
+            at45dbStartBusy(AT45DB_ERASE_PROGRAM_TIME, buffer);
+            busy_page = page_address;
+            busy_programming = TRUE;
+            break;
+        }
+        case FLASH_OPCODE_PAGE_ERASE:
+        {
+            at45dbErasePages(page_address, 1);
+            stats.page_erases++;
+            at45dbStartBusy(AT45DB_PAGE_ERASE_TIME, 0);
+            break;
+        }
+        case FLASH_OPCODE_BLOCK_ERASE:
+        {
+            at45dbErasePages(page_address & ~0x07, 8);
+            stats.block_erases++;
+            at45dbStartBusy(AT45DB_BLOCK_ERASE_TIME, 0);
+            break;
+        }
+        case FLASH_OPCODE_SECTOR_ERASE:
+        {
+            uint16_t first_page = page_address - (page_address % PAGE_PER_SECTOR);
+            uint16_t nb_pages = PAGE_PER_SECTOR;
+            
+            // Sector 0 is split in 0a and 0b
+            if (first_page == 0)
+            {
+                first_page = (page_address < FLASH_SECTOR_ZER0_A_PAGES)? 0 : FLASH_SECTOR_ZER0_A_PAGES;
+                nb_pages = (page_address < FLASH_SECTOR_ZER0_A_PAGES)? FLASH_SECTOR_ZER0_A_PAGES : PAGE_PER_SECTOR - FLASH_SECTOR_ZER0_A_PAGES;
+            }
+            at45dbErasePages(first_page, nb_pages);
+            stats.sector_erases++;
+            at45dbStartBusy(AT45DB_SECTOR_ERASE_TIME * nb_pages / AT45DB_SECTOR_ERASE_PAGES, 0);
+            break;
+        }
+        case AT45DB_OPCODE_CHIP_ERASE:
+        {
+            if ((opcode[1] != 0x94) || (opcode[2] != 0x80) || (opcode[3] != 0x9A))
+            {
+                at45dbViolation("invalid chip erase sequence");
+                break;
+            }
+            at45dbErasePages(0, PAGE_COUNT);
+            stats.chip_erases++;
+            at45dbStartBusy(AT45DB_SECTOR_ERASE_TIME * PAGE_COUNT / AT45DB_SECTOR_ERASE_PAGES, 0);
+            break;
+        }
+        default: break;
+    }
+}
+
+/*! \fn     at45dbPowerCut(void)
+*   \brief  Cut the power at the end of the current transaction
+*/
+static void at45dbPowerCut(void)
+{
+    // A page program in progress leaves the page erased and half programmed
+    if ((power_cut_tear == TRUE) && (busy_programming == TRUE) && (hostTimeGet() < busy_until))
+    {
+        memset(&flash_image[(uint32_t)busy_page * BYTES_PER_PAGE + BYTES_PER_PAGE / 2], 0xFF, BYTES_PER_PAGE - BYTES_PER_PAGE / 2);
+        stats.torn_pages++;
+    }
+    
+    // The device restarts idle with undefined buffers
+    busy_until = 0;
+    busy_buffer = 0;
+    busy_programming = FALSE;
+    memset(flash_buffers, 0xFF, sizeof(flash_buffers));
+    power_cut_transaction = 0;
+    power_cut_callback();
+}
+
+/*! \fn     at45dbSyncChipSelect(void)
+*   \brief  Track chip select changes made on the port since the last call
+*/
+static void at45dbSyncChipSelect(void)
+{
+    uint8_t selected = (host_PORTB & (1 << PORTID_FLASH_nS))? FALSE : TRUE;
+    
+    if ((chip_selected == TRUE) && (selected == FALSE))
+    {
+        chip_selected = FALSE;
+        at45dbEndTransaction();
+        if (++stats.transactions == power_cut_transaction)
+        {
+            at45dbPowerCut();
+        }
+    }
+    else if ((chip_selected == FALSE) && (selected == TRUE))
+    {
+        opcode_length = 0;
+    }
+    chip_selected = selected;
+}
+
+/*! \fn     hostPortSync(volatile uint8_t* port)
+*   \brief  Called before every port register access (see avr/io.h)
+*   \param  port    The port register
+*   \return The port register
+*/
+volatile uint8_t* hostPortSync(volatile uint8_t* port)
+{
+    at45dbSyncChipSelect();
+    return port;
+}
+
+/*! \fn     at45dbCommandAllowedWhileBusy(uint8_t command)
+*   \brief  Check if a command may be sent while an operation is in progress
+*   \param  command     The opcode
+*   \return TRUE or FALSE
+*/
+static uint8_t at45dbCommandAllowedWhileBusy(uint8_t command)
+{
+    if (command == FLASH_OPCODE_READ_STAT_REG)
+    {
+        return TRUE;
+    }
+    if ((command == FLASH_OPCODE_BUF_WRITE) && (busy_buffer == 2))
+    {
+        return TRUE;
+    }
+    if ((command == FLASH_OPCODE_BUF2_WRITE) && (busy_buffer == 1))
+    {
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/*! \fn     at45dbTransfer(uint8_t data)
+*   \brief  Exchange a byte with the device
+*   \param  data    Byte sent by the MCU
+*   \return Byte sent by the device
+*/
+uint8_t at45dbTransfer(uint8_t data)
+{
+    at45dbSyncChipSelect();
+    hostTimeAdvance(AT45DB_SPI_BYTE_TIME);
+    stats.spi_bytes++;
+    
+    if (chip_selected == FALSE)
+    {
+        return 0xFF;
+    }
+    
+    // Command bytes
+    if (opcode_length < AT45DB_OPCODE_LENGTH)
+    {
+        opcode[opcode_length++] = data;
+        
+        if ((opcode_length == 1) && (hostTimeGet() < busy_until) && (at45dbCommandAllowedWhileBusy(data) == FALSE))
+        {
+            at45dbViolation("command sent while busy");
+        }
+        
+        // Single byte opcodes: status register and device ID
+        if (opcode[0] == FLASH_OPCODE_READ_STAT_REG)
+        {
+            opcode_length = AT45DB_OPCODE_LENGTH;
+        }
+        else if (opcode[0] == FLASH_OPCODE_READ_DEV_INFO)
+        {
+            opcode_length = AT45DB_OPCODE_LENGTH;
+            byte_address = 0;
+        }
+        else if (opcode_length == AT45DB_OPCODE_LENGTH)
+        {
+            uint32_t address = ((uint32_t)opcode[1] << 16) | ((uint32_t)opcode[2] << 8) | opcode[3];
+            page_address = (address >> READ_OFFSET_SHT_AMT) % PAGE_COUNT;
+            byte_address = (address & ((1 << READ_OFFSET_SHT_AMT) - 1)) % BYTES_PER_PAGE;
+            if (opcode[0] == FLASH_OPCODE_LOWF_READ)
+            {
+                stats.reads++;
+            }
+            else if ((opcode[0] == FLASH_OPCODE_BUF_WRITE) || (opcode[0] == FLASH_OPCODE_BUF2_WRITE) || (opcode[0] == FLASH_OPCODE_MMP_PROG_TBUF))
+            {
+                stats.buffer_writes++;
+            }
+            else if ((opcode[0] != FLASH_OPCODE_MAINP_TO_BUF) && (opcode[0] != FLASH_OPCODE_BUF_TO_PAGE) &&
+                     (opcode[0] != FLASH_OPCODE_BUF2_TO_PAGE) && (opcode[0] != FLASH_OPCODE_PAGE_ERASE) && (opcode[0] != FLASH_OPCODE_BLOCK_ERASE) &&
+                     (opcode[0] != FLASH_OPCODE_SECTOR_ERASE) && (opcode[0] != AT45DB_OPCODE_CHIP_ERASE))
+            {
+                at45dbViolation("unsupported opcode");
+            }
+        }
+        return 0xFF;
+    }
+    
+    // Data bytes
+    switch (opcode[0])
+    {
+        case FLASH_OPCODE_READ_STAT_REG:
+        {
+            uint8_t status = AT45DB_STATUS_DENSITY;
+            
+            if (hostTimeGet() < busy_until)
+            {
+                // Skip the polling loop
+                stats.busy_wait_time += busy_until - hostTimeGet();
+                hostTimeAdvance(busy_until - hostTimeGet());
+            }
+            else
+            {
+                status |= AT45DB_STATUS_READY;
+            }
+            return status;
+        }
+        case FLASH_OPCODE_READ_DEV_INFO:
+        {
+            const uint8_t device_id[] = {FLASH_MANUF_ID, MAN_FAM_DEN_VAL, 0x01, 0x00};
+            return (byte_address < sizeof(device_id))? device_id[byte_address++] : 0x00;
+        }
+        case FLASH_OPCODE_LOWF_READ:
+        {
+            // Continuous read: wraps to the next page, then to the start of the memory
+            uint8_t value = flash_image[(uint32_t)page_address * BYTES_PER_PAGE + byte_address];
+            stats.read_bytes++;
+            if (++byte_address == BYTES_PER_PAGE)
+            {
+                byte_address = 0;
+                page_address = (page_address + 1) % PAGE_COUNT;
+            }
+            return value;
+        }
+        case FLASH_OPCODE_BUF_WRITE:
+        case FLASH_OPCODE_BUF2_WRITE:
+        case FLASH_OPCODE_MMP_PROG_TBUF:
+        {
+            // Buffer writes wrap within the buffer
+            flash_buffers[(opcode[0] == FLASH_OPCODE_BUF2_WRITE)? 1 : 0][byte_address] = data;
+            stats.buffer_write_bytes++;
+            byte_address = (byte_address + 1) % BYTES_PER_PAGE;
+            return 0xFF;
+        }
+        default: return 0xFF;
+    }
+}
+
+/*! \fn     at45dbOpen(const char* image_path)
+*   \brief  Map the flash image file, created blank if it doesn't exist
+*   \param  image_path  Path to the image, NULL for a blank image kept in memory
+*   \return 0 on success
+*/
+int at45dbOpen(const char* image_path)
+{
+    int fd = -1;
+    struct stat image_stat;
+    uint8_t blank = TRUE;
+    
+    // The model relies on the flash chip select being on port B
+    if (&PORT_FLASH_nS != &host_PORTB)
+    {
+        fprintf(stderr, "at45db: flash chip select isn't on port B\n");
+        return -1;
+    }
+    
+    if (image_path != NULL)
+    {
+        fd = open(image_path, O_RDWR | O_CREAT, 0644);
+        if ((fd < 0) || (fstat(fd, &image_stat) != 0))
+        {
+            perror(image_path);
+            return -1;
+        }
+        if (image_stat.st_size == (off_t)FLASH_SIZE)
+        {
+            blank = FALSE;
+        }
+        else if ((image_stat.st_size != 0) || (ftruncate(fd, FLASH_SIZE) != 0))
+        {
+            fprintf(stderr, "%s: not a %lu bytes flash image\n", image_path, (unsigned long)FLASH_SIZE);
+            close(fd);
+            return -1;
+        }
+        flash_image = mmap(NULL, FLASH_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+    }
+    else
+    {
+        flash_image = mmap(NULL, FLASH_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
+    if (flash_image == MAP_FAILED)
+    {
+        perror("at45db: mmap");
+        return -1;
+    }
+    if (blank == TRUE)
+    {
+        memset(flash_image, 0xFF, FLASH_SIZE);
+    }
+    
+    // Chip select high, device idle
+    host_PORTB |= (1 << PORTID_FLASH_nS);
+    chip_selected = FALSE;
+    busy_until = 0;
+    busy_buffer = 0;
+    busy_programming = FALSE;
+    power_cut_transaction = 0;
+    memset(flash_buffers, 0xFF, sizeof(flash_buffers));
+    memset(&stats, 0, sizeof(stats));
+    return 0;
+}
+
+/*! \fn     at45dbClose(void)
+*   \brief  Complete the last transaction and unmap the image
+*/
+void at45dbClose(void)
+{
+    if (flash_image != MAP_FAILED)
+    {
+        at45dbSyncChipSelect();
+        munmap(flash_image, FLASH_SIZE);
+        flash_image = MAP_FAILED;
+    }
+}
+
+/*! \fn     at45dbGetImage(void)
+*   \brief  Direct access to the flash contents, to prepare or check them
+*   \return Pointer to FLASH_SIZE bytes
+*/
+uint8_t* at45dbGetImage(void)
+{
+    return flash_image;
+}
+
+/*! \fn     at45dbLoadBundle(const char* bundle_path)
+*   \brief  Store a media bundle in the graphics zone
+*   \param  bundle_path Bundle file, as generated for CMD_IMPORT_MEDIA
+*   \return Bundle size, -1 on error
+*/
+long at45dbLoadBundle(const char* bundle_path)
+{
+    FILE* bundle = fopen(bundle_path, "rb");
+    size_t bundle_size;
+    
+    if (bundle == NULL)
+    {
+        perror(bundle_path);
+        return -1;
+    }
+    bundle_size = fread(flash_image + GRAPHIC_ZONE_START, 1, GRAPHIC_ZONE_END - GRAPHIC_ZONE_START, bundle);
+    if (fgetc(bundle) != EOF)
+    {
+        fprintf(stderr, "%s doesn't fit in the %lu bytes graphics zone\n", bundle_path, (unsigned long)(GRAPHIC_ZONE_END - GRAPHIC_ZONE_START));
+        fclose(bundle);
+        return -1;
+    }
+    fclose(bundle);
+    return (long)bundle_size;
+}
+
+/*! \fn     at45dbGetStats(void)
+*   \brief  Get the operation counters
+*   \return Pointer to the counters
+*/
+const at45dbStats_t* at45dbGetStats(void)
+{
+    return &stats;
+}
+
+/*! \fn     at45dbResetStats(void)
+*   \brief  Clear the operation counters
+*/
+void at45dbResetStats(void)
+{
+    memset(&stats, 0, sizeof(stats));
+}
+
+/*! \fn     at45dbSetPowerCut(uint32_t transaction, uint8_t tear, void (*callback)(void))
+*   \brief  Schedule a power cut at the end of a transaction
+*   \param  transaction Transaction number, counted from the last stats reset, 0 to cancel
+*   \param  tear        TRUE to tear a page program started by that transaction, FALSE to let it complete
+*   \param  callback    Called once the power is cut, shouldn't return to the firmware (longjmp)
+*/
+void at45dbSetPowerCut(uint32_t transaction, uint8_t tear, void (*callback)(void))
+{
+    power_cut_transaction = transaction;
+    power_cut_tear = tear;
+    power_cut_callback = callback;
+}
@@ -0,0 +1,58 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     at45db_model.h
+*    \brief    AT45DB flash model for the host builds, connected to the host SPI functions
+*    Created:  19/10/2026
+*/
+#ifndef AT45DB_MODEL_H_
+#define AT45DB_MODEL_H_
+
+#include <stdint.h>
+
+/* Operation counters, times in simulated ns */
+typedef struct
+{
+    uint64_t spi_bytes;
+    uint64_t read_bytes;
+    uint64_t buffer_write_bytes;
+    uint32_t transactions;
+    uint32_t reads;
+    uint32_t buffer_writes;
+    uint32_t page_to_buffer;
+    uint32_t page_programs;
+    uint32_t page_erases;
+    uint32_t block_erases;
+    uint32_t sector_erases;
+    uint32_t chip_erases;
+    uint64_t busy_wait_time;
+    uint32_t violations;
+    uint32_t torn_pages;
+} at45dbStats_t;
+
+int at45dbOpen(const char* image_path);
+void at45dbClose(void);
+uint8_t at45dbTransfer(uint8_t data);
+uint8_t* at45dbGetImage(void);
+long at45dbLoadBundle(const char* bundle_path);
+const at45dbStats_t* at45dbGetStats(void);
+void at45dbResetStats(void);
+void at45dbSetPowerCut(uint32_t transaction, uint8_t tear, void (*callback)(void));
+
+#endif /* AT45DB_MODEL_H_ */
@@ -0,0 +1,370 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     crypto_bench.c
+*    \brief    Host build of the AES/CTR modules: test vector checks and throughput figures
+*    Created:  19/10/2026
+*
+*    Usage:
+*      crypto_bench test <vectors dir>
+*          Run the NESSIE and NIST CTR vectors through aes.c / aes256_ctr.c and diff
+*          the output against aes256_nessie_test.txt and aes256_ctr_vectors.txt
+*      crypto_bench bench [--save FILE] [--baseline FILE] [--tolerance PERCENT]
+*          Print one JSON object per line for each benchmark. When a baseline file
+*          (saved with --save) is given, benchmarks slower than the baseline by
+*          more than the tolerance make the program fail
+*/
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include "aes.h"
+#include "aes256_ctr.h"
+#include "aes256_ctr_test.h"
+#include "aes256_nessie_test.h"
+#include "host_baseline.h"
+
+// Same sizes as in the firmware logic
+#define CREDENTIAL_BLOCK_SIZE   32
+#define DATA_NODE_SIZE          128
+#define USER_CTR_SIZE           3
+// Minimum time spent measuring each benchmark
+#define BENCH_MIN_TIME_NS       200000000ULL
+// Default allowed slowdown against a baseline, in percent
+#define BENCH_DEF_TOLERANCE     15
+
+// Buffer capturing the test functions output
+static char* capture_buffer;
+static size_t capture_length;
+static size_t capture_size;
+
+// Benchmark key & nonce, values don't matter
+static uint8_t bench_key[32];
+static uint8_t bench_nonce[AES256_CTR_LENGTH];
+// Prevents the compiler from optimizing the benchmarked work away
+static volatile uint8_t bench_sink;
+// Benchmark results, compared against a baseline saved with --save
+static const hostBaselineColumn_t bench_columns[1] = {{"ns per op", 1, 0}};
+static hostBaseline_t baseline;
+
+
+/*! \fn     captureChar(uint8_t c)
+*   \brief  Output function given to the test modules, appends a char to the capture buffer
+*   \param  c   The char
+*   \return 0
+*/
+static int8_t captureChar(uint8_t c)
+{
+    if (capture_length == capture_size)
+    {
+        capture_size = (capture_size == 0) ? 4096 : capture_size * 2;
+        capture_buffer = realloc(capture_buffer, capture_size);
+        if (capture_buffer == NULL)
+        {
+            fprintf(stderr, "out of memory\n");
+            exit(2);
+        }
+    }
+    capture_buffer[capture_length++] = (char)c;
+    return 0;
+}
+
+/*! \fn     normalizeText(char* text, size_t length)
+*   \brief  Remove carriage returns, trailing whitespace on each line and trailing empty lines, in place
+*   \param  text    The text
+*   \param  length  Its length
+*   \return The new length
+*/
+static size_t normalizeText(char* text, size_t length)
+{
+    size_t out = 0;
+
+    for (size_t i = 0; i < length; i++)
+    {
+        if (text[i] == '\r')
+        {
+            continue;
+        }
+        if (text[i] == '\n')
+        {
+            while ((out > 0) && ((text[out-1] == ' ') || (text[out-1] == '\t')))
+            {
+                out--;
+            }
+        }
+        text[out++] = text[i];
+    }
+    while ((out > 0) && ((text[out-1] == '\n') || (text[out-1] == ' ') || (text[out-1] == '\t')))
+    {
+        out--;
+    }
+    return out;
+}
+
+/*! \fn     compareWithReference(const char* dir, const char* file_name)
+*   \brief  Compare the capture buffer with a reference file
+*   \param  dir         Directory containing the reference file
+*   \param  file_name   Name of the reference file
+*   \return 0 if they match
+*/
+static int compareWithReference(const char* dir, const char* file_name)
+{
+    char path[4096];
+    size_t ref_length, out_length, line = 1;
+    char* reference;
+    FILE* file;
+    long file_size;
+
+    snprintf(path, sizeof(path), "%s/%s", dir, file_name);
+    file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        fprintf(stderr, "%s: cannot open\n", path);
+        return 1;
+    }
+    fseek(file, 0, SEEK_END);
+    file_size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    reference = malloc((size_t)file_size + 1);
+    if ((reference == NULL) || (fread(reference, 1, (size_t)file_size, file) != (size_t)file_size))
+    {
+        fprintf(stderr, "%s: cannot read\n", path);
+        fclose(file);
+        free(reference);
+        return 1;
+    }
+    fclose(file);
+
+    ref_length = normalizeText(reference, (size_t)file_size);
+    out_length = normalizeText(capture_buffer, capture_length);
+
+    for (size_t i = 0; (i < ref_length) && (i < out_length); i++)
+    {
+        if (reference[i] != capture_buffer[i])
+        {
+            fprintf(stderr, "%s: mismatch at line %zu\n", path, line);
+            free(reference);
+            return 1;
+        }
+        if (reference[i] == '\n')
+        {
+            line++;
+        }
+    }
+    free(reference);
+    if (ref_length != out_length)
+    {
+        fprintf(stderr, "%s: length mismatch (%zu bytes output, %zu expected)\n", path, out_length, ref_length);
+        return 1;
+    }
+    printf("%s: OK\n", file_name);
+    return 0;
+}
+
+/*! \fn     runTestVectors(const char* dir)
+*   \brief  Run the NESSIE and CTR test vectors
+*   \param  dir     Directory containing the reference outputs
+*   \return 0 if all tests passed
+*/
+static int runTestVectors(const char* dir)
+{
+    int nb_failures = 0;
+
+    capture_length = 0;
+    nessieOutput = captureChar;
+    for (uint8_t i = 1; i <= 8; i++)
+    {
+        nessieTest(i);
+    }
+    nb_failures += compareWithReference(dir, "aes256_nessie_test.txt");
+
+    capture_length = 0;
+    ctrTestOutput = captureChar;
+    aes256CtrTest();
+    nb_failures += compareWithReference(dir, "aes256_ctr_vectors.txt");
+
+    return nb_failures;
+}
+
+/*! \fn     getTimeNs(void)
+*   \brief  Get a monotonic timestamp
+*   \return Timestamp in ns
+*/
+static unsigned long long getTimeNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+}
+
+/*! \fn     benchEcbEncrypt(uint32_t nb_loops)
+*   \brief  Encrypt a single 16B block
+*/
+static void benchEcbEncrypt(uint32_t nb_loops)
+{
+    uint8_t block[16] = {0};
+    aes256_context ctx;
+
+    aes256_init_ecb(&ctx, bench_key);
+    for (uint32_t i = 0; i < nb_loops; i++)
+    {
+        aes256_encrypt_ecb(&ctx, block);
+    }
+    bench_sink = block[0];
+}
+
+/*! \fn     benchEcbDecrypt(uint32_t nb_loops)
+*   \brief  Decrypt a single 16B block
+*/
+static void benchEcbDecrypt(uint32_t nb_loops)
+{
+    uint8_t block[16] = {0};
+    aes256_context ctx;
+
+    aes256_init_ecb(&ctx, bench_key);
+    for (uint32_t i = 0; i < nb_loops; i++)
+    {
+        aes256_decrypt_ecb(&ctx, block);
+    }
+    bench_sink = block[0];
+}
+
+/*! \fn     benchCtrBlocks(uint32_t nb_loops, uint8_t nb_bytes)
+*   \brief  Encrypt nb_bytes the way the firmware does: a new IV (nonce xor ctr) for each 32B block
+*/
+static void benchCtrBlocks(uint32_t nb_loops, uint8_t nb_bytes)
+{
+    uint8_t data[DATA_NODE_SIZE] = {0};
+    uint8_t iv[AES256_CTR_LENGTH];
+    uint8_t ctr[USER_CTR_SIZE] = {0};
+    aes256CtrCtx_t ctx;
+
+    aes256CtrInit(&ctx, bench_key, bench_nonce, AES256_CTR_LENGTH);
+    for (uint32_t i = 0; i < nb_loops; i++)
+    {
+        for (uint8_t j = 0; j < nb_bytes; j += CREDENTIAL_BLOCK_SIZE)
+        {
+            memcpy(iv, bench_nonce, AES256_CTR_LENGTH);
+            aesXorVectors(iv + (AES256_CTR_LENGTH-USER_CTR_SIZE), ctr, USER_CTR_SIZE);
+            aes256CtrSetIv(&ctx, iv, AES256_CTR_LENGTH);
+            aes256CtrEncrypt(&ctx, &data[j], CREDENTIAL_BLOCK_SIZE);
+            aesIncrementCtr(ctr, USER_CTR_SIZE);
+            aesIncrementCtr(ctr, USER_CTR_SIZE);
+        }
+    }
+    aes256CtrClean(&ctx);
+    bench_sink = data[0];
+}
+
+static void benchCtrCredential(uint32_t nb_loops)
+{
+    benchCtrBlocks(nb_loops, CREDENTIAL_BLOCK_SIZE);
+}
+
+static void benchCtrDataNode(uint32_t nb_loops)
+{
+    benchCtrBlocks(nb_loops, DATA_NODE_SIZE);
+}
+
+/*! \fn     runBenchmarks(void)
+*   \brief  Run all the benchmarks, output the results as JSON lines and add them to the baseline rows
+*/
+static void runBenchmarks(void)
+{
+    static const struct
+    {
+        const char* name;
+        uint16_t bytes;
+        void (*function)(uint32_t nb_loops);
+    } benchmarks[] =
+    {
+        {"aes256_ecb_encrypt", 16, benchEcbEncrypt},
+        {"aes256_ecb_decrypt", 16, benchEcbDecrypt},
+        {"aes256_ctr_credential_32b", CREDENTIAL_BLOCK_SIZE, benchCtrCredential},
+        {"aes256_ctr_data_node_128b", DATA_NODE_SIZE, benchCtrDataNode},
+    };
+
+    for (uint8_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++)
+    {
+        unsigned long long elapsed;
+        double ns_per_op;
+        uint32_t nb_loops = 16;
+
+        // Double the number of loops until the run is long enough to be measured
+        while (1)
+        {
+            unsigned long long start = getTimeNs();
+            benchmarks[i].function(nb_loops);
+            elapsed = getTimeNs() - start;
+            if ((elapsed >= BENCH_MIN_TIME_NS) || (nb_loops >= 0x80000000UL))
+            {
+                break;
+            }
+            nb_loops *= 2;
+        }
+
+        ns_per_op = (double)elapsed / nb_loops;
+        printf("{\"bench\":\"%s\",\"bytes\":%u,\"iterations\":%lu,\"ns_per_op\":%.1f,\"mb_per_s\":%.3f}\n",
+               benchmarks[i].name, benchmarks[i].bytes, (unsigned long)nb_loops, ns_per_op, benchmarks[i].bytes * 1000.0 / ns_per_op);
+        hostBaselineAddRow(&baseline, &ns_per_op, "%s", benchmarks[i].name);
+    }
+}
+
+static int printUsage(const char* name)
+{
+    char usage[256];
+
+    snprintf(usage, sizeof(usage), "%s test <vectors dir>\n       %s bench [--save FILE] [--baseline FILE] [--tolerance PERCENT]", name, name);
+    return hostBaselineUsage(&baseline, usage, NULL);
+}
+
+int main(int argc, char* argv[])
+{
+    hostBaselineInit(&baseline, bench_columns, 1, 0, BENCH_DEF_TOLERANCE);
+    if ((argc == 3) && (strcmp(argv[1], "test") == 0))
+    {
+        return runTestVectors(argv[2]) ? 1 : 0;
+    }
+    else if ((argc >= 2) && (strcmp(argv[1], "bench") == 0))
+    {
+        int nb_regressions;
+
+        for (int i = 2; i < argc; i++)
+        {
+            if ((i + 1 < argc) && (hostBaselineParseOption(&baseline, argv[i], argv[i + 1]) != 0))
+            {
+                i++;
+            }
+            else
+            {
+                return printUsage(argv[0]);
+            }
+        }
+        runBenchmarks();
+        nb_regressions = hostBaselineFinish(&baseline);
+        if (nb_regressions < 0)
+        {
+            return 2;
+        }
+        return (nb_regressions == 0) ? 0 : 1;
+    }
+
+    return printUsage(argv[0]);
+}
@@ -0,0 +1,181 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     flash_model_test.c
+*    \brief    Runs the firmware flash tests against the AT45DB model
+*    Created:  19/10/2026
+*/
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include "at45db_model.h"
+#include "host_test.h"
+#include "host_time.h"
+#include "flash_test.h"
+#include "flash_mem.h"
+#include "defines.h"
+
+// Number of pages written with the two internal buffers
+#define PIPELINE_TEST_PAGES     32
+
+// Test buffers, one flash page each
+static uint8_t buffer_in[BYTES_PER_PAGE];
+static uint8_t buffer_out[BYTES_PER_PAGE];
+static uint8_t nb_failures = 0;
+
+
+/*! \fn     printResult(const char* name, RET_TYPE ret)
+*   \brief  Print a test result
+*   \param  name    Test name
+*   \param  ret     Test return value
+*/
+static void printResult(const char* name, RET_TYPE ret)
+{
+    const at45dbStats_t* stats = at45dbGetStats();
+    
+    printf("%-24s %-6s %8.1fms simulated, %u violations\n", name, (ret == RETURN_OK)? "ok" : "FAILED", hostTimeGet() / 1e6, stats->violations);
+    if ((ret != RETURN_OK) || (stats->violations != 0))
+    {
+        nb_failures++;
+    }
+}
+
+/*! \fn     pipelinedWriteTest(void)
+*   \brief  Write pages alternating between the two internal buffers, each buffer being filled while the other one is programmed
+*   \return Test status
+*/
+static RET_TYPE pipelinedWriteTest(void)
+{
+    uint16_t page;
+    
+    for (page = 0; page < PIPELINE_TEST_PAGES; page++)
+    {
+        memset(buffer_in, (uint8_t)page, sizeof(buffer_in));
+        flashWriteBufferNb((page & 0x01) + 1, buffer_in, 0, sizeof(buffer_in));
+        flashStartBufferToPage((page & 0x01) + 1, page);
+    }
+    for (page = 0; page < PIPELINE_TEST_PAGES; page++)
+    {
+        memset(buffer_out, (uint8_t)page, sizeof(buffer_out));
+        readDataFromFlash(page, 0, sizeof(buffer_in), buffer_in);
+        if (memcmp(buffer_in, buffer_out, sizeof(buffer_in)) != 0)
+        {
+            return RETURN_NO_MATCH;
+        }
+    }
+    return RETURN_OK;
+}
+
+/*! \fn     persistenceTest(const char* image_path)
+*   \brief  Check the image file keeps the flash contents across model instances
+*   \param  image_path  Image file path
+*   \return Test status
+*/
+static RET_TYPE persistenceTest(const char* image_path)
+{
+    RET_TYPE ret;
+    
+    initBuffer(buffer_out, sizeof(buffer_out), FLASH_TEST_INIT_BUFFER_POLICY_RND);
+    memcpy(buffer_in, buffer_out, sizeof(buffer_in));
+    writeDataToFlash(PAGE_COUNT - 1, 0, sizeof(buffer_in), buffer_in);
+    at45dbClose();
+    if (at45dbOpen(image_path) != 0)
+    {
+        return RETURN_NOK;
+    }
+    ret = flashInitTest();
+    if (ret != RETURN_OK)
+    {
+        return ret;
+    }
+    readDataFromFlash(PAGE_COUNT - 1, 0, sizeof(buffer_in), buffer_in);
+    return (memcmp(buffer_in, buffer_out, sizeof(buffer_in)) == 0)? RETURN_OK : RETURN_NO_MATCH;
+}
+
+/*! \fn     printStats(void)
+*   \brief  Print the flash access statistics
+*/
+static void printStats(void)
+{
+    const at45dbStats_t* stats = at45dbGetStats();
+    
+    printf("\nSPI bytes: %llu, read bytes: %llu (%u reads), buffer write bytes: %llu (%u writes)\n", (unsigned long long)stats->spi_bytes, (unsigned long long)stats->read_bytes, stats->reads, (unsigned long long)stats->buffer_write_bytes, stats->buffer_writes);
+    printf("Page to buffer: %u, page programs: %u, erases: %u pages / %u blocks / %u sectors / %u chips\n", stats->page_to_buffer, stats->page_programs, stats->page_erases, stats->block_erases, stats->sector_erases, stats->chip_erases);
+    printf("Simulated time: %.1fms, spent waiting for the flash: %.1fms\n", hostTimeGet() / 1e6, stats->busy_wait_time / 1e6);
+}
+
+/*! \fn     driverStatsTest(void)
+*   \brief  Check the flash driver activity counters against the model
+*   \return Test status
+*/
+static RET_TYPE driverStatsTest(void)
+{
+    const at45dbStats_t* stats = at45dbGetStats();
+    flashStats_t* driver_stats = flashStatsGet();
+    
+    if ((driver_stats->spi_bytes != (uint32_t)stats->spi_bytes) || (driver_stats->page_loads != stats->page_to_buffer) || (driver_stats->page_programs != stats->page_programs))
+    {
+        return RETURN_NOK;
+    }
+    if (driver_stats->erases != stats->page_erases + stats->block_erases + stats->sector_erases + stats->chip_erases)
+    {
+        return RETURN_NOK;
+    }
+    return RETURN_OK;
+}
+
+int main(int argc, char* argv[])
+{
+    char image_path[] = "/tmp/at45db_XXXXXX";
+    int fd;
+    
+    (void)argv;
+    if (argc != 1)
+    {
+        fprintf(stderr, "usage: flash_model_test\n");
+        return 2;
+    }
+    
+    // Fresh image file, removed at the end
+    fd = mkstemp(image_path);
+    if ((fd < 0) || (close(fd) != 0) || (unlink(image_path) != 0) || (at45dbOpen(image_path) != 0))
+    {
+        fprintf(stderr, "couldn't create the flash image\n");
+        return 2;
+    }
+    printf("Flash model: %u pages of %u bytes\n\n", PAGE_COUNT, BYTES_PER_PAGE);
+    
+    printResult("flashInitTest", flashInitTest());
+    printResult("flashWriteReadTest", flashWriteReadTest(buffer_in, buffer_out, sizeof(buffer_in)));
+    printResult("flashWriteReadOffsetTest", flashWriteReadOffsetTest(buffer_in, buffer_out, sizeof(buffer_in)));
+    printResult("flashErasePageTest", flashErasePageTest(buffer_in, buffer_out, sizeof(buffer_in)));
+    printResult("flashEraseBlockTest", flashEraseBlockTest(buffer_in, buffer_out, sizeof(buffer_in)));
+    printResult("flashEraseSectorXTest", flashEraseSectorXTest(buffer_in, buffer_out, sizeof(buffer_in)));
+    printResult("flashEraseSectorZeroTest", flashEraseSectorZeroTest(buffer_in, buffer_out, sizeof(buffer_in)));
+    printResult("pipelinedWriteTest", pipelinedWriteTest());
+    printStats();
+    printResult("driverStatsTest", driverStatsTest());
+    printResult("persistenceTest", persistenceTest(image_path));
+    
+    at45dbClose();
+    unlink(image_path);
+    printf("\n%s\n", (nb_failures == 0)? "All tests passed" : "Some tests FAILED");
+    return (nb_failures == 0)? 0 : 1;
+}
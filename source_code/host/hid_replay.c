@@ -0,0 +1,480 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     hid_replay.c
+*    \brief    Replay of recorded HID sessions against the firmware command parser
+*    Created:  19/10/2026
+*/
+/*
+ * The requests of a session recorded by virtual_device.c --record or by
+ * mooltipass_coms.py (MOOLTIPASS_RECORD) are fed one by one to the firmware
+ * command parser, as fast as possible. Each request is timed with the
+ * simulated clock (flash and delays at their datasheet / firmware durations,
+ * see host_time.c) and the host clock, the answers are compared with the
+ * recorded ones, and the recorded latency (request to first answer) is kept
+ * next to the replayed service time. Per command results can be saved and
+ * compared against a baseline to judge a firmware change on a real workload.
+ */
+#include <avr/eeprom.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include "at45db_model.h"
+#include "hid_session.h"
+#include "host_baseline.h"
+#include "host_eeprom.h"
+#include "host_test.h"
+#include "host_time.h"
+#include "host_png.h"
+// Firmware structures are packed, see the Makefile
+#pragma pack(push, 1)
+#include "usb_cmd_parser.h"
+#include "host_firmware.h"
+#include "flash_mem.h"
+#include "defines.h"
+#pragma pack(pop)
+
+// Tolerated increase over the baseline, in percent
+#define REPLAY_DEFAULT_TOLERANCE    2.0
+#define REPLAY_NB_COMMANDS          256
+#define REPLAY_MAX_VERBOSE_LINES    1000
+
+typedef struct
+{
+    uint32_t count;
+    uint64_t time;              // Simulated service time in ns
+    uint64_t max_time;
+    uint64_t host_time;         // Host service time in ns
+    uint64_t spi_bytes;
+    uint64_t recorded_time;     // Recorded latency in us, for the requests that got an answer
+    uint32_t recorded_count;
+    uint32_t differing;         // Requests whose answers differ from the recording
+} replayCmdStats_t;
+
+typedef struct
+{
+    uint8_t cmd;
+    uint64_t time_us;           // Recording time of the request
+    uint64_t first_answer_us;   // Recording time of its first answer, 0 if none
+    uint32_t recorded_answers;
+    uint32_t recorded_crc;
+    uint32_t replayed_answers;
+    uint32_t replayed_crc;
+} replayRequest_t;
+
+typedef struct
+{
+    uint8_t cmd;
+    const char* name;
+} replayCmdName_t;
+
+#define REPLAY_CMD_NAME(cmd)    {cmd, #cmd}
+static const replayCmdName_t cmd_names[] =
+{
+    REPLAY_CMD_NAME(CMD_EXPORT_FLASH_START), REPLAY_CMD_NAME(CMD_EXPORT_FLASH), REPLAY_CMD_NAME(CMD_EXPORT_FLASH_END), REPLAY_CMD_NAME(CMD_IMPORT_FLASH_BEGIN),
+    REPLAY_CMD_NAME(CMD_IMPORT_FLASH), REPLAY_CMD_NAME(CMD_IMPORT_FLASH_END), REPLAY_CMD_NAME(CMD_EXPORT_EEPROM_START), REPLAY_CMD_NAME(CMD_EXPORT_EEPROM),
+    REPLAY_CMD_NAME(CMD_EXPORT_EEPROM_END), REPLAY_CMD_NAME(CMD_IMPORT_EEPROM_BEGIN), REPLAY_CMD_NAME(CMD_IMPORT_EEPROM), REPLAY_CMD_NAME(CMD_IMPORT_EEPROM_END),
+    REPLAY_CMD_NAME(CMD_ERASE_EEPROM), REPLAY_CMD_NAME(CMD_ERASE_FLASH), REPLAY_CMD_NAME(CMD_ERASE_SMC), REPLAY_CMD_NAME(CMD_DRAW_BITMAP),
+    REPLAY_CMD_NAME(CMD_SET_FONT), REPLAY_CMD_NAME(CMD_USB_KEYBOARD_PRESS), REPLAY_CMD_NAME(CMD_STACK_FREE), REPLAY_CMD_NAME(CMD_CLONE_SMARTCARD),
+    REPLAY_CMD_NAME(CMD_MINI_FRAME_BUF_DATA), REPLAY_CMD_NAME(CMD_DEBUG), REPLAY_CMD_NAME(CMD_PING), REPLAY_CMD_NAME(CMD_VERSION),
+    REPLAY_CMD_NAME(CMD_CONTEXT), REPLAY_CMD_NAME(CMD_GET_LOGIN), REPLAY_CMD_NAME(CMD_GET_PASSWORD), REPLAY_CMD_NAME(CMD_SET_LOGIN),
+    REPLAY_CMD_NAME(CMD_SET_PASSWORD), REPLAY_CMD_NAME(CMD_CHECK_PASSWORD), REPLAY_CMD_NAME(CMD_ADD_CONTEXT), REPLAY_CMD_NAME(CMD_SET_BOOTLOADER_PWD),
+    REPLAY_CMD_NAME(CMD_JUMP_TO_BOOTLOADER), REPLAY_CMD_NAME(CMD_GET_RANDOM_NUMBER), REPLAY_CMD_NAME(CMD_START_MEMORYMGMT), REPLAY_CMD_NAME(CMD_IMPORT_MEDIA_START),
+    REPLAY_CMD_NAME(CMD_IMPORT_MEDIA), REPLAY_CMD_NAME(CMD_IMPORT_MEDIA_END), REPLAY_CMD_NAME(CMD_SET_MOOLTIPASS_PARM), REPLAY_CMD_NAME(CMD_GET_MOOLTIPASS_PARM),
+    REPLAY_CMD_NAME(CMD_RESET_CARD), REPLAY_CMD_NAME(CMD_READ_CARD_LOGIN), REPLAY_CMD_NAME(CMD_READ_CARD_PASS), REPLAY_CMD_NAME(CMD_SET_CARD_LOGIN),
+    REPLAY_CMD_NAME(CMD_SET_CARD_PASS), REPLAY_CMD_NAME(CMD_ADD_UNKNOWN_CARD), REPLAY_CMD_NAME(CMD_MOOLTIPASS_STATUS), REPLAY_CMD_NAME(CMD_FUNCTIONAL_TEST_RES),
+    REPLAY_CMD_NAME(CMD_SET_DATE), REPLAY_CMD_NAME(CMD_SET_UID), REPLAY_CMD_NAME(CMD_GET_UID), REPLAY_CMD_NAME(CMD_SET_DATA_SERVICE),
+    REPLAY_CMD_NAME(CMD_ADD_DATA_SERVICE), REPLAY_CMD_NAME(CMD_WRITE_32B_IN_DN), REPLAY_CMD_NAME(CMD_READ_32B_IN_DN), REPLAY_CMD_NAME(CMD_GET_CUR_CARD_CPZ),
+    REPLAY_CMD_NAME(CMD_CANCEL_REQUEST), REPLAY_CMD_NAME(CMD_PLEASE_RETRY), REPLAY_CMD_NAME(CMD_READ_FLASH_NODE), REPLAY_CMD_NAME(CMD_WRITE_FLASH_NODE),
+    REPLAY_CMD_NAME(CMD_GET_FAVORITE), REPLAY_CMD_NAME(CMD_SET_FAVORITE), REPLAY_CMD_NAME(CMD_GET_STARTING_PARENT), REPLAY_CMD_NAME(CMD_SET_STARTING_PARENT),
+    REPLAY_CMD_NAME(CMD_GET_CTRVALUE), REPLAY_CMD_NAME(CMD_SET_CTRVALUE), REPLAY_CMD_NAME(CMD_ADD_CARD_CPZ_CTR), REPLAY_CMD_NAME(CMD_GET_CARD_CPZ_CTR),
+    REPLAY_CMD_NAME(CMD_CARD_CPZ_CTR_PACKET), REPLAY_CMD_NAME(CMD_GET_FREE_SLOTS_ADDR), REPLAY_CMD_NAME(CMD_GET_DN_START_PARENT), REPLAY_CMD_NAME(CMD_SET_DN_START_PARENT),
+    REPLAY_CMD_NAME(CMD_END_MEMORYMGMT), REPLAY_CMD_NAME(CMD_GET_DESCRIPTION), REPLAY_CMD_NAME(CMD_UNLOCK_WITH_PIN), REPLAY_CMD_NAME(CMD_READ_NODE_IN_DN),
+    REPLAY_CMD_NAME(CMD_CHECK_PASSWORD_BATCH), REPLAY_CMD_NAME(CMD_READ_FLASH_NODES), REPLAY_CMD_NAME(CMD_WRITE_FLASH_NODES), REPLAY_CMD_NAME(CMD_GET_CREDENTIAL),
+    REPLAY_CMD_NAME(CMD_STATUS_EVENTS), REPLAY_CMD_NAME(CMD_STATUS_EVENT), REPLAY_CMD_NAME(CMD_EXPORT_STREAM_START), REPLAY_CMD_NAME(CMD_EXPORT_STREAM_DATA),
+    REPLAY_CMD_NAME(CMD_EXPORT_STREAM_END), REPLAY_CMD_NAME(CMD_IMPORT_MEDIA_STREAM), REPLAY_CMD_NAME(CMD_IMPORT_MEDIA_STREAM_END), REPLAY_CMD_NAME(CMD_GET_MEDIA_PAGE_HASH),
+    REPLAY_CMD_NAME(CMD_IMPORT_MEDIA_PAGE), REPLAY_CMD_NAME(CMD_GET_LATENCY_STATS), REPLAY_CMD_NAME(CMD_GET_FLASH_STATS), REPLAY_CMD_NAME(CMD_GET_MEDIA_ZONE_CRC)
+};
+
+static replayCmdStats_t cmd_stats[REPLAY_NB_COMMANDS];
+// Request being replayed, its answers are accumulated until the next one
+static replayRequest_t request;
+static uint8_t request_pending = FALSE;
+static uint8_t verbose = FALSE;
+// Per command service time and flash traffic
+static const hostBaselineColumn_t replay_columns[2] = {{"mean time", 1, FALSE}, {"SPI bytes", 1, FALSE}};
+static hostBaseline_t baseline;
+
+
+/*! \fn     cmdName(uint8_t cmd)
+*   \brief  Get the name of a command
+*   \param  cmd     Command ID
+*   \return Its name, NULL if unknown
+*/
+static const char* cmdName(uint8_t cmd)
+{
+    for (uint8_t i = 0; i < sizeof(cmd_names) / sizeof(cmd_names[0]); i++)
+    {
+        if (cmd_names[i].cmd == cmd)
+        {
+            return cmd_names[i].name;
+        }
+    }
+    return NULL;
+}
+
+/*! \fn     hostTimeNs(void)
+*   \brief  Host monotonic clock
+*   \return Time in ns
+*/
+static uint64_t hostTimeNs(void)
+{
+    struct timespec ts;
+    
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*! \fn     answerCrc(uint32_t crc, const uint8_t* packet, uint8_t length)
+*   \brief  Accumulate an answer, zero padded to the report size
+*   \param  crc     Current CRC
+*   \param  packet  The answer
+*   \param  length  Its length
+*   \return Updated CRC
+*/
+static uint32_t answerCrc(uint32_t crc, const uint8_t* packet, uint8_t length)
+{
+    uint8_t report[HID_SESSION_REPORT_SIZE] = {0};
+    
+    memcpy(report, packet, (length > sizeof(report))? sizeof(report) : length);
+    return hostCrc32(crc, report, sizeof(report));
+}
+
+/*! \fn     collectAnswer(const uint8_t* packet, uint8_t length)
+*   \brief  Firmware USB send callback: accumulate the answers to the current request
+*   \param  packet  The packet
+*   \param  length  Packet length
+*/
+static void collectAnswer(const uint8_t* packet, uint8_t length)
+{
+    if (request_pending == TRUE)
+    {
+        request.replayed_answers++;
+        request.replayed_crc = answerCrc(request.replayed_crc, packet, length);
+    }
+}
+
+/*! \fn     finishRequest(void)
+*   \brief  Compare the answers of the current request with the recorded ones
+*/
+static void finishRequest(void)
+{
+    replayCmdStats_t* stats = &cmd_stats[request.cmd];
+    
+    if (request_pending == FALSE)
+    {
+        return;
+    }
+    request_pending = FALSE;
+    if (request.recorded_answers != 0)
+    {
+        stats->recorded_time += request.first_answer_us - request.time_us;
+        stats->recorded_count++;
+    }
+    if ((request.recorded_answers != request.replayed_answers) || (request.recorded_crc != request.replayed_crc))
+    {
+        stats->differing++;
+        if (verbose == TRUE)
+        {
+            printf("answers to the request at %.3fs differ: %u recorded, %u replayed\n", request.time_us / 1e6, request.recorded_answers, request.replayed_answers);
+        }
+    }
+}
+
+/*! \fn     replayRequest(const hidSessionRecord_t* record)
+*   \brief  Have the firmware process a recorded request
+*   \param  record  The request
+*/
+static void replayRequest(const hidSessionRecord_t* record)
+{
+    replayCmdStats_t* stats = &cmd_stats[record->report[HID_TYPE_FIELD]];
+    uint64_t spi_bytes = at45dbGetStats()->spi_bytes;
+    uint64_t start_time, host_start_time, time;
+    
+    memset(&request, 0, sizeof(request));
+    request.cmd = record->report[HID_TYPE_FIELD];
+    request.time_us = record->time_us;
+    request_pending = TRUE;
+    
+    hostUsbQueuePacket(record->report, RAWHID_RX_SIZE);
+    start_time = hostTimeGet();
+    host_start_time = hostTimeNs();
+    hostFirmwareRunMainLoop();
+    time = hostTimeGet() - start_time;
+    
+    stats->count++;
+    stats->host_time += hostTimeNs() - host_start_time;
+    stats->time += time;
+    stats->spi_bytes += at45dbGetStats()->spi_bytes - spi_bytes;
+    if (time > stats->max_time)
+    {
+        stats->max_time = time;
+    }
+}
+
+/*! \fn     loadImage(const char* path, void* buffer, size_t size)
+*   \brief  Load an image file, which the replay doesn't modify
+*   \param  path    File path
+*   \param  buffer  Destination
+*   \param  size    Expected file size
+*   \return 0 on success
+*/
+static int loadImage(const char* path, void* buffer, size_t size)
+{
+    FILE* file = fopen(path, "rb");
+    int ret = 0;
+    
+    if (file == NULL)
+    {
+        perror(path);
+        return -1;
+    }
+    if ((fread(buffer, 1, size, file) != size) || (fgetc(file) != EOF))
+    {
+        fprintf(stderr, "%s: not a %lu bytes image\n", path, (unsigned long)size);
+        ret = -1;
+    }
+    fclose(file);
+    return ret;
+}
+
+/*! \fn     printResults(void)
+*   \brief  Print the per command results and add them to the baseline rows
+*/
+static void printResults(void)
+{
+    printf("%-26s %6s %12s %12s %10s %10s %12s %9s\n", "command", "count", "mean us", "max us", "host us", "SPI bytes", "recorded us", "differing");
+    for (uint16_t cmd = 0; cmd < REPLAY_NB_COMMANDS; cmd++)
+    {
+        replayCmdStats_t* stats = &cmd_stats[cmd];
+        const char* name = cmdName(cmd);
+        char unknown_name[8];
+        double values[2];
+        
+        if (stats->count == 0)
+        {
+            continue;
+        }
+        if (name == NULL)
+        {
+            snprintf(unknown_name, sizeof(unknown_name), "0x%02x", cmd);
+            name = unknown_name;
+        }
+        values[0] = stats->time / (double)stats->count / 1e3;
+        values[1] = stats->spi_bytes / (double)stats->count;
+        printf("%-26s %6u %12.1f %12.1f %10.1f %10.1f ", name, stats->count, values[0], stats->max_time / 1e3, stats->host_time / (double)stats->count / 1e3, values[1]);
+        if (stats->recorded_count != 0)
+        {
+            printf("%12.1f", stats->recorded_time / (double)stats->recorded_count);
+        }
+        else
+        {
+            printf("%12s", "-");
+        }
+        printf(" %9u\n", stats->differing);
+        hostBaselineAddRow(&baseline, values, "0x%02x %s", cmd, name);
+    }
+}
+
+/*! \fn     usage(void)
+*   \brief  Print the usage
+*/
+static int usage(void)
+{
+    char options[1024];
+    
+    snprintf(options, sizeof(options),
+             "  --flash FILE        flash image the session was recorded with, not modified (default: blank)\n"
+             "  --eeprom FILE       eeprom image, not modified (default: blank)\n"
+             "  --card FILE         smart card image, not modified (default: blank)\n"
+             "  --pin PIN           PIN typed by the simulated user, hexadecimal (default: %04x)\n"
+             "  --no-card           start without the card inserted\n"
+             "  --deny              the simulated user denies every request\n"
+             "  --verbose           report the requests whose answers differ from the recording\n"
+             "  --exact             fail if an answer differs from the recording (sessions recorded with a fresh virtual device)\n", HOST_DEFAULT_PIN);
+    return hostBaselineUsage(&baseline, "hid_replay [options] SESSION", options);
+}
+
+int main(int argc, char* argv[])
+{
+    const char* flash_path = NULL;
+    const char* eeprom_path = NULL;
+    const char* card_path = NULL;
+    const char* session_path = NULL;
+    uint16_t pin = HOST_DEFAULT_PIN;
+    uint8_t insert_card = TRUE;
+    uint8_t approve = TRUE;
+    uint8_t exact = FALSE;
+    uint32_t nb_requests = 0, nb_differing = 0;
+    uint64_t session_time_us = 0, start_time, host_start_time, service_time = 0;
+    hidSessionRecord_t record;
+    hidSession_t session;
+    int nb_regressions;
+    int ret;
+    
+    hostBaselineInit(&baseline, replay_columns, 2, FALSE, REPLAY_DEFAULT_TOLERANCE);
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--no-card") == 0)
+        {
+            insert_card = FALSE;
+        }
+        else if (strcmp(argv[i], "--deny") == 0)
+        {
+            approve = FALSE;
+        }
+        else if (strcmp(argv[i], "--verbose") == 0)
+        {
+            verbose = TRUE;
+        }
+        else if (strcmp(argv[i], "--exact") == 0)
+        {
+            exact = TRUE;
+        }
+        else if (argv[i][0] != '-')
+        {
+            session_path = argv[i];
+        }
+        else if (i + 1 == argc)
+        {
+            return usage();
+        }
+        else if (strcmp(argv[i], "--flash") == 0)
+        {
+            flash_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--eeprom") == 0)
+        {
+            eeprom_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--card") == 0)
+        {
+            card_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--pin") == 0)
+        {
+            pin = (uint16_t)strtoul(argv[++i], NULL, 16);
+        }
+        else if (hostBaselineParseOption(&baseline, argv[i], argv[i + 1]) != 0)
+        {
+            i++;
+        }
+        else
+        {
+            return usage();
+        }
+    }
+    if (session_path == NULL)
+    {
+        return usage();
+    }
+    if (hidSessionOpen(&session, session_path) != 0)
+    {
+        return 2;
+    }
+    
+    // Device in the state the session was recorded in, the images are loaded in memory
+    hostFirmwareInit();
+    if ((at45dbOpen(NULL) != 0) || (hostEepromOpen(NULL) != 0) || (hostCardOpen(NULL) != 0))
+    {
+        return 2;
+    }
+    if (((flash_path != NULL) && (loadImage(flash_path, at45dbGetImage(), FLASH_SIZE) != 0)) ||
+        ((eeprom_path != NULL) && (loadImage(eeprom_path, hostEepromGetContents(), E2END + 1) != 0)) ||
+        ((card_path != NULL) && (loadImage(card_path, hostCardGetContents(), sizeof(hostCard_t)) != 0)))
+    {
+        return 2;
+    }
+    if (hostFirmwareBoot() != RETURN_OK)
+    {
+        fprintf(stderr, "flash not detected\n");
+        return 1;
+    }
+    hostSetUserApproval(approve);
+    hostSetUserPin(pin);
+    hostUsbSetSendCallback(collectAnswer);
+    if (insert_card == TRUE)
+    {
+        hostCardInsert();
+    }
+    hostFirmwareRunMainLoop();
+    
+    // Requests replayed in order, the device answers recorded after a request belong to it
+    start_time = hostTimeGet();
+    host_start_time = hostTimeNs();
+    while ((ret = hidSessionRead(&session, &record)) == 1)
+    {
+        session_time_us = record.time_us;
+        if (record.direction == HID_SESSION_FROM_DEVICE)
+        {
+            if (request_pending == TRUE)
+            {
+                if (request.recorded_answers++ == 0)
+                {
+                    request.first_answer_us = record.time_us;
+                }
+                request.recorded_crc = answerCrc(request.recorded_crc, record.report, sizeof(record.report));
+            }
+            continue;
+        }
+        finishRequest();
+        replayRequest(&record);
+        nb_requests++;
+    }
+    finishRequest();
+    hidSessionClose(&session);
+    if (ret < 0)
+    {
+        fprintf(stderr, "%s: truncated or corrupted session\n", session_path);
+        return 2;
+    }
+    
+    for (uint16_t cmd = 0; cmd < REPLAY_NB_COMMANDS; cmd++)
+    {
+        nb_differing += cmd_stats[cmd].differing;
+        service_time += cmd_stats[cmd].host_time;
+    }
+    printf("HID session replay: %s, %u requests over %.3fs\n", session_path, nb_requests, session_time_us / 1e6);
+    printf("Simulated device time %.3fs, host wall time %.3fms (%.3fms in the firmware), %u flash violations\n", (hostTimeGet() - start_time) / 1e9, (hostTimeNs() - host_start_time) / 1e6, service_time / 1e6, at45dbGetStats()->violations);
+    printf("%u requests answered differently than in the recording\n\n", nb_differing);
+    printResults();
+    nb_regressions = hostBaselineFinish(&baseline);
+    at45dbClose();
+    if ((at45dbGetStats()->violations != 0) || ((exact == TRUE) && (nb_differing != 0)))
+    {
+        printf("FAILED\n");
+        return 1;
+    }
+    if (nb_regressions < 0)
+    {
+        return 2;
+    }
+    return (nb_regressions == 0)? 0 : 1;
+}
@@ -0,0 +1,193 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     hid_session.c
+*    \brief    Recorded HID sessions: timestamped raw HID reports in a compact binary file
+*    Created:  19/10/2026
+*/
+/*
+ * Most reports only carry a few bytes after the [len, cmd] header and are
+ * zero padded, a typical request / answer pair takes less than 20 bytes.
+ * tools/python_comms/mooltipass_coms.py writes the same format.
+ */
+#include <string.h>
+#include "hid_session.h"
+
+
+/*! \fn     hidSessionCreate(hidSession_t* session, const char* path)
+*   \brief  Create a session file and write its header
+*   \param  session     Session to initialize
+*   \param  path        File path, replaced if it exists
+*   \return 0 on success
+*/
+int hidSessionCreate(hidSession_t* session, const char* path)
+{
+    const uint8_t header[HID_SESSION_HEADER_SIZE] = {'M', 'P', 'H', 'S', HID_SESSION_VERSION, 0, 0, 0};
+    
+    session->last_time_us = 0;
+    session->file = fopen(path, "wb");
+    if (session->file == NULL)
+    {
+        perror(path);
+        return -1;
+    }
+    if (fwrite(header, sizeof(header), 1, session->file) != 1)
+    {
+        perror(path);
+        fclose(session->file);
+        session->file = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+/*! \fn     hidSessionWrite(hidSession_t* session, uint64_t time_us, uint8_t direction, const uint8_t* report, uint8_t length)
+*   \brief  Append a report to a session
+*   \param  session     Session created with hidSessionCreate()
+*   \param  time_us     Time since the start of the session, not lower than the previous one
+*   \param  direction   HID_SESSION_TO_DEVICE or HID_SESSION_FROM_DEVICE
+*   \param  report      The report
+*   \param  length      Its length, at most HID_SESSION_REPORT_SIZE
+*   \return 0 on success
+*/
+int hidSessionWrite(hidSession_t* session, uint64_t time_us, uint8_t direction, const uint8_t* report, uint8_t length)
+{
+    uint8_t record[10 + 1 + HID_SESSION_REPORT_SIZE];
+    uint64_t delta = (time_us > session->last_time_us)? time_us - session->last_time_us : 0;
+    uint8_t record_length = 0;
+    
+    if (length > HID_SESSION_REPORT_SIZE)
+    {
+        length = HID_SESSION_REPORT_SIZE;
+    }
+    while ((length > 0) && (report[length - 1] == 0))
+    {
+        length--;
+    }
+    
+    // Varint time delta, then direction & length
+    do
+    {
+        record[record_length++] = (uint8_t)(delta & 0x7F) | ((delta > 0x7F)? 0x80 : 0x00);
+        delta >>= 7;
+    }
+    while (delta != 0);
+    record[record_length++] = (uint8_t)(direction << 7) | length;
+    memcpy(&record[record_length], report, length);
+    record_length += length;
+    
+    if (time_us > session->last_time_us)
+    {
+        session->last_time_us = time_us;
+    }
+    if (fwrite(record, record_length, 1, session->file) != 1)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+/*! \fn     hidSessionOpen(hidSession_t* session, const char* path)
+*   \brief  Open a session file and check its header
+*   \param  session     Session to initialize
+*   \param  path        File path
+*   \return 0 on success
+*/
+int hidSessionOpen(hidSession_t* session, const char* path)
+{
+    uint8_t header[HID_SESSION_HEADER_SIZE];
+    
+    session->last_time_us = 0;
+    session->file = fopen(path, "rb");
+    if (session->file == NULL)
+    {
+        perror(path);
+        return -1;
+    }
+    if ((fread(header, sizeof(header), 1, session->file) != 1) || (memcmp(header, HID_SESSION_MAGIC, 4) != 0) || (header[4] != HID_SESSION_VERSION))
+    {
+        fprintf(stderr, "%s: not a version %u HID session\n", path, HID_SESSION_VERSION);
+        fclose(session->file);
+        session->file = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+/*! \fn     hidSessionRead(hidSession_t* session, hidSessionRecord_t* record)
+*   \brief  Read the next report of a session
+*   \param  session     Session opened with hidSessionOpen()
+*   \param  record      Filled with the report, zero padded
+*   \return 1 if a report was read, 0 at the end of the session, -1 if the file is corrupted
+*/
+int hidSessionRead(hidSession_t* session, hidSessionRecord_t* record)
+{
+    uint64_t delta = 0;
+    uint8_t shift = 0;
+    uint8_t length;
+    int c;
+    
+    // Varint time delta
+    do
+    {
+        if ((c = fgetc(session->file)) == EOF)
+        {
+            return (shift == 0)? 0 : -1;
+        }
+        if (shift > 63)
+        {
+            return -1;
+        }
+        delta |= (uint64_t)(c & 0x7F) << shift;
+        shift += 7;
+    }
+    while (c & 0x80);
+    
+    if ((c = fgetc(session->file)) == EOF)
+    {
+        return -1;
+    }
+    record->direction = (uint8_t)c >> 7;
+    length = (uint8_t)c & 0x7F;
+    if (length > HID_SESSION_REPORT_SIZE)
+    {
+        return -1;
+    }
+    memset(record->report, 0, sizeof(record->report));
+    if ((length > 0) && (fread(record->report, length, 1, session->file) != 1))
+    {
+        return -1;
+    }
+    session->last_time_us += delta;
+    record->time_us = session->last_time_us;
+    return 1;
+}
+
+/*! \fn     hidSessionClose(hidSession_t* session)
+*   \brief  Close a session file
+*   \param  session     The session
+*/
+void hidSessionClose(hidSession_t* session)
+{
+    if (session->file != NULL)
+    {
+        fclose(session->file);
+        session->file = NULL;
+    }
+}
@@ -0,0 +1,65 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     hid_session.h
+*    \brief    Recorded HID sessions: timestamped raw HID reports in a compact binary file
+*    Created:  19/10/2026
+*/
+#ifndef HID_SESSION_H_
+#define HID_SESSION_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * File format, little endian:
+ * - header: "MPHS", version byte, 3 zero bytes
+ * - records: time since the previous record in us (LEB128 varint), then a
+ *   byte with the direction in bit 7 and the report length in bits 6-0, then
+ *   the report with its trailing zero bytes removed (length 0 to 64)
+ */
+#define HID_SESSION_MAGIC           "MPHS"
+#define HID_SESSION_VERSION         1
+#define HID_SESSION_HEADER_SIZE     8
+#define HID_SESSION_REPORT_SIZE     64
+
+/* Record directions */
+#define HID_SESSION_TO_DEVICE       0
+#define HID_SESSION_FROM_DEVICE     1
+
+typedef struct
+{
+    uint64_t time_us;           // Since the start of the session
+    uint8_t direction;
+    uint8_t report[HID_SESSION_REPORT_SIZE];
+} hidSessionRecord_t;
+
+typedef struct
+{
+    FILE* file;
+    uint64_t last_time_us;
+} hidSession_t;
+
+int hidSessionCreate(hidSession_t* session, const char* path);
+int hidSessionWrite(hidSession_t* session, uint64_t time_us, uint8_t direction, const uint8_t* report, uint8_t length);
+int hidSessionOpen(hidSession_t* session, const char* path);
+int hidSessionRead(hidSession_t* session, hidSessionRecord_t* record);
+void hidSessionClose(hidSession_t* session);
+
+#endif /* HID_SESSION_H_ */
@@ -0,0 +1,318 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     host_baseline.c
+*    \brief    Results saving and baseline comparison shared by the host tools
+*    Created:  19/10/2026
+*/
+/*
+ * A tool adds one row per measured item: a key made of one or more words
+ * and the values of its columns. With --save the rows are stored as
+ * "key value..." lines, with --baseline they are compared with such a file:
+ * a value above the baseline by more than the tolerance (or any change of a
+ * checksum column) is a regression, a value below it an improvement.
+ */
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "host_baseline.h"
+
+/* Longest line of a baseline file */
+#define BASELINE_LINE_LENGTH    256
+#define BASELINE_MAX_TOKENS     16
+
+
+/*! \fn     hostBaselineInit(hostBaseline_t* baseline, const hostBaselineColumn_t* columns, uint8_t nb_columns, uint8_t strict, double tolerance)
+*   \brief  Initialize the results of a tool
+*   \param  baseline    The results
+*   \param  columns     Value columns of each row
+*   \param  nb_columns  Number of columns, up to HOST_BASELINE_MAX_COLUMNS
+*   \param  strict      Non zero if the rows missing from the results or the baseline are regressions
+*   \param  tolerance   Default tolerated increase in percent
+*/
+void hostBaselineInit(hostBaseline_t* baseline, const hostBaselineColumn_t* columns, uint8_t nb_columns, uint8_t strict, double tolerance)
+{
+    memset(baseline, 0, sizeof(*baseline));
+    baseline->columns = columns;
+    baseline->nb_columns = nb_columns;
+    baseline->strict = strict;
+    baseline->tolerance = tolerance;
+}
+
+/*! \fn     hostBaselineUsage(const hostBaseline_t* baseline, const char* usage, const char* options)
+*   \brief  Print the usage of a tool followed by the baseline options
+*   \param  baseline    The results
+*   \param  usage       Usage line of the tool
+*   \param  options     Description of the tool options, or NULL
+*   \return 2, the exit code for a bad command line
+*/
+int hostBaselineUsage(const hostBaseline_t* baseline, const char* usage, const char* options)
+{
+    fprintf(stderr, "usage: %s\n", usage);
+    if (options != NULL)
+    {
+        fprintf(stderr, "%s", options);
+    }
+    fprintf(stderr, "  --save FILE         save the results\n");
+    fprintf(stderr, "  --baseline FILE     compare the results with a saved file, regressions make the command fail\n");
+    fprintf(stderr, "  --tolerance PERCENT tolerated increase over the baseline (default: %.1f)\n", baseline->tolerance);
+    return 2;
+}
+
+/*! \fn     hostBaselineParseOption(hostBaseline_t* baseline, const char* option, const char* value)
+*   \brief  Parse one of the baseline options
+*   \param  baseline    The results
+*   \param  option      Command line option
+*   \param  value       Its value
+*   \return Non zero if the option was a baseline option
+*/
+int hostBaselineParseOption(hostBaseline_t* baseline, const char* option, const char* value)
+{
+    if (strcmp(option, "--save") == 0)
+    {
+        baseline->save_path = value;
+    }
+    else if (strcmp(option, "--baseline") == 0)
+    {
+        baseline->baseline_path = value;
+    }
+    else if (strcmp(option, "--tolerance") == 0)
+    {
+        baseline->tolerance = strtod(value, NULL);
+    }
+    else
+    {
+        return 0;
+    }
+    return 1;
+}
+
+/*! \fn     hostBaselineAddRow(hostBaseline_t* baseline, const double* values, const char* key_format, ...)
+*   \brief  Add a row to the results
+*   \param  baseline    The results
+*   \param  values      Values of the columns
+*   \param  key_format  printf format of the row key
+*/
+void hostBaselineAddRow(hostBaseline_t* baseline, const double* values, const char* key_format, ...)
+{
+    hostBaselineRow_t* row;
+    va_list args;
+    
+    baseline->rows = realloc(baseline->rows, (baseline->nb_rows + 1) * sizeof(hostBaselineRow_t));
+    if (baseline->rows == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        exit(2);
+    }
+    row = &baseline->rows[baseline->nb_rows++];
+    memset(row, 0, sizeof(*row));
+    va_start(args, key_format);
+    vsnprintf(row->key, sizeof(row->key), key_format, args);
+    va_end(args);
+    memcpy(row->values, values, baseline->nb_columns * sizeof(double));
+}
+
+/*! \fn     printValue(const hostBaselineColumn_t* column, double value, FILE* file)
+*   \brief  Print a value in the format of its column
+*   \param  column  The column
+*   \param  value   The value
+*   \param  file    Output file
+*/
+static void printValue(const hostBaselineColumn_t* column, double value, FILE* file)
+{
+    if (column->checksum != 0)
+    {
+        fprintf(file, "%08x", (uint32_t)value);
+    }
+    else
+    {
+        fprintf(file, "%.*f", column->decimals, value);
+    }
+}
+
+/*! \fn     saveResults(const hostBaseline_t* baseline)
+*   \brief  Save the results to the --save file
+*   \param  baseline    The results
+*   \return 0 on success
+*/
+static int saveResults(const hostBaseline_t* baseline)
+{
+    FILE* save_file = fopen(baseline->save_path, "w");
+    
+    if (save_file == NULL)
+    {
+        fprintf(stderr, "can't create %s\n", baseline->save_path);
+        return -1;
+    }
+    for (uint32_t i = 0; i < baseline->nb_rows; i++)
+    {
+        fprintf(save_file, "%s", baseline->rows[i].key);
+        for (uint8_t j = 0; j < baseline->nb_columns; j++)
+        {
+            fprintf(save_file, " ");
+            printValue(&baseline->columns[j], baseline->rows[i].values[j], save_file);
+        }
+        fprintf(save_file, "\n");
+    }
+    fclose(save_file);
+    return 0;
+}
+
+/*! \fn     compareValue(const hostBaseline_t* baseline, const char* key, uint8_t column_index, double value, double base_value)
+*   \brief  Compare a value with its baseline
+*   \param  baseline        The results
+*   \param  key             Key of the row
+*   \param  column_index    Column of the value
+*   \param  value           The value
+*   \param  base_value      Its baseline
+*   \return 1 for a regression, 0 otherwise
+*/
+static int compareValue(const hostBaseline_t* baseline, const char* key, uint8_t column_index, double value, double base_value)
+{
+    const hostBaselineColumn_t* column = &baseline->columns[column_index];
+    double change = (base_value == 0)? 0 : (value / base_value - 1) * 100;
+    // Half of the last saved digit, the baseline values are rounded
+    double slack = 0.5;
+    
+    for (uint8_t i = 0; i < column->decimals; i++)
+    {
+        slack /= 10;
+    }
+    if (column->checksum != 0)
+    {
+        if (value != base_value)
+        {
+            printf("DIFFERENT %s %s: %08x, baseline %08x\n", key, column->name, (uint32_t)value, (uint32_t)base_value);
+            return 1;
+        }
+        return 0;
+    }
+    if (value > base_value * (1 + baseline->tolerance / 100) + slack)
+    {
+        printf("REGRESSION %s %s: %.*f, baseline %.*f (%+.1f%%)\n", key, column->name, column->decimals, value, column->decimals, base_value, change);
+        return 1;
+    }
+    if (value < base_value * (1 - baseline->tolerance / 100) - slack)
+    {
+        printf("improvement %s %s: %.*f, baseline %.*f (%+.1f%%)\n", key, column->name, column->decimals, value, column->decimals, base_value, change);
+    }
+    return 0;
+}
+
+/*! \fn     compareResults(hostBaseline_t* baseline)
+*   \brief  Compare the results with the --baseline file
+*   \param  baseline    The results
+*   \return Number of regressions, -1 if the baseline can't be read
+*/
+static int compareResults(hostBaseline_t* baseline)
+{
+    FILE* baseline_file = fopen(baseline->baseline_path, "r");
+    char* tokens[BASELINE_MAX_TOKENS];
+    char line[BASELINE_LINE_LENGTH];
+    int nb_regressions = 0;
+    
+    if (baseline_file == NULL)
+    {
+        fprintf(stderr, "can't open %s\n", baseline->baseline_path);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), baseline_file) != NULL)
+    {
+        char key[HOST_BASELINE_KEY_LENGTH] = "";
+        hostBaselineRow_t* row = NULL;
+        uint8_t nb_tokens = 0;
+        uint8_t nb_key_tokens;
+        
+        for (char* token = strtok(line, " \t\r\n"); (token != NULL) && (nb_tokens < BASELINE_MAX_TOKENS); token = strtok(NULL, " \t\r\n"))
+        {
+            tokens[nb_tokens++] = token;
+        }
+        if (nb_tokens <= baseline->nb_columns)
+        {
+            continue;
+        }
+        
+        // The key is made of the words before the values
+        nb_key_tokens = nb_tokens - baseline->nb_columns;
+        for (uint8_t i = 0; i < nb_key_tokens; i++)
+        {
+            snprintf(key + strlen(key), sizeof(key) - strlen(key), (i == 0)? "%s" : " %s", tokens[i]);
+        }
+        for (uint32_t i = 0; (i < baseline->nb_rows) && (row == NULL); i++)
+        {
+            if (strcmp(baseline->rows[i].key, key) == 0)
+            {
+                row = &baseline->rows[i];
+            }
+        }
+        if (row == NULL)
+        {
+            printf("%s%s isn't in the results anymore\n", (baseline->strict != 0)? "REGRESSION " : "", key);
+            nb_regressions += (baseline->strict != 0)? 1 : 0;
+            continue;
+        }
+        row->found = 1;
+        for (uint8_t i = 0; i < baseline->nb_columns; i++)
+        {
+            const char* token = tokens[nb_key_tokens + i];
+            double base_value = (baseline->columns[i].checksum != 0)? strtoul(token, NULL, 16) : strtod(token, NULL);
+            
+            nb_regressions += compareValue(baseline, key, i, row->values[i], base_value);
+        }
+    }
+    fclose(baseline_file);
+    
+    for (uint32_t i = 0; i < baseline->nb_rows; i++)
+    {
+        if (baseline->rows[i].found == 0)
+        {
+            printf("%s%s isn't in the baseline\n", (baseline->strict != 0)? "REGRESSION " : "", baseline->rows[i].key);
+            nb_regressions += (baseline->strict != 0)? 1 : 0;
+        }
+    }
+    return nb_regressions;
+}
+
+/*! \fn     hostBaselineFinish(hostBaseline_t* baseline)
+*   \brief  Save the results and compare them with the baseline, as requested on the command line
+*   \param  baseline    The results, freed
+*   \return Number of regressions, -1 if a file can't be accessed
+*/
+int hostBaselineFinish(hostBaseline_t* baseline)
+{
+    int nb_regressions = 0;
+    
+    if ((baseline->save_path != NULL) && (saveResults(baseline) != 0))
+    {
+        nb_regressions = -1;
+    }
+    else if (baseline->baseline_path != NULL)
+    {
+        nb_regressions = compareResults(baseline);
+        if (nb_regressions >= 0)
+        {
+            printf("%s\n", (nb_regressions == 0)? "No regression against the baseline" : "Regressions against the baseline");
+        }
+    }
+    free(baseline->rows);
+    baseline->rows = NULL;
+    baseline->nb_rows = 0;
+    return nb_regressions;
+}
@@ -0,0 +1,64 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     host_baseline.h
+*    \brief    Results saving and baseline comparison shared by the host tools
+*    Created:  19/10/2026
+*/
+#ifndef HOST_BASELINE_H_
+#define HOST_BASELINE_H_
+
+#include <stdint.h>
+
+#define HOST_BASELINE_KEY_LENGTH    64
+#define HOST_BASELINE_MAX_COLUMNS   4
+
+typedef struct
+{
+    const char* name;           // Name in the comparison reports
+    uint8_t decimals;           // Decimals of the saved values
+    uint8_t checksum;           // Saved in hexadecimal, any change is a regression
+} hostBaselineColumn_t;
+
+typedef struct
+{
+    char key[HOST_BASELINE_KEY_LENGTH];
+    double values[HOST_BASELINE_MAX_COLUMNS];
+    uint8_t found;
+} hostBaselineRow_t;
+
+typedef struct
+{
+    const hostBaselineColumn_t* columns;
+    uint8_t nb_columns;
+    uint8_t strict;             // Rows missing from the results or from the baseline are regressions
+    double tolerance;           // Tolerated increase in percent
+    const char* save_path;
+    const char* baseline_path;
+    hostBaselineRow_t* rows;
+    uint32_t nb_rows;
+} hostBaseline_t;
+
+void hostBaselineInit(hostBaseline_t* baseline, const hostBaselineColumn_t* columns, uint8_t nb_columns, uint8_t strict, double tolerance);
+int hostBaselineUsage(const hostBaseline_t* baseline, const char* usage, const char* options);
+int hostBaselineParseOption(hostBaseline_t* baseline, const char* option, const char* value);
+void hostBaselineAddRow(hostBaseline_t* baseline, const double* values, const char* key_format, ...);
+int hostBaselineFinish(hostBaseline_t* baseline);
+
+#endif /* HOST_BASELINE_H_ */
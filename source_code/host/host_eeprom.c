@@ -0,0 +1,160 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     host_eeprom.c
+*    \brief    EEPROM for the host builds, optionally backed by a file
+*    Created:  19/10/2026
+*/
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <avr/eeprom.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include "host_eeprom.h"
+
+/* The firmware passes EEPROM addresses as pointers */
+#define EEPROM_INDEX(addr)      ((uintptr_t)(addr))
+
+// Blank contents until hostEepromOpen() maps a file
+static uint8_t eeprom_ram[E2END + 1] = {[0 ... E2END] = 0xFF};
+static uint8_t* eeprom_contents = eeprom_ram;
+
+
+/*! \fn     hostEepromCheck(const void* addr, size_t n)
+*   \brief  Abort on accesses outside of the EEPROM, which would silently wrap on the device
+*   \param  addr    EEPROM address
+*   \param  n       Access size
+*/
+static void hostEepromCheck(const void* addr, size_t n)
+{
+    if (EEPROM_INDEX(addr) + n > E2END + 1)
+    {
+        fprintf(stderr, "eeprom: access out of range (address %lu, %lu bytes)\n", (unsigned long)EEPROM_INDEX(addr), (unsigned long)n);
+        abort();
+    }
+}
+
+/*! \fn     hostEepromOpen(const char* image_path)
+*   \brief  Map an EEPROM image file, created blank (0xFF) if it doesn't exist
+*   \param  image_path  Path to the image, NULL to start again from blank contents in memory
+*   \return 0 on success
+*/
+int hostEepromOpen(const char* image_path)
+{
+    struct stat image_stat;
+    uint8_t* mapping;
+    int fd;
+    
+    hostEepromClose();
+    memset(eeprom_ram, 0xFF, sizeof(eeprom_ram));
+    if (image_path == NULL)
+    {
+        return 0;
+    }
+    
+    fd = open(image_path, O_RDWR | O_CREAT, 0644);
+    if ((fd < 0) || (fstat(fd, &image_stat) != 0))
+    {
+        perror(image_path);
+        return -1;
+    }
+    if ((image_stat.st_size != 0) && (image_stat.st_size != sizeof(eeprom_ram)))
+    {
+        fprintf(stderr, "%s: not a %lu bytes eeprom image\n", image_path, (unsigned long)sizeof(eeprom_ram));
+        close(fd);
+        return -1;
+    }
+    if ((image_stat.st_size == 0) && (write(fd, eeprom_ram, sizeof(eeprom_ram)) != sizeof(eeprom_ram)))
+    {
+        perror(image_path);
+        close(fd);
+        return -1;
+    }
+    mapping = mmap(NULL, sizeof(eeprom_ram), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        perror("eeprom: mmap");
+        return -1;
+    }
+    eeprom_contents = mapping;
+    return 0;
+}
+
+/*! \fn     hostEepromClose(void)
+*   \brief  Unmap a possible EEPROM image file
+*/
+void hostEepromClose(void)
+{
+    if (eeprom_contents != eeprom_ram)
+    {
+        munmap(eeprom_contents, sizeof(eeprom_ram));
+        eeprom_contents = eeprom_ram;
+    }
+}
+
+/*! \fn     hostEepromGetContents(void)
+*   \brief  Direct access to the EEPROM contents
+*   \return Pointer to E2END + 1 bytes
+*/
+uint8_t* hostEepromGetContents(void)
+{
+    return eeprom_contents;
+}
+
+uint8_t eeprom_read_byte(const uint8_t* addr)
+{
+    hostEepromCheck(addr, 1);
+    return eeprom_contents[EEPROM_INDEX(addr)];
+}
+
+uint16_t eeprom_read_word(const uint16_t* addr)
+{
+    hostEepromCheck(addr, 2);
+    return eeprom_contents[EEPROM_INDEX(addr)] | ((uint16_t)eeprom_contents[EEPROM_INDEX(addr) + 1] << 8);
+}
+
+void eeprom_read_block(void* dst, const void* src, size_t n)
+{
+    hostEepromCheck(src, n);
+    memcpy(dst, &eeprom_contents[EEPROM_INDEX(src)], n);
+}
+
+void eeprom_write_byte(uint8_t* addr, uint8_t value)
+{
+    hostEepromCheck(addr, 1);
+    eeprom_contents[EEPROM_INDEX(addr)] = value;
+}
+
+void eeprom_write_word(uint16_t* addr, uint16_t value)
+{
+    hostEepromCheck(addr, 2);
+    eeprom_contents[EEPROM_INDEX(addr)] = (uint8_t)value;
+    eeprom_contents[EEPROM_INDEX(addr) + 1] = (uint8_t)(value >> 8);
+}
+
+void eeprom_write_block(const void* src, void* dst, size_t n)
+{
+    hostEepromCheck(dst, n);
+    memcpy(&eeprom_contents[EEPROM_INDEX(dst)], src, n);
+}
@@ -0,0 +1,600 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     host_firmware.c
+*    \brief    Host replacements for the hardware facing firmware modules (USB, smart card, GUI, RNG)
+*    Created:  19/10/2026
+*/
+/*
+ * The user is simulated: confirmation requests, PIN entries and login
+ * selections get the answer set with hostSetUserApproval(), the first login
+ * being selected and the PIN set with hostSetUserPin() being entered. The
+ * smart card only stores what the logic modules read back.
+ */
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <avr/eeprom.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <stdio.h>
+// Firmware structures are packed, see the Makefile
+#pragma pack(push, 1)
+#include "smart_card_higher_level_functions.h"
+#include "gui_credentials_functions.h"
+#include "gui_screen_functions.h"
+#include "gui_basic_functions.h"
+#include "gui_pin_functions.h"
+#include "eeprom_addresses.h"
+#include "logic_aes_and_comms.h"
+#include "logic_smartcard.h"
+#include "usb_cmd_parser.h"
+#include "host_firmware.h"
+#include "logic_eeprom.h"
+#include "mooltipass.h"
+#include "smartcard.h"
+#include "node_mgmt.h"
+#include "flash_mem.h"
+#include "defines.h"
+#include "delays.h"
+#include "usb.h"
+#include "rng.h"
+#pragma pack(pop)
+
+/* Simulated user */
+static uint8_t user_approval = TRUE;
+static uint8_t current_screen = SCREEN_DEFAULT_NINSERTED;
+/* Simulated smart card */
+static uint16_t user_pin = HOST_DEFAULT_PIN;
+static uint8_t card_inserted = FALSE;
+static uint8_t card_detect_event = RETURN_REL;
+static hostCard_t card_ram;
+static hostCard_t* card = &card_ram;
+/* USB packets to be received by the firmware */
+static uint8_t usb_rx_queue[HOST_USB_RX_QUEUE_SIZE][RAWHID_RX_SIZE];
+static uint8_t usb_rx_head = 0;
+static uint8_t usb_rx_count = 0;
+static hostUsbSendCallback_t usb_send_callback = 0;
+/* Variables defined in files that aren't part of the host builds */
+uint8_t mp_timeout_enabled = FALSE;
+#if defined(MINI_VERSION)
+uint8_t wheel_reverse_bool = FALSE;
+#endif
+
+
+/*! \fn     hostFirmwareInit(void)
+*   \brief  Back to a removed card, an approving user, empty USB queues
+*/
+void hostFirmwareInit(void)
+{
+    user_approval = TRUE;
+    current_screen = SCREEN_DEFAULT_NINSERTED;
+    card_inserted = FALSE;
+    card_detect_event = RETURN_REL;
+    user_pin = HOST_DEFAULT_PIN;
+    usb_rx_count = 0;
+    srand(0);
+}
+
+/*! \fn     hostFirmwareBoot(void)
+*   \brief  Flash & eeprom initializations done by main() in mooltipass.c
+*   \return RETURN_OK if the flash is detected
+*/
+RET_TYPE hostFirmwareBoot(void)
+{
+    uint16_t current_bootkey_val = eeprom_read_word((uint16_t*)EEP_BOOTKEY_ADDR);
+    
+    if (current_bootkey_val != CORRECT_BOOTKEY)
+    {
+        mooltipassParametersInit();
+        eeprom_write_byte((uint8_t*)EEP_BOOT_PWD_SET, FALSE);
+    }
+    if (getMooltipassParameterInEeprom(USER_PARAM_INIT_KEY_PARAM) != USER_PARAM_CORRECT_INIT_KEY)
+    {
+        mooltipassParametersInit();
+        setMooltipassParameterInEeprom(USER_PARAM_INIT_KEY_PARAM, USER_PARAM_CORRECT_INIT_KEY);
+    }
+    initFlashIOs();
+    mp_timeout_enabled = getMooltipassParameterInEeprom(LOCK_TIMEOUT_ENABLE_PARAM);
+    if (checkFlashID() != RETURN_OK)
+    {
+        return RETURN_NOK;
+    }
+    if (current_bootkey_val != CORRECT_BOOTKEY)
+    {
+        chipErase();
+        firstTimeUserHandlingInit();
+        eeprom_write_word((uint16_t*)EEP_BOOTKEY_ADDR, CORRECT_BOOTKEY);
+    }
+    // No tutorial to go through
+    setMooltipassParameterInEeprom(TUTORIAL_BOOL_PARAM, FALSE);
+    return RETURN_OK;
+}
+
+/*! \fn     hostFirmwareRunMainLoop(void)
+*   \brief  Card and USB handling of the main loop in mooltipass.c, until there is nothing left to do
+*/
+void hostFirmwareRunMainLoop(void)
+{
+    RET_TYPE card_detect_ret = isCardPlugged();
+    
+    if (card_detect_ret == RETURN_JDETECT)
+    {
+        handleSmartcardInserted();
+    }
+    else if (card_detect_ret == RETURN_JRELEASED)
+    {
+        handleSmartcardRemoved();
+        usbPostStatusEvent(STATUS_EVENT_CARD_REMOVED);
+    }
+    while (hostUsbRxPending() != 0)
+    {
+        usbProcessIncoming(USB_CALLER_MAIN);
+    }
+    if ((getNbDataBlocksLeftInCurrentNode() != 0) && (hasTimerExpired(TIMER_CREDENTIALS, FALSE) == TIMER_EXPIRED))
+    {
+        clearDataNodePlaintextCache();
+    }
+}
+
+/*! \fn     hostSetUserApproval(uint8_t approve)
+*   \brief  Set the answer of the simulated user to the next requests
+*   \param  approve TRUE to approve, FALSE to deny
+*/
+void hostSetUserApproval(uint8_t approve)
+{
+    user_approval = approve;
+}
+
+/*! \fn     hostSetUserPin(uint16_t pin)
+*   \brief  Set the PIN entered by the simulated user
+*   \param  pin     The PIN
+*/
+void hostSetUserPin(uint16_t pin)
+{
+    user_pin = pin;
+}
+
+/*! \fn     hostCardErase(hostCard_t* contents)
+*   \brief  Blank card contents
+*   \param  contents    The card contents
+*/
+static void hostCardErase(hostCard_t* contents)
+{
+    memset(contents, 0xFF, sizeof(*contents));
+    contents->blank = TRUE;
+}
+
+/*! \fn     hostCardOpen(const char* image_path)
+*   \brief  Map a card image file, created blank if it doesn't exist
+*   \param  image_path  Path to the image, NULL for a blank card in memory
+*   \return 0 on success
+*/
+int hostCardOpen(const char* image_path)
+{
+    struct stat image_stat;
+    hostCard_t* mapping;
+    int fd;
+    
+    hostCardClose();
+    hostCardErase(&card_ram);
+    if (image_path == NULL)
+    {
+        return 0;
+    }
+    
+    fd = open(image_path, O_RDWR | O_CREAT, 0644);
+    if ((fd < 0) || (fstat(fd, &image_stat) != 0))
+    {
+        perror(image_path);
+        return -1;
+    }
+    if ((image_stat.st_size != 0) && (image_stat.st_size != sizeof(card_ram)))
+    {
+        fprintf(stderr, "%s: not a %lu bytes card image\n", image_path, (unsigned long)sizeof(card_ram));
+        close(fd);
+        return -1;
+    }
+    if ((image_stat.st_size == 0) && (write(fd, &card_ram, sizeof(card_ram)) != sizeof(card_ram)))
+    {
+        perror(image_path);
+        close(fd);
+        return -1;
+    }
+    mapping = mmap(NULL, sizeof(card_ram), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        perror("card: mmap");
+        return -1;
+    }
+    card = mapping;
+    return 0;
+}
+
+/*! \fn     hostCardClose(void)
+*   \brief  Unmap a possible card image file
+*/
+void hostCardClose(void)
+{
+    if (card != &card_ram)
+    {
+        munmap(card, sizeof(card_ram));
+        card = &card_ram;
+    }
+}
+
+/*! \fn     hostCardGetContents(void)
+*   \brief  Direct access to the card contents, to prepare or check them
+*   \return Pointer to the card contents
+*/
+hostCard_t* hostCardGetContents(void)
+{
+    return card;
+}
+
+/*! \fn     hostCardInsert(void)
+*   \brief  Insert the card, a blank card gets a new user once the insertion is processed
+*/
+void hostCardInsert(void)
+{
+    card_inserted = TRUE;
+    card_detect_event = RETURN_JDETECT;
+}
+
+/*! \fn     hostCardRemove(void)
+*   \brief  Remove the card
+*/
+void hostCardRemove(void)
+{
+    card_inserted = FALSE;
+    card_detect_event = RETURN_JRELEASED;
+}
+
+/*! \fn     hostUsbSetSendCallback(hostUsbSendCallback_t callback)
+*   \brief  Set the function receiving the packets sent by the firmware
+*   \param  callback    The function, 0 to drop the packets
+*/
+void hostUsbSetSendCallback(hostUsbSendCallback_t callback)
+{
+    usb_send_callback = callback;
+}
+
+/*! \fn     hostUsbQueuePacket(const uint8_t* packet, uint8_t length)
+*   \brief  Queue a packet to be received by the firmware
+*   \param  packet  The packet: [len, cmd, data]
+*   \param  length  Packet length, at most RAWHID_RX_SIZE
+*   \return FALSE if the queue is full
+*/
+uint8_t hostUsbQueuePacket(const uint8_t* packet, uint8_t length)
+{
+    uint8_t* slot;
+    
+    if ((usb_rx_count == HOST_USB_RX_QUEUE_SIZE) || (length > RAWHID_RX_SIZE))
+    {
+        return FALSE;
+    }
+    slot = usb_rx_queue[(usb_rx_head + usb_rx_count) % HOST_USB_RX_QUEUE_SIZE];
+    memset(slot, 0, RAWHID_RX_SIZE);
+    memcpy(slot, packet, length);
+    usb_rx_count++;
+    return TRUE;
+}
+
+/*! \fn     hostUsbRxPending(void)
+*   \brief  Number of queued packets the firmware hasn't received yet
+*   \return The number of packets
+*/
+uint8_t hostUsbRxPending(void)
+{
+    return usb_rx_count;
+}
+
+/******************** USB ********************/
+
+uint8_t isUsbConfigured(void)
+{
+    return TRUE;
+}
+
+RET_TYPE usbRawHidRecv(uint8_t* buffer)
+{
+    if (usb_rx_count == 0)
+    {
+        return RETURN_COM_TIMEOUT;
+    }
+    memcpy(buffer, usb_rx_queue[usb_rx_head], RAWHID_RX_SIZE);
+    usb_rx_head = (usb_rx_head + 1) % HOST_USB_RX_QUEUE_SIZE;
+    usb_rx_count--;
+    return RETURN_COM_TRANSF_OK;
+}
+
+RET_TYPE usbHidSend(uint8_t cmd, const void* buffer, uint8_t buflen)
+{
+    uint8_t packet[RAWHID_TX_SIZE];
+    uint8_t length = 0;
+    
+    // Same framing as the firmware: [len, cmd, data] if cmd is non-zero, raw buffer otherwise
+    if (cmd != 0)
+    {
+        packet[length++] = buflen;
+        packet[length++] = cmd;
+    }
+    if (buflen > RAWHID_TX_SIZE - length)
+    {
+        return RETURN_COM_NOK;
+    }
+    memcpy(&packet[length], buffer, buflen);
+    length += buflen;
+    if (usb_send_callback != 0)
+    {
+        usb_send_callback(packet, length);
+    }
+    return RETURN_COM_TRANSF_OK;
+}
+
+RET_TYPE usbSendMessage(uint8_t cmd, uint8_t size, const void* msg)
+{
+    // Send message in chunks
+    while (size > PACKET_EXPORT_SIZE)
+    {
+        usbHidSend(cmd, msg, PACKET_EXPORT_SIZE);
+        msg = (const uint8_t*)msg + PACKET_EXPORT_SIZE;
+        size -= PACKET_EXPORT_SIZE;
+    }
+    return usbHidSend(cmd, msg, size);
+}
+
+RET_TYPE usbPutstr(const char* str)
+{
+    fprintf(stderr, "%s", str);
+    return RETURN_COM_TRANSF_OK;
+}
+
+static uint8_t status_events_enabled = FALSE;
+
+uint8_t usbGetStatusEvents(void)
+{
+    return status_events_enabled;
+}
+
+void usbSetStatusEvents(uint8_t enable)
+{
+    status_events_enabled = enable;
+}
+
+void usbKeybLoadParameters(void)
+{
+}
+
+RET_TYPE usbKeyboardPress(uint8_t key, uint8_t modifier)
+{
+    (void)key;
+    (void)modifier;
+    return RETURN_OK;
+}
+
+RET_TYPE usbKeybPutStr(char* string)
+{
+    (void)string;
+    return RETURN_OK;
+}
+
+/******************** SMART CARD ********************/
+
+RET_TYPE isCardPlugged(void)
+{
+    // Report the insertion / removal once, like the detection routine
+    uint8_t event = card_detect_event;
+    
+    card_detect_event = (card_inserted == TRUE)? RETURN_DET : RETURN_REL;
+    return event;
+}
+
+RET_TYPE cardDetectedRoutine(void)
+{
+    if (card_inserted == FALSE)
+    {
+        return RETURN_MOOLTIPASS_INVALID;
+    }
+    return (card->blank == TRUE)? RETURN_MOOLTIPASS_BLANK : RETURN_MOOLTIPASS_USER;
+}
+
+RET_TYPE mooltipassDetectedRoutine(volatile uint16_t* pin_code)
+{
+    return ((card_inserted == TRUE) && (*pin_code == card->pin))? RETURN_MOOLTIPASS_4_TRIES_LEFT : RETURN_MOOLTIPASS_INVALID;
+}
+
+void removeFunctionSMC(void)
+{
+}
+
+uint8_t* readCodeProtectedZone(uint8_t* buffer)
+{
+    memcpy(buffer, card->cpz, sizeof(card->cpz));
+    return buffer;
+}
+
+void writeCodeProtectedZone(uint8_t* buffer)
+{
+    memcpy(card->cpz, buffer, sizeof(card->cpz));
+}
+
+void readAES256BitsKey(uint8_t* buffer)
+{
+    memcpy(buffer, card->aes_key, sizeof(card->aes_key));
+}
+
+RET_TYPE writeAES256BitsKey(uint8_t* buffer)
+{
+    memcpy(card->aes_key, buffer, sizeof(card->aes_key));
+    return RETURN_OK;
+}
+
+void readApplicationZone1(uint8_t* buffer)
+{
+    memcpy(buffer, card->az1, sizeof(card->az1));
+}
+
+void writeApplicationZone1(uint8_t* buffer)
+{
+    memcpy(card->az1, buffer, sizeof(card->az1));
+}
+
+void readApplicationZone2(uint8_t* buffer)
+{
+    memcpy(buffer, card->az2, sizeof(card->az2));
+}
+
+void writeApplicationZone2(uint8_t* buffer)
+{
+    memcpy(card->az2, buffer, sizeof(card->az2));
+}
+
+void eraseApplicationZone1NZone2SMC(uint8_t zone1_nzone2)
+{
+    memset((zone1_nzone2 == TRUE)? card->az1 : card->az2, 0xFF, sizeof(card->az1));
+}
+
+void readMooltipassWebsiteLogin(uint8_t* buffer)
+{
+    memcpy(buffer, &card->az2[SMARTCARD_MTP_LOGIN_OFFSET/8], SMARTCARD_MTP_LOGIN_LENGTH/8);
+}
+
+void readMooltipassWebsitePassword(uint8_t* buffer)
+{
+    memcpy(buffer, &card->az1[SMARTCARD_MTP_PASS_OFFSET/8], SMARTCARD_MTP_PASS_LENGTH/8);
+}
+
+void writeSecurityCode(volatile uint16_t* code)
+{
+    card->pin = *code;
+    card->blank = FALSE;
+}
+
+void eraseSmartCard(void)
+{
+    hostCardErase(card);
+}
+
+/******************** GUI ********************/
+
+RET_TYPE guiAskForConfirmation(uint8_t nb_args, confirmationText_t* text_object)
+{
+    (void)nb_args;
+    (void)text_object;
+    return (user_approval == TRUE)? RETURN_OK : RETURN_NOK;
+}
+
+RET_TYPE guiCardUnlockingProcess(void)
+{
+    volatile uint16_t pin = user_pin;
+    
+    if (user_approval == FALSE)
+    {
+        return RETURN_NOK;
+    }
+    return (mooltipassDetectedRoutine(&pin) == RETURN_MOOLTIPASS_4_TRIES_LEFT)? RETURN_OK : RETURN_NOK;
+}
+
+RET_TYPE guiAskForNewPin(volatile uint16_t* new_pin, uint8_t message_id)
+{
+    (void)message_id;
+    *new_pin = user_pin;
+    return (user_approval == TRUE)? RETURN_NEW_PIN_OK : RETURN_NEW_PIN_NOK;
+}
+
+uint16_t guiAskForLoginSelect(pNode* p, cNode* c, uint16_t parentNodeAddress, uint8_t bypass_confirmation)
+{
+    (void)c;
+    (void)bypass_confirmation;
+    
+    // The user picks the first login
+    if (user_approval == FALSE)
+    {
+        return NODE_ADDR_NULL;
+    }
+    readParentNode(p, parentNodeAddress);
+    return p->nextChildAddress;
+}
+
+uint16_t favoriteSelectionScreen(pNode* p, cNode* c)
+{
+    (void)p;
+    (void)c;
+    return NODE_ADDR_NULL;
+}
+
+uint16_t loginSelectionScreen(void)
+{
+    return NODE_ADDR_NULL;
+}
+
+uint8_t getCurrentScreen(void)
+{
+    return current_screen;
+}
+
+void guiSetCurrentScreen(uint8_t screen)
+{
+    current_screen = screen;
+}
+
+void guiGetBackToCurrentScreen(void)
+{
+}
+
+void guiDisplayInformationOnScreen(uint8_t stringID)
+{
+    (void)stringID;
+}
+
+void guiDisplayLoginOrPasswordOnScreen(char* text)
+{
+    (void)text;
+}
+
+void guiDisplayProcessingScreen(void)
+{
+}
+
+void guiDisplaySmartcardUnlockedScreen(uint8_t* username)
+{
+    (void)username;
+}
+
+void activityDetectedRoutine(void)
+{
+}
+
+void userViewDelay(void)
+{
+}
+
+/******************** RNG ********************/
+
+void fillArrayWithRandomBytes(uint8_t* buffer, uint8_t nb_bytes)
+{
+    // Deterministic, reseeded by hostFirmwareInit()
+    while (nb_bytes--)
+    {
+        *buffer++ = (uint8_t)rand();
+    }
+}
@@ -0,0 +1,65 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     host_firmware.h
+*    \brief    Host replacements for the hardware facing firmware modules (USB, smart card, GUI, RNG)
+*    Created:  19/10/2026
+*/
+#ifndef HOST_FIRMWARE_H_
+#define HOST_FIRMWARE_H_
+
+#include <stdint.h>
+#include "smartcard.h"
+#include "defines.h"
+
+/* PIN entered by the simulated user unless set otherwise */
+#define HOST_DEFAULT_PIN        0x1234
+
+/* Number of packets waiting to be processed by the firmware */
+#define HOST_USB_RX_QUEUE_SIZE  16
+
+/* Simulated smart card contents */
+typedef struct
+{
+    uint8_t blank;
+    uint16_t pin;
+    uint8_t cpz[SMARTCARD_CPZ_LENGTH];
+    uint8_t aes_key[AES_KEY_LENGTH/8];
+    uint8_t az1[SMARTCARD_AZ_BIT_LENGTH/8];
+    uint8_t az2[SMARTCARD_AZ_BIT_LENGTH/8];
+} hostCard_t;
+
+/* Called for each packet sent by the firmware */
+typedef void (*hostUsbSendCallback_t)(const uint8_t* packet, uint8_t length);
+
+void hostFirmwareInit(void);
+RET_TYPE hostFirmwareBoot(void);
+void hostFirmwareRunMainLoop(void);
+void hostSetUserApproval(uint8_t approve);
+void hostSetUserPin(uint16_t pin);
+int hostCardOpen(const char* image_path);
+hostCard_t* hostCardGetContents(void);
+void hostCardClose(void);
+void hostCardInsert(void);
+void hostCardRemove(void);
+void hostUsbSetSendCallback(hostUsbSendCallback_t callback);
+uint8_t hostUsbQueuePacket(const uint8_t* packet, uint8_t length);
+uint8_t hostUsbRxPending(void);
+
+#endif /* HOST_FIRMWARE_H_ */
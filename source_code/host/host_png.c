@@ -0,0 +1,185 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     host_png.c
+*    \brief    Minimal grayscale PNG writer for the host display models
+*    Created:  19/10/2026
+*/
+/*
+ * Frames are small (a few KB), so the image data is stored in uncompressed
+ * deflate blocks: no zlib dependency and byte identical files for identical
+ * frames.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "host_png.h"
+
+/* Largest stored deflate block */
+#define PNG_MAX_STORED_BLOCK    65535
+
+
+/*! \fn     hostCrc32(uint32_t crc, const uint8_t* data, size_t length)
+*   \brief  CRC32 as used by PNG and zip, chainable
+*   \param  crc     0 or the CRC of the previous data
+*   \param  data    The data
+*   \param  length  Its length
+*   \return The CRC
+*/
+uint32_t hostCrc32(uint32_t crc, const uint8_t* data, size_t length)
+{
+    static uint32_t table[256];
+    
+    if (table[1] == 0)
+    {
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t value = i;
+            
+            for (uint8_t bit = 0; bit < 8; bit++)
+            {
+                value = (value & 1)? (0xEDB88320UL ^ (value >> 1)) : (value >> 1);
+            }
+            table[i] = value;
+        }
+    }
+    crc = ~crc;
+    while (length--)
+    {
+        crc = table[(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+/*! \fn     pngPut32(uint8_t* buffer, uint32_t value)
+*   \brief  Store a big endian 32 bits value
+*   \param  buffer  Where to store it
+*   \param  value   The value
+*/
+static void pngPut32(uint8_t* buffer, uint32_t value)
+{
+    buffer[0] = value >> 24;
+    buffer[1] = value >> 16;
+    buffer[2] = value >> 8;
+    buffer[3] = value;
+}
+
+/*! \fn     pngWriteChunk(FILE* file, const char* type, const uint8_t* data, uint32_t length)
+*   \brief  Write a PNG chunk
+*   \param  file    The file
+*   \param  type    4 letters chunk type
+*   \param  data    Chunk data
+*   \param  length  Its length
+*   \return 0 on success
+*/
+static int pngWriteChunk(FILE* file, const char* type, const uint8_t* data, uint32_t length)
+{
+    uint8_t header[8];
+    uint8_t trailer[4];
+    uint32_t crc;
+    
+    pngPut32(header, length);
+    memcpy(&header[4], type, 4);
+    crc = hostCrc32(0, &header[4], 4);
+    crc = hostCrc32(crc, data, length);
+    pngPut32(trailer, crc);
+    if ((fwrite(header, sizeof(header), 1, file) != 1) || ((length != 0) && (fwrite(data, length, 1, file) != 1)) || (fwrite(trailer, sizeof(trailer), 1, file) != 1))
+    {
+        return -1;
+    }
+    return 0;
+}
+
+/*! \fn     hostPngWriteGray(const char* path, const uint8_t* pixels, uint16_t width, uint16_t height)
+*   \brief  Write an 8 bits grayscale PNG
+*   \param  path    File path
+*   \param  pixels  width * height gray levels, row after row
+*   \param  width   Image width
+*   \param  height  Image height
+*   \return 0 on success
+*/
+int hostPngWriteGray(const char* path, const uint8_t* pixels, uint16_t width, uint16_t height)
+{
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    uint32_t raw_length = (uint32_t)height * (width + 1);
+    uint32_t nb_blocks = (raw_length + PNG_MAX_STORED_BLOCK - 1) / PNG_MAX_STORED_BLOCK;
+    uint8_t* idat = malloc(2 + raw_length + nb_blocks * 5 + 4);
+    uint32_t adler_a = 1, adler_b = 0;
+    uint32_t raw_index = 0;
+    uint32_t idat_length = 0;
+    uint8_t ihdr[13];
+    FILE* file;
+    int ret = 0;
+    
+    if (idat == NULL)
+    {
+        return -1;
+    }
+    
+    // zlib stream of stored blocks, each scanline starting with filter type 0
+    idat[idat_length++] = 0x78;
+    idat[idat_length++] = 0x01;
+    while (raw_index < raw_length)
+    {
+        uint32_t block_length = raw_length - raw_index;
+        
+        if (block_length > PNG_MAX_STORED_BLOCK)
+        {
+            block_length = PNG_MAX_STORED_BLOCK;
+        }
+        idat[idat_length++] = (raw_index + block_length == raw_length)? 0x01 : 0x00;
+        idat[idat_length++] = block_length & 0xFF;
+        idat[idat_length++] = block_length >> 8;
+        idat[idat_length++] = ~block_length & 0xFF;
+        idat[idat_length++] = (~block_length >> 8) & 0xFF;
+        for (uint32_t i = 0; i < block_length; i++, raw_index++)
+        {
+            uint32_t column = raw_index % (width + 1);
+            uint8_t value = (column == 0)? 0 : pixels[(raw_index / (width + 1)) * width + column - 1];
+            
+            idat[idat_length++] = value;
+            adler_a = (adler_a + value) % 65521;
+            adler_b = (adler_b + adler_a) % 65521;
+        }
+    }
+    pngPut32(&idat[idat_length], (adler_b << 16) | adler_a);
+    idat_length += 4;
+    
+    pngPut32(&ihdr[0], width);
+    pngPut32(&ihdr[4], height);
+    ihdr[8] = 8;        // bit depth
+    ihdr[9] = 0;        // grayscale
+    ihdr[10] = 0;       // deflate
+    ihdr[11] = 0;       // adaptive filtering
+    ihdr[12] = 0;       // no interlace
+    
+    file = fopen(path, "wb");
+    if ((file == NULL) || (fwrite(signature, sizeof(signature), 1, file) != 1) || (pngWriteChunk(file, "IHDR", ihdr, sizeof(ihdr)) != 0) ||
+        (pngWriteChunk(file, "IDAT", idat, idat_length) != 0) || (pngWriteChunk(file, "IEND", NULL, 0) != 0))
+    {
+        perror(path);
+        ret = -1;
+    }
+    if ((file != NULL) && (fclose(file) != 0))
+    {
+        ret = -1;
+    }
+    free(idat);
+    return ret;
+}
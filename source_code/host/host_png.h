@@ -0,0 +1,33 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     host_png.h
+*    \brief    Minimal grayscale PNG writer for the host display models
+*    Created:  19/10/2026
+*/
+#ifndef HOST_PNG_H_
+#define HOST_PNG_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+uint32_t hostCrc32(uint32_t crc, const uint8_t* data, size_t length);
+int hostPngWriteGray(const char* path, const uint8_t* pixels, uint16_t width, uint16_t height);
+
+#endif /* HOST_PNG_H_ */
@@ -0,0 +1,36 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     host_stubs.c
+*    \brief    Definitions backing the host avr-libc replacement headers
+*    Created:  19/10/2026
+*/
+#include <avr/io.h>
+
+/* Only written by disableJTAG(), never read back on the host */
+volatile uint8_t MCUCR;
+
+/* Port registers, see avr/io.h */
+volatile uint8_t host_PORTB, host_PORTC, host_PORTD, host_PORTE, host_PORTF;
+volatile uint8_t DDRB, DDRC, DDRD, DDRE, DDRF;
+volatile uint8_t PINB, PINC, PIND, PINE, PINF;
+
+/* Watchdog registers, see avr/wdt.h */
+volatile uint8_t WDTCSR;
+volatile uint8_t MCUSR;
@@ -0,0 +1,73 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     host_test.c
+*    \brief    Helpers shared by the host test programs
+*    Created:  19/10/2026
+*/
+#include "host_test.h"
+#include "host_png.h"
+#if defined(MINI_VERSION)
+    #include "ssd1305_model.h"
+#else
+    #include "ssd1322_model.h"
+#endif
+
+// Random generator state, only depends on the seed
+static uint32_t host_test_rng_state = 1;
+
+
+/*! \fn     hostTestSeed(uint32_t seed)
+*   \brief  Restart the random sequence
+*   \param  seed    Seed of the sequence, not 0
+*/
+void hostTestSeed(uint32_t seed)
+{
+    host_test_rng_state = seed;
+}
+
+/*! \fn     hostTestRandom(void)
+*   \brief  Deterministic xorshift random number generator
+*   \return Random number
+*/
+uint32_t hostTestRandom(void)
+{
+    host_test_rng_state ^= host_test_rng_state << 13;
+    host_test_rng_state ^= host_test_rng_state >> 17;
+    host_test_rng_state ^= host_test_rng_state << 5;
+    return host_test_rng_state;
+}
+
+/*! \fn     hostTestFrameCrc(void)
+*   \brief  Checksum the frame displayed by the OLED controller model
+*   \return CRC32 of the frame
+*/
+uint32_t hostTestFrameCrc(void)
+{
+    #if defined(MINI_VERSION)
+        uint8_t frame[SSD1305_FRAME_SIZE];
+        
+        ssd1305GetFrame(frame);
+    #else
+        uint8_t frame[SSD1322_FRAME_SIZE];
+        
+        ssd1322GetFrame(frame);
+    #endif
+    return hostCrc32(0, frame, sizeof(frame));
+}
@@ -0,0 +1,44 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     host_test.h
+*    \brief    Helpers shared by the host test programs
+*    Created:  19/10/2026
+*/
+#ifndef HOST_TEST_H_
+#define HOST_TEST_H_
+
+#include <stdint.h>
+#include "defines.h"
+
+// Compiled out by defines.h when the firmware has no debug output
+#undef printf
+
+/* Media bundle loaded in the graphics zone by the display tests */
+#if defined(MINI_VERSION)
+    #define HOST_TEST_DEFAULT_BUNDLE    "../bitmaps/mini/bundle.img"
+#else
+    #define HOST_TEST_DEFAULT_BUNDLE    "../bitmaps/bundle_tutorial.img"
+#endif
+
+void hostTestSeed(uint32_t seed);
+uint32_t hostTestRandom(void);
+uint32_t hostTestFrameCrc(void);
+
+#endif /* HOST_TEST_H_ */
@@ -0,0 +1,174 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     host_time.c
+*    \brief    Simulated time for the host builds
+*    Created:  19/10/2026
+*/
+/*
+ * Host builds don't have the 1ms interrupt: time only passes when the firmware
+ * talks to the flash model or polls a timer, which makes runs deterministic.
+ * This file replaces timer_manager.c with the same API on top of that clock.
+ */
+#include "timer_manager.h"
+#include "interrupts.h"
+#include "host_time.h"
+
+/* Slow timers are decremented when the 16 bits ms divider rolls over */
+#define HOST_FAST_TIMER_UNIT    1000000ULL
+#define HOST_SLOW_TIMER_UNIT    (HOST_FAST_TIMER_UNIT * 65536ULL)
+
+// Simulated time in ns
+static uint64_t host_time = 0;
+// Timers expiry time, flag
+static uint64_t timer_expiry[TOTAL_NUMBER_OF_TIMERS];
+static uint8_t timer_running[TOTAL_NUMBER_OF_TIMERS];
+static uint8_t timer_flag[TOTAL_NUMBER_OF_TIMERS];
+
+
+/*! \fn     hostTimeGet(void)
+*   \brief  Get the simulated time
+*   \return Time in ns
+*/
+uint64_t hostTimeGet(void)
+{
+    return host_time;
+}
+
+/*! \fn     hostTimeAdvance(uint64_t time)
+*   \brief  Let simulated time pass
+*   \param  time    Time in ns
+*/
+void hostTimeAdvance(uint64_t time)
+{
+    host_time += time;
+    
+    for (uint8_t i = 0; i < TOTAL_NUMBER_OF_TIMERS; i++)
+    {
+        if ((timer_running[i] == TRUE) && (host_time >= timer_expiry[i]))
+        {
+            timer_running[i] = FALSE;
+            timer_flag[i] = TIMER_EXPIRED;
+        }
+    }
+}
+
+/*! \fn     millis(void)
+*   \brief  Simulated time in ms, replaces the debug timer
+*   \return Time in ms
+*/
+uint32_t millis(void)
+{
+    return (uint32_t)(host_time / 1000000ULL);
+}
+
+/*! \fn     micros(void)
+*   \brief  Simulated time in us, replaces the debug timer
+*   \return Time in us
+*/
+uint32_t micros(void)
+{
+    return (uint32_t)(host_time / 1000ULL);
+}
+
+/*! \fn     timerManagerTick(void)
+*   \brief  Nothing to do, timers are updated when time passes
+*/
+void timerManagerTick(void)
+{
+}
+
+/*! \fn     hasTimerExpired(uint8_t uid, uint8_t clear)
+*   \brief  Know if a timer expired and clear the flag if so
+*   \param  uid     Unique ID
+*   \param  clear   Boolean to say if we clear the flag
+*   \return TIMER_EXPIRED or TIMER_RUNNING
+*/
+RET_TYPE hasTimerExpired(uint8_t uid, uint8_t clear)
+{
+    if (timer_flag[uid] == TIMER_EXPIRED)
+    {
+        if (clear == TRUE)
+        {
+            timer_flag[uid] = TIMER_RUNNING;
+        }
+        return TIMER_EXPIRED;
+    }
+    hostTimeAdvance(HOST_TIMER_POLL_TIME);
+    return TIMER_RUNNING;
+}
+
+/*! \fn     activateTimer(uint8_t uid, uint16_t val)
+*   \brief  Activate timer
+*   \param  uid Unique ID
+*   \param  val Delay
+*/
+void activateTimer(uint8_t uid, uint16_t val)
+{
+    // Like the firmware, activating a timer with its current value doesn't restart it
+    if (getTimerVal(uid) == val)
+    {
+        return;
+    }
+    
+    timer_expiry[uid] = host_time + (uint64_t)val * ((uid < NUMBER_OF_FAST_TIMERS)? HOST_FAST_TIMER_UNIT : HOST_SLOW_TIMER_UNIT);
+    timer_running[uid] = (val == 0)? FALSE : TRUE;
+    timer_flag[uid] = (val == 0)? TIMER_EXPIRED : TIMER_RUNNING;
+}
+
+/*! \fn     getTimerVal(uint8_t uid)
+*   \brief  Get current timer val
+*   \param  uid     Unique ID
+*   \return the timer val
+*/
+uint16_t getTimerVal(uint8_t uid)
+{
+    uint64_t unit = (uid < NUMBER_OF_FAST_TIMERS)? HOST_FAST_TIMER_UNIT : HOST_SLOW_TIMER_UNIT;
+    
+    if (timer_running[uid] == FALSE)
+    {
+        return 0;
+    }
+    return (uint16_t)((timer_expiry[uid] - host_time + unit - 1) / unit);
+}
+
+/*! \fn     timerBasedDelayMs(uint16_t ms)
+*   \brief  Timer based ms delay
+*   \param  ms  Number of ms
+*/
+void timerBasedDelayMs(uint16_t ms)
+{
+    hostTimeAdvance((uint64_t)ms * HOST_FAST_TIMER_UNIT);
+}
+
+/*! \fn     timerBased130MsDelay(void)
+*   \brief  Many times in our code such delay is needed.
+*/
+void timerBased130MsDelay(void)
+{
+    timerBasedDelayMs(130);
+}
+
+/*! \fn     timerBased500MsDelay(void)
+*   \brief  Many times in our code such delay is needed.
+*/
+void timerBased500MsDelay(void)
+{
+    timerBasedDelayMs(500);
+}
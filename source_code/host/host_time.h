@@ -0,0 +1,35 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     host_time.h
+*    \brief    Simulated time for the host builds
+*    Created:  19/10/2026
+*/
+#ifndef HOST_TIME_H_
+#define HOST_TIME_H_
+
+#include <stdint.h>
+
+/* Time spent by each timer poll, so that the firmware busy loops terminate */
+#define HOST_TIMER_POLL_TIME    1000ULL
+
+uint64_t hostTimeGet(void);
+void hostTimeAdvance(uint64_t time);
+
+#endif /* HOST_TIME_H_ */
@@ -0,0 +1,97 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     io.h
+*    \brief    Host replacement for the avr-libc IO header
+*    Created:  19/10/2026
+*/
+#ifndef HOST_AVR_IO_H_
+#define HOST_AVR_IO_H_
+
+#include <stdint.h>
+
+#define _BV(bit)    (1 << (bit))
+
+/* Registers touched by the portable modules' inline helpers */
+extern volatile uint8_t MCUCR;
+#define JTD         7
+
+/*
+ * Port registers: each access goes through hostPortSync() so that the flash model
+ * sees chip select changes between two SPI transfers (see at45db_model.c)
+ */
+volatile uint8_t* hostPortSync(volatile uint8_t* port);
+extern volatile uint8_t host_PORTB;
+extern volatile uint8_t host_PORTC;
+extern volatile uint8_t host_PORTD;
+extern volatile uint8_t host_PORTE;
+extern volatile uint8_t host_PORTF;
+#define PORTB       (*hostPortSync(&host_PORTB))
+#define PORTC       (*hostPortSync(&host_PORTC))
+#define PORTD       (*hostPortSync(&host_PORTD))
+#define PORTE       (*hostPortSync(&host_PORTE))
+#define PORTF       (*hostPortSync(&host_PORTF))
+
+/* Data direction and input registers are plain variables */
+extern volatile uint8_t DDRB, DDRC, DDRD, DDRE, DDRF;
+extern volatile uint8_t PINB, PINC, PIND, PINE, PINF;
+
+/* Port bit numbers */
+#define PORTB0     0
+#define PORTB1     1
+#define PORTB2     2
+#define PORTB3     3
+#define PORTB4     4
+#define PORTB5     5
+#define PORTB6     6
+#define PORTB7     7
+#define PORTC0     0
+#define PORTC1     1
+#define PORTC2     2
+#define PORTC3     3
+#define PORTC4     4
+#define PORTC5     5
+#define PORTC6     6
+#define PORTC7     7
+#define PORTD0     0
+#define PORTD1     1
+#define PORTD2     2
+#define PORTD3     3
+#define PORTD4     4
+#define PORTD5     5
+#define PORTD6     6
+#define PORTD7     7
+#define PORTE0     0
+#define PORTE1     1
+#define PORTE2     2
+#define PORTE3     3
+#define PORTE4     4
+#define PORTE5     5
+#define PORTE6     6
+#define PORTE7     7
+#define PORTF0     0
+#define PORTF1     1
+#define PORTF2     2
+#define PORTF3     3
+#define PORTF4     4
+#define PORTF5     5
+#define PORTF6     6
+#define PORTF7     7
+
+#endif /* HOST_AVR_IO_H_ */
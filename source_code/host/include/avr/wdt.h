@@ -0,0 +1,43 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     wdt.h
+*    \brief    Host replacement for the avr-libc watchdog header
+*    Created:  19/10/2026
+*/
+#ifndef HOST_AVR_WDT_H_
+#define HOST_AVR_WDT_H_
+
+#include <avr/io.h>
+
+/* No watchdog on the host: its registers are only written */
+extern volatile uint8_t WDTCSR;
+extern volatile uint8_t MCUSR;
+#define WDP0        0
+#define WDP1        1
+#define WDP2        2
+#define WDE         3
+#define WDCE        4
+#define WDP3        5
+#define WDIE        6
+#define WDRF        3
+
+#define wdt_reset()
+
+#endif /* HOST_AVR_WDT_H_ */
@@ -0,0 +1,96 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     spi.h
+*    \brief    Host replacement for the USART SPI functions, connected to the flash and OLED models
+*    Created:  19/10/2026
+*/
+#ifndef _SPI_H_
+#define _SPI_H_
+
+#include <stdint.h>
+#include "at45db_model.h"
+#if defined(MINI_VERSION)
+    #include "ssd1305_model.h"
+    #define hostOledSelected()      ssd1305Selected()
+    #define hostOledTransfer(data)  ssd1305Transfer(data)
+#else
+    #include "ssd1322_model.h"
+    #define hostOledSelected()      ssd1322Selected()
+    #define hostOledTransfer(data)  ssd1322Transfer(data)
+#endif
+
+/* Same API as src/SPI/spi.h, the OLED model only gets bytes once opened (see ssd1322_model.c & ssd1305_model.c) */
+#define SPI_RATE_8_MHZ      0
+#define SPI_RATE_4_MHZ      1
+#define SPI_RATE_2_MHZ      3
+#define SPI_RATE_1_MHZ      7
+#define SPI_RATE_800_KHZ    9
+#define SPI_RATE_500_KHZ    15
+#define SPI_RATE_400_KHZ    19
+#define SPI_RATE_100_KHZ    79
+
+static inline void spiUsartBegin(void) {}
+static inline void spiUsartSetRate(uint16_t rate) {(void)rate;}
+
+static inline uint8_t hostSpiUsartTransfer(uint8_t data)
+{
+    if (hostOledSelected() != 0)
+    {
+        return hostOledTransfer(data);
+    }
+    return at45dbTransfer(data);
+}
+
+static inline uint8_t spiUsartTransfer(uint8_t data)
+{
+    return hostSpiUsartTransfer(data);
+}
+
+static inline void spiUsartDummyWrite(void)
+{
+    hostSpiUsartTransfer(0x00);
+}
+
+static inline void spiUsartSendTransfer(uint8_t data)
+{
+    hostSpiUsartTransfer(data);
+}
+
+static inline void spiUsartWaitEndSendTransfer(void)
+{
+}
+
+static inline void spiUsartRead(uint8_t *data, uint16_t size)
+{
+    while (size--)
+    {
+        *data++ = hostSpiUsartTransfer(0);
+    }
+}
+
+static inline void spiUsartWrite(uint8_t *data, uint16_t size)
+{
+    while (size--)
+    {
+        hostSpiUsartTransfer(*data++);
+    }
+}
+
+#endif /* _SPI_H_ */
@@ -0,0 +1,560 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     node_mgmt_bench.c
+*    \brief    Node management benchmark against the AT45DB model
+*    Created:  19/10/2026
+*/
+/*
+ * Synthetic user databases are built in the flash model, then the node
+ * management operations are timed on the first user's database. Costs are
+ * the simulated time, SPI bytes and page programs of the model, which are
+ * deterministic for a given seed and can be compared against a baseline.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "at45db_model.h"
+#include "host_baseline.h"
+#include "host_eeprom.h"
+#include "host_test.h"
+#include "host_time.h"
+#pragma pack(push, 1)
+#include "logic_aes_and_comms.h"
+#include "logic_eeprom.h"
+#include "node_mgmt.h"
+#include "flash_mem.h"
+#include "defines.h"
+#pragma pack(pop)
+
+// Default corpora, services of the benchmarked user
+#define BENCH_DEFAULT_CORPORA   "10,100,1000,10000"
+// Number of timed operations of each kind
+#define BENCH_DEFAULT_NB_OPS    50
+// Other users get this fraction of the benchmarked user services
+#define BENCH_OTHER_USERS_DIV   10
+// Data services per user and data nodes per data service
+#define BENCH_DATA_SERVICES     4
+#define BENCH_DATA_NODES        8
+// Tolerated increase over the baseline, in percent
+#define BENCH_DEFAULT_TOLERANCE 2.0
+#define BENCH_MAX_CORPORA       16
+
+// Operation IDs
+enum bench_op_t {OP_POPULATE_LUT = 0, OP_SEARCH_SERVICE, OP_CREATE_PARENT, OP_CREATE_CHILD, OP_UPDATE_CHILD, OP_DELETE_CHILD, OP_WRITE_DATA_NODE, NB_BENCH_OPS};
+static const char* bench_op_names[NB_BENCH_OPS] = {"populateServicesLut", "searchForServiceName", "createParentNode", "createChildNode", "updateChildNode", "deleteChildNode", "writeNewDataNode"};
+
+// First letter distributions
+enum bench_letters_t {LETTERS_DOMAINS = 0, LETTERS_UNIFORM, LETTERS_SINGLE};
+// Rough first letter frequencies of domain names, in per mille, a to z
+static const uint16_t domain_letter_weights[26] = {60, 70, 90, 50, 30, 50, 50, 40, 30, 10, 20, 40, 80, 30, 20, 70, 5, 40, 110, 60, 10, 20, 30, 5, 10, 20};
+
+typedef struct
+{
+    uint32_t count;
+    uint64_t time;          // Simulated time in ns
+    uint64_t max_time;
+    uint64_t spi_bytes;
+    uint64_t page_programs;
+} benchOpStats_t;
+
+typedef struct
+{
+    char name[NODE_PARENT_SIZE_OF_SERVICE];
+    uint8_t nb_children;
+    uint16_t address;
+} benchService_t;
+
+// Results of the current corpus
+static benchOpStats_t bench_stats[NB_BENCH_OPS];
+// Costs at the start of the operation being measured
+static uint64_t start_time, start_spi_bytes, start_page_programs;
+// Simulated time at the start of the current corpus
+static uint64_t corpus_start_time;
+static uint8_t letter_distribution = LETTERS_DOMAINS;
+static pNode bench_pnode;
+static cNode bench_cnode;
+static dNode bench_dnode;
+// Results of all corpora, values of the operations
+static const hostBaselineColumn_t bench_columns[3] = {{"mean time", 1, FALSE}, {"SPI bytes", 1, FALSE}, {"page programs", 2, FALSE}};
+static hostBaseline_t baseline;
+
+
+/*! \fn     benchServiceName(char* buffer, uint32_t index)
+*   \brief  Generate a unique service name following the selected first letter distribution
+*   \param  buffer  Buffer of NODE_PARENT_SIZE_OF_SERVICE bytes
+*   \param  index   Unique index
+*/
+static void benchServiceName(char* buffer, uint32_t index)
+{
+    char letter = 'a';
+    char body[12];
+    uint8_t length = 3 + hostTestRandom() % (sizeof(body) - 3);
+    
+    if (letter_distribution == LETTERS_UNIFORM)
+    {
+        letter = 'a' + hostTestRandom() % 26;
+    }
+    else if (letter_distribution == LETTERS_DOMAINS)
+    {
+        uint32_t weight = hostTestRandom() % 1000;
+        
+        while ((letter < 'z') && (weight >= domain_letter_weights[letter - 'a']))
+        {
+            weight -= domain_letter_weights[letter - 'a'];
+            letter++;
+        }
+    }
+    for (uint8_t i = 0; i < length; i++)
+    {
+        body[i] = 'a' + hostTestRandom() % 26;
+    }
+    body[length] = 0;
+    memset(buffer, 0, NODE_PARENT_SIZE_OF_SERVICE);
+    snprintf(buffer, NODE_PARENT_SIZE_OF_SERVICE, "%c%s%u.com", letter, body, index);
+}
+
+/*! \fn     compareServicesDescending(const void* a, const void* b)
+*   \brief  qsort comparison, reverse alphabetical order
+*/
+static int compareServicesDescending(const void* a, const void* b)
+{
+    return strncmp(((const benchService_t*)b)->name, ((const benchService_t*)a)->name, NODE_PARENT_SIZE_OF_SERVICE);
+}
+
+/*! \fn     benchStart(void)
+*   \brief  Start measuring an operation
+*/
+static void benchStart(void)
+{
+    const at45dbStats_t* stats = at45dbGetStats();
+    
+    start_time = hostTimeGet();
+    start_spi_bytes = stats->spi_bytes;
+    start_page_programs = stats->page_programs;
+}
+
+/*! \fn     benchStop(uint8_t op)
+*   \brief  Account for the operation being measured
+*   \param  op      Operation ID
+*/
+static void benchStop(uint8_t op)
+{
+    const at45dbStats_t* stats = at45dbGetStats();
+    uint64_t time = hostTimeGet() - start_time;
+    
+    bench_stats[op].count++;
+    bench_stats[op].time += time;
+    bench_stats[op].spi_bytes += stats->spi_bytes - start_spi_bytes;
+    bench_stats[op].page_programs += stats->page_programs - start_page_programs;
+    if (time > bench_stats[op].max_time)
+    {
+        bench_stats[op].max_time = time;
+    }
+}
+
+/*! \fn     fillChildNode(uint8_t login_index)
+*   \brief  Prepare the child node buffer
+*   \param  login_index     Index used for the login name
+*/
+static void fillChildNode(uint8_t login_index)
+{
+    memset((void*)&bench_cnode, 0, NODE_SIZE);
+    for (uint8_t i = 0; i < NODE_CHILD_SIZE_OF_PASSWORD; i++)
+    {
+        bench_cnode.password[i] = hostTestRandom();
+    }
+    snprintf((char*)bench_cnode.login, sizeof(bench_cnode.login), "login%u@mail.com", login_index);
+    strcpy((char*)bench_cnode.description, "benchmark");
+}
+
+/*! \fn     writeDataService(uint32_t index, uint8_t measure)
+*   \brief  Create a data service and fill it with data nodes
+*   \param  index   Unique service index
+*   \param  measure TRUE to measure the data node writes
+*   \return Success status
+*/
+static RET_TYPE writeDataService(uint32_t index, uint8_t measure)
+{
+    uint16_t parent_address;
+    RET_TYPE ret;
+    
+    memset((void*)&bench_pnode, 0, NODE_SIZE);
+    benchServiceName((char*)bench_pnode.service, index);
+    if (createParentNode(&bench_pnode, SERVICE_DATA_TYPE) != RETURN_OK)
+    {
+        return RETURN_NOK;
+    }
+    parent_address = searchForServiceName(bench_pnode.service, COMPARE_MODE_MATCH, SERVICE_DATA_TYPE);
+    readParentNode(&bench_pnode, parent_address);
+    for (uint8_t i = 0; i < BENCH_DATA_NODES; i++)
+    {
+        memset((void*)&bench_dnode, 0, NODE_SIZE);
+        memset((void*)bench_dnode.data, i, sizeof(bench_dnode.data));
+        bench_dnode.flags = DATA_NODE_DATA_LENGTH;
+        if (measure == TRUE)
+        {
+            benchStart();
+        }
+        ret = writeNewDataNode(parent_address, &bench_pnode, &bench_dnode, (i == 0)? TRUE : FALSE, (i == BENCH_DATA_NODES - 1)? TRUE : FALSE);
+        if (measure == TRUE)
+        {
+            benchStop(OP_WRITE_DATA_NODE);
+        }
+        if (ret != RETURN_OK)
+        {
+            return RETURN_NOK;
+        }
+    }
+    return RETURN_OK;
+}
+
+/*! \fn     populateUser(uint8_t uid, benchService_t* services, uint32_t nb_services, uint32_t first_index)
+*   \brief  Create a user database without measuring it
+*   \param  uid             User ID
+*   \param  services        Services to create, sorted in reverse alphabetical order
+*   \param  nb_services     Number of services
+*   \param  first_index     First unique index for the data services
+*   \return Success status
+*/
+static RET_TYPE populateUser(uint8_t uid, benchService_t* services, uint32_t nb_services, uint32_t first_index)
+{
+    formatUserProfileMemory(uid);
+    initNodeManagementHandle(uid);
+    
+    // Each node is created at the head of its list, the LUT is populated once at the end
+    setMooltipassParameterInEeprom(LUT_BOOT_POPULATING_PARAM, FALSE);
+    for (uint32_t i = 0; i < nb_services; i++)
+    {
+        memset((void*)&bench_pnode, 0, NODE_SIZE);
+        memcpy((void*)bench_pnode.service, services[i].name, sizeof(services[i].name));
+        if (createParentNode(&bench_pnode, SERVICE_CRED_TYPE) != RETURN_OK)
+        {
+            return RETURN_NOK;
+        }
+        services[i].address = getStartingParentAddress();
+        for (uint8_t j = services[i].nb_children; j > 0; j--)
+        {
+            fillChildNode(j - 1);
+            if (createChildNode(services[i].address, &bench_cnode) != RETURN_OK)
+            {
+                return RETURN_NOK;
+            }
+        }
+    }
+    for (uint32_t i = 0; i < BENCH_DATA_SERVICES; i++)
+    {
+        if (writeDataService(first_index + i, FALSE) != RETURN_OK)
+        {
+            return RETURN_NOK;
+        }
+    }
+    setMooltipassParameterInEeprom(LUT_BOOT_POPULATING_PARAM, TRUE);
+    return RETURN_OK;
+}
+
+/*! \fn     generateServices(uint32_t nb_services, uint32_t first_index, uint32_t* nb_nodes)
+*   \brief  Generate services with their number of logins, sorted in reverse alphabetical order
+*   \param  nb_services     Number of services
+*   \param  first_index     First unique index
+*   \param  nb_nodes        Incremented by the number of nodes needed
+*   \return Services array, to be freed
+*/
+static benchService_t* generateServices(uint32_t nb_services, uint32_t first_index, uint32_t* nb_nodes)
+{
+    benchService_t* services = calloc(nb_services + 1, sizeof(benchService_t));
+    
+    for (uint32_t i = 0; i < nb_services; i++)
+    {
+        uint32_t logins = hostTestRandom() % 100;
+        
+        // Most services have a single login
+        benchServiceName(services[i].name, first_index + i);
+        services[i].nb_children = (logins < 80)? 1 : ((logins < 95)? 2 : 3);
+        *nb_nodes += 1 + services[i].nb_children;
+    }
+    qsort(services, nb_services, sizeof(benchService_t), compareServicesDescending);
+    *nb_nodes += BENCH_DATA_SERVICES * (1 + BENCH_DATA_NODES);
+    return services;
+}
+
+/*! \fn     runCorpus(uint32_t nb_services, uint8_t nb_users, uint32_t nb_ops)
+*   \brief  Build a corpus and measure the operations on the first user
+*   \param  nb_services     Number of services of the benchmarked user
+*   \param  nb_users        Number of users
+*   \param  nb_ops          Number of operations of each kind
+*   \return RETURN_OK, RETURN_NOK if an operation failed, RETURN_NO_MATCH if the corpus doesn't fit
+*/
+static RET_TYPE runCorpus(uint32_t nb_services, uint8_t nb_users, uint32_t nb_ops)
+{
+    uint32_t available_nodes = (uint32_t)(PAGE_COUNT - PAGE_PER_SECTOR) * NODE_PER_PAGE;
+    benchService_t* services[NODE_MAX_UID];
+    uint32_t nb_user_services[NODE_MAX_UID];
+    benchService_t* new_services;
+    uint32_t nb_nodes = 2 * nb_ops;
+    uint32_t index = 0;
+    RET_TYPE ret = RETURN_OK;
+    
+    // Fresh flash & eeprom
+    at45dbClose();
+    if ((at45dbOpen(NULL) != 0) || (hostEepromOpen(NULL) != 0))
+    {
+        return RETURN_NOK;
+    }
+    mooltipassParametersInit();
+    initFlashIOs();
+    memset(bench_stats, 0, sizeof(bench_stats));
+    corpus_start_time = hostTimeGet();
+    
+    // Benchmarked user last, its nodes end up after the other users ones
+    for (uint8_t uid = 0; uid < nb_users; uid++)
+    {
+        nb_user_services[uid] = (uid == 0)? nb_services : nb_services / BENCH_OTHER_USERS_DIV;
+        services[uid] = generateServices(nb_user_services[uid], index, &nb_nodes);
+        index += nb_user_services[uid];
+    }
+    new_services = generateServices(nb_ops, index, &nb_nodes);
+    index += nb_ops;
+    if (nb_nodes > available_nodes)
+    {
+        printf("%u services: %u nodes needed, the flash has %u\n\n", nb_services, nb_nodes, available_nodes);
+        ret = RETURN_NO_MATCH;
+        goto cleanup;
+    }
+    for (uint8_t uid = nb_users; uid-- > 0;)
+    {
+        if (populateUser(uid, services[uid], nb_user_services[uid], index) != RETURN_OK)
+        {
+            ret = RETURN_NOK;
+            goto cleanup;
+        }
+        index += BENCH_DATA_SERVICES;
+    }
+    
+    // Measured operations, the new services are created in random order
+    initNodeManagementHandle(0);
+    for (uint32_t i = 0; i < 10; i++)
+    {
+        benchStart();
+        populateServicesLut();
+        benchStop(OP_POPULATE_LUT);
+    }
+    for (uint32_t i = 0; (i < nb_ops) && (nb_services > 0); i++)
+    {
+        benchService_t* service = &services[0][hostTestRandom() % nb_services];
+        uint16_t address;
+        
+        benchStart();
+        address = searchForServiceName((uint8_t*)service->name, COMPARE_MODE_MATCH, SERVICE_CRED_TYPE);
+        benchStop(OP_SEARCH_SERVICE);
+        if (address != service->address)
+        {
+            ret = RETURN_NOK;
+            goto cleanup;
+        }
+    }
+    for (uint32_t i = 0; i < nb_ops; i++)
+    {
+        benchService_t* service = &new_services[hostTestRandom() % nb_ops];
+        
+        // Pick the services in random order
+        while (service->address != 0)
+        {
+            service = (service == &new_services[nb_ops - 1])? &new_services[0] : service + 1;
+        }
+        memset((void*)&bench_pnode, 0, NODE_SIZE);
+        memcpy((void*)bench_pnode.service, service->name, sizeof(service->name));
+        benchStart();
+        ret = createParentNode(&bench_pnode, SERVICE_CRED_TYPE);
+        benchStop(OP_CREATE_PARENT);
+        service->address = searchForServiceName((uint8_t*)service->name, COMPARE_MODE_MATCH, SERVICE_CRED_TYPE);
+        if ((ret != RETURN_OK) || (service->address == NODE_ADDR_NULL))
+        {
+            ret = RETURN_NOK;
+            goto cleanup;
+        }
+        fillChildNode(0);
+        benchStart();
+        ret = createChildNode(service->address, &bench_cnode);
+        benchStop(OP_CREATE_CHILD);
+        if (ret != RETURN_OK)
+        {
+            goto cleanup;
+        }
+    }
+    for (uint32_t i = 0; i < nb_ops; i++)
+    {
+        // Password change: same login, the node is rewritten in place
+        readParentNode(&bench_pnode, new_services[i].address);
+        readChildNode(&bench_cnode, bench_pnode.nextChildAddress);
+        bench_cnode.password[0]++;
+        benchStart();
+        ret = updateChildNode(&bench_pnode, &bench_cnode, new_services[i].address, bench_pnode.nextChildAddress);
+        benchStop(OP_UPDATE_CHILD);
+        if (ret != RETURN_OK)
+        {
+            goto cleanup;
+        }
+    }
+    for (uint32_t i = 0; i < nb_ops; i++)
+    {
+        readParentNode(&bench_pnode, new_services[i].address);
+        benchStart();
+        ret = deleteChildNode(new_services[i].address, bench_pnode.nextChildAddress);
+        benchStop(OP_DELETE_CHILD);
+        if (ret != RETURN_OK)
+        {
+            goto cleanup;
+        }
+    }
+    if (writeDataService(index, TRUE) != RETURN_OK)
+    {
+        ret = RETURN_NOK;
+    }
+    
+cleanup:
+    for (uint8_t uid = 0; uid < nb_users; uid++)
+    {
+        free(services[uid]);
+    }
+    free(new_services);
+    return ret;
+}
+
+/*! \fn     printResults(uint32_t nb_services)
+*   \brief  Print the results of a corpus and add them to the baseline rows
+*   \param  nb_services     Number of services of the benchmarked user
+*/
+static void printResults(uint32_t nb_services)
+{
+    printf("%-22s %6s %12s %12s %12s %10s\n", "operation", "count", "mean us", "max us", "SPI bytes", "programs");
+    for (uint8_t op = 0; op < NB_BENCH_OPS; op++)
+    {
+        benchOpStats_t* stats = &bench_stats[op];
+        double count = (stats->count == 0)? 1 : stats->count;
+        double values[3] = {stats->time / count / 1e3, stats->spi_bytes / count, stats->page_programs / count};
+        
+        printf("%-22s %6u %12.1f %12.1f %12.1f %10.2f\n", bench_op_names[op], stats->count, values[0], stats->max_time / 1e3, values[1], values[2]);
+        hostBaselineAddRow(&baseline, values, "%u %s", nb_services, bench_op_names[op]);
+    }
+    printf("\n");
+}
+
+/*! \fn     usage(void)
+*   \brief  Print the usage
+*/
+static int usage(void)
+{
+    return hostBaselineUsage(&baseline, "node_mgmt_bench [--services N,N...] [--users N] [--ops N] [--letters domains|uniform|single] [--seed N] [--save FILE] [--baseline FILE] [--tolerance PERCENT]", NULL);
+}
+
+int main(int argc, char* argv[])
+{
+    char corpora_arg[64] = BENCH_DEFAULT_CORPORA;
+    uint32_t corpora[BENCH_MAX_CORPORA];
+    uint8_t nb_corpora = 0;
+    uint32_t nb_ops = BENCH_DEFAULT_NB_OPS;
+    uint32_t nb_users = 3;
+    uint32_t seed = 1;
+    int nb_regressions;
+    
+    hostBaselineInit(&baseline, bench_columns, 3, FALSE, BENCH_DEFAULT_TOLERANCE);
+    for (int i = 1; i < argc; i++)
+    {
+        if (i + 1 == argc)
+        {
+            return usage();
+        }
+        else if (strcmp(argv[i], "--services") == 0)
+        {
+            snprintf(corpora_arg, sizeof(corpora_arg), "%s", argv[++i]);
+        }
+        else if (strcmp(argv[i], "--users") == 0)
+        {
+            nb_users = strtoul(argv[++i], NULL, 0);
+        }
+        else if (strcmp(argv[i], "--ops") == 0)
+        {
+            nb_ops = strtoul(argv[++i], NULL, 0);
+        }
+        else if (strcmp(argv[i], "--seed") == 0)
+        {
+            seed = strtoul(argv[++i], NULL, 0);
+        }
+        else if (hostBaselineParseOption(&baseline, argv[i], argv[i + 1]) != 0)
+        {
+            i++;
+        }
+        else if (strcmp(argv[i], "--letters") == 0)
+        {
+            i++;
+            if (strcmp(argv[i], "uniform") == 0)
+            {
+                letter_distribution = LETTERS_UNIFORM;
+            }
+            else if (strcmp(argv[i], "single") == 0)
+            {
+                letter_distribution = LETTERS_SINGLE;
+            }
+            else if (strcmp(argv[i], "domains") != 0)
+            {
+                return usage();
+            }
+        }
+        else
+        {
+            return usage();
+        }
+    }
+    for (char* token = strtok(corpora_arg, ","); (token != NULL) && (nb_corpora < BENCH_MAX_CORPORA); token = strtok(NULL, ","))
+    {
+        corpora[nb_corpora++] = strtoul(token, NULL, 0);
+    }
+    if ((nb_users == 0) || (nb_users > NODE_MAX_UID) || (nb_ops == 0) || (seed == 0))
+    {
+        return usage();
+    }
+    
+    printf("Node management benchmark: %u pages of %u bytes, %u users, %u operations of each kind, seed %u\n\n", PAGE_COUNT, BYTES_PER_PAGE, nb_users, nb_ops, seed);
+    for (uint8_t i = 0; i < nb_corpora; i++)
+    {
+        RET_TYPE ret;
+        
+        hostTestSeed(seed);
+        ret = runCorpus(corpora[i], nb_users, nb_ops);
+        if (ret == RETURN_NO_MATCH)
+        {
+            continue;
+        }
+        printf("%u services, %u for each other user, simulated time %.1fs, %u flash violations\n", corpora[i], corpora[i] / BENCH_OTHER_USERS_DIV, (hostTimeGet() - corpus_start_time) / 1e9, at45dbGetStats()->violations);
+        if ((ret != RETURN_OK) || (at45dbGetStats()->violations != 0))
+        {
+            printf("FAILED\n");
+            return 1;
+        }
+        printResults(corpora[i]);
+    }
+    at45dbClose();
+    nb_regressions = hostBaselineFinish(&baseline);
+    if (nb_regressions < 0)
+    {
+        return 2;
+    }
+    return (nb_regressions == 0)? 0 : 1;
+}
@@ -0,0 +1,548 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     oled_capture.c
+*    \brief    OLED frame capture against the SSD1322 & SSD1305 models
+*    Created:  19/10/2026
+*/
+/*
+ * The OLED driver draws the standard Mooltipass screens with the bitmaps and
+ * fonts of a media bundle loaded in the flash model. After each screen
+ * transition the frame rebuilt by the SSD1322 model (SSD1305 for the Mini
+ * build) is checksummed (and possibly saved as a PNG) together with the bus
+ * traffic it took, so that a render change can be checked pixel exact
+ * against a baseline and its bus savings quantified. The screens follow the
+ * drawing sequences of the GUI functions named in their description.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "at45db_model.h"
+#include "host_baseline.h"
+#include "host_eeprom.h"
+#include "host_test.h"
+#include "host_time.h"
+#include "host_png.h"
+#if defined(MINI_VERSION)
+    #include "ssd1305_model.h"
+#else
+    #include "ssd1322_model.h"
+#endif
+#pragma pack(push, 1)
+#include "gui_scrolling_functions.h"
+#include "gui_screen_functions.h"
+#include "logic_fwflash_storage.h"
+#include "logic_eeprom.h"
+#include "oled_wrapper.h"
+#include "node_mgmt.h"
+#include "flash_mem.h"
+#include "defines.h"
+#pragma pack(pop)
+
+// Tolerated bus traffic increase over the baseline, in percent
+#define CAPTURE_DEFAULT_TOLERANCE   0.0
+#define CAPTURE_MAX_FRAMES          48
+#define CAPTURE_NAME_LENGTH         32
+
+#if defined(MINI_VERSION)
+    #define CAPTURE_FRAME_SIZE      SSD1305_FRAME_SIZE
+    // Scrolling ticks of the login selection screen
+    #define CAPTURE_SCROLL_TICKS    20
+    #define modelOpen()             ssd1305Open()
+    #define modelClose()            ssd1305Close()
+    #define modelGetFrame(frame)    ssd1305GetFrame(frame)
+    #define modelWriteFramePng(path) ssd1305WriteFramePng(path)
+    #define modelGetStats()         ssd1305GetStats()
+    #define modelResetStats()       ssd1305ResetStats()
+    typedef ssd1305Stats_t modelStats_t;
+#else
+    #define CAPTURE_FRAME_SIZE      SSD1322_FRAME_SIZE
+    #define modelOpen()             ssd1322Open()
+    #define modelClose()            ssd1322Close()
+    #define modelGetFrame(frame)    ssd1322GetFrame(frame)
+    #define modelWriteFramePng(path) ssd1322WriteFramePng(path)
+    #define modelGetStats()         ssd1322GetStats()
+    #define modelResetStats()       ssd1322ResetStats()
+    typedef ssd1322Stats_t modelStats_t;
+#endif
+
+typedef struct
+{
+    char name[CAPTURE_NAME_LENGTH];
+    uint32_t crc;               // CRC32 of the gray levels
+    uint64_t command_bytes;
+    uint64_t data_bytes;
+    uint64_t ram_bytes;
+    uint32_t windows;
+    uint64_t flash_bytes;       // SPI flash bytes (fonts, bitmaps)
+    uint32_t flash_transactions;
+    uint64_t time;              // Simulated time in ns
+} captureFrame_t;
+
+static captureFrame_t frames[CAPTURE_MAX_FRAMES];
+static uint8_t nb_frames = 0;
+static uint64_t frame_start_time;
+static at45dbStats_t frame_start_flash;
+static const char* png_dir = NULL;
+// Frame checksum and bus traffic, any frame change is a regression
+static const hostBaselineColumn_t capture_columns[3] = {{"crc", 0, TRUE}, {"command bytes", 0, FALSE}, {"data bytes", 0, FALSE}};
+static hostBaseline_t baseline;
+
+
+/*! \fn     captureFrame(const char* name)
+*   \brief  Record the displayed frame and the bus traffic since the previous one
+*   \param  name    Screen name
+*   \return 0 on success
+*/
+static int captureFrame(const char* name)
+{
+    const modelStats_t* stats = modelGetStats();
+    const at45dbStats_t* flash_stats = at45dbGetStats();
+    uint8_t frame[CAPTURE_FRAME_SIZE];
+    captureFrame_t* result;
+    
+    if (nb_frames == CAPTURE_MAX_FRAMES)
+    {
+        fprintf(stderr, "too many frames\n");
+        return -1;
+    }
+    result = &frames[nb_frames++];
+    snprintf(result->name, sizeof(result->name), "%s", name);
+    modelGetFrame(frame);
+    result->crc = hostCrc32(0, frame, sizeof(frame));
+    result->command_bytes = stats->command_bytes;
+    result->data_bytes = stats->data_bytes;
+    result->ram_bytes = stats->ram_bytes;
+    result->windows = stats->windows;
+    result->flash_bytes = flash_stats->spi_bytes - frame_start_flash.spi_bytes;
+    result->flash_transactions = flash_stats->transactions - frame_start_flash.transactions;
+    result->time = hostTimeGet() - frame_start_time;
+    
+    if (png_dir != NULL)
+    {
+        char path[256];
+        
+        snprintf(path, sizeof(path), "%s/%02u_%s.png", png_dir, nb_frames - 1, name);
+        if (modelWriteFramePng(path) != 0)
+        {
+            return -1;
+        }
+    }
+    modelResetStats();
+    frame_start_flash = *flash_stats;
+    frame_start_time = hostTimeGet();
+    return 0;
+}
+
+#if defined(MINI_VERSION)
+/*! \fn     textInformationScreen(char* text)
+*   \brief  guiDisplayTextInformationOnScreen()
+*   \param  text    Text to display
+*/
+static void textInformationScreen(char* text)
+{
+    oledClear();
+    miniOledPutCenteredString(THREE_LINE_TEXT_SECOND_POS, text);
+    miniOledFlushEntireBufferToDisplay();
+}
+
+/*! \fn     smartcardUnlockedScreen(char* username)
+*   \brief  guiDisplaySmartcardUnlockedScreen() with a username
+*   \param  username    The username
+*/
+static void smartcardUnlockedScreen(char* username)
+{
+    oledClear();
+    miniOledPutCenteredString(THREE_LINE_TEXT_SECOND_POS, readStoredStringToBuffer(ID_STRING_YOUR_USERNAME));
+    miniOledPutCenteredString(THREE_LINE_TEXT_THIRD_POS, username);
+    miniOledPutCenteredString(THREE_LINE_TEXT_FIRST_POS, readStoredStringToBuffer(ID_STRING_CARD_UNLOCKED));
+    miniOledFlushEntireBufferToDisplay();
+}
+
+/*! \fn     confirmationScreen(char* line1, char* line2)
+*   \brief  guiAskForConfirmation() with two lines
+*   \param  line1   First line
+*   \param  line2   Second line
+*/
+static void confirmationScreen(char* line1, char* line2)
+{
+    oledClear();
+    miniOledSetMaxTextY(SSD1305_OLED_WIDTH-15);
+    oledBitmapDrawFlash(SSD1305_OLED_WIDTH-15, 0, BITMAP_APPROVE, 0);
+    miniOledPutCenteredString(TWO_LINE_TEXT_FIRST_POS, line1);
+    miniOledPutCenteredString(TWO_LINE_TEXT_SECOND_POS, line2);
+    miniOledFlushEntireBufferToDisplay();
+    miniOledResetMaxTextY();
+}
+
+/*! \fn     pinEntryScreen(void)
+*   \brief  guiGetPinFromUser() & guiDisplayPinOnPinEnteringScreen(), second digit selected
+*/
+static void pinEntryScreen(void)
+{
+    oledBitmapDrawFlash(0, 0, BITMAP_PIN_SLOT2, 0);
+    miniOledSetMaxTextY(62);
+    miniOledAllowTextWritingYIncrement();
+    miniOledPutCenteredString(TWO_LINE_TEXT_FIRST_POS, readStoredStringToBuffer(ID_STRING_INSERT_PIN));
+    miniOledPreventTextWritingYIncrement();
+    miniOledResetMaxTextY();
+    oledSetFont(FONT_PROFONT_14);
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        oledSetXY(64+17*i, 6);
+        oledPutch((i == 1)? 'A' : '*');
+    }
+    oledSetFont(FONT_DEFAULT);
+    miniOledFlushEntireBufferToDisplay();
+}
+
+/*! \fn     loginSelectionScreen(void)
+*   \brief  loginSelectionScreen() with three services, then its scrolling ticks
+*   \return 0 on success
+*/
+static int loginSelectionScreen(void)
+{
+    char* services[3] = {"accounts.google.com", "login.microsoftonline.com", "a.very.long.service.name.example.org"};
+    uint8_t x_coordinates[] = {SCROLL_LINE_TEXT_FIRST_XPOS, SCROLL_LINE_TEXT_SECOND_XPOS, SCROLL_LINE_TEXT_THIRD_XPOS};
+    uint8_t y_coordinates[] = {THREE_LINE_TEXT_FIRST_POS, THREE_LINE_TEXT_SECOND_POS, THREE_LINE_TEXT_THIRD_POS};
+    uint8_t top_coordinates[] = {SCROLL_LINE_FIRST_TOP_YPOS, SCROLL_LINE_SECOND_TOP_YPOS, SCROLL_LINE_THIRD_TOP_YPOS, SSD1305_OLED_HEIGHT};
+    scrollingLine_t scrolling_lines[3];
+    char name[CAPTURE_NAME_LENGTH];
+    uint8_t lines_modified;
+    
+    oledClear();
+    oledBitmapDrawFlash(121, 0, BITMAP_SCROLL_WHEEL, OLED_SCROLL_NONE);
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        guiSetScrollingLine(&scrolling_lines[i], services[i], x_coordinates[i], y_coordinates[i]);
+    }
+    miniOledFlushEntireBufferToDisplay();
+    if (captureFrame("login_selection") != 0) return -1;
+    
+    // Scrolling timer expirations
+    for (uint8_t tick = 1; tick <= CAPTURE_SCROLL_TICKS; tick++)
+    {
+        lines_modified = FALSE;
+        for (uint8_t i = 0; i < 3; i++)
+        {
+            if (guiScrollLine(&scrolling_lines[i], x_coordinates[i], y_coordinates[i], top_coordinates[i], top_coordinates[i+1] - top_coordinates[i]) != FALSE)
+            {
+                lines_modified = TRUE;
+            }
+        }
+        if (lines_modified != FALSE)
+        {
+            miniOledFlushEntireBufferToDisplay();
+        }
+        snprintf(name, sizeof(name), "login_scroll_%u", tick);
+        if (captureFrame(name) != 0) return -1;
+    }
+    return 0;
+}
+
+/*! \fn     runScreens(void)
+*   \brief  Boot the display and go through the screens
+*   \return 0 on success
+*/
+static int runScreens(void)
+{
+    char username[] = "user@mooltipass.com";
+    
+    // Boot sequence of mooltipass.c
+    oledInitIOs();
+    oledBegin(FONT_DEFAULT);
+    oledWriteInactiveBuffer();
+    if (captureFrame("boot") != 0) return -1;
+    
+    // guiGetBackToCurrentScreen()
+    oledBitmapDrawFlash(0, 0, BITMAP_MOOLTIPASS, OLED_SCROLL_UP);
+    if (captureFrame("default_ninserted") != 0) return -1;
+    
+    textInformationScreen(readStoredStringToBuffer(ID_STRING_PROCESSING));
+    if (captureFrame("processing") != 0) return -1;
+    
+    smartcardUnlockedScreen(username);
+    if (captureFrame("card_unlocked") != 0) return -1;
+    
+    oledBitmapDrawFlash(0, 0, BITMAP_MAIN_LOCK, OLED_SCROLL_UP);
+    if (captureFrame("main_lock") != 0) return -1;
+    
+    // guiScreenLoop() wheel down transition
+    for (uint8_t i = 0; i < NB_BMPS_PER_TRANSITION-1; i++)
+    {
+        oledBitmapDrawFlash(0, 0, BITMAP_MAIN_LOCK+1+i, OLED_SCROLL_FLIP);
+    }
+    oledBitmapDrawFlash(0, 0, BITMAP_MAIN_LOGIN, OLED_SCROLL_FLIP);
+    if (captureFrame("main_login") != 0) return -1;
+    
+    oledBitmapDrawFlash(0, 0, BITMAP_MAIN_SETTINGS, OLED_SCROLL_UP);
+    if (captureFrame("settings") != 0) return -1;
+    
+    confirmationScreen(readStoredStringToBuffer(ID_STRING_INSERT_OTHER), username);
+    if (captureFrame("confirmation") != 0) return -1;
+    
+    pinEntryScreen();
+    if (captureFrame("pin_entry") != 0) return -1;
+    
+    if (loginSelectionScreen() != 0) return -1;
+    
+    oledOff();
+    if (captureFrame("off") != 0) return -1;
+    return 0;
+}
+
+#else
+/*! \fn     textInformationScreen(char* text)
+*   \brief  guiDisplayTextInformationOnScreen()
+*   \param  text    Text to display
+*/
+static void textInformationScreen(char* text)
+{
+    oledClear();
+    oledPutstrXY(10, 24, OLED_CENTRE, text);
+    oledBitmapDrawFlash(2, 17, BITMAP_INFO, 0);
+    oledDisplayOtherBuffer();
+}
+
+/*! \fn     smartcardUnlockedScreen(char* username)
+*   \brief  guiDisplaySmartcardUnlockedScreen() with a username
+*   \param  username    The username
+*/
+static void smartcardUnlockedScreen(char* username)
+{
+    oledClear();
+    oledPutstrXY(10, 24, OLED_CENTRE, readStoredStringToBuffer(ID_STRING_YOUR_USERNAME));
+    oledPutstrXY(10, 40, OLED_CENTRE, username);
+    oledPutstrXY(10, 8, OLED_CENTRE, readStoredStringToBuffer(ID_STRING_CARD_UNLOCKED));
+    oledBitmapDrawFlash(2, 17, BITMAP_INFO, 0);
+    oledDisplayOtherBuffer();
+}
+
+/*! \fn     confirmationScreen(char* line1, char* line2)
+*   \brief  guiAskForConfirmation() with two lines
+*   \param  line1   First line
+*   \param  line2   Second line
+*/
+static void confirmationScreen(char* line1, char* line2)
+{
+    oledClear();
+    oledBitmapDrawFlash(0, 0, BITMAP_YES_NO_INT_L, 0);
+    oledBitmapDrawFlash(222, 0, BITMAP_YES_NO_INT_R, 0);
+    oledPutstrXY(0, 2 + (1 << 4), OLED_CENTRE, line2);
+    oledPutstrXY(0, 2, OLED_CENTRE, line1);
+    oledDisplayOtherBuffer();
+}
+
+/*! \fn     pinEntryScreen(void)
+*   \brief  guiGetPinFromUser() & guiDisplayPinOnPinEnteringScreen(), second digit selected
+*/
+static void pinEntryScreen(void)
+{
+    oledClear();
+    oledBitmapDrawFlash(0, 0, BITMAP_YES_NO, 0);
+    oledBitmapDrawFlash(83, 51, BITMAP_PIN_LINES, 0);
+    oledBitmapDrawFlash(238, 23, BITMAP_RIGHT_ARROW, 0);
+    oledPutstrXY(0, 0, OLED_CENTRE, readStoredStringToBuffer(ID_STRING_INSERT_PIN));
+    oledDisplayOtherBuffer();
+    oledSetFont(FONT_PROFONT_24);
+    oledWriteActiveBuffer();
+    oledFillXY(88, 31, 82, 19, 0x00);
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        oledSetXY(88+22*i, 25);
+        oledPutch((i == 1)? 'A' : '*');
+    }
+}
+
+/*! \fn     loginSearchScreen(void)
+*   \brief  loginSelectionScreen() search text
+*/
+static void loginSearchScreen(void)
+{
+    oledBitmapDrawFlash(0, 0, BITMAP_LOGIN_FIND, 0);
+    oledDisplayOtherBuffer();
+    oledWriteActiveBuffer();
+    oledSetFont(FONT_PROFONT_18);
+    oledFillXY(100, 18, 50, 23, 0x00);
+    oledPutstrXY(148, 17, OLED_RIGHT, "goo");
+}
+
+/*! \fn     runScreens(void)
+*   \brief  Boot the display and go through the screens
+*   \return 0 on success
+*/
+static int runScreens(void)
+{
+    char username[] = "user@mooltipass.com";
+    
+    // Boot sequence of mooltipass.c
+    oledInitIOs();
+    oledBegin(FONT_DEFAULT);
+    oledWriteInactiveBuffer();
+    if (captureFrame("boot") != 0) return -1;
+    
+    for (uint8_t i = 0; i < BITMAP_TUTORIAL_6 - BITMAP_TUTORIAL_1 + 1; i++)
+    {
+        char name[CAPTURE_NAME_LENGTH];
+        
+        oledBitmapDrawFlash(0, 0, BITMAP_TUTORIAL_1 + i, OLED_SCROLL_UP);
+        snprintf(name, sizeof(name), "tutorial_%u", i + 1);
+        if (captureFrame(name) != 0) return -1;
+    }
+    
+    // guiGetBackToCurrentScreen()
+    oledBitmapDrawFlash(0, 0, BITMAP_MOOLTIPASS, OLED_SCROLL_UP);
+    if (captureFrame("default_ninserted") != 0) return -1;
+    
+    textInformationScreen(readStoredStringToBuffer(ID_STRING_PROCESSING));
+    if (captureFrame("processing") != 0) return -1;
+    
+    smartcardUnlockedScreen(username);
+    if (captureFrame("card_unlocked") != 0) return -1;
+    
+    oledBitmapDrawFlash(0, 0, BITMAP_MAIN_SCREEN, OLED_SCROLL_UP);
+    if (captureFrame("main_screen") != 0) return -1;
+    
+    oledBitmapDrawFlash(0, 0, BITMAP_SETTINGS_SC, OLED_SCROLL_UP);
+    if (captureFrame("settings") != 0) return -1;
+    
+    confirmationScreen(readStoredStringToBuffer(ID_STRING_INSERT_OTHER), username);
+    if (captureFrame("confirmation") != 0) return -1;
+    
+    pinEntryScreen();
+    if (captureFrame("pin_entry") != 0) return -1;
+    oledSetFont(FONT_DEFAULT);
+    oledWriteInactiveBuffer();
+    
+    loginSearchScreen();
+    if (captureFrame("login_search") != 0) return -1;
+    oledSetFont(FONT_DEFAULT);
+    oledWriteInactiveBuffer();
+    
+    oledOff();
+    if (captureFrame("off") != 0) return -1;
+    return 0;
+}
+#endif
+
+/*! \fn     printResults(void)
+*   \brief  Print the captured frames and add them to the baseline rows
+*/
+static void printResults(void)
+{
+    captureFrame_t total;
+    
+    memset(&total, 0, sizeof(total));
+    printf("%-20s %8s %10s %10s %10s %8s %11s %8s %10s\n", "frame", "crc32", "cmd bytes", "data bytes", "RAM bytes", "windows", "flash bytes", "flash tx", "time us");
+    for (uint8_t i = 0; i < nb_frames; i++)
+    {
+        captureFrame_t* frame = &frames[i];
+        double values[3] = {frame->crc, frame->command_bytes, frame->data_bytes};
+        
+        printf("%-20s %08x %10llu %10llu %10llu %8u %11llu %8u %10.1f\n", frame->name, frame->crc, (unsigned long long)frame->command_bytes, (unsigned long long)frame->data_bytes,
+               (unsigned long long)frame->ram_bytes, frame->windows, (unsigned long long)frame->flash_bytes, frame->flash_transactions, frame->time / 1e3);
+        hostBaselineAddRow(&baseline, values, "%s", frame->name);
+        total.command_bytes += frame->command_bytes;
+        total.data_bytes += frame->data_bytes;
+        total.ram_bytes += frame->ram_bytes;
+        total.windows += frame->windows;
+        total.flash_bytes += frame->flash_bytes;
+        total.flash_transactions += frame->flash_transactions;
+        total.time += frame->time;
+    }
+    printf("%-20s %8s %10llu %10llu %10llu %8u %11llu %8u %10.1f\n\n", "total", "", (unsigned long long)total.command_bytes, (unsigned long long)total.data_bytes,
+           (unsigned long long)total.ram_bytes, total.windows, (unsigned long long)total.flash_bytes, total.flash_transactions, total.time / 1e3);
+}
+
+/*! \fn     usage(void)
+*   \brief  Print the usage
+*/
+static int usage(void)
+{
+    return hostBaselineUsage(&baseline, "oled_capture [--bundle FILE] [--png DIR] [--save FILE] [--baseline FILE] [--tolerance PERCENT]", NULL);
+}
+
+int main(int argc, char* argv[])
+{
+    const char* bundle_path = HOST_TEST_DEFAULT_BUNDLE;
+    int nb_regressions;
+    long bundle_size;
+    
+    hostBaselineInit(&baseline, capture_columns, 3, TRUE, CAPTURE_DEFAULT_TOLERANCE);
+    for (int i = 1; i < argc; i++)
+    {
+        if (i + 1 == argc)
+        {
+            return usage();
+        }
+        else if (strcmp(argv[i], "--bundle") == 0)
+        {
+            bundle_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--png") == 0)
+        {
+            png_dir = argv[++i];
+        }
+        else if (hostBaselineParseOption(&baseline, argv[i], argv[i + 1]) != 0)
+        {
+            i++;
+        }
+        else
+        {
+            return usage();
+        }
+    }
+    
+    if ((at45dbOpen(NULL) != 0) || (hostEepromOpen(NULL) != 0))
+    {
+        return 2;
+    }
+    mooltipassParametersInit();
+    initFlashIOs();
+    bundle_size = at45dbLoadBundle(bundle_path);
+    if (bundle_size < 0)
+    {
+        return 2;
+    }
+    printf("%s: %ld bytes loaded in the graphics zone\n\n", bundle_path, bundle_size);
+    
+    modelOpen();
+    frame_start_flash = *at45dbGetStats();
+    frame_start_time = hostTimeGet();
+    if (runScreens() != 0)
+    {
+        printf("FAILED\n");
+        return 1;
+    }
+    printResults();
+    printf("%u frames, %u controller violations, %u flash violations\n", nb_frames, modelGetStats()->violations, at45dbGetStats()->violations);
+    if ((modelGetStats()->violations != 0) || (at45dbGetStats()->violations != 0))
+    {
+        printf("FAILED\n");
+        return 1;
+    }
+    modelClose();
+    at45dbClose();
+    nb_regressions = hostBaselineFinish(&baseline);
+    if (nb_regressions < 0)
+    {
+        return 2;
+    }
+    return (nb_regressions == 0)? 0 : 1;
+}
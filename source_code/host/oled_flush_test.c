@@ -0,0 +1,255 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     oled_flush_test.c
+*    \brief    Mini frame buffer flushes of the modified spans against full flushes
+*    Created:  19/10/2026
+*/
+/*
+ * miniOledFlushEntireBufferToDisplay() only sends the column spans of the
+ * frame buffer pages modified since the previous flush. A random sequence of
+ * drawing operations (rectangles, bitmaps, text, clears, scrolled bitmaps
+ * and flushes) is run twice from the same seed: once as the firmware does,
+ * once with miniOledResendEntireBuffer() before every flush so that the whole
+ * screen is sent. The frames rebuilt by the SSD1305 model after every flush
+ * have to be identical, and the bus bytes of both runs are compared against
+ * a baseline.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "at45db_model.h"
+#include "host_baseline.h"
+#include "host_eeprom.h"
+#include "host_test.h"
+#include "ssd1305_model.h"
+#include "host_png.h"
+#pragma pack(push, 1)
+#include "logic_fwflash_storage.h"
+#include "logic_eeprom.h"
+#include "oled_wrapper.h"
+#include "flash_mem.h"
+#include "defines.h"
+#pragma pack(pop)
+
+#define FLUSH_DEFAULT_TOLERANCE     0.0
+#define FLUSH_DEFAULT_STEPS         20000
+#define FLUSH_MAX_STEPS             100000
+#define FLUSH_TEXT_LENGTH           24
+
+/* Bus traffic of one run */
+typedef struct
+{
+    uint32_t crc;               // CRC32 of the frame CRCs
+    uint32_t flushes;
+    uint64_t command_bytes;
+    uint64_t data_bytes;
+    uint32_t violations;
+} flushStats_t;
+
+static const uint8_t small_bitmaps[] = {BITMAP_APPROVE, BITMAP_DENY, BITMAP_SCROLL_WHEEL};
+static const uint8_t screen_bitmaps[] = {BITMAP_MAIN_LOCK, BITMAP_MAIN_LOGIN, BITMAP_MAIN_FAVORITES, BITMAP_MAIN_SETTINGS};
+// The Mini GUI doesn't scroll down, that path of miniOledBitmapDrawFlash() sends invalid start lines
+static const uint8_t scroll_options[] = {OLED_SCROLL_UP, OLED_SCROLL_FLIP};
+static const uint8_t text_justify[] = {OLED_LEFT, OLED_RIGHT, OLED_CENTRE};
+static uint32_t frame_crcs[FLUSH_MAX_STEPS];
+static flushStats_t dirty_stats;
+static flushStats_t full_stats;
+// Frames and bus traffic of each run, any frame change is a regression
+static const hostBaselineColumn_t flush_columns[3] = {{"frames crc", 0, TRUE}, {"command bytes", 0, FALSE}, {"data bytes", 0, FALSE}};
+static hostBaseline_t baseline;
+
+
+/*! \fn     runSequence(uint32_t seed, uint32_t nb_steps, uint8_t full_flushes, flushStats_t* stats)
+*   \brief  Run the drawing sequence of a seed from a blank screen
+*   \param  seed            Seed of the sequence
+*   \param  nb_steps        Number of operations
+*   \param  full_flushes    TRUE to send the whole screen on every flush
+*   \param  stats           Where to store the bus traffic and frame checksums
+*   \return Number of frames differing from the ones of the previous run, when full_flushes is set
+*/
+static uint32_t runSequence(uint32_t seed, uint32_t nb_steps, uint8_t full_flushes, flushStats_t* stats)
+{
+    char text[FLUSH_TEXT_LENGTH+1];
+    uint32_t nb_differences = 0;
+    uint32_t crc;
+    
+    ssd1305Open();
+    oledBegin(FONT_DEFAULT);
+    ssd1305ResetStats();
+    memset(stats, 0, sizeof(*stats));
+    hostTestSeed(seed);
+    for (uint32_t step = 0; step < nb_steps; step++)
+    {
+        uint8_t operation = hostTestRandom() % 100;
+        uint8_t x = hostTestRandom() % SSD1305_OLED_WIDTH;
+        uint8_t y = hostTestRandom() % SSD1305_OLED_HEIGHT;
+        
+        if (operation < 30)
+        {
+            oledFillXY(x, y, 1 + hostTestRandom() % (SSD1305_OLED_WIDTH - x), 1 + hostTestRandom() % (SSD1305_OLED_HEIGHT - y), hostTestRandom() & 0x01);
+            continue;
+        }
+        else if (operation < 50)
+        {
+            oledBitmapDrawFlash(x, y % 8, small_bitmaps[hostTestRandom() % sizeof(small_bitmaps)], OLED_SCROLL_NONE);
+            continue;
+        }
+        else if (operation < 70)
+        {
+            uint8_t length = 1 + hostTestRandom() % FLUSH_TEXT_LENGTH;
+            
+            for (uint8_t i = 0; i < length; i++)
+            {
+                text[i] = ' ' + hostTestRandom() % 95;
+            }
+            text[length] = 0;
+            miniOledPutstrXY(x, y % 22, text_justify[hostTestRandom() % sizeof(text_justify)], text);
+            continue;
+        }
+        else if (operation < 73)
+        {
+            oledClear();
+            continue;
+        }
+        
+        // Frame displayed after a flush or a scrolled bitmap
+        if (full_flushes != FALSE)
+        {
+            miniOledResendEntireBuffer();
+        }
+        if (operation < 76)
+        {
+            oledBitmapDrawFlash(0, 0, screen_bitmaps[hostTestRandom() % sizeof(screen_bitmaps)], scroll_options[hostTestRandom() % sizeof(scroll_options)]);
+        }
+        else
+        {
+            miniOledFlushEntireBufferToDisplay();
+        }
+        crc = hostTestFrameCrc();
+        stats->crc = hostCrc32(stats->crc, (uint8_t*)&crc, sizeof(crc));
+        if ((full_flushes != FALSE) && (crc != frame_crcs[stats->flushes]))
+        {
+            nb_differences++;
+        }
+        frame_crcs[stats->flushes++] = crc;
+    }
+    stats->command_bytes = ssd1305GetStats()->command_bytes;
+    stats->data_bytes = ssd1305GetStats()->data_bytes;
+    stats->violations = ssd1305GetStats()->violations;
+    return nb_differences;
+}
+
+/*! \fn     addResult(const char* name, const flushStats_t* stats)
+*   \brief  Print the bus traffic of a run and add it to the baseline rows
+*   \param  name    Run name
+*   \param  stats   Its statistics
+*/
+static void addResult(const char* name, const flushStats_t* stats)
+{
+    double values[3] = {stats->crc, stats->command_bytes, stats->data_bytes};
+    
+    printf("%-8s %08x %8u %12llu %12llu %12.1f\n", name, stats->crc, stats->flushes, (unsigned long long)stats->command_bytes, (unsigned long long)stats->data_bytes,
+           (double)(stats->command_bytes + stats->data_bytes) / stats->flushes);
+    hostBaselineAddRow(&baseline, values, "%s", name);
+}
+
+/*! \fn     usage(void)
+*   \brief  Print the usage
+*/
+static int usage(void)
+{
+    return hostBaselineUsage(&baseline, "oled_flush_test [--bundle FILE] [--steps N] [--seed N] [--save FILE] [--baseline FILE] [--tolerance PERCENT]", NULL);
+}
+
+int main(int argc, char* argv[])
+{
+    const char* bundle_path = HOST_TEST_DEFAULT_BUNDLE;
+    uint32_t nb_steps = FLUSH_DEFAULT_STEPS;
+    uint32_t nb_differences;
+    uint32_t seed = 1;
+    int nb_regressions;
+    
+    hostBaselineInit(&baseline, flush_columns, 3, TRUE, FLUSH_DEFAULT_TOLERANCE);
+    for (int i = 1; i < argc; i++)
+    {
+        if (i + 1 == argc)
+        {
+            return usage();
+        }
+        else if (strcmp(argv[i], "--bundle") == 0)
+        {
+            bundle_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--steps") == 0)
+        {
+            nb_steps = strtoul(argv[++i], NULL, 0);
+        }
+        else if (strcmp(argv[i], "--seed") == 0)
+        {
+            seed = strtoul(argv[++i], NULL, 0);
+        }
+        else if (hostBaselineParseOption(&baseline, argv[i], argv[i + 1]) != 0)
+        {
+            i++;
+        }
+        else
+        {
+            return usage();
+        }
+    }
+    if ((nb_steps == 0) || (nb_steps > FLUSH_MAX_STEPS) || (seed == 0))
+    {
+        return usage();
+    }
+    
+    if ((at45dbOpen(NULL) != 0) || (hostEepromOpen(NULL) != 0))
+    {
+        return 2;
+    }
+    mooltipassParametersInit();
+    initFlashIOs();
+    if (at45dbLoadBundle(bundle_path) < 0)
+    {
+        return 2;
+    }
+    printf("Frame buffer flushes: %u operations, seed %u\n\n", nb_steps, seed);
+    
+    oledInitIOs();
+    runSequence(seed, nb_steps, FALSE, &dirty_stats);
+    nb_differences = runSequence(seed, nb_steps, TRUE, &full_stats);
+    
+    printf("%-8s %8s %8s %12s %12s %12s\n", "flushes", "crc32", "number", "cmd bytes", "data bytes", "per flush");
+    addResult("dirty", &dirty_stats);
+    addResult("full", &full_stats);
+    printf("\n%u differing frames, %u controller violations, %u flash violations\n", nb_differences, dirty_stats.violations + full_stats.violations, at45dbGetStats()->violations);
+    if ((nb_differences != 0) || (dirty_stats.violations + full_stats.violations != 0) || (at45dbGetStats()->violations != 0))
+    {
+        printf("FAILED\n");
+        return 1;
+    }
+    ssd1305Close();
+    at45dbClose();
+    nb_regressions = hostBaselineFinish(&baseline);
+    if (nb_regressions < 0)
+    {
+        return 2;
+    }
+    return (nb_regressions == 0)? 0 : 1;
+}
@@ -0,0 +1,774 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     power_cut_test.c
+*    \brief    Power cut fault injection on the node management storage
+*    Created:  19/10/2026
+*/
+/*
+ * A node management workload (parent, child and data node creation, child
+ * update and deletion) runs on a small multi user database in the flash
+ * model. The power is then cut at every Nth SPI transaction of the workload:
+ * the database is restored, the workload replayed until the cut, and the flash
+ * contents are checked without the firmware (whose readNode() traps on a bad
+ * link). The parent / child / data lists of the user are walked from the user
+ * profile, the links, types, owners and sort order are checked, the valid
+ * nodes of the user that can't be reached and the damage to the other users
+ * are reported, and the corruption classes found are counted per cut point.
+ * Each cut point is tested twice: with the operation in progress completed
+ * (device with a hold-up capacitor) and with its page program torn.
+ */
+#include <setjmp.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "at45db_model.h"
+#include "host_baseline.h"
+#include "host_eeprom.h"
+#include "host_test.h"
+#include "host_time.h"
+#pragma pack(push, 1)
+#include "logic_aes_and_comms.h"
+#include "logic_eeprom.h"
+#include "node_mgmt.h"
+#include "flash_mem.h"
+#include "defines.h"
+#pragma pack(pop)
+
+// User running the workload, the other users share its pages
+#define CUT_TEST_UID            0
+#define CUT_NB_USERS            4
+#define CUT_NB_FAVORITES        3
+#define CUT_MAX_ADDRESSES       0x10000
+#define CUT_MAX_VERBOSE_LINES   20
+
+// Corruption classes
+enum cut_class_t {CLASS_USER_PROFILE = 0, CLASS_FAVORITE, CLASS_FREE_SLOT_LINK, CLASS_FOREIGN_LINK, CLASS_BACK_LINK, CLASS_CYCLE, CLASS_LIST_ORDER, CLASS_ORPHAN_NODE, CLASS_OTHER_USERS, NB_CUT_CLASSES};
+static const char* cut_class_names[NB_CUT_CLASSES] = {"user_profile", "favorite", "free_slot_link", "foreign_link", "back_link", "cycle", "list_order", "orphan_node", "other_users"};
+static const char* cut_class_descriptions[NB_CUT_CLASSES] = {
+    "starting parent / data parent pointer invalid, user CTR changed",
+    "favorite not pointing to one of the user credentials",
+    "link to a free slot, reused by the next node creation",
+    "link out of the node area, to another user or node type",
+    "previous address not matching the list order",
+    "list looping on itself",
+    "services / logins not sorted",
+    "valid node of the user not reachable",
+    "node or profile of another user changed"};
+
+// Workload steps
+enum cut_step_t {STEP_FIRST_PARENT = 0, STEP_MIDDLE_PARENT, STEP_LAST_PARENT, STEP_FIRST_CHILD, STEP_LAST_CHILD, STEP_UPDATE_CHILD, STEP_RENAME_CHILD, STEP_DELETE_FIRST_CHILD, STEP_DELETE_MIDDLE_CHILD, STEP_DELETE_LAST_CHILD, STEP_DATA_SERVICE, NB_CUT_STEPS};
+static const char* cut_step_names[NB_CUT_STEPS] = {"create first parent", "create middle parent", "create last parent", "create first child", "create last child", "update child", "rename child", "delete first child", "delete middle child", "delete last child", "write data service"};
+
+// Cut modes
+enum cut_mode_t {MODE_COMPLETE = 0, MODE_TORN, NB_CUT_MODES};
+static const char* cut_mode_names[NB_CUT_MODES] = {"complete", "torn"};
+static const char* cut_mode_descriptions[NB_CUT_MODES] = {"operation in progress completed", "page program in progress torn"};
+
+// Base database services, the workload adds services before, between and after them
+static const char* base_services[] = {"bitbucket.org", "cnn.com", "dropbox.com", "ebay.com", "facebook.com", "github.com", "google.com", "linkedin.com", "paypal.com", "reddit.com", "twitter.com", "wikipedia.org"};
+#define CUT_NB_BASE_SERVICES    (sizeof(base_services) / sizeof(base_services[0]))
+// Service the workload modifies the logins of
+#define CUT_CHILD_SERVICE       "github.com"
+
+typedef struct
+{
+    uint32_t cut_points[NB_CUT_CLASSES];    // Cut points showing the class
+    uint32_t instances[NB_CUT_CLASSES];
+    uint32_t step_cut_points[NB_CUT_STEPS];
+    uint32_t step_corrupted[NB_CUT_STEPS];
+    uint32_t corrupted;                     // Cut points with at least one corruption
+} cutModeResults_t;
+
+static cutModeResults_t results[NB_CUT_MODES];
+// Cut points showing each corruption class, a storage change should only lower them
+static const hostBaselineColumn_t cut_columns[1] = {{"cut points", 0, FALSE}};
+static hostBaseline_t baseline;
+static jmp_buf power_cut_jmp;
+static uint8_t current_step;
+// Database before the workload
+static uint8_t* base_image;
+// Node addresses reached from the user profile, and for children their parent
+static uint8_t node_reached[CUT_MAX_ADDRESSES];
+static uint16_t node_parent[CUT_MAX_ADDRESSES];
+static pNode cut_pnode;
+static cNode cut_cnode;
+static dNode cut_dnode;
+
+
+/*! \fn     powerCutCallback(void)
+*   \brief  Called by the flash model when the power is cut, leaves the firmware
+*/
+static void powerCutCallback(void)
+{
+    longjmp(power_cut_jmp, 1);
+}
+
+/*! \fn     nodeInArea(uint16_t address)
+*   \brief  Check that an address is in the node area of the flash
+*   \param  address     Node address
+*   \return TRUE or FALSE
+*/
+static uint8_t nodeInArea(uint16_t address)
+{
+    return ((pageNumberFromAddress(address) >= PAGE_PER_SECTOR) && (pageNumberFromAddress(address) < PAGE_COUNT) && (nodeNumberFromAddress(address) < NODE_PER_PAGE))? TRUE : FALSE;
+}
+
+/*! \fn     nodePointer(const uint8_t* image, uint16_t address)
+*   \brief  Get a node in a flash image
+*   \param  image       Flash image
+*   \param  address     Node address, in the node area
+*   \return Pointer to the node
+*/
+static const gNode* nodePointer(const uint8_t* image, uint16_t address)
+{
+    return (const gNode*)&image[(uint32_t)pageNumberFromAddress(address) * BYTES_PER_PAGE + (uint32_t)nodeNumberFromAddress(address) * NODE_SIZE];
+}
+
+/*! \fn     userProfilePointer(const uint8_t* image, uint8_t uid)
+*   \brief  Get a user profile in a flash image
+*   \param  image       Flash image
+*   \param  uid         User ID
+*   \return Pointer to the profile
+*/
+static const uint8_t* userProfilePointer(const uint8_t* image, uint8_t uid)
+{
+    uint16_t page, offset;
+    
+    userProfileStartingOffset(uid, &page, &offset);
+    return &image[(uint32_t)page * BYTES_PER_PAGE + offset];
+}
+
+/*! \fn     checkLink(const uint8_t* image, uint16_t address, uint8_t type, uint32_t* counts)
+*   \brief  Check that a link points to a valid node of the user with the given type
+*   \param  image       Flash image
+*   \param  address     Link, not NULL
+*   \param  type        Expected node type
+*   \param  counts      Corruption counts, incremented
+*   \return TRUE if the node can be followed
+*/
+static uint8_t checkLink(const uint8_t* image, uint16_t address, uint8_t type, uint32_t* counts)
+{
+    const gNode* node;
+    
+    if (nodeInArea(address) == FALSE)
+    {
+        counts[CLASS_FOREIGN_LINK]++;
+        return FALSE;
+    }
+    node = nodePointer(image, address);
+    if (validBitFromFlags(node->flags) != NODE_VBIT_VALID)
+    {
+        counts[CLASS_FREE_SLOT_LINK]++;
+        return FALSE;
+    }
+    if ((userIdFromFlags(node->flags) != CUT_TEST_UID) || (((node->flags & NODE_F_TYPE_MASK) >> NODE_F_TYPE_SHMT) != type))
+    {
+        counts[CLASS_FOREIGN_LINK]++;
+        return FALSE;
+    }
+    if (node_reached[address] != FALSE)
+    {
+        counts[CLASS_CYCLE]++;
+        return FALSE;
+    }
+    node_reached[address] = TRUE;
+    return TRUE;
+}
+
+/*! \fn     checkDataChain(const uint8_t* image, uint16_t address, uint32_t* counts)
+*   \brief  Walk the data nodes of a data service
+*   \param  image       Flash image
+*   \param  address     First data node
+*   \param  counts      Corruption counts, incremented
+*/
+static void checkDataChain(const uint8_t* image, uint16_t address, uint32_t* counts)
+{
+    while ((address != NODE_ADDR_NULL) && (checkLink(image, address, NODE_TYPE_DATA, counts) == TRUE))
+    {
+        address = ((const dNode*)nodePointer(image, address))->nextDataAddress;
+    }
+}
+
+/*! \fn     checkList(const uint8_t* image, uint16_t address, uint8_t type, uint16_t parent, uint32_t* counts)
+*   \brief  Walk a doubly linked sorted list and the lists below it
+*   \param  image       Flash image
+*   \param  address     First node, link already checked
+*   \param  type        Node type of the list
+*   \param  parent      Parent of a child list
+*   \param  counts      Corruption counts, incremented
+*/
+static void checkList(const uint8_t* image, uint16_t address, uint8_t type, uint16_t parent, uint32_t* counts)
+{
+    uint8_t comparison_offset = (type == NODE_TYPE_CHILD)? CNODE_COMPARISON_FIELD_OFFSET : PNODE_COMPARISON_FIELD_OFFSET;
+    uint8_t comparison_length = (type == NODE_TYPE_CHILD)? NODE_CHILD_SIZE_OF_LOGIN : NODE_PARENT_SIZE_OF_SERVICE;
+    uint16_t previous = NODE_ADDR_NULL;
+    
+    while (TRUE)
+    {
+        const gNode* node = nodePointer(image, address);
+        
+        node_parent[address] = parent;
+        if (node->prevAddress != previous)
+        {
+            counts[CLASS_BACK_LINK]++;
+        }
+        if ((previous != NODE_ADDR_NULL) && (strncmp((const char*)nodePointer(image, previous) + comparison_offset, (const char*)node + comparison_offset, comparison_length) >= 0))
+        {
+            counts[CLASS_LIST_ORDER]++;
+        }
+        
+        // Credentials or data of a parent
+        if ((type != NODE_TYPE_CHILD) && (((const pNode*)node)->nextChildAddress != NODE_ADDR_NULL))
+        {
+            uint16_t child = ((const pNode*)node)->nextChildAddress;
+            
+            if (type == NODE_TYPE_PARENT_DATA)
+            {
+                checkDataChain(image, child, counts);
+            }
+            else if (checkLink(image, child, NODE_TYPE_CHILD, counts) == TRUE)
+            {
+                checkList(image, child, NODE_TYPE_CHILD, address, counts);
+            }
+        }
+        
+        previous = address;
+        address = node->nextAddress;
+        if ((address == NODE_ADDR_NULL) || (checkLink(image, address, type, counts) == FALSE))
+        {
+            return;
+        }
+    }
+}
+
+/*! \fn     checkDatabase(const uint8_t* image, uint32_t* counts)
+*   \brief  Check the database of the test user and the other users data
+*   \param  image       Flash image
+*   \param  counts      Corruption counts, NB_CUT_CLASSES, filled
+*   \return Number of corruptions
+*/
+static uint32_t checkDatabase(const uint8_t* image, uint32_t* counts)
+{
+    const uint8_t* profile = userProfilePointer(image, CUT_TEST_UID);
+    uint16_t starting_parents[2];
+    uint32_t total = 0;
+    
+    memset(counts, 0, NB_CUT_CLASSES * sizeof(uint32_t));
+    memset(node_reached, FALSE, sizeof(node_reached));
+    
+    // Credential and data lists from the user profile
+    memcpy(&starting_parents[0], profile, sizeof(uint16_t));
+    memcpy(&starting_parents[1], profile + USER_START_NODE_SIZE + USER_MAX_FAV * USER_FAV_SIZE, sizeof(uint16_t));
+    for (uint8_t i = 0; i < 2; i++)
+    {
+        uint8_t type = (i == 0)? NODE_TYPE_PARENT : NODE_TYPE_PARENT_DATA;
+        uint32_t link_counts[NB_CUT_CLASSES] = {0};
+        
+        if (starting_parents[i] == NODE_ADDR_NULL)
+        {
+            continue;
+        }
+        if (checkLink(image, starting_parents[i], type, link_counts) == TRUE)
+        {
+            checkList(image, starting_parents[i], type, NODE_ADDR_NULL, counts);
+        }
+        else
+        {
+            counts[CLASS_USER_PROFILE]++;
+        }
+    }
+    if (memcmp(profile + USER_PROFILE_SIZE - USER_RES_CTR, userProfilePointer(base_image, CUT_TEST_UID) + USER_PROFILE_SIZE - USER_RES_CTR, USER_CTR_SIZE) != 0)
+    {
+        counts[CLASS_USER_PROFILE]++;
+    }
+    
+    // Favorites pointing to a free slot are cleared by readFav()
+    for (uint8_t i = 0; i < USER_MAX_FAV; i++)
+    {
+        uint16_t addresses[2];
+        
+        memcpy(addresses, profile + USER_START_NODE_SIZE + i * USER_FAV_SIZE, sizeof(addresses));
+        if ((addresses[1] == NODE_ADDR_NULL) || ((nodeInArea(addresses[1]) == TRUE) && (validBitFromFlags(nodePointer(image, addresses[1])->flags) != NODE_VBIT_VALID)))
+        {
+            continue;
+        }
+        if ((node_reached[addresses[1]] == FALSE) || (addresses[0] == NODE_ADDR_NULL) || (node_parent[addresses[1]] != addresses[0]))
+        {
+            counts[CLASS_FAVORITE]++;
+        }
+    }
+    
+    // Unreachable nodes of the user, changed nodes of the other users
+    for (uint16_t page = PAGE_PER_SECTOR; page < PAGE_COUNT; page++)
+    {
+        for (uint8_t node_number = 0; node_number < NODE_PER_PAGE; node_number++)
+        {
+            uint16_t address = (page << NODE_ADDR_SHMT) | node_number;
+            const gNode* node = nodePointer(image, address);
+            const gNode* base_node = nodePointer(base_image, address);
+            
+            if ((validBitFromFlags(node->flags) == NODE_VBIT_VALID) && (userIdFromFlags(node->flags) == CUT_TEST_UID) && (node_reached[address] == FALSE))
+            {
+                counts[CLASS_ORPHAN_NODE]++;
+            }
+            if ((validBitFromFlags(base_node->flags) == NODE_VBIT_VALID) && (userIdFromFlags(base_node->flags) != CUT_TEST_UID) && (memcmp(node, base_node, NODE_SIZE) != 0))
+            {
+                counts[CLASS_OTHER_USERS]++;
+            }
+        }
+    }
+    for (uint8_t uid = 0; uid < NODE_MAX_UID; uid++)
+    {
+        if ((uid != CUT_TEST_UID) && (memcmp(userProfilePointer(image, uid), userProfilePointer(base_image, uid), USER_PROFILE_SIZE) != 0))
+        {
+            counts[CLASS_OTHER_USERS]++;
+        }
+    }
+    
+    for (uint8_t i = 0; i < NB_CUT_CLASSES; i++)
+    {
+        total += counts[i];
+    }
+    return total;
+}
+
+/*! \fn     fillChildNode(const char* login, uint8_t password)
+*   \brief  Prepare the child node buffer
+*   \param  login       Login name
+*   \param  password    Password bytes value
+*/
+static void fillChildNode(const char* login, uint8_t password)
+{
+    memset((void*)&cut_cnode, 0, NODE_SIZE);
+    memset((void*)cut_cnode.password, password, sizeof(cut_cnode.password));
+    snprintf((char*)cut_cnode.login, sizeof(cut_cnode.login), "%s", login);
+    strcpy((char*)cut_cnode.description, "power cut");
+}
+
+/*! \fn     createService(const char* name, uint8_t type)
+*   \brief  Create a parent node
+*   \param  name    Service name
+*   \param  type    SERVICE_CRED_TYPE or SERVICE_DATA_TYPE
+*   \return Its address, NODE_ADDR_NULL on failure
+*/
+static uint16_t createService(const char* name, uint8_t type)
+{
+    memset((void*)&cut_pnode, 0, NODE_SIZE);
+    snprintf((char*)cut_pnode.service, sizeof(cut_pnode.service), "%s", name);
+    if (createParentNode(&cut_pnode, type) != RETURN_OK)
+    {
+        return NODE_ADDR_NULL;
+    }
+    return searchForServiceName(cut_pnode.service, COMPARE_MODE_MATCH, type);
+}
+
+/*! \fn     writeDataService(const char* name, uint8_t nb_nodes)
+*   \brief  Create a data service and fill it with data nodes
+*   \param  name        Service name
+*   \param  nb_nodes    Number of data nodes
+*   \return Success status
+*/
+static RET_TYPE writeDataService(const char* name, uint8_t nb_nodes)
+{
+    uint16_t parent_address = createService(name, SERVICE_DATA_TYPE);
+    
+    if (parent_address == NODE_ADDR_NULL)
+    {
+        return RETURN_NOK;
+    }
+    readParentNode(&cut_pnode, parent_address);
+    for (uint8_t i = 0; i < nb_nodes; i++)
+    {
+        memset((void*)&cut_dnode, 0, NODE_SIZE);
+        memset((void*)cut_dnode.data, i, sizeof(cut_dnode.data));
+        cut_dnode.flags = DATA_NODE_DATA_LENGTH;
+        if (writeNewDataNode(parent_address, &cut_pnode, &cut_dnode, (i == 0)? TRUE : FALSE, (i == nb_nodes - 1)? TRUE : FALSE) != RETURN_OK)
+        {
+            return RETURN_NOK;
+        }
+    }
+    return RETURN_OK;
+}
+
+/*! \fn     buildBaseDatabase(void)
+*   \brief  Create the users databases, their nodes interleaved in the flash
+*   \return Success status
+*/
+static RET_TYPE buildBaseDatabase(void)
+{
+    for (uint8_t uid = 0; uid < CUT_NB_USERS; uid++)
+    {
+        formatUserProfileMemory(uid);
+    }
+    for (uint8_t i = 0; i < CUT_NB_BASE_SERVICES; i++)
+    {
+        for (uint8_t uid = 0; uid < CUT_NB_USERS; uid++)
+        {
+            uint16_t address;
+            
+            // The test user has all the services, the others one in two
+            if ((uid != CUT_TEST_UID) && ((i + uid) % 2 != 0))
+            {
+                continue;
+            }
+            initNodeManagementHandle(uid);
+            if ((address = createService(base_services[i], SERVICE_CRED_TYPE)) == NODE_ADDR_NULL)
+            {
+                return RETURN_NOK;
+            }
+            for (uint8_t j = 0; j < 1 + i % 3; j++)
+            {
+                char login[32];
+                
+                snprintf(login, sizeof(login), "user%u@mail.com", j);
+                fillChildNode(login, j);
+                if (createChildNode(address, &cut_cnode) != RETURN_OK)
+                {
+                    return RETURN_NOK;
+                }
+            }
+            if ((uid == CUT_TEST_UID) && (i % 4 == 1))
+            {
+                readParentNode(&cut_pnode, address);
+                setFav(i / 4, address, cut_pnode.nextChildAddress);
+            }
+        }
+    }
+    for (uint8_t uid = 0; uid < CUT_NB_USERS; uid++)
+    {
+        initNodeManagementHandle(uid);
+        if (writeDataService("keys", 2) != RETURN_OK)
+        {
+            return RETURN_NOK;
+        }
+    }
+    return RETURN_OK;
+}
+
+/*! \fn     childAddress(uint16_t parent_address, uint8_t position)
+*   \brief  Get a child of a parent
+*   \param  parent_address  Parent address
+*   \param  position        0 for the first, 1 for the second, 0xFF for the last
+*   \return Child address
+*/
+static uint16_t childAddress(uint16_t parent_address, uint8_t position)
+{
+    uint16_t address;
+    
+    readParentNode(&cut_pnode, parent_address);
+    address = cut_pnode.nextChildAddress;
+    for (uint8_t i = 0; i < position; i++)
+    {
+        readChildNode(&cut_cnode, address);
+        if (cut_cnode.nextChildAddress == NODE_ADDR_NULL)
+        {
+            break;
+        }
+        address = cut_cnode.nextChildAddress;
+    }
+    return address;
+}
+
+/*! \fn     runWorkload(void)
+*   \brief  Run the workload on the test user database, current_step tracks its progress
+*   \return Success status
+*/
+static RET_TYPE runWorkload(void)
+{
+    uint16_t parent_address, child_address;
+    
+    current_step = STEP_FIRST_PARENT;
+    if (createService("aaa.com", SERVICE_CRED_TYPE) == NODE_ADDR_NULL)
+    {
+        return RETURN_NOK;
+    }
+    current_step = STEP_MIDDLE_PARENT;
+    if (createService("mooltipass.com", SERVICE_CRED_TYPE) == NODE_ADDR_NULL)
+    {
+        return RETURN_NOK;
+    }
+    current_step = STEP_LAST_PARENT;
+    if (createService("zzz.com", SERVICE_CRED_TYPE) == NODE_ADDR_NULL)
+    {
+        return RETURN_NOK;
+    }
+    
+    parent_address = searchForServiceName((uint8_t*)CUT_CHILD_SERVICE, COMPARE_MODE_MATCH, SERVICE_CRED_TYPE);
+    current_step = STEP_FIRST_CHILD;
+    fillChildNode("aaa@mail.com", 0xA0);
+    if (createChildNode(parent_address, &cut_cnode) != RETURN_OK)
+    {
+        return RETURN_NOK;
+    }
+    current_step = STEP_LAST_CHILD;
+    fillChildNode("zzz@mail.com", 0xA1);
+    if (createChildNode(parent_address, &cut_cnode) != RETURN_OK)
+    {
+        return RETURN_NOK;
+    }
+    
+    // Password change, then login change (deletion and creation)
+    current_step = STEP_UPDATE_CHILD;
+    child_address = childAddress(parent_address, 2);
+    readParentNode(&cut_pnode, parent_address);
+    readChildNode(&cut_cnode, child_address);
+    cut_cnode.password[0]++;
+    if (updateChildNode(&cut_pnode, &cut_cnode, parent_address, child_address) != RETURN_OK)
+    {
+        return RETURN_NOK;
+    }
+    current_step = STEP_RENAME_CHILD;
+    child_address = childAddress(parent_address, 1);
+    readParentNode(&cut_pnode, parent_address);
+    readChildNode(&cut_cnode, child_address);
+    strcpy((char*)cut_cnode.login, "user9@mail.com");
+    if (updateChildNode(&cut_pnode, &cut_cnode, parent_address, child_address) != RETURN_OK)
+    {
+        return RETURN_NOK;
+    }
+    
+    current_step = STEP_DELETE_FIRST_CHILD;
+    if (deleteChildNode(parent_address, childAddress(parent_address, 0)) != RETURN_OK)
+    {
+        return RETURN_NOK;
+    }
+    current_step = STEP_DELETE_MIDDLE_CHILD;
+    if (deleteChildNode(parent_address, childAddress(parent_address, 1)) != RETURN_OK)
+    {
+        return RETURN_NOK;
+    }
+    current_step = STEP_DELETE_LAST_CHILD;
+    if (deleteChildNode(parent_address, childAddress(parent_address, 0xFF)) != RETURN_OK)
+    {
+        return RETURN_NOK;
+    }
+    
+    current_step = STEP_DATA_SERVICE;
+    return writeDataService("notes", 3);
+}
+
+/*! \fn     printCounts(const uint32_t* counts)
+*   \brief  Print the corruption classes found by a check
+*   \param  counts  Corruption counts
+*/
+static void printCounts(const uint32_t* counts)
+{
+    for (uint8_t i = 0; i < NB_CUT_CLASSES; i++)
+    {
+        if (counts[i] != 0)
+        {
+            printf(" %s x%u", cut_class_names[i], counts[i]);
+        }
+    }
+    printf("\n");
+}
+
+/*! \fn     runCutPoint(uint32_t transaction, uint8_t mode, uint8_t verbose)
+*   \brief  Replay the workload until a power cut and check the database
+*   \param  transaction Transaction at the end of which the power is cut
+*   \param  mode        MODE_COMPLETE or MODE_TORN
+*   \param  verbose     TRUE to print the corruptions found
+*   \return Success status, RETURN_NOK if the workload failed
+*/
+static RET_TYPE runCutPoint(uint32_t transaction, uint8_t mode, uint8_t verbose)
+{
+    cutModeResults_t* mode_results = &results[mode];
+    static uint32_t nb_verbose_lines = 0;
+    uint32_t counts[NB_CUT_CLASSES];
+    uint32_t torn_pages;
+    
+    // Device restarted on the base database
+    memcpy(at45dbGetImage(), base_image, FLASH_SIZE);
+    initNodeManagementHandle(CUT_TEST_UID);
+    at45dbResetStats();
+    at45dbSetPowerCut(transaction, (mode == MODE_TORN)? TRUE : FALSE, powerCutCallback);
+    if (setjmp(power_cut_jmp) == 0)
+    {
+        RET_TYPE ret = runWorkload();
+        
+        // The workload is replayed identically, it can't end before the cut
+        at45dbSetPowerCut(0, FALSE, NULL);
+        printf("workload %s before transaction %u\n", (ret == RETURN_OK)? "completed" : "failed", transaction);
+        return RETURN_NOK;
+    }
+    torn_pages = at45dbGetStats()->torn_pages;
+    
+    mode_results->step_cut_points[current_step]++;
+    if (checkDatabase(at45dbGetImage(), counts) == 0)
+    {
+        return RETURN_OK;
+    }
+    mode_results->corrupted++;
+    mode_results->step_corrupted[current_step]++;
+    for (uint8_t i = 0; i < NB_CUT_CLASSES; i++)
+    {
+        mode_results->cut_points[i] += (counts[i] != 0)? 1 : 0;
+        mode_results->instances[i] += counts[i];
+    }
+    if ((verbose == TRUE) && (nb_verbose_lines++ < CUT_MAX_VERBOSE_LINES))
+    {
+        printf("%s cut at transaction %u (%s%s):", cut_mode_names[mode], transaction, cut_step_names[current_step], (torn_pages != 0)? ", torn page" : "");
+        printCounts(counts);
+    }
+    return RETURN_OK;
+}
+
+/*! \fn     printResults(uint8_t mode)
+*   \brief  Print the results of a cut mode and add them to the baseline rows
+*   \param  mode        Cut mode
+*/
+static void printResults(uint8_t mode)
+{
+    cutModeResults_t* mode_results = &results[mode];
+    double value;
+    
+    printf("Power cuts with the %s\n", cut_mode_descriptions[mode]);
+    printf("%-22s %10s %10s\n", "step", "cut points", "corrupted");
+    for (uint8_t i = 0; i < NB_CUT_STEPS; i++)
+    {
+        printf("%-22s %10u %10u\n", cut_step_names[i], mode_results->step_cut_points[i], mode_results->step_corrupted[i]);
+    }
+    printf("%-22s %10s %10s  %s\n", "class", "cut points", "instances", "description");
+    for (uint8_t i = 0; i < NB_CUT_CLASSES; i++)
+    {
+        printf("%-22s %10u %10u  %s\n", cut_class_names[i], mode_results->cut_points[i], mode_results->instances[i], cut_class_descriptions[i]);
+        value = mode_results->cut_points[i];
+        hostBaselineAddRow(&baseline, &value, "%s %s", cut_mode_names[mode], cut_class_names[i]);
+    }
+    printf("%u corrupted cut points\n\n", mode_results->corrupted);
+    value = mode_results->corrupted;
+    hostBaselineAddRow(&baseline, &value, "%s corrupted", cut_mode_names[mode]);
+}
+
+/*! \fn     usage(void)
+*   \brief  Print the usage
+*/
+static int usage(void)
+{
+    return hostBaselineUsage(&baseline, "power_cut_test [--every N] [--verbose] [--save FILE] [--baseline FILE] [--tolerance PERCENT]", NULL);
+}
+
+int main(int argc, char* argv[])
+{
+    uint32_t counts[NB_CUT_CLASSES];
+    uint32_t nb_transactions;
+    uint8_t verbose = FALSE;
+    uint32_t every = 1;
+    int nb_regressions;
+    
+    hostBaselineInit(&baseline, cut_columns, 1, FALSE, 0);
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--verbose") == 0)
+        {
+            verbose = TRUE;
+        }
+        else if (i + 1 == argc)
+        {
+            return usage();
+        }
+        else if (strcmp(argv[i], "--every") == 0)
+        {
+            every = strtoul(argv[++i], NULL, 0);
+        }
+        else if (hostBaselineParseOption(&baseline, argv[i], argv[i + 1]) != 0)
+        {
+            i++;
+        }
+        else
+        {
+            return usage();
+        }
+    }
+    if (every == 0)
+    {
+        return usage();
+    }
+    
+    // Base database, kept to restore it before each cut point
+    if ((at45dbOpen(NULL) != 0) || (hostEepromOpen(NULL) != 0) || ((base_image = malloc(FLASH_SIZE)) == NULL))
+    {
+        return 2;
+    }
+    mooltipassParametersInit();
+    initFlashIOs();
+    if (buildBaseDatabase() != RETURN_OK)
+    {
+        printf("FAILED to build the base database\n");
+        return 1;
+    }
+    memcpy(base_image, at45dbGetImage(), FLASH_SIZE);
+    if (checkDatabase(base_image, counts) != 0)
+    {
+        printf("FAILED: corruptions found in the base database:");
+        printCounts(counts);
+        return 1;
+    }
+    
+    // Reference run, without power cut
+    initNodeManagementHandle(CUT_TEST_UID);
+    at45dbResetStats();
+    if (runWorkload() != RETURN_OK)
+    {
+        printf("FAILED to run the workload\n");
+        return 1;
+    }
+    nb_transactions = at45dbGetStats()->transactions;
+    if (checkDatabase(at45dbGetImage(), counts) != 0)
+    {
+        printf("FAILED: corruptions found after the workload:");
+        printCounts(counts);
+        return 1;
+    }
+    printf("Power cut test: %u pages of %u bytes, %u users, workload of %u transactions, cut every %u transactions\n\n", PAGE_COUNT, BYTES_PER_PAGE, CUT_NB_USERS, nb_transactions, every);
+    
+    for (uint8_t mode = 0; mode < NB_CUT_MODES; mode++)
+    {
+        for (uint32_t transaction = every; transaction <= nb_transactions; transaction += every)
+        {
+            if (runCutPoint(transaction, mode, verbose) != RETURN_OK)
+            {
+                printf("FAILED\n");
+                return 1;
+            }
+            if (at45dbGetStats()->violations != 0)
+            {
+                printf("FAILED: %u flash violations\n", at45dbGetStats()->violations);
+                return 1;
+            }
+        }
+    }
+    if (verbose == TRUE)
+    {
+        printf("\n");
+    }
+    for (uint8_t mode = 0; mode < NB_CUT_MODES; mode++)
+    {
+        printResults(mode);
+    }
+    at45dbClose();
+    free(base_image);
+    nb_regressions = hostBaselineFinish(&baseline);
+    if (nb_regressions < 0)
+    {
+        return 2;
+    }
+    return (nb_regressions == 0)? 0 : 1;
+}
@@ -0,0 +1,327 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     scroll_test.c
+*    \brief    Scrolling lines of the Mini login selection screen against a full redraw
+*    Created:  19/10/2026
+*/
+/*
+ * guiScrollLine() moves the displayed characters of a service name larger
+ * than the screen in the frame buffer and only draws the ones appearing on
+ * its right. Random service names are stored in parent nodes and scrolled
+ * like loginSelectionScreen() does, and the frame rebuilt by the SSD1305
+ * model after each tick is compared with the one of a full redraw, as the
+ * previous loginSelectionScreen() did: nodes read again, screen cleared and
+ * the three lines drawn from their offsets. The full redraw draws the lines
+ * bottom up, so that a glyph clearing rows outside of its own line in
+ * miniOledBitmapDrawRaw() shows as a difference. The flash and OLED bus
+ * traffic per tick of both methods are compared against a baseline.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "at45db_model.h"
+#include "host_baseline.h"
+#include "host_eeprom.h"
+#include "host_test.h"
+#include "ssd1305_model.h"
+#include "host_png.h"
+#pragma pack(push, 1)
+#include "gui_scrolling_functions.h"
+#include "gui_screen_functions.h"
+#include "logic_fwflash_storage.h"
+#include "logic_eeprom.h"
+#include "oled_wrapper.h"
+#include "node_mgmt.h"
+#include "flash_mem.h"
+#include "defines.h"
+#pragma pack(pop)
+
+#define SCROLL_DEFAULT_TOLERANCE    0.0
+#define SCROLL_DEFAULT_SCREENS      3000
+#define SCROLL_DEFAULT_TICKS        150
+#define SCROLL_MAX_TICKS            1000
+#define SCROLL_NB_LINES             3
+
+/* Traffic of the ticks of one method */
+typedef struct
+{
+    uint32_t crc;               // CRC32 of the frame CRCs
+    uint64_t ticks;
+    uint64_t flash_bytes;
+    uint64_t flash_transactions;
+    uint64_t oled_bytes;        // Commands, arguments and data
+} scrollStats_t;
+
+static const uint8_t x_coordinates[SCROLL_NB_LINES] = {SCROLL_LINE_TEXT_FIRST_XPOS, SCROLL_LINE_TEXT_SECOND_XPOS, SCROLL_LINE_TEXT_THIRD_XPOS};
+static const uint8_t y_coordinates[SCROLL_NB_LINES] = {THREE_LINE_TEXT_FIRST_POS, THREE_LINE_TEXT_SECOND_POS, THREE_LINE_TEXT_THIRD_POS};
+static const uint8_t top_coordinates[SCROLL_NB_LINES+1] = {SCROLL_LINE_FIRST_TOP_YPOS, SCROLL_LINE_SECOND_TOP_YPOS, SCROLL_LINE_THIRD_TOP_YPOS, SSD1305_OLED_HEIGHT};
+static uint16_t addresses[SCROLL_NB_LINES];
+static uint32_t frame_crcs[SCROLL_MAX_TICKS];
+static uint8_t frame_offsets[SCROLL_MAX_TICKS][SCROLL_NB_LINES];
+static scrollStats_t scroll_stats;
+static scrollStats_t redraw_stats;
+// Frames and traffic per tick, any frame change is a regression
+static const hostBaselineColumn_t scroll_columns[4] = {{"frames crc", 0, TRUE}, {"flash bytes", 2, FALSE}, {"flash transactions", 2, FALSE}, {"OLED bytes", 2, FALSE}};
+static hostBaseline_t baseline;
+
+
+/*! \fn     storeRandomServices(void)
+*   \brief  Store three random service names in parent nodes, one per page after the graphics zone
+*   \note   Most names are mixed letters with descenders, a third of them fit on the screen
+*/
+static void storeRandomServices(void)
+{
+    const char letters[] = "gjpqyGPQYabcdefmwWMil.,_";
+    pNode temp_pnode;
+    
+    for (uint8_t i = 0; i < SCROLL_NB_LINES; i++)
+    {
+        uint8_t length = (hostTestRandom() % 3 == 0)? hostTestRandom() % 15 : hostTestRandom() % NODE_PARENT_SIZE_OF_SERVICE;
+        
+        memset(&temp_pnode, 0, sizeof(temp_pnode));
+        for (uint8_t j = 0; j < length; j++)
+        {
+            temp_pnode.service[j] = (hostTestRandom() % 6 == 0)? ' ' + hostTestRandom() % 95 : letters[hostTestRandom() % (sizeof(letters) - 1)];
+        }
+        addresses[i] = (PAGE_PER_SECTOR + i) << NODE_ADDR_SHMT;
+        writeDataToFlash(pageNumberFromAddress(addresses[i]), 0, NODE_SIZE, &temp_pnode);
+    }
+}
+
+/*! \fn     addTickStats(scrollStats_t* stats, const at45dbStats_t* flash_start)
+*   \brief  Add the traffic of a tick, counted since the model statistics were reset
+*   \param  stats       Statistics of the method
+*   \param  flash_start Flash counters at the start of the tick
+*/
+static void addTickStats(scrollStats_t* stats, const at45dbStats_t* flash_start)
+{
+    stats->ticks++;
+    stats->flash_bytes += at45dbGetStats()->spi_bytes - flash_start->spi_bytes;
+    stats->flash_transactions += at45dbGetStats()->transactions - flash_start->transactions;
+    stats->oled_bytes += ssd1305GetStats()->command_bytes + ssd1305GetStats()->data_bytes;
+}
+
+/*! \fn     scrollScreen(uint16_t nb_ticks)
+*   \brief  Display the services and scroll them with the firmware functions, like loginSelectionScreen()
+*   \param  nb_ticks    Number of frames, the first one being the selection screen
+*/
+static void scrollScreen(uint16_t nb_ticks)
+{
+    scrollingLine_t scrolling_lines[SCROLL_NB_LINES];
+    at45dbStats_t flash_start;
+    uint8_t lines_modified;
+    pNode temp_pnode;
+    
+    oledClear();
+    for (uint8_t i = 0; i < SCROLL_NB_LINES; i++)
+    {
+        readParentNode(&temp_pnode, addresses[i]);
+        guiSetScrollingLine(&scrolling_lines[i], (char*)temp_pnode.service, x_coordinates[i], y_coordinates[i]);
+    }
+    miniOledFlushEntireBufferToDisplay();
+    
+    for (uint16_t tick = 0; tick < nb_ticks; tick++)
+    {
+        if (tick > 0)
+        {
+            flash_start = *at45dbGetStats();
+            ssd1305ResetStats();
+            lines_modified = FALSE;
+            for (uint8_t i = 0; i < SCROLL_NB_LINES; i++)
+            {
+                if (guiScrollLine(&scrolling_lines[i], x_coordinates[i], y_coordinates[i], top_coordinates[i], top_coordinates[i+1] - top_coordinates[i]) != FALSE)
+                {
+                    lines_modified = TRUE;
+                }
+            }
+            if (lines_modified != FALSE)
+            {
+                miniOledFlushEntireBufferToDisplay();
+            }
+            addTickStats(&scroll_stats, &flash_start);
+        }
+        frame_crcs[tick] = hostTestFrameCrc();
+        for (uint8_t i = 0; i < SCROLL_NB_LINES; i++)
+        {
+            frame_offsets[tick][i] = scrolling_lines[i].offset;
+        }
+        scroll_stats.crc = hostCrc32(scroll_stats.crc, (uint8_t*)&frame_crcs[tick], sizeof(frame_crcs[tick]));
+    }
+}
+
+/*! \fn     redrawScreen(uint16_t nb_ticks)
+*   \brief  Redraw the services on every tick and compare the frames with the scrolled ones
+*   \param  nb_ticks    Number of frames, the first one being the selection screen
+*   \return Number of differing frames
+*/
+static uint16_t redrawScreen(uint16_t nb_ticks)
+{
+    uint8_t offsets[SCROLL_NB_LINES] = {0, 0, 0};
+    uint8_t extra_chars[SCROLL_NB_LINES] = {0, 0, 0};
+    at45dbStats_t flash_start;
+    uint16_t nb_differences = 0;
+    pNode temp_pnode;
+    uint32_t crc;
+    
+    for (uint16_t tick = 0; tick < nb_ticks; tick++)
+    {
+        // String offset counters of the previous loginSelectionScreen()
+        for (uint8_t i = 0; (tick > 0) && (i < SCROLL_NB_LINES); i++)
+        {
+            if ((extra_chars[i] > 0) && (offsets[i]++ == extra_chars[i]))
+            {
+                offsets[i] = 0;
+            }
+        }
+        
+        flash_start = *at45dbGetStats();
+        ssd1305ResetStats();
+        oledClear();
+        for (uint8_t i = SCROLL_NB_LINES; i-- > 0;)
+        {
+            readParentNode(&temp_pnode, addresses[i]);
+            extra_chars[i] = strlen((char*)temp_pnode.service) - miniOledPutstrXY(x_coordinates[i], y_coordinates[i], OLED_RIGHT, (char*)temp_pnode.service + offsets[i]);
+        }
+        miniOledFlushEntireBufferToDisplay();
+        if (tick > 0)
+        {
+            addTickStats(&redraw_stats, &flash_start);
+        }
+        
+        crc = hostTestFrameCrc();
+        redraw_stats.crc = hostCrc32(redraw_stats.crc, (uint8_t*)&crc, sizeof(crc));
+        if ((crc != frame_crcs[tick]) || (memcmp(offsets, frame_offsets[tick], sizeof(offsets)) != 0))
+        {
+            nb_differences++;
+        }
+    }
+    return nb_differences;
+}
+
+/*! \fn     addResult(const char* name, const scrollStats_t* stats)
+*   \brief  Print the mean traffic per tick of a method and add it to the baseline rows
+*   \param  name    Method name
+*   \param  stats   Its statistics
+*/
+static void addResult(const char* name, const scrollStats_t* stats)
+{
+    double values[4] = {stats->crc, (double)stats->flash_bytes / stats->ticks, (double)stats->flash_transactions / stats->ticks, (double)stats->oled_bytes / stats->ticks};
+    
+    printf("%-12s %08x %12.2f %12.2f %12.2f\n", name, stats->crc, values[1], values[2], values[3]);
+    hostBaselineAddRow(&baseline, values, "%s", name);
+}
+
+/*! \fn     usage(void)
+*   \brief  Print the usage
+*/
+static int usage(void)
+{
+    return hostBaselineUsage(&baseline, "scroll_test [--bundle FILE] [--screens N] [--ticks N] [--seed N] [--save FILE] [--baseline FILE] [--tolerance PERCENT]", NULL);
+}
+
+int main(int argc, char* argv[])
+{
+    const char* bundle_path = HOST_TEST_DEFAULT_BUNDLE;
+    uint32_t nb_screens = SCROLL_DEFAULT_SCREENS;
+    uint32_t nb_ticks = SCROLL_DEFAULT_TICKS;
+    uint32_t nb_differences = 0;
+    uint32_t seed = 1;
+    int nb_regressions;
+    
+    hostBaselineInit(&baseline, scroll_columns, 4, TRUE, SCROLL_DEFAULT_TOLERANCE);
+    for (int i = 1; i < argc; i++)
+    {
+        if (i + 1 == argc)
+        {
+            return usage();
+        }
+        else if (strcmp(argv[i], "--bundle") == 0)
+        {
+            bundle_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--screens") == 0)
+        {
+            nb_screens = strtoul(argv[++i], NULL, 0);
+        }
+        else if (strcmp(argv[i], "--ticks") == 0)
+        {
+            nb_ticks = strtoul(argv[++i], NULL, 0);
+        }
+        else if (strcmp(argv[i], "--seed") == 0)
+        {
+            seed = strtoul(argv[++i], NULL, 0);
+        }
+        else if (hostBaselineParseOption(&baseline, argv[i], argv[i + 1]) != 0)
+        {
+            i++;
+        }
+        else
+        {
+            return usage();
+        }
+    }
+    if ((nb_screens == 0) || (nb_ticks < 2) || (nb_ticks > SCROLL_MAX_TICKS) || (seed == 0))
+    {
+        return usage();
+    }
+    
+    if ((at45dbOpen(NULL) != 0) || (hostEepromOpen(NULL) != 0))
+    {
+        return 2;
+    }
+    mooltipassParametersInit();
+    initFlashIOs();
+    if (at45dbLoadBundle(bundle_path) < 0)
+    {
+        return 2;
+    }
+    printf("Scrolling lines: %u screens of %u ticks, seed %u\n\n", nb_screens, nb_ticks, seed);
+    
+    ssd1305Open();
+    oledInitIOs();
+    oledBegin(FONT_DEFAULT);
+    hostTestSeed(seed);
+    for (uint32_t screen = 0; screen < nb_screens; screen++)
+    {
+        // The screen comes after a scrolled bitmap, the frame buffer offset changes every time
+        oledBitmapDrawFlash(0, 0, BITMAP_MAIN_LOCK, OLED_SCROLL_UP);
+        storeRandomServices();
+        scrollScreen(nb_ticks);
+        nb_differences += redrawScreen(nb_ticks);
+    }
+    
+    printf("%-12s %8s %12s %12s %12s\n", "per tick", "crc32", "flash bytes", "flash tx", "OLED bytes");
+    addResult("scroll", &scroll_stats);
+    addResult("full_redraw", &redraw_stats);
+    printf("\n%llu ticks, %u differing frames, %u controller violations, %u flash violations\n", (unsigned long long)scroll_stats.ticks, nb_differences, ssd1305GetStats()->violations, at45dbGetStats()->violations);
+    if ((nb_differences != 0) || (ssd1305GetStats()->violations != 0) || (at45dbGetStats()->violations != 0))
+    {
+        printf("FAILED\n");
+        return 1;
+    }
+    ssd1305Close();
+    at45dbClose();
+    nb_regressions = hostBaselineFinish(&baseline);
+    if (nb_regressions < 0)
+    {
+        return 2;
+    }
+    return (nb_regressions == 0)? 0 : 1;
+}
@@ -0,0 +1,410 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     ssd1305_model.c
+*    \brief    SSD1305 OLED controller model for the Mini host builds, connected to the host SPI functions
+*    Created:  19/10/2026
+*/
+/*
+ * Once opened, the model gets the USART SPI bytes sent while the OLED chip
+ * select is low (and the flash one high). Unlike the SSD1322, the command
+ * arguments are sent with the data / command pin low and each command is
+ * decoded from its opcode length, the data bytes only go to the GDDRAM. The
+ * 132 columns by 8 pages (64 rows, one bit per pixel) GDDRAM is updated in
+ * the horizontal, vertical or page addressing mode like on the chip, and
+ * the visible 128x32 frame is rebuilt from the display start line.
+ * Frames are in the firmware's coordinates: column 4 is x 0 and bit 0 of a
+ * page is its top row, the segment and COM remaps only matter to the way
+ * the panel is mounted and aren't applied. Each byte takes 1us of simulated
+ * time (8MHz bus), commands and data are counted separately so that render
+ * changes can be compared by their bus traffic.
+ */
+#include <string.h>
+#include <stdio.h>
+#include "ssd1305_model.h"
+#include "host_time.h"
+#include "host_png.h"
+#include "defines.h"
+#include "oledmini.h"
+
+/* Simulated duration of a byte transfer in ns */
+#define SSD1305_SPI_BYTE_TIME       1000ULL
+/* GDDRAM geometry, 8 rows per page */
+#define SSD1305_NB_COLUMNS          132
+#define SSD1305_NB_PAGES            8
+#define SSD1305_NB_ROWS             (SSD1305_NB_PAGES * 8)
+/* Addressing modes */
+#define SSD1305_MODE_HORIZONTAL     0
+#define SSD1305_MODE_VERTICAL       1
+#define SSD1305_MODE_PAGE           2
+#define SSD1305_MAX_ARGS            4
+#define SSD1305_MAX_VIOLATION_PRINTS 10
+
+/* Device state */
+static uint8_t model_open = FALSE;
+static uint8_t gddram[SSD1305_NB_PAGES][SSD1305_NB_COLUMNS];
+static uint8_t column_start, column_end, page_start, page_end;
+static uint8_t column, page, addressing_mode;
+static uint8_t start_line, display_offset;
+static uint8_t display_mode = SSD1305_CMD_ENTIRE_DISPLAY_NORMAL;
+static uint8_t display_inverted = FALSE;
+static uint8_t display_on = FALSE;
+/* Command being received */
+static uint8_t command;
+static uint8_t args[SSD1305_MAX_ARGS];
+static uint8_t nb_args, expected_args;
+static ssd1305Stats_t stats;
+
+
+/*! \fn     ssd1305Violation(const char* reason)
+*   \brief  Count and report a transfer the real controller wouldn't make sense of
+*   \param  reason  Description of the violation
+*/
+static void ssd1305Violation(const char* reason)
+{
+    if (stats.violations++ < SSD1305_MAX_VIOLATION_PRINTS)
+    {
+        fprintf(stderr, "ssd1305: %s (command 0x%02x)\n", reason, command);
+    }
+}
+
+/*! \fn     ssd1305NbArgs(uint8_t cmd)
+*   \brief  Number of argument bytes of a command
+*   \param  cmd     The command
+*   \return Number of bytes, 0xFF for unsupported commands
+*/
+static uint8_t ssd1305NbArgs(uint8_t cmd)
+{
+    // Commands holding their parameter in the opcode
+    if ((cmd < SSD1305_CMD_SET_MEM_ADDRESSING_MODE) || ((cmd & 0xC0) == SSD1305_CMD_SET_DISPLAY_START_LINE) || ((cmd & 0xF8) == SSD1305_CMD_SET_PAGE_START_ADDR))
+    {
+        return 0;
+    }
+    switch (cmd)
+    {
+        case SSD1305_CMD_SET_LUT:
+        case SSD1305_CMD_SET_BANK_COLOR_1TO16:
+        case SSD1305_CMD_SET_BANK_COLOR_17TO32:
+        case SSD1305_CMD_DIM_MODE_SETTING:          return 4;
+        case SSD1305_CMD_SET_COLUMN_ADDR:
+        case SSD1305_CMD_SET_PAGE_ADDR:             return 2;
+        case SSD1305_CMD_SET_MEM_ADDRESSING_MODE:
+        case SSD1305_CMD_SET_CONTRAST_CURRENT:
+        case SSD1305_CMD_SET_BRIGHTNESS:
+        case SSD1305_CMD_SET_MULTIPLEX_RATIO:
+        case SSD1305_CMD_SET_MASTER_CONFIGURATION:
+        case SSD1305_CMD_SET_DISPLAY_OFFSET:
+        case SSD1305_CMD_SET_DISPLAY_CLOCK_DIVIDE:
+        case SSD1305_CMD_SET_AREA_COLOR_MODE:
+        case SSD1305_CMD_SET_PRECHARGE_PERIOD:
+        case SSD1305_CMD_SET_COM_PINS_CONF:
+        case SSD1305_CMD_SET_VCOMH_VOLTAGE:         return 1;
+        case SSD1305_CMD_SET_SEGMENT_REMAP_COL_0:
+        case SSD1305_CMD_SET_SEGMENT_REMAP_COL_131:
+        case SSD1305_CMD_ENTIRE_DISPLAY_NORMAL:
+        case SSD1305_CMD_ENTIRE_DISPLAY_ON:
+        case SSD1305_CMD_ENTIRE_DISPLAY_NREVERSED:
+        case SSD1305_CMD_ENTIRE_DISPLAY_REVERSED:
+        case SSD1305_CMD_DISPLAY_DIM_MODE:
+        case SSD1305_CMD_DISPLAY_OFF:
+        case SSD1305_CMD_DISPLAY_NORMAL_MODE:
+        case SSD1305_CMD_COM_OUTPUT_NORMAL:
+        case SSD1305_CMD_COM_OUTPUT_REVERSED:
+        case SSD1305_CMD_ENTER_READ_MODIFY_WRITE_MODE:
+        case SSD1305_CMD_NOP:
+        case SSD1305_CMD_EXIT_READ_MODIFY_WRITE_MODE: return 0;
+        default:                                    return 0xFF;
+    }
+}
+
+/*! \fn     ssd1305ClampAddress(uint8_t address, uint8_t nb_addresses)
+*   \brief  Check a column or page address
+*   \param  address         The address
+*   \param  nb_addresses    Number of valid addresses
+*   \return The address, the last valid one if out of range
+*/
+static uint8_t ssd1305ClampAddress(uint8_t address, uint8_t nb_addresses)
+{
+    if (address >= nb_addresses)
+    {
+        ssd1305Violation("address out of range");
+        return nb_addresses - 1;
+    }
+    return address;
+}
+
+/*! \fn     ssd1305ExecuteCommand(void)
+*   \brief  Apply a command once all its arguments are received
+*/
+static void ssd1305ExecuteCommand(void)
+{
+    if (command < SSD1305_CMD_SET_HIGH_COLUMN_START_ADDR)
+    {
+        // Page addressing mode column, low nibble
+        column = ssd1305ClampAddress((column & 0xF0) | (command & 0x0F), SSD1305_NB_COLUMNS);
+        return;
+    }
+    if (command < SSD1305_CMD_SET_MEM_ADDRESSING_MODE)
+    {
+        // Page addressing mode column, high nibble
+        column = ssd1305ClampAddress(((command & 0x0F) << 4) | (column & 0x0F), SSD1305_NB_COLUMNS);
+        return;
+    }
+    if ((command & 0xC0) == SSD1305_CMD_SET_DISPLAY_START_LINE)
+    {
+        start_line = command & (SSD1305_NB_ROWS - 1);
+        stats.start_line_changes++;
+        return;
+    }
+    if ((command & 0xF8) == SSD1305_CMD_SET_PAGE_START_ADDR)
+    {
+        page = command & (SSD1305_NB_PAGES - 1);
+        return;
+    }
+    switch (command)
+    {
+        case SSD1305_CMD_SET_MEM_ADDRESSING_MODE:
+        {
+            addressing_mode = args[0] & 0x03;
+            if (addressing_mode > SSD1305_MODE_PAGE)
+            {
+                ssd1305Violation("invalid addressing mode");
+                addressing_mode = SSD1305_MODE_PAGE;
+            }
+            break;
+        }
+        case SSD1305_CMD_SET_COLUMN_ADDR:
+        {
+            column_start = ssd1305ClampAddress(args[0], SSD1305_NB_COLUMNS);
+            column_end = ssd1305ClampAddress(args[1], SSD1305_NB_COLUMNS);
+            column = column_start;
+            stats.windows++;
+            break;
+        }
+        case SSD1305_CMD_SET_PAGE_ADDR:
+        {
+            page_start = ssd1305ClampAddress(args[0], SSD1305_NB_PAGES);
+            page_end = ssd1305ClampAddress(args[1], SSD1305_NB_PAGES);
+            page = page_start;
+            stats.windows++;
+            break;
+        }
+        case SSD1305_CMD_SET_DISPLAY_OFFSET:        display_offset = args[0] & (SSD1305_NB_ROWS - 1); break;
+        case SSD1305_CMD_ENTIRE_DISPLAY_NORMAL:
+        case SSD1305_CMD_ENTIRE_DISPLAY_ON:         display_mode = command; break;
+        case SSD1305_CMD_ENTIRE_DISPLAY_NREVERSED:  display_inverted = FALSE; break;
+        case SSD1305_CMD_ENTIRE_DISPLAY_REVERSED:   display_inverted = TRUE; break;
+        case SSD1305_CMD_DISPLAY_OFF:               display_on = FALSE; break;
+        case SSD1305_CMD_DISPLAY_NORMAL_MODE:       display_on = TRUE; break;
+        default: break;
+    }
+}
+
+/*! \fn     ssd1305WriteRam(uint8_t data)
+*   \brief  Write a GDDRAM byte and move to the next one within the window
+*   \param  data    The byte
+*/
+static void ssd1305WriteRam(uint8_t data)
+{
+    gddram[page][column] = data;
+    stats.ram_bytes++;
+    
+    if (addressing_mode == SSD1305_MODE_PAGE)
+    {
+        column = (column + 1) % SSD1305_NB_COLUMNS;
+    }
+    else if (addressing_mode == SSD1305_MODE_VERTICAL)
+    {
+        if (page++ == page_end)
+        {
+            page = page_start;
+            column = (column == column_end)? column_start : column + 1;
+        }
+    }
+    else
+    {
+        if (column++ == column_end)
+        {
+            column = column_start;
+            page = (page == page_end)? page_start : page + 1;
+        }
+    }
+    // Windows wrapping around the end of the GDDRAM
+    column %= SSD1305_NB_COLUMNS;
+    page %= SSD1305_NB_PAGES;
+}
+
+/*! \fn     ssd1305Open(void)
+*   \brief  Reset the controller, connect it to the host SPI bus
+*/
+void ssd1305Open(void)
+{
+    memset(gddram, 0, sizeof(gddram));
+    column_start = 0;
+    column_end = SSD1305_NB_COLUMNS - 1;
+    page_start = 0;
+    page_end = SSD1305_NB_PAGES - 1;
+    column = page = 0;
+    addressing_mode = SSD1305_MODE_PAGE;
+    start_line = display_offset = 0;
+    display_mode = SSD1305_CMD_ENTIRE_DISPLAY_NORMAL;
+    display_inverted = FALSE;
+    display_on = FALSE;
+    command = SSD1305_CMD_DISPLAY_OFF;
+    nb_args = expected_args = 0;
+    memset(&stats, 0, sizeof(stats));
+    model_open = TRUE;
+}
+
+/*! \fn     ssd1305Close(void)
+*   \brief  Disconnect the controller from the host SPI bus
+*/
+void ssd1305Close(void)
+{
+    model_open = FALSE;
+}
+
+/*! \fn     ssd1305Selected(void)
+*   \brief  Check if the next SPI byte is for the controller
+*   \return TRUE or FALSE
+*/
+uint8_t ssd1305Selected(void)
+{
+    if ((model_open == FALSE) || (host_PORTD & (1 << PORTID_OLED_SS)) || ((host_PORTB & (1 << PORTID_FLASH_nS)) == 0))
+    {
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/*! \fn     ssd1305Transfer(uint8_t data)
+*   \brief  Receive a byte, the controller doesn't answer on the SPI bus
+*   \param  data    Byte sent by the MCU
+*   \return 0xFF
+*/
+uint8_t ssd1305Transfer(uint8_t data)
+{
+    hostTimeAdvance(SSD1305_SPI_BYTE_TIME);
+    
+    if (host_PORTD & (1 << PORTID_OLED_DnC))
+    {
+        // GDDRAM data, a command missing arguments is dropped
+        stats.data_bytes++;
+        if (nb_args != expected_args)
+        {
+            ssd1305Violation("missing arguments");
+            nb_args = expected_args;
+        }
+        ssd1305WriteRam(data);
+        return 0xFF;
+    }
+    
+    stats.command_bytes++;
+    if (nb_args < expected_args)
+    {
+        args[nb_args++] = data;
+        if (nb_args == expected_args)
+        {
+            ssd1305ExecuteCommand();
+        }
+        return 0xFF;
+    }
+    
+    command = data;
+    nb_args = 0;
+    expected_args = ssd1305NbArgs(data);
+    if (expected_args == 0xFF)
+    {
+        ssd1305Violation("unsupported command");
+        expected_args = 0;
+    }
+    if (expected_args == 0)
+    {
+        ssd1305ExecuteCommand();
+    }
+    return 0xFF;
+}
+
+/*! \fn     ssd1305GetFrame(uint8_t* frame)
+*   \brief  Get the frame currently displayed
+*   \param  frame   SSD1305_FRAME_SIZE bytes buffer, filled with 0 (off) or 1 (on)
+*/
+void ssd1305GetFrame(uint8_t* frame)
+{
+    for (uint16_t y = 0; y < SSD1305_FRAME_HEIGHT; y++)
+    {
+        uint8_t frame_row = (start_line + display_offset + y) % SSD1305_NB_ROWS;
+        
+        for (uint16_t x = 0; x < SSD1305_FRAME_WIDTH; x++)
+        {
+            uint8_t level = (gddram[frame_row / 8][SSD1305_X_OFFSET + x] >> (frame_row % 8)) & 0x01;
+            
+            if (display_on == FALSE)
+            {
+                level = 0;
+            }
+            else if (display_mode == SSD1305_CMD_ENTIRE_DISPLAY_ON)
+            {
+                level = 1;
+            }
+            else if (display_inverted != FALSE)
+            {
+                level ^= 0x01;
+            }
+            *frame++ = level;
+        }
+    }
+}
+
+/*! \fn     ssd1305WriteFramePng(const char* path)
+*   \brief  Save the frame currently displayed
+*   \param  path    PNG file path
+*   \return 0 on success
+*/
+int ssd1305WriteFramePng(const char* path)
+{
+    uint8_t frame[SSD1305_FRAME_SIZE];
+    
+    ssd1305GetFrame(frame);
+    for (uint16_t i = 0; i < SSD1305_FRAME_SIZE; i++)
+    {
+        frame[i] *= 0xFF;
+    }
+    return hostPngWriteGray(path, frame, SSD1305_FRAME_WIDTH, SSD1305_FRAME_HEIGHT);
+}
+
+/*! \fn     ssd1305GetStats(void)
+*   \brief  Get the bus traffic counters
+*   \return The counters
+*/
+const ssd1305Stats_t* ssd1305GetStats(void)
+{
+    return &stats;
+}
+
+/*! \fn     ssd1305ResetStats(void)
+*   \brief  Reset the bus traffic counters, the violations are kept
+*/
+void ssd1305ResetStats(void)
+{
+    uint32_t violations = stats.violations;
+    
+    memset(&stats, 0, sizeof(stats));
+    stats.violations = violations;
+}
@@ -0,0 +1,380 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     ssd1322_model.c
+*    \brief    SSD1322 OLED controller model for the host builds, connected to the host SPI functions
+*    Created:  19/10/2026
+*/
+/*
+ * Once opened, the model gets the USART SPI bytes sent while the OLED chip
+ * select is low (and the flash one high), the data / command pin telling
+ * commands from their arguments and GDDRAM data. The 120 columns (4 pixels,
+ * 2 bytes each) by 128 rows GDDRAM is updated through the column / row
+ * address window like on the chip, and the visible frame is rebuilt from the
+ * display start line and display mode.
+ * Frames are in the firmware's coordinates: column 28 is x 0 and the first
+ * nibble sent is the leftmost pixel, the remap register only matters to the
+ * way the panel is mounted and isn't applied. Each byte takes 1us of
+ * simulated time (8MHz bus), commands and data are counted separately so
+ * that render changes can be compared by their bus traffic.
+ */
+#include <string.h>
+#include <stdio.h>
+#include "ssd1322_model.h"
+#include "host_time.h"
+#include "host_png.h"
+#include "defines.h"
+#include "oledmp.h"
+
+/* Simulated duration of a byte transfer in ns */
+#define SSD1322_SPI_BYTE_TIME       1000ULL
+/* GDDRAM geometry, 4 pixels per column */
+#define SSD1322_NB_COLUMNS          120
+#define SSD1322_NB_ROWS             128
+#define SSD1322_BYTES_PER_COLUMN    2
+/* Columns wired to the panel */
+#define SSD1322_FIRST_COLUMN        28
+#define SSD1322_MAX_ARGS            16
+#define SSD1322_MAX_VIOLATION_PRINTS 10
+
+/* Device state */
+static uint8_t model_open = FALSE;
+static uint8_t gddram[SSD1322_NB_ROWS][SSD1322_NB_COLUMNS][SSD1322_BYTES_PER_COLUMN];
+static uint8_t column_start, column_end, row_start, row_end;
+static uint8_t column, row, column_byte;
+static uint8_t remap, start_line, display_offset;
+static uint8_t display_mode = CMD_SET_DISPLAY_MODE_NORMAL;
+static uint8_t display_on = FALSE;
+/* Command being received */
+static uint8_t command;
+static uint8_t args[SSD1322_MAX_ARGS];
+static uint8_t nb_args, expected_args;
+static ssd1322Stats_t stats;
+
+
+/*! \fn     ssd1322Violation(const char* reason)
+*   \brief  Count and report a transfer the real controller wouldn't make sense of
+*   \param  reason  Description of the violation
+*/
+static void ssd1322Violation(const char* reason)
+{
+    if (stats.violations++ < SSD1322_MAX_VIOLATION_PRINTS)
+    {
+        fprintf(stderr, "ssd1322: %s (command 0x%02x)\n", reason, command);
+    }
+}
+
+/*! \fn     ssd1322NbArgs(uint8_t cmd)
+*   \brief  Number of argument bytes of a command
+*   \param  cmd     The command
+*   \return Number of bytes, 0xFF for unsupported commands
+*/
+static uint8_t ssd1322NbArgs(uint8_t cmd)
+{
+    switch (cmd)
+    {
+        case CMD_SET_GRAY_SCALE_TABLE:          return 15;
+        case CMD_SET_COLUMN_ADDR:
+        case CMD_SET_ROW_ADDR:
+        case CMD_SET_REMAP:
+        case CMD_ENABLE_PARTIAL_DISPLAY:
+        case CMD_DISPLAY_ENHANCEMENT:
+        case CMD_DISPLAY_ENHANCEMENT_B:         return 2;
+        case CMD_SET_DISPLAY_START_LINE:
+        case CMD_SET_DISPLAY_OFFSET:
+        case CMD_SET_FUNCTION_SELECTION:
+        case CMD_SET_PHASE_LENGTH:
+        case CMD_SET_CLOCK_DIVIDER:
+        case CMD_SET_GPIO:
+        case CMD_SET_SECOND_PRECHARGE_PERIOD:
+        case CMD_SET_PRECHARGE_VOLTAGE:
+        case CMD_SET_VCOMH_VOLTAGE:
+        case CMD_SET_CONTRAST_CURRENT:
+        case CMD_MASTER_CURRENT_CONTROL:
+        case CMD_SET_MULTIPLEX_RATIO:
+        case CMD_SET_COMMAND_LOCK:              return 1;
+        case CMD_ENABLE_GRAY_SCALE_TABLE:
+        case CMD_WRITE_RAM:
+        case CMD_SET_DISPLAY_MODE_OFF:
+        case CMD_SET_DISPLAY_MODE_ON:
+        case CMD_SET_DISPLAY_MODE_NORMAL:
+        case CMD_SET_DISPLAY_MODE_INVERSE:
+        case CMD_EXIT_PARTIAL_DISPLAY:
+        case CMD_SET_DISPLAY_OFF:
+        case CMD_SET_DISPLAY_ON:
+        case CMD_SET_DEFAULT_LINEAR_GRAY_SCALE_TABLE: return 0;
+        default:                                return 0xFF;
+    }
+}
+
+/*! \fn     ssd1322ClampAddress(uint8_t address, uint8_t nb_addresses)
+*   \brief  Check a column or row address
+*   \param  address         The address
+*   \param  nb_addresses    Number of valid addresses
+*   \return The address, the last valid one if out of range
+*/
+static uint8_t ssd1322ClampAddress(uint8_t address, uint8_t nb_addresses)
+{
+    if (address >= nb_addresses)
+    {
+        ssd1322Violation("address out of range");
+        return nb_addresses - 1;
+    }
+    return address;
+}
+
+/*! \fn     ssd1322ExecuteCommand(void)
+*   \brief  Apply a command once all its arguments are received
+*/
+static void ssd1322ExecuteCommand(void)
+{
+    switch (command)
+    {
+        case CMD_SET_COLUMN_ADDR:
+        {
+            column_start = ssd1322ClampAddress(args[0], SSD1322_NB_COLUMNS);
+            column_end = ssd1322ClampAddress(args[1], SSD1322_NB_COLUMNS);
+            column = column_start;
+            column_byte = 0;
+            stats.windows++;
+            break;
+        }
+        case CMD_SET_ROW_ADDR:
+        {
+            row_start = ssd1322ClampAddress(args[0], SSD1322_NB_ROWS);
+            row_end = ssd1322ClampAddress(args[1], SSD1322_NB_ROWS);
+            row = row_start;
+            column_byte = 0;
+            stats.windows++;
+            break;
+        }
+        case CMD_SET_REMAP:                     remap = args[0]; break;
+        case CMD_SET_DISPLAY_START_LINE:
+        {
+            start_line = args[0] & (SSD1322_NB_ROWS - 1);
+            stats.start_line_changes++;
+            break;
+        }
+        case CMD_SET_DISPLAY_OFFSET:            display_offset = args[0] & (SSD1322_NB_ROWS - 1); break;
+        case CMD_SET_DISPLAY_MODE_OFF:
+        case CMD_SET_DISPLAY_MODE_ON:
+        case CMD_SET_DISPLAY_MODE_NORMAL:
+        case CMD_SET_DISPLAY_MODE_INVERSE:      display_mode = command; break;
+        case CMD_SET_DISPLAY_OFF:               display_on = FALSE; break;
+        case CMD_SET_DISPLAY_ON:                display_on = TRUE; break;
+        default: break;
+    }
+}
+
+/*! \fn     ssd1322WriteRam(uint8_t data)
+*   \brief  Write a GDDRAM byte and move to the next one within the window
+*   \param  data    The byte
+*/
+static void ssd1322WriteRam(uint8_t data)
+{
+    gddram[row][column][column_byte] = data;
+    stats.ram_bytes++;
+    
+    if (++column_byte < SSD1322_BYTES_PER_COLUMN)
+    {
+        return;
+    }
+    column_byte = 0;
+    if (remap & OLED_REMAP_ADDR_INC_ROW)
+    {
+        if (row++ == row_end)
+        {
+            row = row_start;
+            column = (column == column_end)? column_start : column + 1;
+        }
+    }
+    else
+    {
+        if (column++ == column_end)
+        {
+            column = column_start;
+            row = (row == row_end)? row_start : row + 1;
+        }
+    }
+    // Windows wrapping around the end of the GDDRAM
+    column %= SSD1322_NB_COLUMNS;
+    row %= SSD1322_NB_ROWS;
+}
+
+/*! \fn     ssd1322Open(void)
+*   \brief  Reset the controller, connect it to the host SPI bus
+*/
+void ssd1322Open(void)
+{
+    memset(gddram, 0, sizeof(gddram));
+    column_start = 0;
+    column_end = SSD1322_NB_COLUMNS - 1;
+    row_start = 0;
+    row_end = SSD1322_NB_ROWS - 1;
+    column = row = column_byte = 0;
+    remap = start_line = display_offset = 0;
+    display_mode = CMD_SET_DISPLAY_MODE_NORMAL;
+    display_on = FALSE;
+    command = CMD_SET_DISPLAY_OFF;
+    nb_args = expected_args = 0;
+    memset(&stats, 0, sizeof(stats));
+    model_open = TRUE;
+}
+
+/*! \fn     ssd1322Close(void)
+*   \brief  Disconnect the controller from the host SPI bus
+*/
+void ssd1322Close(void)
+{
+    model_open = FALSE;
+}
+
+/*! \fn     ssd1322Selected(void)
+*   \brief  Check if the next SPI byte is for the controller
+*   \return TRUE or FALSE
+*/
+uint8_t ssd1322Selected(void)
+{
+    if ((model_open == FALSE) || (host_PORTD & (1 << PORTID_OLED_SS)) || ((host_PORTB & (1 << PORTID_FLASH_nS)) == 0))
+    {
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/*! \fn     ssd1322Transfer(uint8_t data)
+*   \brief  Receive a byte, the controller doesn't answer on the SPI bus
+*   \param  data    Byte sent by the MCU
+*   \return 0xFF
+*/
+uint8_t ssd1322Transfer(uint8_t data)
+{
+    hostTimeAdvance(SSD1322_SPI_BYTE_TIME);
+    
+    if ((host_PORTD & (1 << PORTID_OLED_DnC)) == 0)
+    {
+        // New command, a previous one missing arguments is dropped
+        stats.command_bytes++;
+        if (nb_args != expected_args)
+        {
+            ssd1322Violation("missing arguments");
+        }
+        command = data;
+        nb_args = 0;
+        expected_args = ssd1322NbArgs(data);
+        if (expected_args == 0xFF)
+        {
+            ssd1322Violation("unsupported command");
+            expected_args = 0;
+        }
+        if (expected_args == 0)
+        {
+            ssd1322ExecuteCommand();
+        }
+        return 0xFF;
+    }
+    
+    stats.data_bytes++;
+    if (nb_args < expected_args)
+    {
+        args[nb_args++] = data;
+        if (nb_args == expected_args)
+        {
+            ssd1322ExecuteCommand();
+        }
+    }
+    else if (command == CMD_WRITE_RAM)
+    {
+        ssd1322WriteRam(data);
+    }
+    else
+    {
+        ssd1322Violation("data without a command");
+    }
+    return 0xFF;
+}
+
+/*! \fn     ssd1322GetFrame(uint8_t* frame)
+*   \brief  Get the frame currently displayed
+*   \param  frame   SSD1322_FRAME_SIZE bytes buffer, filled with gray levels from 0 to 15
+*/
+void ssd1322GetFrame(uint8_t* frame)
+{
+    for (uint16_t y = 0; y < SSD1322_FRAME_HEIGHT; y++)
+    {
+        uint8_t frame_row = (start_line + display_offset + y) % SSD1322_NB_ROWS;
+        
+        for (uint16_t x = 0; x < SSD1322_FRAME_WIDTH; x++)
+        {
+            uint8_t ram_byte = gddram[frame_row][SSD1322_FIRST_COLUMN + x / 4][(x / 2) % 2];
+            uint8_t level = (x % 2 == 0)? (ram_byte >> 4) : (ram_byte & 0x0F);
+            
+            if ((display_on == FALSE) || (display_mode == CMD_SET_DISPLAY_MODE_OFF))
+            {
+                level = 0;
+            }
+            else if (display_mode == CMD_SET_DISPLAY_MODE_ON)
+            {
+                level = 0x0F;
+            }
+            else if (display_mode == CMD_SET_DISPLAY_MODE_INVERSE)
+            {
+                level ^= 0x0F;
+            }
+            *frame++ = level;
+        }
+    }
+}
+
+/*! \fn     ssd1322WriteFramePng(const char* path)
+*   \brief  Save the frame currently displayed
+*   \param  path    PNG file path
+*   \return 0 on success
+*/
+int ssd1322WriteFramePng(const char* path)
+{
+    uint8_t frame[SSD1322_FRAME_SIZE];
+    
+    ssd1322GetFrame(frame);
+    for (uint16_t i = 0; i < SSD1322_FRAME_SIZE; i++)
+    {
+        frame[i] *= 0x11;
+    }
+    return hostPngWriteGray(path, frame, SSD1322_FRAME_WIDTH, SSD1322_FRAME_HEIGHT);
+}
+
+/*! \fn     ssd1322GetStats(void)
+*   \brief  Get the bus traffic counters
+*   \return The counters
+*/
+const ssd1322Stats_t* ssd1322GetStats(void)
+{
+    return &stats;
+}
+
+/*! \fn     ssd1322ResetStats(void)
+*   \brief  Reset the bus traffic counters, the violations are kept
+*/
+void ssd1322ResetStats(void)
+{
+    uint32_t violations = stats.violations;
+    
+    memset(&stats, 0, sizeof(stats));
+    stats.violations = violations;
+}
@@ -0,0 +1,54 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     ssd1322_model.h
+*    \brief    SSD1322 OLED controller model for the host builds, connected to the host SPI functions
+*    Created:  19/10/2026
+*/
+#ifndef SSD1322_MODEL_H_
+#define SSD1322_MODEL_H_
+
+#include <stdint.h>
+
+/* Visible frame, one gray level (0 to 15) per pixel */
+#define SSD1322_FRAME_WIDTH     256
+#define SSD1322_FRAME_HEIGHT    64
+#define SSD1322_FRAME_SIZE      (SSD1322_FRAME_WIDTH * SSD1322_FRAME_HEIGHT)
+
+/* Bus traffic counters */
+typedef struct
+{
+    uint64_t command_bytes;
+    uint64_t data_bytes;            // Command arguments and GDDRAM data
+    uint64_t ram_bytes;             // GDDRAM data
+    uint32_t windows;               // Column or row address commands
+    uint32_t start_line_changes;
+    uint32_t violations;
+} ssd1322Stats_t;
+
+void ssd1322Open(void);
+void ssd1322Close(void);
+uint8_t ssd1322Selected(void);
+uint8_t ssd1322Transfer(uint8_t data);
+void ssd1322GetFrame(uint8_t* frame);
+int ssd1322WriteFramePng(const char* path);
+const ssd1322Stats_t* ssd1322GetStats(void);
+void ssd1322ResetStats(void);
+
+#endif /* SSD1322_MODEL_H_ */
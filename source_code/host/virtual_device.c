@@ -0,0 +1,499 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     virtual_device.c
+*    \brief    Virtual Mooltipass: the firmware logic exposed as a raw HID device (uhid) or over a unix socket
+*    Created:  19/10/2026
+*/
+/*
+ * The command parser, node management and crypto are the firmware ones, the
+ * flash is the AT45DB model, the user and smart card are simulated by
+ * host_firmware.c: the user approves everything and types the configured PIN.
+ * A blank card gets a new user when it is first inserted, like on the device.
+ * Flash, eeprom and card contents can be kept in image files between runs.
+ *
+ * uhid mode: /dev/uhid creates a hidraw device with the firmware raw HID
+ * descriptor and the Mooltipass VID/PID, clients see a plugged device.
+ * Socket mode: SOCK_SEQPACKET unix socket, one RAWHID_TX_SIZE/RAWHID_RX_SIZE
+ * packet per message, for environments without uhid access.
+ * With --record, the exchanged packets are saved as a session replayed by
+ * hid_replay.c.
+ */
+#include <linux/uhid.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <signal.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdio.h>
+#include <poll.h>
+#include <time.h>
+// Firmware structures are packed, see the Makefile
+#pragma pack(push, 1)
+#include "usb_cmd_parser.h"
+#include "at45db_model.h"
+#include "host_firmware.h"
+#include "hid_session.h"
+#include "host_eeprom.h"
+#include "host_test.h"
+#include "flash_mem.h"
+#include "defines.h"
+#include "usb.h"
+#pragma pack(pop)
+
+// Same as rawhid_hid_report_desc in usb_descriptors.c
+static const uint8_t rawhid_hid_report_desc[] =
+{
+    0x06, LSB(RAWHID_USAGE_PAGE), MSB(RAWHID_USAGE_PAGE),
+    0x0A, LSB(RAWHID_USAGE), MSB(RAWHID_USAGE),
+    0xA1, 0x01,                         // Collection 0x01
+    0x75, 0x08,                         // report size = 8 bits
+    0x15, 0x00,                         // logical minimum = 0
+    0x26, 0xFF, 0x00,                   // logical maximum = 255
+    0x95, RAWHID_TX_SIZE,               // report count
+    0x09, 0x01,                         // usage
+    0x81, 0x02,                         // Input (array)
+    0x95, RAWHID_RX_SIZE,               // report count
+    0x09, 0x02,                         // usage
+    0x91, 0x02,                         // Output (array)
+    0xC0                                // end collection
+};
+
+// Transport file descriptors: uhid or listening socket, connected socket client
+static int device_fd = -1;
+static int client_fd = -1;
+static uint8_t socket_mode = FALSE;
+static uint8_t verbose = FALSE;
+// Session recording, times relative to the start
+static hidSession_t session;
+static uint8_t recording = FALSE;
+static struct timespec start_time;
+static volatile sig_atomic_t exit_requested = FALSE;
+
+
+/*! \fn     printPacket(const char* direction, const uint8_t* packet, uint8_t length)
+*   \brief  Print a packet in verbose mode
+*   \param  direction   Direction string
+*   \param  packet      The packet
+*   \param  length      Packet length
+*/
+static void printPacket(const char* direction, const uint8_t* packet, uint8_t length)
+{
+    uint8_t i;
+    
+    if (verbose == FALSE)
+    {
+        return;
+    }
+    printf("%s", direction);
+    for (i = 0; (i < length) && (i < HID_DATA_START + packet[HID_LEN_FIELD]); i++)
+    {
+        printf(" %02x", packet[i]);
+    }
+    printf("\n");
+}
+
+/*! \fn     recordPacket(uint8_t direction, const uint8_t* packet, uint8_t length)
+*   \brief  Append a packet to the recorded session
+*   \param  direction   HID_SESSION_TO_DEVICE or HID_SESSION_FROM_DEVICE
+*   \param  packet      The packet
+*   \param  length      Packet length
+*/
+static void recordPacket(uint8_t direction, const uint8_t* packet, uint8_t length)
+{
+    struct timespec now;
+    
+    if (recording == FALSE)
+    {
+        return;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (hidSessionWrite(&session, (uint64_t)(now.tv_sec - start_time.tv_sec) * 1000000 + (now.tv_nsec - start_time.tv_nsec) / 1000, direction, packet, length) != 0)
+    {
+        perror("session: write");
+        recording = FALSE;
+    }
+}
+
+/*! \fn     sendToHost(const uint8_t* packet, uint8_t length)
+*   \brief  Firmware USB send callback: forward the packet to the client
+*   \param  packet  The packet
+*   \param  length  Packet length
+*/
+static void sendToHost(const uint8_t* packet, uint8_t length)
+{
+    printPacket("<", packet, length);
+    recordPacket(HID_SESSION_FROM_DEVICE, packet, length);
+    if (socket_mode == TRUE)
+    {
+        uint8_t report[RAWHID_TX_SIZE] = {0};
+        
+        memcpy(report, packet, length);
+        if ((client_fd >= 0) && (send(client_fd, report, sizeof(report), MSG_NOSIGNAL) != sizeof(report)))
+        {
+            close(client_fd);
+            client_fd = -1;
+        }
+    }
+    else
+    {
+        struct uhid_event ev;
+        
+        memset(&ev, 0, sizeof(ev));
+        ev.type = UHID_INPUT2;
+        ev.u.input2.size = RAWHID_TX_SIZE;
+        memcpy(ev.u.input2.data, packet, length);
+        if (write(device_fd, &ev, sizeof(ev)) != sizeof(ev))
+        {
+            perror("uhid: input");
+        }
+    }
+}
+
+/*! \fn     openUhidDevice(void)
+*   \brief  Create the virtual raw HID device
+*   \return 0 on success
+*/
+static int openUhidDevice(void)
+{
+    struct uhid_event ev;
+    
+    device_fd = open("/dev/uhid", O_RDWR | O_CLOEXEC);
+    if (device_fd < 0)
+    {
+        perror("/dev/uhid");
+        return -1;
+    }
+    memset(&ev, 0, sizeof(ev));
+    ev.type = UHID_CREATE2;
+    strcpy((char*)ev.u.create2.name, "Mooltipass (virtual)");
+    memcpy(ev.u.create2.rd_data, rawhid_hid_report_desc, sizeof(rawhid_hid_report_desc));
+    ev.u.create2.rd_size = sizeof(rawhid_hid_report_desc);
+    ev.u.create2.bus = BUS_USB;
+    ev.u.create2.vendor = VENDOR_ID;
+    ev.u.create2.product = PRODUCT_ID;
+    ev.u.create2.version = 0x0100;
+    if (write(device_fd, &ev, sizeof(ev)) != sizeof(ev))
+    {
+        perror("uhid: create");
+        close(device_fd);
+        return -1;
+    }
+    return 0;
+}
+
+/*! \fn     readUhidEvent(void)
+*   \brief  Read an uhid event, queue output reports for the firmware
+*   \return 0 on success
+*/
+static int readUhidEvent(void)
+{
+    struct uhid_event ev;
+    const uint8_t* data;
+    uint16_t size;
+    
+    if (read(device_fd, &ev, sizeof(ev)) <= 0)
+    {
+        perror("uhid: read");
+        return -1;
+    }
+    switch (ev.type)
+    {
+        case UHID_OUTPUT:
+        {
+            // hidraw writes start with the report number, 0 as the descriptor doesn't use any
+            data = ev.u.output.data;
+            size = ev.u.output.size;
+            if ((size == RAWHID_RX_SIZE + 1) && (data[0] == 0))
+            {
+                data++;
+                size--;
+            }
+            if (size > RAWHID_RX_SIZE)
+            {
+                size = RAWHID_RX_SIZE;
+            }
+            printPacket(">", data, size);
+            recordPacket(HID_SESSION_TO_DEVICE, data, size);
+            if (hostUsbQueuePacket(data, size) == FALSE)
+            {
+                fprintf(stderr, "usb: receive queue full, packet dropped\n");
+            }
+            break;
+        }
+        case UHID_GET_REPORT:
+        {
+            // Feature reports aren't supported by the firmware
+            uint32_t id = ev.u.get_report.id;
+            memset(&ev, 0, sizeof(ev));
+            ev.type = UHID_GET_REPORT_REPLY;
+            ev.u.get_report_reply.id = id;
+            ev.u.get_report_reply.err = EIO;
+            if (write(device_fd, &ev, sizeof(ev)) != sizeof(ev))
+            {
+                perror("uhid: get report reply");
+            }
+            break;
+        }
+        case UHID_SET_REPORT:
+        {
+            uint32_t id = ev.u.set_report.id;
+            memset(&ev, 0, sizeof(ev));
+            ev.type = UHID_SET_REPORT_REPLY;
+            ev.u.set_report_reply.id = id;
+            ev.u.set_report_reply.err = EIO;
+            if (write(device_fd, &ev, sizeof(ev)) != sizeof(ev))
+            {
+                perror("uhid: set report reply");
+            }
+            break;
+        }
+        default: break;
+    }
+    return 0;
+}
+
+/*! \fn     openSocket(const char* path)
+*   \brief  Listen on a unix socket
+*   \param  path    Socket path, replaced if it exists
+*   \return 0 on success
+*/
+static int openSocket(const char* path)
+{
+    struct sockaddr_un address;
+    
+    if (strlen(path) >= sizeof(address.sun_path))
+    {
+        fprintf(stderr, "%s: path too long\n", path);
+        return -1;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+    unlink(path);
+    device_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if ((device_fd < 0) || (bind(device_fd, (struct sockaddr*)&address, sizeof(address)) != 0) || (listen(device_fd, 1) != 0))
+    {
+        perror(path);
+        return -1;
+    }
+    return 0;
+}
+
+/*! \fn     readSocket(void)
+*   \brief  Read a packet from the socket client and queue it for the firmware
+*/
+static void readSocket(void)
+{
+    uint8_t packet[RAWHID_RX_SIZE];
+    ssize_t length = recv(client_fd, packet, sizeof(packet), 0);
+    
+    if (length <= 0)
+    {
+        // Client gone, the next one is accepted
+        close(client_fd);
+        client_fd = -1;
+        return;
+    }
+    printPacket(">", packet, length);
+    recordPacket(HID_SESSION_TO_DEVICE, packet, length);
+    if (hostUsbQueuePacket(packet, length) == FALSE)
+    {
+        fprintf(stderr, "usb: receive queue full, packet dropped\n");
+    }
+}
+
+static void exitHandler(int sig)
+{
+    (void)sig;
+    exit_requested = TRUE;
+}
+
+static void usage(const char* name)
+{
+    fprintf(stderr, "usage: %s [options]\n", name);
+    fprintf(stderr, "  --flash FILE    flash image, created blank if needed (default: in memory)\n");
+    fprintf(stderr, "  --eeprom FILE   eeprom image, created blank if needed (default: in memory)\n");
+    fprintf(stderr, "  --card FILE     smart card image, created blank if needed (default: in memory)\n");
+    fprintf(stderr, "  --pin PIN       PIN typed by the simulated user, hexadecimal (default: %04x)\n", HOST_DEFAULT_PIN);
+    fprintf(stderr, "  --no-card       start without the card inserted\n");
+    fprintf(stderr, "  --deny          the simulated user denies every request\n");
+    fprintf(stderr, "  --socket PATH   serve a SOCK_SEQPACKET unix socket instead of creating an uhid device\n");
+    fprintf(stderr, "  --record FILE   record the exchanged packets, to be replayed by hid_replay\n");
+    fprintf(stderr, "  --verbose       print the exchanged packets\n");
+}
+
+int main(int argc, char* argv[])
+{
+    static const struct option options[] =
+    {
+        {"flash", required_argument, 0, 'f'},
+        {"eeprom", required_argument, 0, 'e'},
+        {"card", required_argument, 0, 'c'},
+        {"pin", required_argument, 0, 'p'},
+        {"no-card", no_argument, 0, 'n'},
+        {"deny", no_argument, 0, 'd'},
+        {"socket", required_argument, 0, 's'},
+        {"record", required_argument, 0, 'r'},
+        {"verbose", no_argument, 0, 'v'},
+        {0, 0, 0, 0}
+    };
+    const char* flash_path = NULL;
+    const char* eeprom_path = NULL;
+    const char* card_path = NULL;
+    const char* socket_path = NULL;
+    const char* record_path = NULL;
+    uint8_t insert_card = TRUE;
+    uint8_t approve = TRUE;
+    uint16_t pin = HOST_DEFAULT_PIN;
+    struct sigaction action;
+    struct pollfd fds[2];
+    int option;
+    
+    while ((option = getopt_long(argc, argv, "", options, NULL)) != -1)
+    {
+        switch (option)
+        {
+            case 'f': flash_path = optarg; break;
+            case 'e': eeprom_path = optarg; break;
+            case 'c': card_path = optarg; break;
+            case 'p': pin = (uint16_t)strtoul(optarg, NULL, 16); break;
+            case 'n': insert_card = FALSE; break;
+            case 'd': approve = FALSE; break;
+            case 's': socket_path = optarg; break;
+            case 'r': record_path = optarg; break;
+            case 'v': verbose = TRUE; break;
+            default: usage(argv[0]); return 2;
+        }
+    }
+    if (optind != argc)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+    
+    // Device contents
+    hostFirmwareInit();
+    if ((at45dbOpen(flash_path) != 0) || (hostEepromOpen(eeprom_path) != 0) || (hostCardOpen(card_path) != 0))
+    {
+        return 1;
+    }
+    if (hostFirmwareBoot() != RETURN_OK)
+    {
+        fprintf(stderr, "flash not detected\n");
+        return 1;
+    }
+    hostSetUserApproval(approve);
+    hostSetUserPin(pin);
+    
+    // Transport
+    socket_mode = (socket_path != NULL)? TRUE : FALSE;
+    if (((socket_mode == TRUE) && (openSocket(socket_path) != 0)) || ((socket_mode == FALSE) && (openUhidDevice() != 0)))
+    {
+        return 1;
+    }
+    hostUsbSetSendCallback(sendToHost);
+    if (record_path != NULL)
+    {
+        if (hidSessionCreate(&session, record_path) != 0)
+        {
+            return 1;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &start_time);
+        recording = TRUE;
+    }
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = exitHandler;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    printf("Virtual Mooltipass ready (%s%s), %u pages of %u bytes\n", (socket_mode == TRUE)? "socket " : "uhid", (socket_mode == TRUE)? socket_path : "", PAGE_COUNT, BYTES_PER_PAGE);
+    fflush(stdout);
+    
+    if (insert_card == TRUE)
+    {
+        hostCardInsert();
+    }
+    while (exit_requested == FALSE)
+    {
+        hostFirmwareRunMainLoop();
+        
+        // Wait for the next packet
+        fds[0].fd = device_fd;
+        fds[0].events = POLLIN;
+        fds[1].fd = client_fd;
+        fds[1].events = POLLIN;
+        fds[1].revents = 0;
+        if (poll(fds, (client_fd >= 0)? 2 : 1, -1) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            perror("poll");
+            break;
+        }
+        if ((socket_mode == FALSE) && (fds[0].revents & POLLIN) && (readUhidEvent() != 0))
+        {
+            break;
+        }
+        if ((socket_mode == TRUE) && (fds[0].revents & POLLIN))
+        {
+            // One client at a time
+            int fd = accept(device_fd, NULL, NULL);
+            if (client_fd >= 0)
+            {
+                close(fd);
+            }
+            else
+            {
+                client_fd = fd;
+            }
+        }
+        if ((socket_mode == TRUE) && (client_fd >= 0) && (fds[1].revents & (POLLIN | POLLHUP)))
+        {
+            readSocket();
+        }
+    }
+    
+    // Cleanup, the images are up to date as they're shared mappings
+    if (socket_mode == TRUE)
+    {
+        unlink(socket_path);
+    }
+    else
+    {
+        struct uhid_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.type = UHID_DESTROY;
+        if (write(device_fd, &ev, sizeof(ev)) != sizeof(ev))
+        {
+            perror("uhid: destroy");
+        }
+    }
+    close(device_fd);
+    hidSessionClose(&session);
+    at45dbClose();
+    hostEepromClose();
+    hostCardClose();
+    return 0;
+}
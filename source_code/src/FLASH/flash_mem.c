@@ -26,15 +26,204 @@
 *    Author:   Michael Neiderhauser
 */
 #include "flash_mem.h"
+#include "interrupts.h"
 #include "defines.h"
 #include "usb.h"
 #include <avr/io.h>
+#include <string.h>
 #include <stdint.h>
 #include <spi.h>
 #if SPI_FLASH != SPI_USART
     #error "SPI not implemented"
 #endif
 
+#ifndef BOOTLOADER
+// Buffer number of a page program started without waiting for its completion, 0 if none
+static uint8_t flash_program_pending = 0;
+#else
+// The bootloader doesn't start page programs without waiting, the checks get compiled out
+#define flash_program_pending   0
+#endif
+
+#ifdef ENABLE_FLASH_STATS
+// Activity counters and trace ring buffer, read with CMD_GET_FLASH_STATS
+static flashStats_t flash_stats;
+static flashTraceEntry_t flash_trace[FLASH_TRACE_NB_ENTRIES];
+static uint8_t flash_trace_head = 0;
+static uint8_t flash_trace_count = 0;
+static uint16_t flash_trace_dropped = 0;
+// USB command the flash accesses are attributed to
+static uint8_t flash_stats_cmd = 0;
+// Start page and length of the ongoing stream read
+static uint16_t flash_stream_page;
+static uint16_t flash_stream_length;
+
+/*! \fn     flashTraceAdd(uint8_t opcode, uint16_t page, uint16_t value)
+*   \brief  Add an entry to the trace, dropping the oldest one if it is full
+*   \param  opcode  Flash opcode
+*   \param  page    Page number
+*   \param  value   Data length or wait time
+*/
+static void flashTraceAdd(uint8_t opcode, uint16_t page, uint16_t value)
+{
+    flashTraceEntry_t* entry = &flash_trace[flash_trace_head];
+    
+    if (flash_trace_count == FLASH_TRACE_NB_ENTRIES)
+    {
+        flash_trace_dropped++;
+    }
+    else
+    {
+        flash_trace_count++;
+    }
+    entry->cmd = flash_stats_cmd;
+    entry->opcode = opcode;
+    entry->page = page;
+    entry->value = value;
+    flash_trace_head = (flash_trace_head + 1) % FLASH_TRACE_NB_ENTRIES;
+}
+
+/*! \fn     flashStatsRecordOpcode(uint8_t* opcode, uint16_t size)
+*   \brief  Account for a four bytes opcode transaction
+*   \param  opcode  Pointer to the opcode, before it is sent
+*   \param  size    Number of data bytes
+*/
+static void flashStatsRecordOpcode(uint8_t* opcode, uint16_t size)
+{
+    uint16_t page = 0;
+    
+    // Page addressed by the opcode, first page of the block / sector for the erases
+    if (opcode[0] != FLASH_OPCODE_CHIP_ERASE)
+    {
+        page = (((uint16_t)opcode[1] << 8) | opcode[2]) >> (READ_OFFSET_SHT_AMT-8);
+    }
+    switch (opcode[0])
+    {
+        case FLASH_OPCODE_MAINP_TO_BUF: flash_stats.page_loads++; break;
+        case FLASH_OPCODE_MMP_PROG_TBUF:
+        case FLASH_OPCODE_BUF_TO_PAGE:
+        case FLASH_OPCODE_BUF2_TO_PAGE: flash_stats.page_programs++; break;
+        case FLASH_OPCODE_PAGE_ERASE:
+        case FLASH_OPCODE_BLOCK_ERASE:
+        case FLASH_OPCODE_SECTOR_ERASE:
+        case FLASH_OPCODE_CHIP_ERASE: flash_stats.erases++; break;
+        default: break;
+    }
+    flash_stats.cs_toggles++;
+    flash_stats.spi_bytes += 4 + size;
+    flashTraceAdd(opcode[0], page, size);
+}
+
+/*! \fn     flashStatsRecordWait(uint32_t nb_polls, uint32_t start_time)
+*   \brief  Account for a wait for the flash to be ready
+*   \param  nb_polls    Number of status register reads
+*   \param  start_time  micros() value when the wait started
+*/
+static void flashStatsRecordWait(uint32_t nb_polls, uint32_t start_time)
+{
+    uint32_t wait_time = micros() - start_time;
+    
+    flash_stats.cs_toggles++;
+    flash_stats.busy_waits++;
+    flash_stats.spi_bytes += 2 * nb_polls;
+    flash_stats.busy_time += wait_time;
+    wait_time >>= FLASH_TRACE_TIME_SHIFT;
+    flashTraceAdd(FLASH_OPCODE_READ_STAT_REG, 0, (wait_time > UINT16_MAX)? UINT16_MAX : (uint16_t)wait_time);
+}
+
+/*! \fn     flashStatsStreamStart(uint16_t page)
+*   \brief  Account for the start of a stream read, its trace entry is added when it stops
+*   \param  page    Start page
+*/
+static void flashStatsStreamStart(uint16_t page)
+{
+    flash_stats.cs_toggles++;
+    flash_stats.spi_bytes += 4;
+    flash_stream_page = page;
+    flash_stream_length = 0;
+}
+
+/*! \fn     flashStatsStreamRead(uint16_t size)
+*   \brief  Account for bytes read during a stream read
+*   \param  size    Number of bytes
+*/
+static void flashStatsStreamRead(uint16_t size)
+{
+    flash_stats.spi_bytes += size;
+    flash_stream_length += size;
+}
+
+/*! \fn     flashStatsSetCmd(uint8_t cmd)
+*   \brief  Set the USB command the next flash accesses are attributed to
+*   \param  cmd     Command ID, 0 for none
+*/
+void flashStatsSetCmd(uint8_t cmd)
+{
+    flash_stats_cmd = cmd;
+}
+
+/*! \fn     flashStatsGetCmd(void)
+*   \brief  Get the USB command the flash accesses are attributed to
+*   \return Command ID, 0 for none
+*/
+uint8_t flashStatsGetCmd(void)
+{
+    return flash_stats_cmd;
+}
+
+/*! \fn     flashStatsGet(void)
+*   \brief  Get the flash activity counters
+*   \return Pointer to the counters
+*/
+flashStats_t* flashStatsGet(void)
+{
+    return &flash_stats;
+}
+
+/*! \fn     flashTraceRead(flashTraceEntry_t* buffer, uint8_t max_entries)
+*   \brief  Read and remove the oldest trace entries
+*   \param  buffer      Buffer to store the entries
+*   \param  max_entries Max number of entries to read
+*   \return Number of entries read
+*/
+uint8_t flashTraceRead(flashTraceEntry_t* buffer, uint8_t max_entries)
+{
+    uint8_t nb_entries = (flash_trace_count < max_entries)? flash_trace_count : max_entries;
+    uint8_t index = (flash_trace_head + FLASH_TRACE_NB_ENTRIES - flash_trace_count) % FLASH_TRACE_NB_ENTRIES;
+    
+    for (uint8_t i = 0; i < nb_entries; i++)
+    {
+        buffer[i] = flash_trace[index];
+        index = (index + 1) % FLASH_TRACE_NB_ENTRIES;
+    }
+    flash_trace_count -= nb_entries;
+    return nb_entries;
+}
+
+/*! \fn     flashTraceGetDropped(void)
+*   \brief  Get the number of trace entries dropped since the last reset
+*   \return Number of entries
+*/
+uint16_t flashTraceGetDropped(void)
+{
+    return flash_trace_dropped;
+}
+
+/*! \fn     flashStatsReset(void)
+*   \brief  Clear the counters and the trace
+*/
+void flashStatsReset(void)
+{
+    memset((void*)&flash_stats, 0, sizeof(flash_stats));
+    flash_trace_count = 0;
+    flash_trace_dropped = 0;
+}
+#else
+    #define flashStatsRecordOpcode(opcode, size)
+    #define flashStatsStreamStart(page)
+    #define flashStatsStreamRead(size)
+#endif
+
 
 /*! \fn     memoryBoundaryErrorCallback(void)
 *   \brief  Function called when a memory boundary issue occurs
@@ -72,6 +261,14 @@ static inline void fillPageReadWriteEraseOpcodeFromAddress(uint16_t pageNumber,
 */
 void sendDataToFlashWithFourBytesOpcode(uint8_t* opcode, uint8_t* buffer, uint16_t buffer_size)
 {
+    // Only the other buffer can be written while a page is being programmed
+    if ((flash_program_pending != 0) && !((opcode[0] == FLASH_OPCODE_BUF_WRITE) && (flash_program_pending == 2)) && !((opcode[0] == FLASH_OPCODE_BUF2_WRITE) && (flash_program_pending == 1)))
+    {
+        waitForFlash();
+    }
+    
+    flashStatsRecordOpcode(opcode, buffer_size);
+    
     /* Assert chip select */
     PORT_FLASH_nS &= ~(1 << PORTID_FLASH_nS);
 
@@ -99,12 +296,20 @@ void sendDataToFlashWithFourBytesOpcode(uint8_t* opcode, uint8_t* buffer, uint16
  */
 void waitForFlash(void)
 {
+    #ifdef ENABLE_FLASH_STATS
+        uint32_t wait_start_time = micros();
+        uint32_t nb_polls = 0;
+    #endif
+    
     /* Assert chip select */
     PORT_FLASH_nS &= ~(1 << PORTID_FLASH_nS);
     
     uint8_t tempBool = TRUE;
     while(tempBool == TRUE)
     {
+        #ifdef ENABLE_FLASH_STATS
+            nb_polls++;
+        #endif
         spiUsartTransfer(FLASH_OPCODE_READ_STAT_REG);
         if(spiUsartTransfer(0)&FLASH_READY_BITMASK)
         {
@@ -114,6 +319,13 @@ void waitForFlash(void)
     
     /* Deassert chip select */
     PORT_FLASH_nS |= (1 << PORTID_FLASH_nS);
+    #ifndef BOOTLOADER
+        flash_program_pending = 0;
+    #endif
+    
+    #ifdef ENABLE_FLASH_STATS
+        flashStatsRecordWait(nb_polls, wait_start_time);
+    #endif
 } // End waitForFlash
 
 /**
@@ -213,7 +425,7 @@ void sectorErase(uint8_t sectorNumber)
  */
 void chipErase(void)
 {
-    uint8_t opcode[4] = {0xC7, 0x94, 0x80, 0x9A};
+    uint8_t opcode[4] = {FLASH_OPCODE_CHIP_ERASE, 0x94, 0x80, 0x9A};
     sendDataToFlashWithFourBytesOpcode(opcode, opcode, 0);
     
     /* Wait until memory is ready */
@@ -383,21 +595,106 @@ void readDataFromFlash(uint16_t pageNumber, uint16_t offset, uint16_t dataSize,
 } // End readDataFromFlash
 
 /**
- * Contiguous data read across flash page boundaries with a max 65k bytes addressing space
- * @param   datap           pointer to the buffer to store the read data
+ * Start a contiguous read across flash page boundaries with a max 65k bytes addressing space
  * @param   addr            byte offset in the flash
- * @param   size            the number of bytes to read
+ * @note chip select stays asserted: fetch data with flashStreamRead() then call flashStreamReadStop()
  * @note bypasses the memory buffer
  */
-void flashRawRead(uint8_t* datap, uint16_t addr, uint16_t size)
-{    
+void flashStreamReadStart(uint16_t addr)
+{
     uint16_t page_number = (addr/BYTES_PER_PAGE);
     uint8_t high_byte = page_number >> (16 - READ_OFFSET_SHT_AMT);
     addr = (page_number << READ_OFFSET_SHT_AMT) | (addr % BYTES_PER_PAGE);
-    uint8_t op[] = {FLASH_OPCODE_LOWF_READ, high_byte, (uint8_t)(addr >> 8), (uint8_t)addr};            
+    
+    if (flash_program_pending != 0)
+    {
+        waitForFlash();
+    }
 
-    /* Read from flash */
-    sendDataToFlashWithFourBytesOpcode(op, datap, size);
+    flashStatsStreamStart(page_number);
+    
+    /* Assert chip select */
+    PORT_FLASH_nS &= ~(1 << PORTID_FLASH_nS);
+
+    /* Send opcode */
+    spiUsartTransfer(FLASH_OPCODE_LOWF_READ);
+    spiUsartTransfer(high_byte);
+    spiUsartTransfer((uint8_t)(addr >> 8));
+    spiUsartTransfer((uint8_t)addr);
+}
+
+#ifndef BOOTLOADER
+/**
+ * Start a contiguous read across flash page boundaries, for the whole flash addressing space
+ * @param   page_number     page to start the read from
+ * @param   offset          byte offset in the page
+ * @note chip select stays asserted: fetch data with flashStreamRead() then call flashStreamReadStop()
+ * @note bypasses the memory buffer
+ */
+void flashStreamReadStartAtPage(uint16_t page_number, uint16_t offset)
+{
+    uint8_t opcode[3];
+    
+    fillPageReadWriteEraseOpcodeFromAddress(page_number, offset, opcode);
+    
+    if (flash_program_pending != 0)
+    {
+        waitForFlash();
+    }
+
+    flashStatsStreamStart(page_number);
+    
+    /* Assert chip select */
+    PORT_FLASH_nS &= ~(1 << PORTID_FLASH_nS);
+
+    /* Send opcode */
+    spiUsartTransfer(FLASH_OPCODE_LOWF_READ);
+    spiUsartTransfer(opcode[0]);
+    spiUsartTransfer(opcode[1]);
+    spiUsartTransfer(opcode[2]);
+}
+#endif
+
+/**
+ * Read the next bytes of a read started with flashStreamReadStart()
+ * @param   datap           pointer to the buffer to store the read data
+ * @param   size            the number of bytes to read
+ */
+void flashStreamRead(uint8_t* datap, uint16_t size)
+{
+    flashStatsStreamRead(size);
+    
+    while (size--)
+    {
+        *datap++ = spiUsartTransfer(0);
+    }
+}
+
+/**
+ * End a read started with flashStreamReadStart()
+ */
+void flashStreamReadStop(void)
+{
+    /* Deassert chip select */
+    PORT_FLASH_nS |= (1 << PORTID_FLASH_nS);
+    
+    #ifdef ENABLE_FLASH_STATS
+        flashTraceAdd(FLASH_OPCODE_LOWF_READ, flash_stream_page, flash_stream_length);
+    #endif
+}
+
+/**
+ * Contiguous data read across flash page boundaries with a max 65k bytes addressing space
+ * @param   datap           pointer to the buffer to store the read data
+ * @param   addr            byte offset in the flash
+ * @param   size            the number of bytes to read
+ * @note bypasses the memory buffer
+ */
+void flashRawRead(uint8_t* datap, uint16_t addr, uint16_t size)
+{
+    flashStreamReadStart(addr);
+    flashStreamRead(datap, size);
+    flashStreamReadStop();
 }
 
 /**
@@ -430,4 +727,39 @@ void flashWriteBufferToPage(uint16_t page)
     fillPageReadWriteEraseOpcodeFromAddress(page, 0, &op[1]);
     sendDataToFlashWithFourBytesOpcode(op, op, 0);
     waitForFlash();
-}
\ No newline at end of file
+}
+
+#ifndef BOOTLOADER
+/**
+ * Write data into one of the two internal memory buffers, without waiting for the flash
+ * @param buffer_nb buffer number, 1 or 2
+ * @param datap pointer to data to write
+ * @param offset offset to start writing to in the internal memory buffer
+ * @param size the number of bytes to write
+ * @note a buffer can be written while the other one is being programmed
+ */
+void flashWriteBufferNb(uint8_t buffer_nb, uint8_t* datap, uint16_t offset, uint16_t size)
+{
+    uint8_t op[4];
+    
+    op[0] = (buffer_nb == 2)? FLASH_OPCODE_BUF2_WRITE : FLASH_OPCODE_BUF_WRITE;
+    fillPageReadWriteEraseOpcodeFromAddress(0, offset, &op[1]);
+    sendDataToFlashWithFourBytesOpcode(op, datap, size);
+}
+
+/**
+ * Start writing the contents of one of the internal memory buffers to a page in flash
+ * @param buffer_nb buffer number, 1 or 2
+ * @param page the page to store the buffer in
+ * @note doesn't wait for the page program to complete: the next flash access other than a write to the other buffer does
+ */
+void flashStartBufferToPage(uint8_t buffer_nb, uint16_t page)
+{
+    uint8_t op[4];
+    
+    op[0] = (buffer_nb == 2)? FLASH_OPCODE_BUF2_TO_PAGE : FLASH_OPCODE_BUF_TO_PAGE;
+    fillPageReadWriteEraseOpcodeFromAddress(page, 0, &op[1]);
+    sendDataToFlashWithFourBytesOpcode(op, op, 0);
+    flash_program_pending = buffer_nb;
+}
+#endif
\ No newline at end of file
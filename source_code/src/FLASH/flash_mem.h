@@ -41,14 +41,53 @@ void pageErase(uint16_t pageNumber);
 void chipErase(void);
 void formatFlash(void);
 void initFlashIOs(void);
+void waitForFlash(void);
 RET_TYPE checkFlashID(void);
 void flashWriteBufferToPage(uint16_t page);
 void loadPageToInternalBuffer(uint16_t page_number);
 void flashRawRead(uint8_t* datap, uint16_t addr, uint16_t size);
+void flashStreamReadStart(uint16_t addr);
+void flashStreamRead(uint8_t* datap, uint16_t size);
+void flashStreamReadStop(void);
 void flashWriteBuffer(uint8_t* datap, uint16_t offset, uint16_t size);
+#ifndef BOOTLOADER
+void flashStreamReadStartAtPage(uint16_t page_number, uint16_t offset);
+void flashWriteBufferNb(uint8_t buffer_nb, uint8_t* datap, uint16_t offset, uint16_t size);
+void flashStartBufferToPage(uint8_t buffer_nb, uint16_t page);
+#endif
 void writeDataToFlash(uint16_t pageNumber, uint16_t offset, uint16_t dataSize, void *data);
 void readDataFromFlash(uint16_t pageNumber, uint16_t offset, uint16_t dataSize, void *data);
 
+#ifdef ENABLE_FLASH_STATS
+// Flash activity counters, since the last reset
+typedef struct
+{
+    uint32_t spi_bytes;         // Bytes clocked on the bus, opcodes and status polls included
+    uint32_t busy_time;         // Time spent waiting for the flash to be ready, in us
+    uint32_t cs_toggles;        // Chip select assertions
+    uint32_t page_loads;        // Main memory page to buffer transfers
+    uint32_t page_programs;     // Buffer to main memory page programs
+    uint32_t erases;            // Page, block, sector & chip erases
+    uint32_t busy_waits;        // Calls to waitForFlash()
+} flashStats_t;
+
+// Trace entry, one per chip select assertion
+typedef struct
+{
+    uint8_t cmd;                // USB command being processed, 0 if none
+    uint8_t opcode;             // Flash opcode, FLASH_OPCODE_READ_STAT_REG for a ready wait
+    uint16_t page;              // Page addressed by the opcode
+    uint16_t value;             // Data bytes transferred, wait time in 1 << FLASH_TRACE_TIME_SHIFT us for a ready wait
+} flashTraceEntry_t;
+
+void flashStatsSetCmd(uint8_t cmd);
+uint8_t flashStatsGetCmd(void);
+flashStats_t* flashStatsGet(void);
+uint8_t flashTraceRead(flashTraceEntry_t* buffer, uint8_t max_entries);
+uint16_t flashTraceGetDropped(void);
+void flashStatsReset(void);
+#endif
+
 // Defines
 /** DEFINES FLASH **/
 
@@ -272,8 +311,22 @@ void readDataFromFlash(uint16_t pageNumber, uint16_t offset, uint16_t dataSize,
 #define FLASH_OPCODE_LOWF_READ        0x03  // Opcode to perform a Continuous Array Read (Low Frequency)
 #define FLASH_OPCODE_BUF_WRITE        0x84  // Opcode to write into buffer
 #define FLASH_OPCODE_BUF_TO_PAGE      0x83  // Opcode to write buffer to given page
+#define FLASH_OPCODE_BUF2_WRITE       0x87  // Opcode to write into buffer 2
+#define FLASH_OPCODE_BUF2_TO_PAGE     0x86  // Opcode to write buffer 2 to given page
 #define FLASH_OPCODE_READ_DEV_INFO    0x9F  // Opcode to perform a Manufacturer and Device ID Read
 #define FLASH_READY_BITMASK           0x80  // Bitmask used to determine if the chip is ready (poll status register). Used with FLASH_OPCODE_READ_STAT_REG.
+#define FLASH_OPCODE_CHIP_ERASE       0xC7  // First byte of the chip erase opcode sequence
+
+/** FLASH ACTIVITY STATISTICS **/
+// Trace ring buffer size, oldest entries are dropped when it is full
+#ifndef FLASH_TRACE_NB_ENTRIES
+    #define FLASH_TRACE_NB_ENTRIES    32
+#endif
+#define FLASH_TRACE_TIME_SHIFT        5     // Ready wait times are traced in 32us units
+// CMD_GET_FLASH_STATS arguments
+#define FLASH_STATS_COUNTERS          0x00
+#define FLASH_STATS_TRACE             0x01
+#define FLASH_STATS_RESET             0xFF
 #define FLASH_SECTOR_ZER0_A_PAGES     8
 #define FLASH_SECTOR_ZERO_A_CODE      0
 #define FLASH_SECTOR_ZERO_B_CODE      1
@@ -289,4 +342,11 @@ void readDataFromFlash(uint16_t pageNumber, uint16_t offset, uint16_t dataSize,
 // Flash size defines
 #define FLASH_SIZE          ((uint32_t)PAGE_COUNT * (uint32_t)BYTES_PER_PAGE)
 
+// Number of internal SRAM buffers
+#if defined(FLASH_CHIP_1M)
+    #define FLASH_NB_BUFFERS    1
+#else
+    #define FLASH_NB_BUFFERS    2
+#endif
+
 #endif /* FLASH_MEM_H_ */
\ No newline at end of file
@@ -26,6 +26,7 @@
 #include "smart_card_higher_level_functions.h"
 #include "touch_higher_level_functions.h"
 #include "gui_credentials_functions.h"
+#include "gui_scrolling_functions.h"
 #include "gui_screen_functions.h"
 #include "gui_basic_functions.h"
 #include "logic_aes_and_comms.h"
@@ -795,12 +796,13 @@ uint16_t loginSelectionScreen(void)
 #if defined(MINI_VERSION)
     uint8_t x_coordinates[] = {SCROLL_LINE_TEXT_FIRST_XPOS, SCROLL_LINE_TEXT_SECOND_XPOS, SCROLL_LINE_TEXT_THIRD_XPOS};
     uint8_t y_coordinates[] = {THREE_LINE_TEXT_FIRST_POS, THREE_LINE_TEXT_SECOND_POS, THREE_LINE_TEXT_THIRD_POS};
+    uint8_t top_coordinates[] = {SCROLL_LINE_FIRST_TOP_YPOS, SCROLL_LINE_SECOND_TOP_YPOS, SCROLL_LINE_THIRD_TOP_YPOS, SSD1305_OLED_HEIGHT};
     uint16_t first_address = getLastParentAddress();
     uint16_t cur_address_selected = NODE_ADDR_NULL;
     uint8_t string_refresh_needed = TRUE;
-    uint8_t string_offset_cntrs[3];
-    uint8_t string_extra_chars[3];
+    scrollingLine_t scrolling_lines[3];
     uint16_t temp_parent_address;
+    uint8_t lines_modified;
     uint8_t nb_parent_nodes;
     RET_TYPE wheel_action;
     pNode temp_pnode;
@@ -827,34 +829,15 @@ uint16_t loginSelectionScreen(void)
 
     while(1)
     {
-        // If needed, re-compute the string offsets & extra chars
-        if ((string_refresh_needed != FALSE) || (hasTimerExpired(TIMER_CAPS, TRUE) == TIMER_EXPIRED))
+        // If the selection changed, read the displayed services and draw the screen
+        if (string_refresh_needed != FALSE)
         {
-            if(string_refresh_needed != FALSE)
-            {
-                // Reset counters
-                memset((void*)string_offset_cntrs, 0x00, sizeof(string_offset_cntrs));
-            }
-            else
-            {
-                // Implement scrolling
-                for (i = 0; i < sizeof(string_extra_chars); i++)
-                {
-                    if (string_extra_chars[i] > 0)
-                    {
-                        if (string_offset_cntrs[i]++ == string_extra_chars[i])
-                        {
-                            string_offset_cntrs[i] = 0;
-                        }
-                    }
-                }
-            }
-
-            // Scrolling timer expired
+            // Restart scrolling timer
             activateTimer(TIMER_CAPS, SCROLLING_DEL);
 
             // Start looping, starting from the first displayed child
             temp_parent_address = first_address;
+            memset((void*)scrolling_lines, 0x00, sizeof(scrolling_lines));
 
             // Skip one display slot if the real first parent is selected
             if (nb_parent_nodes < 3)
@@ -874,8 +857,8 @@ uint16_t loginSelectionScreen(void)
                 // Read child node to get login
                 readParentNode(&temp_pnode, temp_parent_address);
                 
-                // Print Login at the correct slot
-                string_extra_chars[i] = strlen((char*)temp_pnode.service) - miniOledPutstrXY(x_coordinates[i], y_coordinates[i], OLED_RIGHT, (char*)temp_pnode.service + string_offset_cntrs[i]);
+                // Print Login at the correct slot, keep it for scrolling
+                guiSetScrollingLine(&scrolling_lines[i], (char*)temp_pnode.service, x_coordinates[i], y_coordinates[i]);
 
                 // Second child displayed is the chosen one
                 if (i == 1)
@@ -900,6 +883,26 @@ uint16_t loginSelectionScreen(void)
             miniOledFlushEntireBufferToDisplay();
             string_refresh_needed = FALSE;
         }
+        else if (hasTimerExpired(TIMER_CAPS, TRUE) == TIMER_EXPIRED)
+        {
+            // Scrolling timer expired
+            activateTimer(TIMER_CAPS, SCROLLING_DEL);
+
+            // Scroll the lines larger than the screen from the stored strings, no flash access
+            lines_modified = FALSE;
+            for (i = 0; i < 3; i++)
+            {
+                if (guiScrollLine(&scrolling_lines[i], x_coordinates[i], y_coordinates[i], top_coordinates[i], top_coordinates[i+1] - top_coordinates[i]) != FALSE)
+                {
+                    lines_modified = TRUE;
+                }
+            }
+
+            if (lines_modified != FALSE)
+            {
+                miniOledFlushEntireBufferToDisplay();
+            }
+        }
 
         // Get wheel action
         wheel_action = miniGetWheelAction(FALSE, FALSE);
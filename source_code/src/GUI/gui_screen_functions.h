@@ -40,6 +40,10 @@
     #define SCROLL_LINE_TEXT_FIRST_XPOS     121
     #define SCROLL_LINE_TEXT_SECOND_XPOS    116
     #define SCROLL_LINE_TEXT_THIRD_XPOS     121
+    // First row redrawn when a scrolling line moves, the glyph descenders of a line use the first row of the next one
+    #define SCROLL_LINE_FIRST_TOP_YPOS      0
+    #define SCROLL_LINE_SECOND_TOP_YPOS     (THREE_LINE_TEXT_SECOND_POS + 1)
+    #define SCROLL_LINE_THIRD_TOP_YPOS      (THREE_LINE_TEXT_THIRD_POS + 1)
 #endif
 
 // Prototypes
@@ -0,0 +1,127 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     gui_scrolling_functions.c
+*    \brief    General user interface - scrolling text lines of the Mini selection screens
+*    Created:  19/10/2026
+*/
+#include <string.h>
+#include "gui_scrolling_functions.h"
+#include "oled_wrapper.h"
+#include "defines.h"
+/***********************************************************/
+/*  This file is only used for the Mooltipass mini version */
+#if defined(MINI_VERSION)
+
+/*! \fn     drawScrollingLine(scrollingLine_t* line, uint8_t x, uint8_t y)
+*   \brief  Display a scrolling line from its current offset, right justified at x
+*   \param  line    Pointer to the scrolling line
+*   \param  x       X coordinate the line is justified to
+*   \param  y       Y coordinate of the line
+*/
+static void drawScrollingLine(scrollingLine_t* line, uint8_t x, uint8_t y)
+{
+    uint8_t i;
+    
+    line->nb_displayed = miniOledPutstrXY(x, y, OLED_RIGHT, line->text + line->offset);
+    
+    // Strings larger than the line are displayed from its start, store where they end
+    line->end_x = 0;
+    for (i = 0; i < line->nb_displayed; i++)
+    {
+        line->end_x += miniOledGlyphWidth(line->text[line->offset + i]);
+    }
+}
+
+/*! \fn     guiSetScrollingLine(scrollingLine_t* line, const char* text, uint8_t x, uint8_t y)
+*   \brief  Store the string of a scrolling line and display it
+*   \param  line    Pointer to the scrolling line
+*   \param  text    String to display
+*   \param  x       X coordinate the line is justified to
+*   \param  y       Y coordinate of the line
+*/
+void guiSetScrollingLine(scrollingLine_t* line, const char* text, uint8_t x, uint8_t y)
+{
+    strncpy(line->text, text, sizeof(line->text));
+    line->text[sizeof(line->text)-1] = 0;
+    line->length = strlen(line->text);
+    line->width = miniOledStrWidth(line->text);
+    line->offset = 0;
+    drawScrollingLine(line, x, y);
+}
+
+/*! \fn     guiScrollLine(scrollingLine_t* line, uint8_t x, uint8_t y, uint8_t top_y, uint8_t height)
+*   \brief  Scroll a line larger than the screen by one character
+*   \param  line    Pointer to the scrolling line
+*   \param  x       X coordinate the line is justified to
+*   \param  y       Y coordinate of the line
+*   \param  top_y   First row used by the line
+*   \param  height  Number of rows used by the line
+*   \return TRUE if the line was modified
+*   \note   The displayed characters are moved in the frame buffer, only the ones appearing on the right are drawn
+*/
+uint8_t guiScrollLine(scrollingLine_t* line, uint8_t x, uint8_t y, uint8_t top_y, uint8_t height)
+{
+    uint8_t nb_printed_chars;
+    
+    // Strings fitting on the screen don't scroll
+    if ((line->offset == 0) && (line->nb_displayed == line->length))
+    {
+        return FALSE;
+    }
+    
+    if (line->offset == (line->length - line->nb_displayed))
+    {
+        // The end of the string was displayed, start again
+        line->offset = 0;
+        line->width = miniOledStrWidth(line->text);
+        miniOledDrawRectangle(0, top_y, x, height, FALSE);
+        drawScrollingLine(line, x, y);
+    }
+    else
+    {
+        uint8_t shift = miniOledGlyphWidth(line->text[line->offset++]);
+        line->width -= shift;
+        
+        if (line->width <= x)
+        {
+            // The end of the string fits, it gets right justified
+            miniOledDrawRectangle(0, top_y, x, height, FALSE);
+            drawScrollingLine(line, x, y);
+        }
+        else
+        {
+            // Move the displayed characters, then draw the ones that now fit
+            miniOledShiftRectangleLeft(0, top_y, x, height, shift);
+            line->end_x -= shift;
+            line->nb_displayed--;
+            miniOledSetMaxTextY(x);
+            miniOledSetXY(line->end_x, y);
+            nb_printed_chars = miniOledPutstr(line->text + line->offset + line->nb_displayed);
+            miniOledResetMaxTextY();
+            while (nb_printed_chars--)
+            {
+                line->end_x += miniOledGlyphWidth(line->text[line->offset + line->nb_displayed++]);
+            }
+        }
+    }
+    
+    return TRUE;
+}
+#endif
@@ -0,0 +1,49 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     gui_scrolling_functions.h
+*    \brief    General user interface - scrolling text lines of the Mini selection screens
+*    Created:  19/10/2026
+*/
+
+
+#ifndef GUI_SCROLLING_FUNCTIONS_H_
+#define GUI_SCROLLING_FUNCTIONS_H_
+
+#include "node_mgmt.h"
+#include "defines.h"
+
+#ifdef MINI_VERSION
+/* Scrolling text line of the selection screens, kept between two refreshes */
+typedef struct
+{
+    char text[NODE_PARENT_SIZE_OF_SERVICE];     // Displayed string
+    uint16_t width;                             // Pixel width of the string from the current offset
+    uint8_t length;                             // String length
+    uint8_t offset;                             // Index of the first displayed character
+    uint8_t nb_displayed;                       // Number of displayed characters
+    uint8_t end_x;                              // X position after the last displayed character
+} scrollingLine_t;
+
+void guiSetScrollingLine(scrollingLine_t* line, const char* text, uint8_t x, uint8_t y);
+uint8_t guiScrollLine(scrollingLine_t* line, uint8_t x, uint8_t y, uint8_t top_y, uint8_t height);
+#endif
+
+
+#endif /* GUI_SCROLLING_FUNCTIONS_H_ */
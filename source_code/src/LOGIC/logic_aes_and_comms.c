@@ -91,6 +91,7 @@ uint8_t getSmartCardInsertedUnlocked(void)
 
 /*! \fn     setSmartCardInsertedUnlocked(void)
 *   \brief  set the smartcard is inserted and unlocked
+*   \note   Every unlock path goes through here, so this is where STATUS_EVENT_UNLOCKED is posted
 */
 void setSmartCardInsertedUnlocked(void)
 {
@@ -98,10 +99,12 @@ void setSmartCardInsertedUnlocked(void)
     {
         smartcard_inserted_unlocked = TRUE;
     }
+    usbPostStatusEvent(STATUS_EVENT_UNLOCKED);
 }
 
 /*! \fn     clearSmartCardInsertedUnlocked(void)
 *   \brief  set the smartcard is removed (called by interrupt!)
+*   \note   STATUS_EVENT_LOCKED is only posted if the card was unlocked
 */
 void clearSmartCardInsertedUnlocked(void)
 {
@@ -109,6 +112,10 @@ void clearSmartCardInsertedUnlocked(void)
     selected_login_flag = FALSE;
     leaveMemoryManagementMode();
     activateTimer(TIMER_CREDENTIALS, 0);
+    if (smartcard_inserted_unlocked == TRUE)
+    {
+        usbPostStatusEvent(STATUS_EVENT_LOCKED);
+    }
     smartcard_inserted_unlocked = FALSE;
 }
 
@@ -226,6 +233,8 @@ uint16_t searchForLoginInGivenParent(uint16_t parent_addr, uint8_t* name)
 {
     uint16_t next_node_addr;
     
+    clearDataNodePlaintextCache();
+    
     // Read parent node and get first child address
     readParentNode(&temp_pnode, parent_addr);    
     next_node_addr = temp_pnode.nextChildAddress;
@@ -311,6 +320,68 @@ void decrypt32bBlockOfDataAndClearCTVFlag(uint8_t* data, uint8_t* ctr)
     while (hasTimerExpired(TIMER_CREDENTIALS, FALSE) == TIMER_RUNNING);
 }
 
+/*! \fn     decryptDataNodeAndClearCTVFlag(dNode* node, uint8_t* ctr)
+*   \brief  Decrypt all the 32B blocks stored in a data node, clear credential_timer_valid
+*   \param  node    Data node to be decrypted in place
+*   \param  ctr     Ctr value for the first block, incremented past the last block
+*   \note   Each block was encrypted with its own ctr value, so only the IV is set again between blocks
+*/
+void decryptDataNodeAndClearCTVFlag(dNode* node, uint8_t* ctr)
+{
+    uint8_t nb_bytes = (uint8_t)(node->flags & 0x00FF);
+    uint8_t temp_buffer[AES256_CTR_LENGTH];
+    
+    // Preventing side channel attacks: only return after a given amount of time, whatever the number of blocks
+    activateTimer(TIMER_CREDENTIALS, AES_NODE_DECR_TIMER_VAL);
+    
+    for (uint8_t i = 0; (i < nb_bytes) && (i < DATA_NODE_DATA_LENGTH); i += AES_ROUTINE_ENC_SIZE)
+    {
+        // AES decryption: xor our nonce with the block ctr value, set the result, then decrypt
+        memcpy((void*)temp_buffer, (void*)current_nonce, AES256_CTR_LENGTH);
+        aesXorVectors(temp_buffer + (AES256_CTR_LENGTH-USER_CTR_SIZE), ctr, USER_CTR_SIZE);
+        aes256CtrSetIv(&aesctx, temp_buffer, AES256_CTR_LENGTH);
+        aes256CtrDecrypt(&aesctx, &node->data[i], AES_ROUTINE_ENC_SIZE);
+        
+        // A 32B block uses two ctr values
+        aesIncrementCtr(ctr, USER_CTR_SIZE);
+        aesIncrementCtr(ctr, USER_CTR_SIZE);
+    }
+    
+    // Wait for credential timer to fire (we wanted to clear credential_timer_valid flag anyway)
+    while (hasTimerExpired(TIMER_CREDENTIALS, FALSE) == TIMER_RUNNING);
+}
+
+/*! \fn     clearDataNodePlaintextCache(void)
+*   \brief  Wipe the decrypted data node we may be serving 32B at a time
+*   \note   temp_cnode holds this node: called before it is used for anything else, and when the credential timer expires
+*   \note   Only a node being read holds plaintext, a node being written is kept. A read stopped with blocks left can't go on with the next node: the data context is invalidated so that it fails
+*/
+void clearDataNodePlaintextCache(void)
+{
+    if (currently_reading_data_cntr != 0)
+    {
+        data_context_valid_flag = FALSE;
+        memset((void*)temp_dnode_ptr->data, 0x00, DATA_NODE_DATA_LENGTH);
+        currently_reading_data_cntr = 0;
+    }
+}
+
+/*! \fn     getNbDataBlocksLeftInCurrentNode(void)
+*   \brief  Know how many decrypted 32B blocks are left to be read in the current data node
+*   \return The number of blocks
+*/
+uint8_t getNbDataBlocksLeftInCurrentNode(void)
+{
+    if (currently_reading_data_cntr == 0)
+    {
+        return 0;
+    }
+    else
+    {
+        return ((temp_dnode_ptr->flags & 0x00FF) - currently_reading_data_cntr + AES_ROUTINE_ENC_SIZE - 1) / AES_ROUTINE_ENC_SIZE;
+    }
+}
+
 /*! \fn     encrypt32bBlockOfDataAndClearCTVFlag(uint8_t* data, uint8_t* ctr)
 *   \brief  Encrypt a block of data, clear credential_timer_valid
 *   \param  data    Data to be decrypted
@@ -358,6 +429,9 @@ RET_TYPE setCurrentContext(uint8_t* name, uint8_t type)
         currently_writing_first_block = FALSE;
     }
     
+    // Wipe data we may have decrypted for the previous context
+    clearDataNodePlaintextCache();
+    
     // Do we know this context ?
     if ((context_parent_node_addr != NODE_ADDR_NULL) && (smartcard_inserted_unlocked == TRUE))
     {
@@ -442,6 +516,8 @@ RET_TYPE getLoginForContext(char* buffer)
     }
     else
     {
+        clearDataNodePlaintextCache();
+        
         // Credential timer off, ask for user to choose
         if (hasTimerExpired(TIMER_CREDENTIALS, FALSE) == TIMER_EXPIRED)
         {
@@ -541,6 +617,7 @@ RET_TYPE getPasswordForContext(char* buffer)
     if ((context_valid_flag == TRUE) && (hasTimerExpired(TIMER_CREDENTIALS, FALSE) == TIMER_RUNNING) && (selected_login_flag == TRUE))
     {
         // Fetch password from selected login and send it over USB
+        clearDataNodePlaintextCache();
         readChildNode(&temp_cnode, selected_login_child_node_addr);
         
         // Call the password decryption function, which also clears the credential_timer_valid flag
@@ -566,6 +643,7 @@ RET_TYPE getDescriptionForContext(char* buffer)
     if ((context_valid_flag == TRUE) && (hasTimerExpired(TIMER_CREDENTIALS, FALSE) == TIMER_RUNNING) && (selected_login_flag == TRUE))
     {
         // Fetch description from selected login and send it over USB
+        clearDataNodePlaintextCache();
         readChildNode(&temp_cnode, selected_login_child_node_addr);
         
         // Store the description
@@ -676,6 +754,8 @@ RET_TYPE setPasswordForContext(uint8_t* password, uint8_t length)
     }
     else
     {
+        clearDataNodePlaintextCache();
+        
         // Read parent node
         readParentNode(&temp_pnode, context_parent_node_addr);
         
@@ -739,6 +819,7 @@ RET_TYPE addDataForDataContext(uint8_t* data, uint8_t last_packet_flag)
 {
     uint8_t temp_ctr[3];
     
+    clearDataNodePlaintextCache();
     if (data_context_valid_flag == FALSE)
     {
         // Login not set
@@ -831,6 +912,13 @@ RET_TYPE get32BytesDataForCurrentService(uint8_t* buffer)
             // Credential timer off, ask for user to approve
             if (hasTimerExpired(TIMER_CREDENTIALS, FALSE) == TIMER_EXPIRED)
             {
+                // Wipe a node left with blocks to read, the read then fails instead of skipping them
+                clearDataNodePlaintextCache();
+                if (data_context_valid_flag == FALSE)
+                {
+                    return RETURN_NOK;
+                }
+                
                 // Read current parent node, extract child addr and ctr value
                 readParentNode(&temp_pnode, context_parent_node_addr);
                 memcpy(dataNodeCtrVal, temp_pnode.startDataCtr, 3);
@@ -845,7 +933,6 @@ RET_TYPE get32BytesDataForCurrentService(uint8_t* buffer)
                 if (guiAskForConfirmation(2, &conf_text) == RETURN_OK)
                 {
                     activateTimer(TIMER_CREDENTIALS, CREDENTIAL_TIMER_VALIDITY);
-                    currently_reading_data_cntr = 0;
                 }
                 guiGetBackToCurrentScreen(); 
             }
@@ -869,18 +956,17 @@ RET_TYPE get32BytesDataForCurrentService(uint8_t* buffer)
                         if(validBitFromFlags(temp_dnode_ptr->flags) == NODE_VBIT_INVALID)
                         {
                             return RETURN_NOK;
-                        }                  
+                        }
+                        
+                        // Decrypt the whole node, which also clears the credential_timer_valid flag and increments the ctr value
+                        decryptDataNodeAndClearCTVFlag(temp_dnode_ptr, dataNodeCtrVal);
                     }
                 }
                 
-                // Call the password decryption function, which also clears the credential_timer_valid flag
-                decrypt32bBlockOfDataAndClearCTVFlag(&temp_dnode_ptr->data[currently_reading_data_cntr], dataNodeCtrVal);
                 activateTimer(TIMER_CREDENTIALS, CREDENTIAL_TIMER_VALIDITY);
-                // Increment ctr value
-                aesIncrementCtr(dataNodeCtrVal, USER_CTR_SIZE);
-                aesIncrementCtr(dataNodeCtrVal, USER_CTR_SIZE);                
-                // Copy in our buffer the data
+                // Copy in our buffer the data and wipe it from the decrypted node
                 memcpy(buffer, (void*)&temp_dnode_ptr->data[currently_reading_data_cntr], 32);
+                memset((void*)&temp_dnode_ptr->data[currently_reading_data_cntr], 0x00, 32);
                                 
                 // Increment our counter
                 currently_reading_data_cntr += 32;
@@ -921,6 +1007,7 @@ RET_TYPE checkPasswordForContext(uint8_t* password)
         {
             // Check password in Flash
             // Read child node
+            clearDataNodePlaintextCache();
             readChildNode(&temp_cnode, selected_login_child_node_addr);
             
             // Call the password decryption function, which also clears the credential_timer_valid flag
@@ -941,6 +1028,105 @@ RET_TYPE checkPasswordForContext(uint8_t* password)
     }
 }
 
+/*! \fn     checkPasswordBatchForContext(uint8_t* pairs, uint8_t length, uint8_t* bitmap)
+*   \brief  Check several login / password pairs for current context
+*   \param  pairs   Succession of null terminated login and password strings
+*   \param  length  Length of the pairs buffer
+*   \param  bitmap  Where to store the results, bit set when the pair's password is correct (LSB first)
+*   \return Operation success or not (see pass_check_return_t)
+*   \note   Each pair not matching a stored credential adds CHECK_PASSWORD_TIMER_VAL to the lockout time,
+*   \note   so a batch gives an attacker the same guess rate as single checks
+*/
+RET_TYPE checkPasswordBatchForContext(uint8_t* pairs, uint8_t length, uint8_t* bitmap)
+{
+    uint8_t* logins[CHECK_PASSWORD_BATCH_MAX_PAIRS];
+    uint8_t nb_pairs = 0, nb_failures;
+    uint16_t next_node_addr;
+    uint8_t string_length;
+    uint8_t i = 0;
+    
+    // If timer is running
+    if (hasTimerExpired(TIMER_PASS_CHECK, FALSE) == TIMER_RUNNING)
+    {
+        return RETURN_PASS_CHECK_BLOCKED;
+    }
+    
+    // Check context valid flag
+    if (context_valid_flag == FALSE)
+    {
+        return RETURN_PASS_CHECK_NOK;
+    }
+    
+    // Split the buffer in pairs, checking that each string is terminated and fits in a child node
+    while (i < length)
+    {
+        if (nb_pairs == CHECK_PASSWORD_BATCH_MAX_PAIRS)
+        {
+            return RETURN_PASS_CHECK_NOK;
+        }
+        logins[nb_pairs++] = &pairs[i];
+        
+        string_length = strnlen((char*)&pairs[i], length - i);
+        if ((string_length >= NODE_CHILD_SIZE_OF_LOGIN) || (string_length >= length - i))
+        {
+            return RETURN_PASS_CHECK_NOK;
+        }
+        i += string_length + 1;
+        
+        string_length = strnlen((char*)&pairs[i], length - i);
+        if ((string_length >= NODE_CHILD_SIZE_OF_PASSWORD) || (string_length >= length - i))
+        {
+            return RETURN_PASS_CHECK_NOK;
+        }
+        i += string_length + 1;
+    }
+    if (nb_pairs == 0)
+    {
+        return RETURN_PASS_CHECK_NOK;
+    }
+    
+    // Go through the child nodes once, decrypting the password of the ones matching a requested login
+    memset((void*)bitmap, 0x00, (CHECK_PASSWORD_BATCH_MAX_PAIRS+7)/8);
+    nb_failures = nb_pairs;
+    clearDataNodePlaintextCache();
+    readParentNode(&temp_pnode, context_parent_node_addr);
+    next_node_addr = temp_pnode.nextChildAddress;
+    while (next_node_addr != NODE_ADDR_NULL)
+    {
+        uint8_t password_decrypted = FALSE;
+        
+        readChildNode(&temp_cnode, next_node_addr);
+        for (i = 0; i < nb_pairs; i++)
+        {
+            if (strncmp((char*)temp_cnode.login, (char*)logins[i], NODE_CHILD_SIZE_OF_LOGIN) == 0)
+            {
+                // Call the password decryption function, which also clears the credential_timer_valid flag
+                if (password_decrypted == FALSE)
+                {
+                    decrypt32bBlockOfDataAndClearCTVFlag(temp_cnode.password, temp_cnode.ctr);
+                    password_decrypted = TRUE;
+                }
+                
+                // Password follows the login, a pair matched by several children only counts once
+                if ((strncmp((char*)temp_cnode.password, (char*)logins[i] + strlen((char*)logins[i]) + 1, NODE_CHILD_SIZE_OF_PASSWORD) == 0) && ((bitmap[i >> 3] & (1 << (i & 0x07))) == 0))
+                {
+                    bitmap[i >> 3] |= (1 << (i & 0x07));
+                    nb_failures--;
+                }
+            }
+        }
+        memset((void*)temp_cnode.password, 0x00, NODE_CHILD_SIZE_OF_PASSWORD);
+        next_node_addr = temp_cnode.nextChildAddress;
+    }
+    
+    // Rate limiting, accounted per wrong pair
+    if (nb_failures != 0)
+    {
+        activateTimer(TIMER_PASS_CHECK, (uint16_t)nb_failures * CHECK_PASSWORD_TIMER_VAL);
+    }
+    return RETURN_PASS_CHECK_OK;
+}
+
 /*! \fn     askUserForLoginAndPasswordKeybOutput(uint16_t child_address, char* service_name)
 *   \brief  Ask the user to enter the login password of a given child
 *   \param  child_address   Address of the child
@@ -1013,6 +1199,7 @@ void askUserForLoginAndPasswordKeybOutput(uint16_t child_address, char* service_
 */
 void favoritePickingLogic(void)
 {
+    clearDataNodePlaintextCache();
     // favoriteSelectionScreen loads the chosen parent node in memory before exciting
     askUserForLoginAndPasswordKeybOutput(favoriteSelectionScreen(&temp_pnode, &temp_cnode), (char*)temp_pnode.service);
 }
@@ -1022,5 +1209,6 @@ void favoritePickingLogic(void)
 */
 void loginSelectLogic(void)
 {
+    clearDataNodePlaintextCache();
     askUserForLoginAndPasswordKeybOutput(guiAskForLoginSelect(&temp_pnode, &temp_cnode, loginSelectionScreen(), TRUE), (char*)temp_pnode.service);
 }
\ No newline at end of file
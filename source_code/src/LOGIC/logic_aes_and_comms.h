@@ -30,14 +30,19 @@
 
 /** Defines **/
 #define CHECK_PASSWORD_TIMER_VAL        4000
+#define CHECK_PASSWORD_BATCH_MAX_PAIRS  15     // 4 bytes min per pair in a 62 bytes packet
 #define CREDENTIAL_TIMER_VALIDITY       1000
 #define AES_ENCR_DECR_TIMER_VAL         20     // Timed at 5ms!
+#define AES_NODE_DECR_TIMER_VAL         40     // 4 blocks, timed at 20ms
 #define CTR_FLASH_MIN_INCR              64
 #define AES_ROUTINE_ENC_SIZE            32
 
 #if AES_ROUTINE_ENC_SIZE != NODE_CHILD_SIZE_OF_PASSWORD
     #error "Wrong password size"
 #endif
+#if (CHECK_PASSWORD_BATCH_MAX_PAIRS * CHECK_PASSWORD_TIMER_VAL) > 65535
+    #error "Batch password check lockout doesn't fit the timer"
+#endif
 #if AES_ROUTINE_ENC_SIZE != DATA_NODE_BLOCK_SIZ
     #error "Wrong data node block size"
 #endif
@@ -49,9 +54,12 @@ RET_TYPE addDataForDataContext(uint8_t* data, uint8_t last_packet_flag);
 RET_TYPE addNewContext(uint8_t* name, uint8_t length, uint8_t type);
 RET_TYPE setPasswordForContext(uint8_t* password, uint8_t length);
 void initEncryptionHandling(uint8_t* aes_key, uint8_t* nonce);
+void decryptDataNodeAndClearCTVFlag(dNode* node, uint8_t* ctr);
+uint8_t getNbDataBlocksLeftInCurrentNode(void);
 RET_TYPE setLoginForContext(uint8_t* name, uint8_t length);
 RET_TYPE get32BytesDataForCurrentService(uint8_t* buffer);
 RET_TYPE setCurrentContext(uint8_t* name, uint8_t type);
+RET_TYPE checkPasswordBatchForContext(uint8_t* pairs, uint8_t length, uint8_t* bitmap);
 RET_TYPE checkPasswordForContext(uint8_t* password);
 RET_TYPE getDescriptionForContext(char* buffer);
 RET_TYPE getPasswordForContext(char* buffer);
@@ -59,6 +67,7 @@ uint8_t getSmartCardInsertedUnlocked(void);
 void initUserFlashContext(uint8_t user_id);
 RET_TYPE getLoginForContext(char* buffer);
 void clearSmartCardInsertedUnlocked(void);
+void clearDataNodePlaintextCache(void);
 void setSmartCardInsertedUnlocked(void);
 void eraseFlashUsersContents(void);
 void ctrPreEncryptionTasks(void);
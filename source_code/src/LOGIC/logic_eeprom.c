@@ -69,6 +69,7 @@ static const uint8_t eeprom_param_init[] __attribute__((__progmem__)) =
     5,                  // DELAY_AFTER_KEY_ENTRY_PARAM          How many ms are added after a key is typed
     FALSE,              // WHEEL_DIRECTION_REVERSE_PARAM        Reverse wheel direction
     0x80,               // MINI_OLED_CONTRAST_CURRENT_PARAM     Default contrast current for the mini oled display
+    FALSE,              // MULTI_KEY_REPORTS_BOOL_PARAM         Type one key per keyboard report by default
 };
 
 
@@ -68,6 +68,7 @@
 #define DELAY_AFTER_KEY_ENTRY_PARAM         24
 #define WHEEL_DIRECTION_REVERSE_PARAM       25
 #define MINI_OLED_CONTRAST_CURRENT_PARAM    26
+#define MULTI_KEY_REPORTS_BOOL_PARAM        27
 // ... we can go until 33 ;)
 #define FIRST_USER_PARAM                    KEYBOARD_LAYOUT_PARAM
 
@@ -21,6 +21,7 @@
  *  \brief  Logic for storing/getting fw data in the dedicated flash storage
  *  Copyright [2014] [Mathieu Stephan]
  */
+#include <string.h>
 #include <stdint.h>
 #include "logic_fwflash_storage.h"
 #include "logic_eeprom.h"
@@ -90,25 +91,23 @@ char* readStoredStringToBuffer(uint8_t stringID)
     return (char*)ret_val;
 }
 
-/*!	\fn     getKeybLutEntryForLayout(uint8_t layout, uint8_t ascii_char)
-*	\brief	Get a keyboard LUT entry for a given layout
-*   \note   No checking is performed on boundaries, must be done in calling function
+/*!	\fn     loadKeybLutForLayout(uint8_t layout, uint8_t* buffer)
+*	\brief	Load the keyboard LUT for a given layout
 *   \param  layout      Keyboard layout
-*   \param  ascii_char  The ascii char
-*   \return The LUT entry
+*   \param  buffer      KEYB_LUT_LENGTH long buffer, filled with escape keys if the LUT can't be found
 */
-uint8_t getKeybLutEntryForLayout(uint8_t layout, uint8_t ascii_char)
+void loadKeybLutForLayout(uint8_t layout, uint8_t* buffer)
 {
-    // Default return value is escape
-    uint8_t ret_val = KEY_ESCAPE;
     uint16_t temp_addr;
-        
+    
     // Get address in flash
     if ((getStoredFileAddr((uint16_t)controlEepromParameter(layout, FIRST_KEYB_LUT, LAST_KEYB_LUT), &temp_addr) == RETURN_OK) && (temp_addr != 0x0000))
     {
         // The LUT only covers from ' ' to ~ included
-        flashRawRead(&ret_val, temp_addr + (ascii_char - ' ') + MEDIA_TYPE_LENGTH, 1);
+        flashRawRead(buffer, temp_addr + MEDIA_TYPE_LENGTH, KEYB_LUT_LENGTH);
+    }
+    else
+    {
+        memset((void*)buffer, KEY_ESCAPE, KEYB_LUT_LENGTH);
     }
-    
-    return ret_val;
 }
\ No newline at end of file
@@ -298,9 +298,10 @@
 #define ID_KEYB_US_MAC_LUT      BITMAP_ID_OFFSET+57
 #define FIRST_KEYB_LUT          ID_KEYB_EN_US_LUT
 #define LAST_KEYB_LUT           ID_KEYB_US_MAC_LUT
+#define KEYB_LUT_LENGTH         ('~' - ' ' + 1)
 
 // Prototypes
-uint8_t getKeybLutEntryForLayout(uint8_t layout, uint8_t ascii_char);
+void loadKeybLutForLayout(uint8_t layout, uint8_t* buffer);
 RET_TYPE getStoredFileAddr(uint16_t fileId, uint16_t* addr);
 char* readStoredStringToBuffer(uint8_t stringID);
 
@@ -30,6 +30,7 @@
 #include "logic_aes_and_comms.h"
 #include "gui_pin_functions.h"
 #include "logic_smartcard.h"
+#include "usb_cmd_parser.h"
 #include "logic_eeprom.h"
 #include "aes256_ctr.h"
 #include "rng.h"
@@ -50,6 +51,9 @@ RET_TYPE handleSmartcardInserted(void)
     // Return fail by default
     RET_TYPE return_value = RETURN_NOK;
     
+    // Let the host app know without waiting for it to poll
+    usbPostStatusEvent(STATUS_EVENT_CARD_INSERTED);
+    
     if ((detection_result == RETURN_MOOLTIPASS_PB) || (detection_result == RETURN_MOOLTIPASS_INVALID))
     {
         // Either it is not a card or our Manufacturer Test Zone write/read test failed
@@ -142,6 +146,7 @@ void handleSmartcardRemoved(void)
     // Remove power and flags
     removeFunctionSMC();
     clearSmartCardInsertedUnlocked();
+    clearDataNodePlaintextCache();
     
     // Clear encryption context
     memset((void*)temp_buffer, 0, AES_KEY_LENGTH/8);
@@ -829,9 +829,8 @@ RET_TYPE createGenericNode(gNode* g, uint16_t firstNodeAddress, uint16_t* newFir
 void populateServicesLut(void)
 {
     uint16_t next_node_addr = currentNodeMgmtHandle.firstParentNode;
-    uint8_t temp_node_buffer[9];
+    uint8_t temp_node_buffer[offsetof(pNode, service) + 1];
     uint16_t temp_page_number;
-    pNode* pnode_ptr = (pNode*)temp_node_buffer;
     uint8_t first_service_letter;
     
     // Empty our current services list
@@ -857,9 +856,9 @@ void populateServicesLut(void)
             return;
         }
 
-        // Read first 9 bytes of the parent node as we just want to know the first letter
+        // Read the parent node up to the first letter of its service: the buffer is smaller than a node, fields are taken at their offsets
         readDataFromFlash(temp_page_number, NODE_SIZE * nodeNumberFromAddress(next_node_addr), sizeof(temp_node_buffer), temp_node_buffer);
-        first_service_letter = pnode_ptr->service[0];
+        first_service_letter = temp_node_buffer[offsetof(pNode, service)];
             
         // LUT is only for chars between 'a' and 'z'
         if ((first_service_letter >= 'a') && (first_service_letter <= 'z'))
@@ -875,7 +874,7 @@ void populateServicesLut(void)
         currentNodeMgmtHandle.lastParentNode = next_node_addr;
             
         // Fetch next node
-        next_node_addr = pnode_ptr->nextParentAddress;
+        memcpy(&next_node_addr, &temp_node_buffer[offsetof(pNode, nextParentAddress)], sizeof(next_node_addr));
     }
 }
 
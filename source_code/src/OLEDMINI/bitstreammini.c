@@ -23,6 +23,7 @@
  *  Copyright [2016] [Mathieu Stephan]
  */
 #include <avr/pgmspace.h>
+#include <string.h>
 #include "bitstreammini.h"
 #include "flash_mem.h"
 #include "usb.h"
@@ -49,6 +50,20 @@ void miniBistreamInit(bitstream_mini_t* bs, uint8_t height, uint16_t width, uint
     bs->dataSize = (uint16_t)width * (((uint16_t)height+7) >> BITSTREAM_PIXELS_PER_BYTE_BITSHIFT);
 }
 
+/*! \fn     miniBistreamInitFromRam(bitstream_mini_t* bs, uint8_t height, uint16_t width, uint8_t* data)
+ *  \brief  Initialise a bitstream for data already in RAM, which must fit in the read ahead buffer
+ *  \param  bs      pointer to the bitstream context to be used for the new bitmap
+ *  \param  height  data height
+ *  \param  width   data width
+ *  \param  data    the data
+ */
+void miniBistreamInitFromRam(bitstream_mini_t* bs, uint8_t height, uint16_t width, uint8_t* data)
+{
+    miniBistreamInit(bs, height, width, 0);
+    memcpy(bs->buffer, data, bs->dataSize);
+    bs->bufferInd = 0;
+}
+
 /*! \fn     bsGetNextByte(bitstream_mini_t* bs)
  *  \brief  Return the next data byte from flash
  *  \param  bs      pointer to initialized bitstream context to get the next word from
@@ -47,5 +47,6 @@ typedef struct
 /** PROTOTYPES **/
 uint8_t miniBistreamGetNextByte(bitstream_mini_t* bs);
 void miniBistreamInit(bitstream_mini_t* bs, uint8_t height, uint16_t width, uint16_t addr);
+void miniBistreamInitFromRam(bitstream_mini_t* bs, uint8_t height, uint16_t width, uint8_t* data);
 
 #endif /* BITSTREAMMINI_H_ */
\ No newline at end of file
@@ -31,6 +31,7 @@
 #include "bitstreammini.h"
 #include "timer_manager.h"
 #include "logic_eeprom.h"
+#include "font_cache.h"
 #include "flash_mem.h"
 #include "oledmini.h"
 #include "defines.h"
@@ -42,6 +43,11 @@
 /*  This file is only used for the Mooltipass mini version */
 #if defined(MINI_VERSION)
 
+// Cached glyph bitmaps are given to the bitstream through its read ahead buffer
+#if GLYPH_CACHE_DATA_SIZE > BITSTREAM_BUFFER_SIZE
+    #error "Glyph cache data doesn't fit in the bitstream buffer"
+#endif
+
 // Frame buffer, first byte is X0 Y7 (MSB) to X0 Y0 (LSB)
 uint8_t miniOledFrameBuffer[SSD1305_OLED_WIDTH*SSD1305_OLED_BUFFER_HEIGHT/SSD1305_PAGE_HEIGHT];
 // Current y offset in buffer
@@ -50,6 +56,12 @@ uint8_t miniOledBufferYOffset;
 uint8_t miniOledScreenYOffset;
 // Last y offset in screen
 uint8_t miniOledLastScreenYOffset;
+// Column span modified in each frame buffer page since it was last flushed, start > end for an unmodified page
+static uint8_t miniOledDirtyXStart[SSD1305_OLED_BUFFER_PAGE_HEIGHT];
+static uint8_t miniOledDirtyXEnd[SSD1305_OLED_BUFFER_PAGE_HEIGHT];
+// First frame buffer page and first screen page of the last flush, the whole screen is sent again when they change
+static uint8_t miniOledFlushedBufferPage = SSD1305_NO_PAGE;
+static uint8_t miniOledFlushedScreenPage = SSD1305_NO_PAGE;
 // Boolean to know if OLED on
 uint8_t miniOledIsOn = FALSE;
 // Used to know which address to request in the SPI flash
@@ -104,6 +116,48 @@ static const uint8_t mini_oled_init[] __attribute__((__progmem__)) =
 };
 
 
+/*! \fn     miniOledMarkDirty(uint8_t page, uint8_t xstart, uint8_t xend)
+ *  \brief  Record a modification of the frame buffer, to be sent by the next flush
+ *  \param  page    Frame buffer page, can be above the buffer height
+ *  \param  xstart  First modified column
+ *  \param  xend    Last modified column
+ */
+static void miniOledMarkDirty(uint8_t page, uint8_t xstart, uint8_t xend)
+{
+    page = page % SSD1305_OLED_BUFFER_PAGE_HEIGHT;
+    if (xend >= SSD1305_OLED_WIDTH)
+    {
+        xend = SSD1305_OLED_WIDTH - 1;
+    }
+    
+    if (miniOledDirtyXStart[page] > miniOledDirtyXEnd[page])
+    {
+        // First modification of this page
+        miniOledDirtyXStart[page] = xstart;
+        miniOledDirtyXEnd[page] = xend;
+    }
+    else
+    {
+        if (xstart < miniOledDirtyXStart[page])
+        {
+            miniOledDirtyXStart[page] = xstart;
+        }
+        if (xend > miniOledDirtyXEnd[page])
+        {
+            miniOledDirtyXEnd[page] = xend;
+        }
+    }
+}
+
+/*! \fn     miniOledMarkAllDirty(void)
+ *  \brief  Record a modification of the whole frame buffer
+ */
+static void miniOledMarkAllDirty(void)
+{
+    memset(miniOledDirtyXStart, 0, sizeof(miniOledDirtyXStart));
+    memset(miniOledDirtyXEnd, SSD1305_OLED_WIDTH - 1, sizeof(miniOledDirtyXEnd));
+}
+
 #ifdef DEV_PLUGIN_COMMS
 /*! \fn     miniOledWriteFrameBuffer(uint16_t offset, uint8_t* data, uint8_t size)
  *  \brief  Write data directly into the frame buffer
@@ -114,6 +168,7 @@ static const uint8_t mini_oled_init[] __attribute__((__progmem__)) =
 void miniOledWriteFrameBuffer(uint16_t offset, uint8_t* data, uint8_t nbBytes)
 {
     memcpy(miniOledFrameBuffer + offset, data, nbBytes);
+    miniOledMarkAllDirty();
     miniOledFlushEntireBufferToDisplay();
 }
 #endif
@@ -273,33 +328,55 @@ void miniOledFlushBufferContents(uint8_t xstart, uint8_t xend, uint8_t ystart, u
     }
     spiUsartWaitEndSendTransfer();
     PORT_OLED_SS |= (1 << PORTID_OLED_SS); 
+    
+    // The screen offsets aren't taken into account here, the next flush has to send everything
+    miniOledFlushedScreenPage = SSD1305_NO_PAGE;
 }
 
 /*! \fn     miniOledFlushEntireBufferToDisplay(void)
  *  \brief  Flush buffer contents to the display
- *  \notes  timed at 1.6ms!
+ *  \notes  only the column spans modified since the last flush are sent (the whole screen took 1.6ms), unless the screen or buffer offsets changed
  */
 void miniOledFlushEntireBufferToDisplay(void)
 {
     // Display window: starting & ending X
-    uint8_t set_x_window_command[3] = {SSD1305_CMD_SET_COLUMN_ADDR, SSD1305_X_OFFSET, SSD1305_OLED_WIDTH + SSD1305_X_OFFSET - 1};
+    uint8_t set_x_window_command[3] = {SSD1305_CMD_SET_COLUMN_ADDR, 0, 0};
     
     // Display window: starting & ending page
     uint8_t current_page = miniOledScreenYOffset >> SSD1305_PAGE_HEIGHT_BIT_SHIFT;
     uint8_t set_page_command[3] = {SSD1305_CMD_SET_PAGE_ADDR, current_page, current_page};
+    
+    // Frame buffer page displayed at the top of the screen
+    uint8_t buffer_page = ((miniOledBufferYOffset + 7) % SSD1305_OLED_BUFFER_HEIGHT) >> SSD1305_PAGE_HEIGHT_BIT_SHIFT;
+    
+    // The pages we flushed last time don't hold the same frame buffer pages anymore
+    if ((buffer_page != miniOledFlushedBufferPage) || (current_page != miniOledFlushedScreenPage))
+    {
+        miniOledMarkAllDirty();
+        miniOledFlushedBufferPage = buffer_page;
+        miniOledFlushedScreenPage = current_page;
+    }
       
     // Unfortunately the SSD1305 controller doesn't accept a starting page bigger than the ending page, so we need to send page by page
-    uint16_t offset = (((miniOledBufferYOffset + 7) % SSD1305_OLED_BUFFER_HEIGHT) >> SSD1305_PAGE_HEIGHT_BIT_SHIFT) << SSD1305_WIDTH_BIT_SHIFT;
     for (uint8_t i = 0; i < SSD1305_SCREEN_PAGE_HEIGHT; i++)
     {
-        // Set window
-        miniOledWriteCommand(set_x_window_command, sizeof(set_x_window_command));
-        miniOledWriteCommand(set_page_command, sizeof(set_page_command));
+        uint8_t xstart = miniOledDirtyXStart[buffer_page];
+        uint8_t xend = miniOledDirtyXEnd[buffer_page];
         
-        // Send one page of data
-        //OLEDDEBUGPRINTF_P(PSTR("Frame buffer offset %d\n"),offset);
-        miniOledWriteData(miniOledFrameBuffer + offset, SSD1305_OLED_WIDTH);
-        offset = (offset + SSD1305_OLED_WIDTH) % sizeof(miniOledFrameBuffer);
+        if (xstart <= xend)
+        {
+            // Set window
+            set_x_window_command[1] = xstart + SSD1305_X_OFFSET;
+            set_x_window_command[2] = xend + SSD1305_X_OFFSET;
+            miniOledWriteCommand(set_x_window_command, sizeof(set_x_window_command));
+            miniOledWriteCommand(set_page_command, sizeof(set_page_command));
+            
+            // Send the modified part of the page
+            miniOledWriteData(miniOledFrameBuffer + (((uint16_t)buffer_page) << SSD1305_WIDTH_BIT_SHIFT) + xstart, xend - xstart + 1);
+            miniOledDirtyXStart[buffer_page] = SSD1305_OLED_WIDTH;
+            miniOledDirtyXEnd[buffer_page] = 0;
+        }
+        buffer_page = (buffer_page + 1) % SSD1305_OLED_BUFFER_PAGE_HEIGHT;
         
         // Compute page
         current_page = (current_page+1) & SSD1305_TOTAL_PAGE_HEIGHT_BITMASK;
@@ -307,6 +384,14 @@ void miniOledFlushEntireBufferToDisplay(void)
     }
 }
 
+/*! \fn     miniOledResendEntireBuffer(void)
+ *  \brief  Have the next flush send the whole screen, as it did before the modified spans were tracked
+ */
+void miniOledResendEntireBuffer(void)
+{
+    miniOledFlushedScreenPage = SSD1305_NO_PAGE;
+}
+
 /*! \fn     miniOledOn(void)
  *  \brief  Turn the display on
  */
@@ -361,12 +446,15 @@ void miniOledInit(void)
     // Set the contrast current stored in the eeprom
     miniOledSetContrastCurrent(getMooltipassParameterInEeprom(MINI_OLED_CONTRAST_CURRENT_PARAM));
 
-    // Switch on an empty screen
+    // Switch on an empty screen, the controller memory has to be entirely written
+    miniOledFlushedScreenPage = SSD1305_NO_PAGE;
     miniOledClearFrameBuffer();
     miniOledScreenYOffset = SSD1305_OLED_HEIGHT;
     miniOledFlushEntireBufferToDisplay();
     miniOledScreenYOffset = 0;
     miniOledFlushEntireBufferToDisplay();
+    // Start line set by the init sequence, the previous one is lost when the display is initialized again
+    miniOledLastScreenYOffset = 0;
     miniOledOn();
 }
 
@@ -463,6 +551,7 @@ void miniOledDrawRectangle(uint8_t x, uint8_t y, uint8_t width, uint8_t height,
     for(uint8_t page = page_start; page <= page_end; page++)
     {
         uint16_t buffer_shift = (((uint16_t)page) % SSD1305_OLED_BUFFER_PAGE_HEIGHT) << SSD1305_WIDTH_BIT_SHIFT;
+        miniOledMarkDirty(page, x, x + width - 1);
         for(uint8_t xpos = x; xpos < x + width; xpos++)
         {
             uint8_t or_mask = 0xFF;
@@ -512,12 +601,63 @@ void miniOledDrawRectangle(uint8_t x, uint8_t y, uint8_t width, uint8_t height,
     }
 }
 
+/*! \fn     miniOledShiftRectangleLeft(uint8_t x, uint8_t y, uint8_t width, uint8_t height, uint8_t shift)
+ *  \brief  Move the pixels of a rectangle to the left, the columns freed on its right are cleared
+ *  \param  x       X position
+ *  \param  y       Y position
+ *  \param  width   width
+ *  \param  height  height
+ *  \param  shift   number of columns to move the pixels by
+ *  \note   pixels outside of the rectangle aren't modified, which allows scrolling a text line without redrawing it
+ */
+void miniOledShiftRectangleLeft(uint8_t x, uint8_t y, uint8_t width, uint8_t height, uint8_t shift)
+{
+    // Compute page start & page end
+    uint8_t start_ypixel = miniOledBufferYOffset + y;
+    uint8_t end_ypixel = start_ypixel + height - 1;
+    uint8_t page_start = start_ypixel >> SSD1305_PAGE_HEIGHT_BIT_SHIFT;
+    uint8_t page_end = end_ypixel >> SSD1305_PAGE_HEIGHT_BIT_SHIFT;
+    uint8_t end_x = x + width;
+
+    // Compute mask settings
+    uint8_t f_bitshift_mask[] = {0x01, 0x03, 0x07, 0x0F, 0x1F, 0x3F, 0x7F, 0xFF};
+    uint8_t l_bitshift_mask[] = {0xFF, 0xFE, 0xFC, 0xF8, 0xF0, 0xE0, 0xC0, 0x80};
+
+    for (uint8_t page = page_start; page <= page_end; page++)
+    {
+        uint8_t* line = &miniOledFrameBuffer[(((uint16_t)page) % SSD1305_OLED_BUFFER_PAGE_HEIGHT) << SSD1305_WIDTH_BIT_SHIFT];
+        uint8_t mask = 0xFF;
+
+        // Only move the rows of the rectangle
+        if (page == page_start)
+        {
+            mask &= l_bitshift_mask[start_ypixel & 0x07];
+        }
+        if (page == page_end)
+        {
+            mask &= f_bitshift_mask[end_ypixel & 0x07];
+        }
+
+        miniOledMarkDirty(page, x, end_x - 1);
+        for (uint8_t xpos = x; xpos < end_x; xpos++)
+        {
+            uint8_t pixels = 0x00;
+            if ((xpos + shift) < end_x)
+            {
+                pixels = line[xpos + shift];
+            }
+            line[xpos] = (line[xpos] & ~mask) | (pixels & mask);
+        }
+    }
+}
+
 /*! \fn     miniOledClearFrameBuffer(void)
  *  \brief  Clear the frame buffer
  */
 void miniOledClearFrameBuffer(void)
 {
     memset(miniOledFrameBuffer, 0x00, sizeof(miniOledFrameBuffer));    
+    miniOledMarkAllDirty();
 }
 
 /*! \fn     miniOledDumpCurrentFont(void)
@@ -590,6 +730,10 @@ void miniOledSetFont(uint8_t fontIndex)
     {
         miniOledFontId = FONT_NONE;
     }
+    else
+    {
+        fontCacheLoad(miniOledFontAddr, &miniOledCurrentFont);
+    }
 
     OLEDDEBUGPRINTF_P(PSTR("found font at file index %d\n"),fontIndex);
     OLEDDEBUGPRINTF_P(PSTR("oled set font %d\n"),fontIndex);
@@ -617,7 +761,7 @@ void miniOledBitmapDrawRaw(uint8_t x, uint8_t y, bitstream_mini_t* bs)
     OLEDDEBUGPRINTF_P(PSTR("Draw raw: xs %d xe %d ps %d pe %d rbits %d lbits %d"), start_x, end_x, start_page, end_page, data_rbitshift, data_lbitshift);
     
     // Bitmasks
-    uint8_t rbitmask[] = {0x00, 0x80, 0xC0, 0xE0, 0xF0, 0xF8, 0xFC, 0xFE};
+    uint8_t rbitmask[] = {0x00, 0x80, 0xC0, 0xE0, 0xF0, 0xF8, 0xFC, 0xFE, 0xFF};
     //uint8_t lbitmask[] = {0xFF, 0x01, 0x03, 0x07, 0x0F, 0x1F, 0x3F, 0x7F};
         
     // Check that we're not displaying off-screen
@@ -626,6 +770,19 @@ void miniOledBitmapDrawRaw(uint8_t x, uint8_t y, bitstream_mini_t* bs)
         return;
     }
     
+    // Record the modified area
+    for (uint8_t page = start_page; page <= end_page; page++)
+    {
+        miniOledMarkDirty(page, start_x, end_x);
+    }
+    
+    // Rows kept in the end page, including the ones above the bitmap when it fits in a single page
+    uint8_t end_page_mask = rbitmask[data_rbitshift];
+    if (start_page == end_page)
+    {
+        end_page_mask |= ~rbitmask[8 - ((miniOledBufferYOffset + y) & 0x07)];
+    }
+    
     for (uint8_t x = start_x; x <= end_x; x++)
     {
         int16_t buffer_shift = (((uint16_t)end_page % SSD1305_OLED_BUFFER_PAGE_HEIGHT) << SSD1305_WIDTH_BIT_SHIFT);
@@ -635,7 +792,7 @@ void miniOledBitmapDrawRaw(uint8_t x, uint8_t y, bitstream_mini_t* bs)
             if (page == end_page)
             {
                 cur_pixels = miniBistreamGetNextByte(bs);
-                miniOledFrameBuffer[buffer_shift+x] &= rbitmask[data_rbitshift];
+                miniOledFrameBuffer[buffer_shift+x] &= end_page_mask;
                 miniOledFrameBuffer[buffer_shift+x] |= cur_pixels >> data_rbitshift;
                 pixels_to_be_displayed -= (8 - data_rbitshift);
             }
@@ -764,14 +921,33 @@ void miniOledBitmapDrawFlash(uint8_t x, int8_t y, uint8_t fileId, uint8_t option
     }
 }
 
+/*! \fn     miniOledGlyphIndex(char ch)
+ *  \brief  Return the glyph index of a character in the current font
+ *  \param  ch      the character, ' ' or above
+ *  \return glyph index, the one of '?' if the font doesn't have the character, GLYPH_INDEX_NONE if it doesn't have '?' either
+ */
+static uint8_t miniOledGlyphIndex(char ch)
+{
+    uint8_t gind = fontCacheGetIndex(ch);
+    
+    // If we don't know this character, try again with '?'
+    if (gind == GLYPH_INDEX_NONE)
+    {
+        gind = fontCacheGetIndex('?');
+    }
+    return gind;
+}
+
 /*! \fn     miniOledGlyphWidth(char ch)
  *  \brief  Return the width of the specified character in the current font
  *  \param  ch      return the width of this character
  *  \return width of the glyph
+ *  \note   the printable ASCII widths are only read from the flash once per font
  */
 uint8_t miniOledGlyphWidth(char ch)
 {
     glyph_t glyph;
+    uint8_t width;
     uint8_t gind;
     
     // Check that a font was actually chosen
@@ -781,37 +957,38 @@ uint8_t miniOledGlyphWidth(char ch)
         if (ch < ' ')
         {
             return 0;
-        }     
-        
-        // Convert character to glyph index
-        flashRawRead(&gind, miniOledFontAddr + (uint16_t)&miniOledFontp->map[ch - ' '], sizeof(gind));
+        }
         
-        // Check that we know this glyph
-        if(gind == 0xFF)
+        // Check if it was already measured
+        width = fontCacheGetWidth(ch);
+        if (width != GLYPH_WIDTH_UNKNOWN)
         {
-            // If we don't know this character, try again with '?'
-            ch = '?';
-            flashRawRead(&gind, miniOledFontAddr + (uint16_t)&miniOledFontp->map[ch - ' '], sizeof(gind));
-            
-            // If we still don't know it, return 0
-            if (gind == 0xFF)
-            {
-                return 0;
-            }            
+            return width;
         }
-
-        // Read the beginning of the glyph
-        flashRawRead((uint8_t*)&glyph, miniOledFontAddr + (uint16_t)&miniOledFontp->glyph[gind], sizeof(glyph_t));
-
-        if ((uint16_t)glyph.glyph == 0xFFFF)
+        
+        // Convert character to glyph index, return 0 if we don't know it
+        gind = miniOledGlyphIndex(ch);
+        if (gind == GLYPH_INDEX_NONE)
         {
-            // If there's no glyph data, it is the space!
-            return (glyph.width >> 1) + 1; // space character is always too large...
+            width = 0;
         }
         else
         {
-            return glyph.xrect + glyph.xoffset + 1;
+            // Read the beginning of the glyph
+            fontCacheGetHeader(gind, &glyph);
+            
+            if ((uint16_t)glyph.glyph == 0xFFFF)
+            {
+                // If there's no glyph data, it is the space!
+                width = (glyph.width >> 1) + 1; // space character is always too large...
+            }
+            else
+            {
+                width = glyph.xrect + glyph.xoffset + 1;
+            }
         }
+        fontCacheSetWidth(ch, width);
+        return width;
     }
     else 
     {
@@ -846,6 +1023,7 @@ uint8_t miniOledGlyphDraw(uint8_t x, uint8_t y, char ch)
     bitstream_mini_t bs;                // Character bitstream
     uint8_t glyph_height;               // Glyph height
     uint8_t glyph_width;                // Glyph width
+    glyphCacheEntry_t* entry;           // Glyph cache entry
     glyph_t glyph;                      // Glyph header
     uint8_t gind;                       // Glyph index
     
@@ -861,25 +1039,16 @@ uint8_t miniOledGlyphDraw(uint8_t x, uint8_t y, char ch)
         return 0;
     }
     
-    // Convert character to glyph index
-    flashRawRead(&gind, miniOledFontAddr + (uint16_t)&miniOledFontp->map[ch - ' '], sizeof(gind));
-    
-    // Check that we know this glyph
-    if(gind == 0xFF)
+    // Convert character to glyph index, return 0 if we don't know it
+    gind = miniOledGlyphIndex(ch);
+    if (gind == GLYPH_INDEX_NONE)
     {
-        // If we don't know this character, try again with '?'
-        ch = '?';
-        flashRawRead(&gind, miniOledFontAddr + (uint16_t)&miniOledFontp->map[ch - ' '], sizeof(gind));
-        
-        // If we still don't know it, return 0
-        if (gind == 0xFF)
-        {
-            return 0;
-        }
+        return 0;
     }
     
-    // Get the glyph header data
-    flashRawRead((uint8_t*)&glyph, miniOledFontAddr + (uint16_t)&miniOledFontp->glyph[gind], sizeof(glyph_t));
+    // Get the glyph header data, and its bitmap if it is small enough to be cached
+    entry = fontCacheGetGlyph(gind);
+    glyph = entry->header;
     
     OLEDDEBUGPRINTF_P(PSTR("    glyph_t addr 0x%04x\n"), miniOledFontAddr + (uint16_t)&miniOledFontp->glyph[gind]);
     
@@ -906,7 +1075,14 @@ uint8_t miniOledGlyphDraw(uint8_t x, uint8_t y, char ch)
         OLEDDEBUGPRINTF_P(PSTR("    glyph '%c' width %d height %d xoffset %d yoffset %d addr 0x%04x\n"), ch, glyph_width, glyph_height, glyph.xoffset, glyph.yoffset, gaddr);
         
         // Initialize bitstream & draw the character
-        miniBistreamInit(&bs, glyph_height, glyph_width, gaddr);   
+        if (entry->data_cached)
+        {
+            miniBistreamInitFromRam(&bs, glyph_height, glyph_width, entry->data);
+        }
+        else
+        {
+            miniBistreamInit(&bs, glyph_height, glyph_width, gaddr);
+        }
         miniOledBitmapDrawRaw(x, y, &bs);
     }
     
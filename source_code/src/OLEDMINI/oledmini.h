@@ -83,6 +83,7 @@
 #define SSD1305_SCREEN_PAGE_HEIGHT_BITMASK          0x03        // Bitmask for 4
 #define SSD1305_TOTAL_PAGE_HEIGHT                   8           // 8 pages is one screen buffer height
 #define SSD1305_TOTAL_PAGE_HEIGHT_BITMASK           0x07        // Bitmask for 8
+#define SSD1305_NO_PAGE                             0xFF        // No page flushed yet
 
 /** ONE LINE FUNCTIONS **/
 #define miniOledNormalDisplay()                     miniOledWriteSimpleCommand(SSD1305_CMD_ENTIRE_DISPLAY_NREVERSED)
@@ -106,6 +107,7 @@ void miniOledBegin(uint8_t font);
 RET_TYPE miniOledIsScreenOn(void);
 void miniOledDumpCurrentFont(void);
 void miniOledClearFrameBuffer(void);
+uint8_t miniOledGlyphWidth(char ch);
 void miniOledWriteActiveBuffer(void);
 void miniOledDisplayOtherBuffer(void);
 void miniOledSetMaxTextY(uint8_t maxY);
@@ -114,9 +116,11 @@ uint8_t miniOledPutstr(const char* str);
 void miniOledSetFont(uint8_t fontIndex);
 void miniOledSetXY(uint8_t x, int8_t y);
 void miniOledCheckFlashStringsWidth(void);
+uint16_t miniOledStrWidth(const char* str);
 void miniOledFlushWrittenTextToDisplay(void);
 void miniOledWriteSimpleCommand(uint8_t reg);
 void miniOledFlushEntireBufferToDisplay(void);
+void miniOledResendEntireBuffer(void);
 void miniOledAllowTextWritingYIncrement(void);
 void miniOledPreventTextWritingYIncrement(void);
 void miniOledDontFlushWrittenTextToDisplay(void);
@@ -129,5 +133,6 @@ uint8_t miniOledPutstrXY(uint8_t x, uint8_t y, uint8_t justify, const char* str)
 void miniOledBitmapDrawFlash(uint8_t x, int8_t y, uint8_t fileId, uint8_t options);
 void miniOledFlushBufferContents(uint8_t xstart, uint8_t xend, uint8_t ystart, uint8_t yend);
 void miniOledDrawRectangle(uint8_t x, uint8_t y, uint8_t width, uint8_t height, uint8_t full);
+void miniOledShiftRectangleLeft(uint8_t x, uint8_t y, uint8_t width, uint8_t height, uint8_t shift);
 
 #endif /* OLEDMINI_H_ */
\ No newline at end of file
@@ -0,0 +1,182 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     font_cache.c
+*    \brief    Glyph metrics and glyph cache of the current font
+*    Created:  19/10/2026
+*/
+/*
+ * Drawing or measuring a character used to take two SPI flash reads (the
+ * map entry, then the glyph header) before its bitmap could be read. The
+ * glyph indexes of the printable ASCII characters are now read in one go
+ * when a font is selected and their widths are kept once measured, while
+ * the headers and small bitmaps of the last drawn glyphs are kept in a LRU
+ * cache, so that drawing a string mostly comes down to the OLED traffic.
+ */
+#include "font_cache.h"
+#include "flash_mem.h"
+#include "defines.h"
+#include <string.h>
+
+// Used to compute the addresses in the font
+static flashFont_t* font_cache_fontp = (flashFont_t*)0;
+// Address, glyph count and depth of the current font
+static uint16_t font_cache_addr;
+static uint8_t font_cache_count;
+static uint8_t font_cache_depth;
+// Glyph indexes and widths of the printable ASCII characters
+static uint8_t font_cache_indexes[FONT_METRICS_NB_CHARS];
+static uint8_t font_cache_widths[FONT_METRICS_NB_CHARS];
+// Cached glyphs, and their entry numbers from the most to the least recently used
+static glyphCacheEntry_t font_cache_glyphs[GLYPH_CACHE_NB_ENTRIES];
+static uint8_t font_cache_order[GLYPH_CACHE_NB_ENTRIES];
+
+
+/*! \fn     fontCacheLoad(uint16_t font_addr, fontHeader_t* font_header)
+*   \brief  Load the glyph indexes of a new font and empty the caches
+*   \param  font_addr   Font address in the SPI flash
+*   \param  font_header Font header
+*/
+void fontCacheLoad(uint16_t font_addr, fontHeader_t* font_header)
+{
+    font_cache_addr = font_addr;
+    font_cache_count = font_header->count;
+    font_cache_depth = font_header->depth;
+    flashRawRead(font_cache_indexes, font_addr + (uint16_t)&font_cache_fontp->map[FONT_METRICS_FIRST_CHAR - ' '], sizeof(font_cache_indexes));
+    memset(font_cache_widths, GLYPH_WIDTH_UNKNOWN, sizeof(font_cache_widths));
+    for (uint8_t i = 0; i < GLYPH_CACHE_NB_ENTRIES; i++)
+    {
+        font_cache_glyphs[i].index = GLYPH_INDEX_NONE;
+        font_cache_order[i] = i;
+    }
+}
+
+/*! \fn     fontCacheGetIndex(char ch)
+*   \brief  Get the glyph index of a character
+*   \param  ch      The character, ' ' or above
+*   \return The glyph index, GLYPH_INDEX_NONE if the font doesn't have it
+*/
+uint8_t fontCacheGetIndex(char ch)
+{
+    uint8_t gind;
+    
+    if (ch <= FONT_METRICS_LAST_CHAR)
+    {
+        return font_cache_indexes[ch - FONT_METRICS_FIRST_CHAR];
+    }
+    flashRawRead(&gind, font_cache_addr + (uint16_t)&font_cache_fontp->map[ch - ' '], sizeof(gind));
+    return gind;
+}
+
+/*! \fn     fontCacheGetWidth(char ch)
+*   \brief  Get the width of a character measured before
+*   \param  ch      The character
+*   \return The width, GLYPH_WIDTH_UNKNOWN if it wasn't measured or isn't printable ASCII
+*/
+uint8_t fontCacheGetWidth(char ch)
+{
+    if ((ch < FONT_METRICS_FIRST_CHAR) || (ch > FONT_METRICS_LAST_CHAR))
+    {
+        return GLYPH_WIDTH_UNKNOWN;
+    }
+    return font_cache_widths[ch - FONT_METRICS_FIRST_CHAR];
+}
+
+/*! \fn     fontCacheSetWidth(char ch, uint8_t width)
+*   \brief  Store the width of a character, ignored outside printable ASCII
+*   \param  ch      The character
+*   \param  width   Its width
+*/
+void fontCacheSetWidth(char ch, uint8_t width)
+{
+    if ((ch >= FONT_METRICS_FIRST_CHAR) && (ch <= FONT_METRICS_LAST_CHAR))
+    {
+        font_cache_widths[ch - FONT_METRICS_FIRST_CHAR] = width;
+    }
+}
+
+/*! \fn     fontCacheGetHeader(uint8_t gind, glyph_t* glyph)
+*   \brief  Get a glyph header without adding the glyph to the cache
+*   \param  gind    Glyph index, not GLYPH_INDEX_NONE
+*   \param  glyph   Where to store the header
+*/
+void fontCacheGetHeader(uint8_t gind, glyph_t* glyph)
+{
+    for (uint8_t i = 0; i < GLYPH_CACHE_NB_ENTRIES; i++)
+    {
+        if (font_cache_glyphs[i].index == gind)
+        {
+            memcpy(glyph, &font_cache_glyphs[i].header, sizeof(glyph_t));
+            return;
+        }
+    }
+    flashRawRead((uint8_t*)glyph, font_cache_addr + (uint16_t)&font_cache_fontp->glyph[gind], sizeof(glyph_t));
+}
+
+/*! \fn     fontCacheGetGlyph(uint8_t gind)
+*   \brief  Get a glyph from the cache, loading it in place of the least recently used one if needed
+*   \param  gind    Glyph index, not GLYPH_INDEX_NONE
+*   \return The cache entry, valid until the next call
+*   \note   The bitmap is only cached when it fits in GLYPH_CACHE_DATA_SIZE bytes
+*/
+glyphCacheEntry_t* fontCacheGetGlyph(uint8_t gind)
+{
+    glyphCacheEntry_t* entry;
+    uint16_t data_size;
+    uint8_t entry_nb;
+    uint8_t i;
+    
+    // Look for the glyph, the last entry checked is the least recently used one
+    for (i = 0; i < GLYPH_CACHE_NB_ENTRIES - 1; i++)
+    {
+        if (font_cache_glyphs[font_cache_order[i]].index == gind)
+        {
+            break;
+        }
+    }
+    entry_nb = font_cache_order[i];
+    entry = &font_cache_glyphs[entry_nb];
+    
+    // It becomes the most recently used one
+    memmove(&font_cache_order[1], &font_cache_order[0], i);
+    font_cache_order[0] = entry_nb;
+    
+    if (entry->index != gind)
+    {
+        entry->index = gind;
+        entry->data_cached = FALSE;
+        flashRawRead((uint8_t*)&entry->header, font_cache_addr + (uint16_t)&font_cache_fontp->glyph[gind], sizeof(glyph_t));
+        
+        // Spaces don't have any bitmap, glyph data offsets are from the end of the glyph header array
+        if ((uint16_t)entry->header.glyph != 0xFFFF)
+        {
+            #if defined(MINI_VERSION)
+                data_size = (uint16_t)entry->header.xrect * ((entry->header.yrect + 7) >> 3);
+            #else
+                data_size = ((entry->header.xrect * font_cache_depth + 7) / 8) * entry->header.yrect;
+            #endif
+            if (data_size <= GLYPH_CACHE_DATA_SIZE)
+            {
+                flashRawRead(entry->data, font_cache_addr + (uint16_t)&font_cache_fontp->glyph[font_cache_count] + (uint16_t)entry->header.glyph, data_size);
+                entry->data_cached = TRUE;
+            }
+        }
+    }
+    return entry;
+}
@@ -0,0 +1,69 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     font_cache.h
+*    \brief    Glyph metrics and glyph cache of the current font
+*    Created:  19/10/2026
+*/
+
+#ifndef FONT_CACHE_H_
+#define FONT_CACHE_H_
+
+#include "fonts.h"
+#include <stdint.h>
+
+/*** DEFINES ***/
+// Characters whose glyph index and width are kept in RAM
+#define FONT_METRICS_FIRST_CHAR     ' '
+#define FONT_METRICS_LAST_CHAR      '~'
+#define FONT_METRICS_NB_CHARS       (FONT_METRICS_LAST_CHAR - FONT_METRICS_FIRST_CHAR + 1)
+// Width not measured yet
+#define GLYPH_WIDTH_UNKNOWN         0xFF
+// Glyph index of the characters missing in the font, and of a free cache entry
+#define GLYPH_INDEX_NONE            0xFF
+// Number of glyphs in the cache (21 bytes of RAM each)
+#ifndef GLYPH_CACHE_NB_ENTRIES
+    #define GLYPH_CACHE_NB_ENTRIES  2
+#endif
+#if GLYPH_CACHE_NB_ENTRIES < 1
+    #error "The glyph cache needs at least one entry"
+#endif
+// Max bitmap size of a cached glyph (the default font glyphs take at most 11 bytes)
+#ifndef GLYPH_CACHE_DATA_SIZE
+    #define GLYPH_CACHE_DATA_SIZE   12
+#endif
+
+/*** STRUCTS ***/
+typedef struct
+{
+    uint8_t index;                          // Glyph index, GLYPH_INDEX_NONE for a free entry
+    uint8_t data_cached;                    // TRUE when the glyph bitmap is in data
+    glyph_t header;                         // Glyph header
+    uint8_t data[GLYPH_CACHE_DATA_SIZE];    // Glyph bitmap
+} glyphCacheEntry_t;
+
+/*** PROTOTYPES ***/
+void fontCacheLoad(uint16_t font_addr, fontHeader_t* font_header);
+uint8_t fontCacheGetIndex(char ch);
+uint8_t fontCacheGetWidth(char ch);
+void fontCacheSetWidth(char ch, uint8_t width);
+void fontCacheGetHeader(uint8_t gind, glyph_t* glyph);
+glyphCacheEntry_t* fontCacheGetGlyph(uint8_t gind);
+
+#endif /* FONT_CACHE_H_ */
@@ -34,7 +34,7 @@ typedef struct
     uint8_t yrect;          // y height of rectangle
     int8_t xoffset;         // x offset of glyph in rectangle
     int8_t yoffset;         // y offset of glyph in rectangle
-    const uint8_t *glyph;   // glyph pixel data
+    uint16_t glyph;         // glyph pixel data offset from the end of the glyph_t array, 0xFFFF for spaces
 } glyph_t;
 
 typedef struct
@@ -52,6 +52,7 @@
 #include "logic_fwflash_storage.h"
 #include "timer_manager.h"
 #include "oled_wrapper.h"
+#include "font_cache.h"
 #include "bitstream.h"
 #include "flash_mem.h"
 #include "node_mgmt.h"
@@ -455,7 +456,7 @@ void stockOledPutch(char ch)
         oled_cur_x[oled_writeBuffer] = 0;
         break;
     default: {
-        uint8_t width = oledGlyphWidth(ch, NULL, NULL);
+        uint8_t width = oledGlyphWidth(ch);
 #ifdef OLED_DEBUG
         usbPrintf_P(PSTR("oled_putch('%c')\n"), ch);
 #endif
@@ -809,6 +810,7 @@ void stockOledSetFont(uint8_t fontIndex)
     oledFontPage = oledFontAddr / BYTES_PER_PAGE;
     oledFontOffset = oledFontAddr % BYTES_PER_PAGE;
     flashRawRead((uint8_t *)&currentFont, oledFontAddr, sizeof(currentFont));
+    fontCacheLoad(oledFontAddr, &currentFont);
 
 #ifdef OLED_DEBUG1
     usbPrintf_P(PSTR("found font at file index %d\n"),fontIndex);
@@ -1076,7 +1078,7 @@ uint16_t oledStrWidth(const char *str)
     uint16_t width=0;
     for (uint8_t ind=0; str[ind] != 0; ind++) 
     {
-        width += oledGlyphWidth(str[ind], NULL, NULL);
+        width += oledGlyphWidth(str[ind]);
     }
     return width;
 }
@@ -1093,7 +1095,7 @@ uint16_t oledStrWidth_P(const char *str)
     char ch;
     for (uint8_t ind=0; (ch = (pgm_read_byte(&str[ind]))) != 0; ind++) 
     {
-        width += oledGlyphWidth(ch, NULL, NULL);
+        width += oledGlyphWidth(ch);
     }
     return width;
 }
@@ -1138,18 +1140,34 @@ uint16_t oledGetTextWidth_P(char *fmt, ...)
 } 
 
 
+/**
+ * Return the glyph index of a character in the current font.
+ * @param ch - character
+ * @returns index of the glyph, control characters and characters missing in the font use the first glyph (space)
+ */
+static uint8_t oledGlyphIndex(char ch)
+{
+    uint8_t gind = 0;
+
+    if (ch >= ' ')
+    {
+        gind = fontCacheGetIndex(ch);
+        if (gind == GLYPH_INDEX_NONE)
+        {
+            gind = 0;
+        }
+    }
+    return gind;
+}
+
 /**
  * Return the width of the specified character in the current font.
  * @param ch - return the width of this character
- * @param indp - optional pointer to return index of glyph
  * @returns width of the glyph
+ * @note the printable ASCII widths are only read from the flash once per font
  */
-uint8_t oledGlyphWidth(char ch, uint8_t *indp, glyph_t *glyphp)
+uint8_t oledGlyphWidth(char ch)
 {
-    if (glyphp == NULL) {
-        // use the stack
-        glyphp = (glyph_t *)alloca(sizeof(glyph_t));
-    }
     if (fontId != FONT_NONE) 
     {
         uint8_t width = currentFont.fixedWidth;
@@ -1159,33 +1177,23 @@ uint8_t oledGlyphWidth(char ch, uint8_t *indp, glyph_t *glyphp)
         }
         else 
         {
-            uint8_t gind;
-            if (ch >= ' ')
-            {
-                // convert character to glyph index
-                flashRawRead(&gind, oledFontAddr + (uint16_t)&oled_fontp->map[ch - ' '], sizeof(gind));
-            }
-            else 
-            {
-                // default to a space
-                gind = 0;
-            }
-
-            if (indp)
+            width = fontCacheGetWidth(ch);
+            if (width == GLYPH_WIDTH_UNKNOWN)
             {
-                *indp = gind;
-            }
-
-            flashRawRead((uint8_t *)glyphp, oledFontAddr + (uint16_t)&oled_fontp->glyph[gind], sizeof(glyph_t));
+                glyph_t glyph;
 
-            if ((uint16_t)glyphp->glyph == 0xFFFF)
-            {
-                return glyphp->width + glyphp->xoffset + 1;
-            }
-            else
-            {
-                return glyphp->xrect + glyphp->xoffset + 1;
+                fontCacheGetHeader(oledGlyphIndex(ch), &glyph);
+                if ((uint16_t)glyph.glyph == 0xFFFF)
+                {
+                    width = glyph.width + glyph.xoffset + 1;
+                }
+                else
+                {
+                    width = glyph.xrect + glyph.xoffset + 1;
+                }
+                fontCacheSetWidth(ch, width);
             }
+            return width;
         }
     }
     else 
@@ -1235,6 +1243,7 @@ uint8_t oledGlyphDraw(int16_t x, int16_t y, char ch, uint16_t colour, uint16_t b
     uint8_t gind;
     uint16_t pixel_scale;
     glyph_t glyph;
+    glyphCacheEntry_t *glyphEntry;
     uint8_t *glyphData = NULL;
 
 #ifdef OLED_DEBUG1
@@ -1250,9 +1259,7 @@ uint8_t oledGlyphDraw(int16_t x, int16_t y, char ch, uint16_t colour, uint16_t b
         bg = 0;
     }
 
-
-    glyph_width = oledGlyphWidth(ch, &gind, &glyph);
-
+    gind = oledGlyphIndex(ch);
     glyph_depth = currentFont.depth;
     glyph_shift = 8 - glyph_depth;
     glyph_width = currentFont.fixedWidth;
@@ -1260,6 +1267,7 @@ uint8_t oledGlyphDraw(int16_t x, int16_t y, char ch, uint16_t colour, uint16_t b
     if (currentFont.fixedWidth)
     {
         glyph_height = 0;
+        glyph.xoffset = 0;
 #ifdef OLED_FEATURE_FIXED_WIDTH
         // Fixed width font
         glyph_height = currentFont.height;
@@ -1272,10 +1280,12 @@ uint8_t oledGlyphDraw(int16_t x, int16_t y, char ch, uint16_t colour, uint16_t b
     }
     else 
     {
-        // proportional width font
+        // proportional width font, header and small bitmaps come from the glyph cache
 #ifdef OLED_DEBUG
         usbPrintf_P(PSTR("    glyph_t addr 0x%04x\n"), oledFontAddr + (uint16_t)&oled_fontp->glyph[gind]);
 #endif
+        glyphEntry = fontCacheGetGlyph(gind);
+        glyph = glyphEntry->header;
         if ((uint16_t)glyph.glyph == 0xFFFF) 
         {
             // space character, just fill in the gddram buffer and output background pixels
@@ -1300,15 +1310,22 @@ uint8_t oledGlyphDraw(int16_t x, int16_t y, char ch, uint16_t colour, uint16_t b
             {
                 y = 0;
             }
-            uint16_t gsize = ((glyph_width*glyph_depth + 7)/8) * glyph_height;
-            uint16_t gaddr = oledFontAddr + (uint16_t)&oled_fontp->glyph[currentFont.count] + (uint16_t)glyph.glyph;
-            glyphData = alloca(gsize);
+            if (glyphEntry->data_cached)
+            {
+                glyphData = glyphEntry->data;
+            }
+            else
+            {
+                uint16_t gsize = ((glyph_width*glyph_depth + 7)/8) * glyph_height;
+                uint16_t gaddr = oledFontAddr + (uint16_t)&oled_fontp->glyph[currentFont.count] + (uint16_t)glyph.glyph;
+                glyphData = alloca(gsize);
 #ifdef OLED_DEBUG1
-            // glyph data offsets are from the end of the glyph header array
-            usbPrintf_P(PSTR("    glyph '%c' width %d height %d depth %d, addr 0x%04x size %d\n"),
-                        ch, glyph_width, glyph_height, glyph_depth, gaddr, gsize);
+                // glyph data offsets are from the end of the glyph header array
+                usbPrintf_P(PSTR("    glyph '%c' width %d height %d depth %d, addr 0x%04x size %d\n"),
+                            ch, glyph_width, glyph_height, glyph_depth, gaddr, gsize);
 #endif
-            flashRawRead(glyphData, gaddr, gsize);
+                flashRawRead(glyphData, gaddr, gsize);
+            }
         }
     }
     xoff = x % 4;
@@ -186,7 +186,7 @@ void oledSetX(uint8_t col);
 
 void oledSetPixel(uint8_t x, uint8_t y, uint8_t colour);
 
-uint8_t oledGlyphWidth(char ch, uint8_t *indp, glyph_t *glyphp);
+uint8_t oledGlyphWidth(char ch);
 uint8_t oledGlyphHeight(void);
 uint8_t oledGlyphDraw(int16_t x, int16_t y, char ch, uint16_t colour, uint16_t bg);
 
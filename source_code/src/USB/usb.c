@@ -65,6 +65,27 @@ static uint8_t keyboard_idle_count = 0;
 // 1=num lock, 2=caps lock, 4=scroll lock, 8=compose, 16=kana
 volatile uint8_t keyboard_leds = 0;
 
+// Keyboard LUT for the selected layout, loaded by usbKeybLoadParameters()
+static uint8_t keyboard_lut[KEYB_LUT_LENGTH];
+
+// Delay in ms added after each typed key, 0 if disabled
+static uint8_t keyboard_delay_after_key = 0;
+
+// Several keys can be pressed in a single report when typing a string
+static uint8_t keyboard_multi_key_reports = FALSE;
+
+// Raw HID reports waiting for a free endpoint bank, drained at each start of frame
+static uint8_t rawhid_tx_queue[RAWHID_TX_QUEUE_LEN][RAWHID_TX_SIZE];
+
+// Index of the oldest queued report
+static uint8_t rawhid_tx_queue_head = 0;
+
+// Number of queued reports
+static volatile uint8_t rawhid_tx_queue_count = 0;
+
+// Set when the host app opted in for unsolicited status events, cleared on USB reset
+static volatile uint8_t rawhid_status_events = FALSE;
+
 // Endpoint configuration table
 static const uint8_t PROGMEM endpoint_config_table[] =
 {
@@ -249,6 +270,58 @@ RET_TYPE usbRawHidRecv(uint8_t *buffer)
 }
 
 
+/*! \fn     usbRawHidTxQueueDrain(void)
+*   \brief  Move queued reports to the raw HID TX endpoint banks while some are free
+*   \note   Must be called with interrupts disabled
+*/
+static void usbRawHidTxQueueDrain(void)
+{
+    uint8_t prev_endpoint = UENUM;
+    
+    UENUM = RAWHID_TX_ENDPOINT;
+    while ((rawhid_tx_queue_count != 0) && (UEINTX & (1<<RWAL)))
+    {
+        for (uint8_t i = 0; i < RAWHID_TX_SIZE; i++)
+        {
+            UEDATX = rawhid_tx_queue[rawhid_tx_queue_head][i];
+        }
+        UEINTX = 0x3A;
+        if (++rawhid_tx_queue_head == RAWHID_TX_QUEUE_LEN)
+        {
+            rawhid_tx_queue_head = 0;
+        }
+        rawhid_tx_queue_count--;
+    }
+    UENUM = prev_endpoint;
+}
+
+/*! \fn     usbRawHidTxQueueFree(void)
+*   \brief  Know how many reports can still be queued, for producers that don't want to wait
+*   \return Number of free slots in the raw HID TX queue
+*/
+uint8_t usbRawHidTxQueueFree(void)
+{
+    return RAWHID_TX_QUEUE_LEN - rawhid_tx_queue_count;
+}
+
+/*! \fn     usbSetStatusEvents(uint8_t enable)
+*   \brief  Enable or disable unsolicited status events on the raw HID interface
+*   \param  enable  TRUE or FALSE
+*/
+void usbSetStatusEvents(uint8_t enable)
+{
+    rawhid_status_events = enable;
+}
+
+/*! \fn     usbGetStatusEvents(void)
+*   \brief  Know if the host app opted in for unsolicited status events
+*   \return TRUE or FALSE
+*/
+uint8_t usbGetStatusEvents(void)
+{
+    return rawhid_status_events;
+}
+
 /*! \fn     ISR(USB_GEN_vect)
 *   \brief  USB Device Interrupt - handle all device-level events
 *           the transmit buffer flushing is triggered by the start of frame
@@ -269,6 +342,8 @@ ISR(USB_GEN_vect)
         UECFG1X = EP_SIZE(ENDPOINT0_SIZE) | EP_SINGLE_BUFFER;
         UEIENX = (1<<RXSTPE);
         usb_configuration = 0;
+        rawhid_tx_queue_count = 0;
+        rawhid_status_events = FALSE;
     }
     // Detect pseudo suspend mode
     if ((intbits & (1<<SOFI)) && usb_configuration) 
@@ -279,6 +354,8 @@ ISR(USB_GEN_vect)
             act_detected_flag = TRUE;
         }
         activateTimer(TIMER_USB_SUSPEND, 65000);
+        // Send the reports we couldn't send earlier
+        usbRawHidTxQueueDrain();
     }
 }
 
@@ -406,6 +483,8 @@ ISR(USB_COM_vect)
         if (bRequest == SET_CONFIGURATION && bmRequestType == 0)
         {
             usb_configuration = wValue;
+            rawhid_tx_queue_count = 0;
+            rawhid_status_events = FALSE;
             usb_send_in();
             cfg = endpoint_config_table;
             for (i=1; i<5; i++)
@@ -587,63 +666,41 @@ ISR(USB_COM_vect)
     UECONX = (1<<STALLRQ) | (1<<EPEN);  // stall
 }
 
-/*!
-*   \brief  Wait for the TX fifo to be ready to accept data.
-*   \param  intr_state   pointer to storage to save the interrupt state
-*   \retval RETURN_TRANSF_COM_OK fifo is ready, and interrupts are disabled
-*   \retval RETURN_COM_TIMEOUT timeout waiting for fifo to be ready
-*   \retval RETURN_COM_NOK USB not configured
+/*! \fn     usbHidPutByte(uint8_t** queue_ptr, uint8_t data)
+*   \brief  Write a byte to the endpoint FIFO, or to a queued report
+*   \param  queue_ptr   Pointer to the queued report write pointer, pointing to 0 for the FIFO
+*   \param  data        The byte
 */
-static RET_TYPE usbWaitFifoReady(uint8_t *intr_state)
+static inline void usbHidPutByte(uint8_t** queue_ptr, uint8_t data)
 {
-    // if we're not online (enumerated and configured), error
-    if (!usb_configuration)
+    if (*queue_ptr == 0)
     {
-        return RETURN_COM_NOK;
+        UEDATX = data;
     }
-    *intr_state = SREG;
-    cli();
-    // Activate timeout timer
-    activateTimer(TIMER_WAIT_FUNCTS, USB_WRITE_TIMEOUT);
-    UENUM = RAWHID_TX_ENDPOINT;
-    // wait for the FIFO to be ready to accept data
-    while (1)
+    else
     {
-        if (UEINTX & (1<<RWAL))
-        {
-            break;
-        }
-        SREG = *intr_state;
-        if (hasTimerExpired(TIMER_WAIT_FUNCTS, TRUE) == TIMER_EXPIRED)
-        {
-            return RETURN_COM_TIMEOUT;
-        }
-        if (!usb_configuration)
-        {
-            return RETURN_COM_NOK;
-        }
-        *intr_state = SREG;
-        cli();
-        UENUM = RAWHID_TX_ENDPOINT;
+        *(*queue_ptr)++ = data;
     }
-    return RETURN_COM_TRANSF_OK;
 }
 
-
 /*!
 *   \brief  Send a packet, with timeout
 *           If cmd is non-zero then the lenght and cmd byte are
 *           sent first, followed by the buffer.
 *           If cmd is zero, the buffer is sent as-is.
 *   \param  cmd       optional command byte to send. Ignored if 0
-*   \param  buffer    Pointer to the buffer to send data from
+*   \param  buffer    Pointer to the data to send
 *   \param  buflen    amount of data to send from buffer
+*   \param  progmem   TRUE if buffer is in program memory
 *   \return RETURN_TRANSF_COM_OK or RETURN_COM_NOK or RETURN_COM_TIMEOUT
+*   \note   The packet goes to the endpoint FIFO if a bank is free, to the TX queue otherwise.
+*   \note   We only wait (back pressure) when both the FIFO and the queue are full.
 */
-RET_TYPE usbHidSend(uint8_t cmd, const void *buffer, uint8_t buflen)
+static RET_TYPE usbHidSendOrQueue(uint8_t cmd, const uint8_t* buffer, uint8_t buflen, uint8_t progmem)
 {
+    uint8_t* queue_ptr = 0;
     uint8_t intr_state;
-    int8_t res, rem;
+    int8_t rem;
     
     // How many bytes to add to send a full packet
     if (cmd)
@@ -662,37 +719,98 @@ RET_TYPE usbHidSend(uint8_t cmd, const void *buffer, uint8_t buflen)
         return RETURN_COM_NOK;
     }
 
-    res = usbWaitFifoReady(&intr_state);
-
-    if (res != RETURN_COM_TRANSF_OK) 
+    // if we're not online (enumerated and configured), error
+    if (!usb_configuration)
     {
-        return res;
+        return RETURN_COM_NOK;
+    }
+    intr_state = SREG;
+    cli();
+    // Activate timeout timer
+    activateTimer(TIMER_WAIT_FUNCTS, USB_WRITE_TIMEOUT);
+    while (1)
+    {
+        // Queued reports go first
+        usbRawHidTxQueueDrain();
+        UENUM = RAWHID_TX_ENDPOINT;
+        if ((rawhid_tx_queue_count == 0) && (UEINTX & (1<<RWAL)))
+        {
+            // The FIFO is ready to accept data
+            break;
+        }
+        if (rawhid_tx_queue_count < RAWHID_TX_QUEUE_LEN)
+        {
+            // Take the next free queue slot
+            uint8_t slot = rawhid_tx_queue_head + rawhid_tx_queue_count;
+            if (slot >= RAWHID_TX_QUEUE_LEN)
+            {
+                slot -= RAWHID_TX_QUEUE_LEN;
+            }
+            queue_ptr = rawhid_tx_queue[slot];
+            break;
+        }
+        // Wait for the start of frame interrupt to free a slot
+        SREG = intr_state;
+        if (hasTimerExpired(TIMER_WAIT_FUNCTS, TRUE) == TIMER_EXPIRED)
+        {
+            return RETURN_COM_TIMEOUT;
+        }
+        if (!usb_configuration)
+        {
+            return RETURN_COM_NOK;
+        }
+        intr_state = SREG;
+        cli();
     }
 
     if (cmd)
     {
-        UEDATX = buflen;
-        UEDATX = cmd;
+        usbHidPutByte(&queue_ptr, buflen);
+        usbHidPutByte(&queue_ptr, cmd);
     }
 
-    // write bytes to the FIFO
+    // write bytes
     while (buflen--)
     {
-        UEDATX = *(uint8_t *)buffer++;
+        usbHidPutByte(&queue_ptr, progmem ? pgm_read_byte(buffer) : *buffer);
+        buffer++;
     }
 
     // make up the remainder
     while (rem--)
     {
-        UEDATX = 0;
+        usbHidPutByte(&queue_ptr, 0);
     }
 
-    // transmit it now
-    UEINTX = 0x3A;
+    if (queue_ptr == 0)
+    {
+        // transmit it now
+        UEINTX = 0x3A;
+    }
+    else
+    {
+        // transmitted by the start of frame interrupt
+        rawhid_tx_queue_count++;
+    }
     SREG = intr_state;
     return RETURN_COM_TRANSF_OK;
 }
 
+/*!
+*   \brief  Send a packet, with timeout
+*           If cmd is non-zero then the lenght and cmd byte are
+*           sent first, followed by the buffer.
+*           If cmd is zero, the buffer is sent as-is.
+*   \param  cmd       optional command byte to send. Ignored if 0
+*   \param  buffer    Pointer to the buffer to send data from
+*   \param  buflen    amount of data to send from buffer
+*   \return RETURN_TRANSF_COM_OK or RETURN_COM_NOK or RETURN_COM_TIMEOUT
+*/
+RET_TYPE usbHidSend(uint8_t cmd, const void *buffer, uint8_t buflen)
+{
+    return usbHidSendOrQueue(cmd, (const uint8_t*)buffer, buflen, FALSE);
+}
+
 /*!
 *   \brief  Send a packet, with timeout
 *           If cmd is non-zero then the lenght and cmd byte are
@@ -705,55 +823,7 @@ RET_TYPE usbHidSend(uint8_t cmd, const void *buffer, uint8_t buflen)
 */
 RET_TYPE usbHidSend_P(uint8_t cmd, const void *buffer, uint8_t buflen)
 {
-    uint8_t intr_state;
-    int8_t res, rem;
-    
-    // How many bytes to add to send a full packet
-    if (cmd)
-    {
-        // If there is a command, the first 2 bytes are taken
-        rem = PACKET_EXPORT_SIZE - buflen;
-    }
-    else
-    {
-        rem = RAWHID_TX_SIZE - buflen;
-    }
-
-    // Check that we don't want to send too many bytes
-    if (rem < 0)
-    {
-        return RETURN_COM_NOK;
-    }
-
-    res = usbWaitFifoReady(&intr_state);
-
-    if (res != RETURN_COM_TRANSF_OK)
-    {
-        return res;
-    }
-
-    if (cmd)
-    {
-        UEDATX = buflen;
-        UEDATX = cmd;
-    }
-
-    // write bytes to the FIFO
-    while (buflen--)
-    {
-        UEDATX = pgm_read_byte(buffer++);
-    }
-
-    // make up the remainder
-    while (rem--)
-    {
-        UEDATX = 0;
-    }
-
-    // transmit it now
-    UEINTX = 0x3A;
-    SREG = intr_state;
-    return RETURN_COM_TRANSF_OK;
+    return usbHidSendOrQueue(cmd, (const uint8_t*)buffer, buflen, TRUE);
 }
 
 /*! \fn     usbRawHidSend(uint8_t *buffer, uint8_t timeout)
@@ -934,91 +1004,161 @@ RET_TYPE usbPutstr(const char *str)
     }
 #endif
 
-/*! \fn     usbKeybPutChar(char ch)
-*   \brief  press a given char on the keyboard
-*   \param  ch    char to press
-*   \return if the key was sent
+/*! \fn     usbKeybLoadParameters(void)
+*   \brief  Load the keyboard LUT and typing parameters, to be called when they change
 */
-RET_TYPE usbKeybPutChar(char ch)
+void usbKeybLoadParameters(void)
+{
+    loadKeybLutForLayout(getMooltipassParameterInEeprom(KEYBOARD_LAYOUT_PARAM), keyboard_lut);
+    
+    if (getMooltipassParameterInEeprom(DELAY_AFTER_KEY_ENTRY_BOOL_PARAM) != FALSE)
+    {
+        keyboard_delay_after_key = getMooltipassParameterInEeprom(DELAY_AFTER_KEY_ENTRY_PARAM);
+    }
+    else
+    {
+        keyboard_delay_after_key = 0;
+    }
+    
+    // Only enabled if explicitly set (the parameter isn't initialized on devices updated from older firmwares)
+    if (getMooltipassParameterInEeprom(MULTI_KEY_REPORTS_BOOL_PARAM) == TRUE)
+    {
+        keyboard_multi_key_reports = TRUE;
+    }
+    else
+    {
+        keyboard_multi_key_reports = FALSE;
+    }
+}
+
+/*! \fn     usbKeybGetKeyAndModifier(char ch, uint8_t* key, uint8_t* modifier)
+*   \brief  Get the key and modifier to press for a given char, depending on the layout
+*   \param  ch          char to press
+*   \param  key         Where to store the key
+*   \param  modifier    Where to store the modifier
+*   \return RETURN_NOK if the char can't be typed
+*/
+static RET_TYPE usbKeybGetKeyAndModifier(char ch, uint8_t* key, uint8_t* modifier)
 {
+    *modifier = 0;
+    
     if (ch == 0x0A)
     {
         // New line
-        return usbKeyboardPress(KEY_RETURN, 0);
+        *key = KEY_RETURN;
     }
     else if (ch == 0x09)
     {
         // TAB
-        return usbKeyboardPress(KEY_TAB, 0);
+        *key = KEY_TAB;
     }
     else if ((ch < ' ') || (ch > '~'))
     {
         // The LUT only covers from ' ' to ~ included
-        return RETURN_COM_NOK;
+        return RETURN_NOK;
     }
     else
     {
         // Get correct keyboard key depending on the layout
-        uint8_t key = getKeybLutEntryForLayout(getMooltipassParameterInEeprom(KEYBOARD_LAYOUT_PARAM), ch);
-        uint8_t masked_key = key & (SHIFT_MASK|ALTGR_MASK);
+        uint8_t lut_entry = keyboard_lut[ch - ' '];
         
-        if ((key & 0x3F) == KEY_EUROPE_2)
+        if (lut_entry & SHIFT_MASK)
         {
-            // Because of a redefine of KEY_EUROPE_2 for storage purposes we need to do that
-            uint8_t mod_tbs = 0;
-            
-            if (masked_key == (SHIFT_MASK|ALTGR_MASK))
-            {
-                mod_tbs = KEY_SHIFT|KEY_RIGHT_ALT;
-            }
-            else if (masked_key == SHIFT_MASK)
-            {
-                mod_tbs = KEY_SHIFT;
-            }
-            else if (masked_key == ALTGR_MASK)
-            {
-                mod_tbs = KEY_RIGHT_ALT;
-            }
-            
-            // Send the correct KEY_EUROPE_2 with the correct modifier
-            return usbKeyboardPress(KEY_EUROPE_2_REAL, mod_tbs);
+            // If we need shift
+            *modifier |= KEY_SHIFT;
         }
-        else if (masked_key == (SHIFT_MASK|ALTGR_MASK))
+        if (lut_entry & ALTGR_MASK)
         {
-            return usbKeyboardPress(key & ~(SHIFT_MASK|ALTGR_MASK), KEY_SHIFT|KEY_RIGHT_ALT);
+            // We need altgr for the numbered keys, only possible because we don't use the numerical keypad
+            *modifier |= KEY_RIGHT_ALT;
         }
-        else if (masked_key == SHIFT_MASK)
+        
+        if ((lut_entry & 0x3F) == KEY_EUROPE_2)
         {
-            // If we need shift
-            return usbKeyboardPress(key & ~SHIFT_MASK, KEY_SHIFT);
-        }
-        else if (masked_key == ALTGR_MASK)
-        {            
-            // We need altgr for the numbered keys, only possible because we don't use the numerical keypad
-            return usbKeyboardPress(key & ~ALTGR_MASK, KEY_RIGHT_ALT);
+            // Because of a redefine of KEY_EUROPE_2 for storage purposes we need to do that
+            *key = KEY_EUROPE_2_REAL;
         }
         else
         {
-            return usbKeyboardPress(key, 0);
+            *key = lut_entry & ~(SHIFT_MASK|ALTGR_MASK);
         }
-    }    
+    }
+    
+    return RETURN_OK;
+}
+
+/*! \fn     usbKeybPutChar(char ch)
+*   \brief  press a given char on the keyboard
+*   \param  ch    char to press
+*   \return if the key was sent
+*/
+RET_TYPE usbKeybPutChar(char ch)
+{
+    uint8_t key, modifier;
+    
+    if (usbKeybGetKeyAndModifier(ch, &key, &modifier) != RETURN_OK)
+    {
+        return RETURN_COM_NOK;
+    }
+    
+    return usbKeyboardPress(key, modifier);
 }
 
 /*! \fn     usbKeybPutStr(char* string)
 *   \brief  press a given text on the keyboard
 *   \param  string    string to press
 *   \return if the string was sent
+*   \note   When enabled, consecutive chars needing different keys and the same modifier are pressed in a single report.
+*   \note   Hosts report the keys of a report in their slot order, a release report separates two runs.
 */
 RET_TYPE usbKeybPutStr(char* string)
 {
     RET_TYPE temp_ret = RETURN_COM_TRANSF_OK;
+    uint8_t key, modifier, nb_keys;
+    
+    // One key per report if the host doesn't support several keys per report or if the user wants a delay between keys
+    if ((keyboard_multi_key_reports == FALSE) || (keyboard_delay_after_key != 0))
+    {
+        while((*string) && (temp_ret == RETURN_COM_TRANSF_OK))
+        {
+            temp_ret = usbKeybPutChar(*string++);
+            if (keyboard_delay_after_key != 0)
+            {
+                timerBasedDelayMs(keyboard_delay_after_key);
+            }
+        }
+        
+        return temp_ret;
+    }
     
     while((*string) && (temp_ret == RETURN_COM_TRANSF_OK))
     {
-        temp_ret = usbKeybPutChar(*string++);
-        if (getMooltipassParameterInEeprom(DELAY_AFTER_KEY_ENTRY_BOOL_PARAM) != FALSE)
+        // Fill the report with the next chars until we need a different modifier or an already pressed key
+        nb_keys = 0;
+        while ((*string) && (nb_keys < sizeof(keyboard_keys)) && (usbKeybGetKeyAndModifier(*string, &key, &modifier) == RETURN_OK))
+        {
+            if ((nb_keys != 0) && ((modifier != keyboard_modifier_keys) || (memchr(keyboard_keys, key, nb_keys) != NULL)))
+            {
+                break;
+            }
+            keyboard_modifier_keys = modifier;
+            keyboard_keys[nb_keys++] = key;
+            string++;
+        }
+        
+        // Char that can't be typed
+        if (nb_keys == 0)
+        {
+            return RETURN_COM_NOK;
+        }
+        
+        // Press, then release all the keys
+        temp_ret = usbKeyboardSend();
+        keyboard_modifier_keys = 0;
+        memset((void*)keyboard_keys, 0x00, sizeof(keyboard_keys));
+        if (temp_ret == RETURN_COM_TRANSF_OK)
         {
-            timerBasedDelayMs(getMooltipassParameterInEeprom(DELAY_AFTER_KEY_ENTRY_PARAM));
+            temp_ret = usbKeyboardSend();
         }
     }
     
@@ -32,6 +32,7 @@
 #define RAWHID_RX_SIZE      64                  // Raw HID receive packet size
 #define RAWHID_TX_BUFFER    EP_DOUBLE_BUFFER    // Double buffer
 #define RAWHID_RX_BUFFER    EP_DOUBLE_BUFFER    // Double buffer
+#define RAWHID_TX_QUEUE_LEN 2                   // Reports queued in RAM when both TX banks are full
 #define KEYBOARD_INTERFACE  1                   // Interface for keyboard
 #define KEYBOARD_ENDPOINT   3                   // Endpoint number for keyboard
 #define KEYBOARD_SIZE       8                   // Endpoint size for keyboard
@@ -90,12 +91,16 @@
 void initUsb(void);                                           // initialize everything
 uint8_t isUsbConfigured(void);                                // is the USB port configured
 uint8_t getKeyboardLeds(void);                                // get keyboard LEDs
+void usbKeybLoadParameters(void);                             // load keyboard LUT & typing parameters
 RET_TYPE usbKeybPutChar(char ch);                             // type char
 RET_TYPE usbKeybPutStr(char* string);                         // type string
 RET_TYPE usbRawHidRecv(uint8_t* buffer);                      // receive a packet, with timeout
 RET_TYPE usbRawHidSend(uint8_t* buffer);
 RET_TYPE usbHidSend(uint8_t cmd, const void *buffer, uint8_t buflen);
 RET_TYPE usbHidSend_P(uint8_t cmd, const void *buffer, uint8_t buflen);
+uint8_t usbRawHidTxQueueFree(void);                           // free raw hid tx queue slots
+void usbSetStatusEvents(uint8_t enable);                      // enable unsolicited status events
+uint8_t usbGetStatusEvents(void);                             // are status events enabled
 RET_TYPE usbKeyboardPress(uint8_t key, uint8_t modifier);     // send a keyboard press
 RET_TYPE usbPutstr(const char *str);
 RET_TYPE usbPutstr_P(const char *str);
@@ -34,11 +34,15 @@
 #include "watchdog_driver.h"
 #include "logic_smartcard.h"
 #include "usb_cmd_parser.h"
+#include "usb_cmd_stats.h"
+#include "usb_framing.h"
 #include "timer_manager.h"
 #include "oled_wrapper.h"
 #include "logic_eeprom.h"
 #include "hid_defines.h"
 #include "mini_inputs.h"
+#include <util/atomic.h>
+#include <util/crc16.h>
 #include <avr/eeprom.h>
 #include "mooltipass.h"
 #include "node_mgmt.h"
@@ -46,6 +50,7 @@
 #include <string.h>
 #include <ctype.h>
 #include <stdio.h>
+#include "interrupts.h"
 #include "delays.h"
 #include "utils.h"
 #include "stack.h"
@@ -58,10 +63,44 @@ uint8_t memoryManagementModeApproved = FALSE;
 uint8_t mediaFlashImportApproved = FALSE;
 // Current node we're writing
 uint16_t currentNodeWritten = NODE_ADDR_NULL;
+// Address & flags of the node currently written by a framed node batch
+uint8_t framedNodeHeader[4];
+// Status events not sent yet, may be set from interrupts
+volatile uint8_t statusEventsPending = 0;
+#ifdef DEV_PLUGIN_COMMS
+// Region currently exported by the export stream
+uint8_t exportStreamRegion = EXPORT_STREAM_NONE;
+// Number of packets the host allows us to send
+uint8_t exportStreamCredit;
+// Next flash page / eeprom address to export
+uint16_t exportStreamPage;
+// Next byte offset in the flash page
+uint16_t exportStreamOffset;
+// Number of bytes left to export
+uint32_t exportStreamRemaining;
+// CRC of the exported bytes
+uint16_t exportStreamCrc;
+#endif
 // Media flash import temp page
 uint16_t mediaFlashImportPage;
 // Media flash import temp offset
 uint16_t mediaFlashImportOffset;
+// Media import stream: flash internal buffer being filled
+uint8_t mediaImportStreamBuffer;
+// Media import stream: number of packets received
+uint16_t mediaImportStreamPackets;
+// Media import stream: CRC of the received bytes
+uint16_t mediaImportStreamCrc;
+#ifdef ENABLE_CMD_LATENCY_STATS
+// Command currently being processed
+uint8_t cmdStatsCurrentCmd = CMD_STATS_NO_CMD;
+// Time at which its processing started
+uint32_t cmdStatsStartTime;
+#endif
+#ifdef ENABLE_STACK_PROFILE
+// Command being processed, for the stack profile
+uint8_t stackProfileCmd = 0;
+#endif
 
 /*! \fn     checkMooltipassPassword(uint8_t* data)
 *   \brief  Check that the provided bytes is the mooltipass password
@@ -106,7 +145,246 @@ uint8_t checkMooltipassPassword(uint8_t* data, void* addr, uint8_t length)
 */
 void leaveMemoryManagementMode(void)
 {
+    if (memoryManagementModeApproved == TRUE)
+    {
+        usbPostStatusEvent(STATUS_EVENT_MEMMGMT_LEFT);
+    }
     memoryManagementModeApproved = FALSE;
+    usbFramedRxReset();
+}
+
+/*! \fn     usbPostStatusEvent(uint8_t event)
+*   \brief  Mark a status event to be sent to the host app, can be called from interrupts
+*   \param  event   STATUS_EVENT_xxx
+*   \note   Events are sent from usbProcessIncoming, only if the host app opted in
+*/
+void usbPostStatusEvent(uint8_t event)
+{
+    if (usbGetStatusEvents() == TRUE)
+    {
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+        {
+            statusEventsPending |= event;
+        }
+    }
+}
+
+#ifdef DEV_PLUGIN_COMMS
+/*! \fn     exportStreamTask(void)
+*   \brief  Send the next export stream packets, as long as we have credit and the USB TX queue isn't full
+*/
+static void exportStreamTask(void)
+{
+    uint8_t temp_buffer[PACKET_EXPORT_SIZE];
+    uint8_t chunk_size;
+    
+    if ((exportStreamCredit == 0) || (usbRawHidTxQueueFree() == 0))
+    {
+        return;
+    }
+    
+    // Continuous array read, only interrupted when we run out of credit or queue slots
+    if (exportStreamRegion == EXPORT_STREAM_FLASH)
+    {
+        flashStreamReadStartAtPage(exportStreamPage, exportStreamOffset);
+    }
+    while ((exportStreamRemaining != 0) && (exportStreamCredit != 0) && (usbRawHidTxQueueFree() != 0))
+    {
+        chunk_size = PACKET_EXPORT_SIZE;
+        if (exportStreamRemaining < PACKET_EXPORT_SIZE)
+        {
+            chunk_size = (uint8_t)exportStreamRemaining;
+        }
+        
+        if (exportStreamRegion == EXPORT_STREAM_FLASH)
+        {
+            flashStreamRead(temp_buffer, chunk_size);
+            exportStreamOffset += chunk_size;
+            if (exportStreamOffset >= BYTES_PER_PAGE)
+            {
+                exportStreamOffset -= BYTES_PER_PAGE;
+                exportStreamPage++;
+            }
+        } 
+        else
+        {
+            eeprom_read_block((void*)temp_buffer, (void*)exportStreamPage, chunk_size);
+            exportStreamPage += chunk_size;
+        }
+        
+        for (uint8_t i = 0; i < chunk_size; i++)
+        {
+            exportStreamCrc = _crc_ccitt_update(exportStreamCrc, temp_buffer[i]);
+        }
+        exportStreamRemaining -= chunk_size;
+        exportStreamCredit--;
+        usbHidSend(CMD_EXPORT_STREAM_DATA, temp_buffer, chunk_size);
+    }
+    if (exportStreamRegion == EXPORT_STREAM_FLASH)
+    {
+        flashStreamReadStop();
+    }
+    
+    // Export done, send the CRC
+    if (exportStreamRemaining == 0)
+    {
+        exportStreamRegion = EXPORT_STREAM_NONE;
+        usbSendMessage(CMD_EXPORT_STREAM_END, sizeof(exportStreamCrc), &exportStreamCrc);
+    }
+}
+#endif
+
+/*! \fn     getMooltipassStatus(uint8_t caller_id)
+*   \brief  Get the status byte sent in CMD_MOOLTIPASS_STATUS packets
+*   \param  caller_id   UID of the calling function
+*   \return The status byte
+*/
+static uint8_t getMooltipassStatus(uint8_t caller_id)
+{
+    uint8_t mp_status = 0x00;
+    
+    // Last bit: is card inserted
+    if (isSmartCardAbsent() == RETURN_NOK)
+    {
+        mp_status |= 0x01;
+    } 
+    // Unlocking screen
+    if (caller_id == USB_CALLER_PIN)
+    {
+        mp_status |= 0x02;
+    }
+    // Smartcard unlocked
+    if (getSmartCardInsertedUnlocked() == TRUE)
+    {
+        mp_status |= 0x04;
+    }
+    // Unknown card
+    if (getCurrentScreen() == SCREEN_DEFAULT_INSERTED_UNKNOWN)
+    {
+        mp_status |= 0x08;
+    }
+    return mp_status;
+}
+
+/*! \fn     writeFramedNodesPayload(uint8_t* payload, uint8_t length, uint16_t offset)
+*   \brief  Write a fragment of a CMD_WRITE_FLASH_NODES message: [address, node] records
+*   \param  payload         Fragment payload
+*   \param  length          Payload length
+*   \param  offset          Payload offset in the message
+*   \return RETURN_OK or RETURN_NOK if the user doesn't own a node
+*/
+static RET_TYPE writeFramedNodesPayload(uint8_t* payload, uint8_t length, uint16_t offset)
+{
+    uint8_t record_offset;
+    uint8_t chunk_size;
+    
+    while (length != 0)
+    {
+        record_offset = offset % FRAMED_NODE_REC_SIZ;
+        
+        if (record_offset < sizeof(framedNodeHeader))
+        {
+            // Node address and flags may span two fragments, gather them first
+            framedNodeHeader[record_offset] = *payload;
+            chunk_size = 1;
+            
+            if (record_offset == sizeof(framedNodeHeader) - 1)
+            {
+                //  Check user permissions
+                if (checkUserPermission(*(uint16_t*)framedNodeHeader) != RETURN_OK)
+                {
+                    currentNodeWritten = NODE_ADDR_NULL;
+                    return RETURN_NOK;
+                }
+                currentNodeWritten = *(uint16_t*)framedNodeHeader;
+                loadPageToInternalBuffer(pageNumberFromAddress(currentNodeWritten));
+                
+                // Set correct user ID
+                userIdToFlags((uint16_t*)&framedNodeHeader[2], getCurrentUserID());
+                flashWriteBuffer(&framedNodeHeader[2], NODE_SIZE * nodeNumberFromAddress(currentNodeWritten), 2);
+            }
+        }
+        else
+        {
+            // Fill the data at the right place
+            chunk_size = FRAMED_NODE_REC_SIZ - record_offset;
+            if (length < chunk_size)
+            {
+                chunk_size = length;
+            }
+            flashWriteBuffer(payload, (NODE_SIZE * nodeNumberFromAddress(currentNodeWritten)) + (record_offset - 2), chunk_size);
+            
+            // If we finished writing the node, flush buffer
+            if (record_offset + chunk_size == FRAMED_NODE_REC_SIZ)
+            {
+                flashWriteBufferToPage(pageNumberFromAddress(currentNodeWritten));
+                currentNodeWritten = NODE_ADDR_NULL;
+            }
+        }
+        
+        payload += chunk_size;
+        offset += chunk_size;
+        length -= chunk_size;
+    }
+    
+    return RETURN_OK;
+}
+
+/*! \fn     sendFramedNodes(uint16_t* addresses, uint8_t nb_nodes)
+*   \brief  Answer a CMD_READ_FLASH_NODES request: the nodes are sent in a framed message as they are read
+*   \param  addresses       Node addresses, permissions already checked
+*   \param  nb_nodes        Number of nodes
+*   \note   Not inlined: its node buffer and framing state only use the stack during this command
+*/
+static void sendFramedNodes(uint16_t* addresses, uint8_t nb_nodes) __attribute__((noinline));
+static void sendFramedNodes(uint16_t* addresses, uint8_t nb_nodes)
+{
+    uint8_t temp_buffer[NODE_SIZE];
+    usbFramedTx_t temp_tx;
+    
+    usbFramedTxStart(&temp_tx, CMD_READ_FLASH_NODES, (uint16_t)nb_nodes * NODE_SIZE);
+    for (uint8_t i = 0; i < nb_nodes; i++)
+    {
+        readNode((gNode*)temp_buffer, addresses[i]);
+        if (usbFramedTxAppend(&temp_tx, temp_buffer, NODE_SIZE) != RETURN_COM_TRANSF_OK)
+        {
+            break;
+        }
+    }
+}
+
+/*! \fn     sendMediaPageHashes(uint16_t page, uint8_t nb_pages)
+*   \brief  Answer a CMD_GET_MEDIA_PAGE_HASH request: one CRC32 per page in a framed message
+*   \param  page            First page, range already checked
+*   \param  nb_pages        Number of pages
+*   \note   CRC32 with the 0xEDB88320 reflected polynomial, as zlib.crc32: a changed page has a 1 in 2^32 chance to be missed
+*   \note   Not inlined: its framing state only uses the stack during this command
+*/
+static void sendMediaPageHashes(uint16_t page, uint8_t nb_pages) __attribute__((noinline));
+static void sendMediaPageHashes(uint16_t page, uint8_t nb_pages)
+{
+    usbFramedTx_t temp_tx;
+    uint32_t temp_crc;
+    uint8_t temp_byte;
+    
+    usbFramedTxStart(&temp_tx, CMD_GET_MEDIA_PAGE_HASH, (uint16_t)nb_pages * 4);
+    while (nb_pages--)
+    {
+        temp_crc = 0xFFFFFFFF;
+        flashStreamReadStartAtPage(page++, 0);
+        for (uint16_t i = 0; i < BYTES_PER_PAGE; i++)
+        {
+            flashStreamRead(&temp_byte, 1);
+            temp_crc ^= temp_byte;
+            for (uint8_t j = 0; j < 8; j++)
+            {
+                temp_crc = (temp_crc >> 1) ^ ((temp_crc & 1)? 0xEDB88320 : 0);
+            }
+        }
+        flashStreamReadStop();
+        temp_crc = ~temp_crc;
+        usbFramedTxAppend(&temp_tx, &temp_crc, 4);
+    }
 }
 
 /*! \fn     lowerCaseString(char* data)
@@ -122,6 +400,27 @@ void lowerCaseString(uint8_t* data)
     }
 }
 
+/*! \fn     appendCredentialField(usbFramedTx_t* tx, uint8_t status, char* field)
+*   \brief  Append a [status, string] field to a framed CMD_GET_CREDENTIAL answer
+*   \param  tx      Framed answer being sent
+*   \param  status  Plugin byte for this field
+*   \param  field   Null terminated string, only sent if status is OK
+*/
+static void appendCredentialField(usbFramedTx_t* tx, uint8_t status, char* field)
+{
+    usbFramedTxAppend(tx, &status, 1);
+    if (status == PLUGIN_BYTE_OK)
+    {
+        usbFramedTxAppend(tx, field, strlen(field) + 1);
+    }
+    else
+    {
+        // Empty string
+        status = 0;
+        usbFramedTxAppend(tx, &status, 1);
+    }
+}
+
 /*! \fn     checkTextField(uint8_t* data, uint8_t len)
 *   \brief  Check that the sent text is correct
 *   \param  data    Pointer to the data
@@ -147,21 +446,134 @@ RET_TYPE checkTextField(uint8_t* data, uint8_t len, uint8_t max_len)
     }
 }
 
-/*! \fn     usbProcessIncoming(uint8_t caller_id)
+/*! \fn     sendCredential(uint8_t* data, uint8_t datalen, uint8_t* buffer)
+*   \brief  Answer a CMD_GET_CREDENTIAL request with a framed message
+*   \param  data            Service name, optionally followed by the login
+*   \param  datalen         Request length
+*   \param  buffer          RAWHID_TX_SIZE bytes buffer for the password, may hold data as it is used after the context is set
+*   \return RETURN_NOK if the request is invalid and wasn't answered
+*   \note   Not inlined: its login and description buffers only use the stack during this command
+*/
+static RET_TYPE sendCredential(uint8_t* data, uint8_t datalen, uint8_t* buffer) __attribute__((noinline));
+static RET_TYPE sendCredential(uint8_t* data, uint8_t datalen, uint8_t* buffer)
+{
+    // Login request in the format expected by getLoginForContext, then login
+    uint8_t temp_login[RAWHID_RX_SIZE];
+    char temp_description[NODE_CHILD_SIZE_OF_DESCRIPTION];
+    uint8_t service_len, login_len;
+    uint8_t temp_status[4];
+    usbFramedTx_t temp_tx;
+    
+    // Service name, optionally followed by the login
+    if (memchr(data, 0, datalen) == 0)
+    {
+        return RETURN_NOK;
+    }
+    service_len = strlen((char*)data) + 1;
+    login_len = datalen - service_len;
+    if ((checkTextField(data, service_len, NODE_PARENT_SIZE_OF_SERVICE) == RETURN_NOK) || ((login_len != 0) && (checkTextField(data + service_len, login_len, NODE_CHILD_SIZE_OF_LOGIN) == RETURN_NOK)))
+    {
+        return RETURN_NOK;
+    }
+    temp_login[HID_LEN_FIELD] = login_len;
+    memcpy(temp_login + HID_DATA_START, data + service_len, login_len);
+    memset(temp_status, PLUGIN_BYTE_ERROR, sizeof(temp_status));
+    
+    // Same as CMD_CONTEXT
+    if (memoryManagementModeApproved == TRUE)
+    {
+        populateServicesLut();
+    }
+    if (getSmartCardInsertedUnlocked() != TRUE)
+    {
+        temp_status[0] = PLUGIN_BYTE_NOCARD;
+    }
+    else if (setCurrentContext(data, SERVICE_CRED_TYPE) == RETURN_OK)
+    {
+        temp_status[0] = PLUGIN_BYTE_OK;
+        
+        // Same as CMD_GET_LOGIN, CMD_GET_DESCRIPTION then CMD_GET_PASSWORD, the password decryption ending the credential validity
+        if (getLoginForContext((char*)temp_login) == RETURN_OK)
+        {
+            temp_status[1] = PLUGIN_BYTE_OK;
+            if (getDescriptionForContext(temp_description) == RETURN_OK)
+            {
+                temp_status[2] = PLUGIN_BYTE_OK;
+            }
+            if (getPasswordForContext((char*)buffer) == RETURN_OK)
+            {
+                temp_status[3] = PLUGIN_BYTE_OK;
+            }
+        }
+    }
+    
+    // Framed answer: [context status] [login status] [login] [description status] [description] [password status] [password]
+    usbFramedTxStart(&temp_tx, CMD_GET_CREDENTIAL, 4 + ((temp_status[1] == PLUGIN_BYTE_OK)? strlen((char*)temp_login) + 1 : 1) + ((temp_status[2] == PLUGIN_BYTE_OK)? strlen(temp_description) + 1 : 1) + ((temp_status[3] == PLUGIN_BYTE_OK)? strlen((char*)buffer) + 1 : 1));
+    usbFramedTxAppend(&temp_tx, temp_status, 1);
+    appendCredentialField(&temp_tx, temp_status[1], (char*)temp_login);
+    appendCredentialField(&temp_tx, temp_status[2], temp_description);
+    appendCredentialField(&temp_tx, temp_status[3], (char*)buffer);
+    USBPARSERDEBUGPRINTF_P(PSTR("get cred: %02x %02x %02x %02x\n"), temp_status[0], temp_status[1], temp_status[2], temp_status[3]);
+    return RETURN_OK;
+}
+
+/*! \fn     usbProcessIncomingMessage(uint8_t caller_id)
 *   \brief  Process a possible incoming USB packet
 *   \param  caller_id   UID of the calling function
 */
-void usbProcessIncoming(uint8_t caller_id)
+static void usbProcessIncomingMessage(uint8_t caller_id)
 {
     // Our USB data buffer
     uint8_t incomingData[RAWHID_TX_SIZE];
     
+    // Send pending status events: [events bitmask, status byte]
+    if (statusEventsPending != 0)
+    {
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+        {
+            incomingData[0] = statusEventsPending;
+            statusEventsPending = 0;
+        }
+        incomingData[1] = getMooltipassStatus(caller_id);
+        usbSendMessage(CMD_STATUS_EVENT, 2, incomingData);
+    }
+    
+    #ifdef DEV_PLUGIN_COMMS
+    // Continue a possible export stream
+    if (exportStreamRegion != EXPORT_STREAM_NONE)
+    {
+        exportStreamTask();
+    }
+    #endif
+    
     // Try to read data from USB, return if we didn't receive anything
     if(usbRawHidRecv(incomingData) != RETURN_COM_TRANSF_OK)
     {
         return;
     }
     
+    #ifdef ENABLE_CMD_LATENCY_STATS
+    // Start measuring the processing time, leaving our own command out
+    if (incomingData[HID_TYPE_FIELD] != CMD_GET_LATENCY_STATS)
+    {
+        cmdStatsCurrentCmd = incomingData[HID_TYPE_FIELD];
+        cmdStatsStartTime = micros();
+    }
+    #endif
+    
+    #ifdef ENABLE_FLASH_STATS
+    // Attribute the flash accesses to this command
+    flashStatsSetCmd(incomingData[HID_TYPE_FIELD]);
+    #endif
+    
+    #ifdef ENABLE_STACK_PROFILE
+    // Leave our own command out of the stack profile
+    if (incomingData[HID_TYPE_FIELD] != CMD_STACK_FREE)
+    {
+        stackProfileCmd = incomingData[HID_TYPE_FIELD];
+    }
+    #endif
+    
     // Temp plugin return value, error by default
     uint8_t plugin_return_value = PLUGIN_BYTE_ERROR;
 
@@ -185,27 +597,7 @@ void usbProcessIncoming(uint8_t caller_id)
     // Check if we're currently asking the user to enter his PIN or want to query the MP status
     if ((caller_id == USB_CALLER_PIN) || (datacmd == CMD_MOOLTIPASS_STATUS))
     {
-        uint8_t mp_status = 0x00;
-        // Last bit: is card inserted
-        if (isSmartCardAbsent() == RETURN_NOK)
-        {
-            mp_status |= 0x01;
-        } 
-        // Unlocking screen
-        if (caller_id == USB_CALLER_PIN)
-        {
-            mp_status |= 0x02;
-        }
-        // Smartcard unlocked
-        if (getSmartCardInsertedUnlocked() == TRUE)
-        {
-            mp_status |= 0x04;
-        }
-        // Unknown card
-        if (getCurrentScreen() == SCREEN_DEFAULT_INSERTED_UNKNOWN)
-        {
-            mp_status |= 0x08;
-        }
+        uint8_t mp_status = getMooltipassStatus(caller_id);
         // Inform the plugin to inform the user to unlock his card
         usbSendMessage(CMD_MOOLTIPASS_STATUS, 1, &mp_status);
         return;
@@ -248,7 +640,7 @@ void usbProcessIncoming(uint8_t caller_id)
     }
     
     // Check that we are in node mangement mode when needed
-    if ((datacmd >= FIRST_CMD_FOR_DATAMGMT) && (datacmd <= LAST_CMD_FOR_DATAMGMT) && (memoryManagementModeApproved == FALSE))
+    if ((((datacmd >= FIRST_CMD_FOR_DATAMGMT) && (datacmd <= LAST_CMD_FOR_DATAMGMT)) || (datacmd == CMD_READ_FLASH_NODES) || (datacmd == CMD_WRITE_FLASH_NODES)) && (memoryManagementModeApproved == FALSE))
     {
         // Return an error that was defined before (ERROR)
         usbSendMessage(datacmd, 1, &plugin_return_value);
@@ -382,6 +774,28 @@ void usbProcessIncoming(uint8_t caller_id)
             break;
         }
 
+        // opt in / out for unsolicited status events
+        case CMD_STATUS_EVENTS :
+        {
+            if ((datalen == 1) && (msg->body.data[0] <= TRUE))
+            {
+                usbSetStatusEvents(msg->body.data[0]);
+                statusEventsPending = 0;
+                plugin_return_value = PLUGIN_BYTE_OK;
+            }
+            break;
+        }
+
+        // set context, get login, description & password: framed answer
+        case CMD_GET_CREDENTIAL :
+        {
+            if (sendCredential(msg->body.data, datalen, incomingData) == RETURN_OK)
+            {
+                return;
+            }
+            break;
+        }
+
         // set login
         case CMD_SET_LOGIN :
         {
@@ -433,6 +847,28 @@ void usbProcessIncoming(uint8_t caller_id)
             break;
         }
 
+        // check several login / password pairs
+        case CMD_CHECK_PASSWORD_BATCH :
+        {
+            uint8_t temp_bitmap[(CHECK_PASSWORD_BATCH_MAX_PAIRS+7)/8];
+            
+            temp_rettype = checkPasswordBatchForContext(msg->body.data, datalen, temp_bitmap);
+            if (temp_rettype == RETURN_PASS_CHECK_OK)
+            {
+                usbSendMessage(CMD_CHECK_PASSWORD_BATCH, sizeof(temp_bitmap), temp_bitmap);
+                return;
+            }
+            else if (temp_rettype == RETURN_PASS_CHECK_NOK)
+            {
+                plugin_return_value = PLUGIN_BYTE_ERROR;
+            }
+            else
+            {
+                plugin_return_value = PLUGIN_BYTE_NA;
+            }
+            break;
+        }
+
         // Add credential context
         case CMD_ADD_CONTEXT :
         {
@@ -502,6 +938,33 @@ void usbProcessIncoming(uint8_t caller_id)
             }
             break;
         }
+        
+        // get the remaining 32B blocks of the current data node
+        case CMD_READ_NODE_IN_DN :
+        {
+            // First byte is the number of blocks still to come, then the block
+            uint8_t temp_block[1+DATA_NODE_BLOCK_SIZ];
+            
+            // The first block read triggers the user approval and the node decryption
+            if (get32BytesDataForCurrentService(&temp_block[1]) == RETURN_OK)
+            {
+                do
+                {
+                    temp_block[0] = getNbDataBlocksLeftInCurrentNode();
+                    usbSendMessage(CMD_READ_NODE_IN_DN, sizeof(temp_block), temp_block);
+                }
+                while ((temp_block[0] != 0) && (get32BytesDataForCurrentService(&temp_block[1]) == RETURN_OK));
+                memset((void*)temp_block, 0x00, sizeof(temp_block));
+                USBPARSERDEBUGPRINTF_P(PSTR("get data node: ok\n"));
+                return;
+            }
+            else
+            {
+                plugin_return_value = PLUGIN_BYTE_ERROR;
+                USBPARSERDEBUGPRINTF_P(PSTR("get data node: failed\n"));
+            }
+            break;
+        }
 #endif
         // Read user profile in flash
         case CMD_START_MEMORYMGMT :
@@ -822,12 +1285,85 @@ void usbProcessIncoming(uint8_t caller_id)
             break;
         }
 
+        // read several nodes, answer is a framed message
+        case CMD_READ_FLASH_NODES :
+        {
+            // Memory management mode check implemented before the switch
+            // Packet contains the node addresses
+            uint16_t* temp_node_addr_ptr = (uint16_t*)msg->body.data;
+            uint8_t nb_nodes = datalen / 2;
+            uint8_t i;
+            
+            if ((datalen == 0) || ((datalen & 0x01) != 0))
+            {
+                plugin_return_value = PLUGIN_BYTE_ERROR;
+                break;
+            }
+            
+            //  Check user permissions on all nodes before starting the answer
+            for (i = 0; i < nb_nodes; i++)
+            {
+                if (checkUserPermission(temp_node_addr_ptr[i]) != RETURN_OK)
+                {
+                    break;
+                }
+            }
+            
+            if (i == nb_nodes)
+            {
+                sendFramedNodes(temp_node_addr_ptr, nb_nodes);
+                return;
+            }
+            else
+            {
+                plugin_return_value = PLUGIN_BYTE_ERROR;
+            }
+            break;
+        }
+        
+        // write several nodes, request is a framed message
+        case CMD_WRITE_FLASH_NODES :
+        {
+            // Memory management mode check implemented before the switch
+            uint8_t* temp_payload;
+            uint8_t temp_payload_len;
+            uint16_t temp_offset;
+            uint8_t temp_framed_rx = usbFramedRxProcess(msg, &temp_payload, &temp_payload_len, &temp_offset);
+            
+            if (temp_framed_rx == FRAMED_RX_IGNORE)
+            {
+                // Leftovers of a message we already answered to
+                return;
+            }
+            else if ((temp_framed_rx != FRAMED_RX_ERROR) && (writeFramedNodesPayload(temp_payload, temp_payload_len, temp_offset) == RETURN_OK))
+            {
+                if (temp_framed_rx == FRAMED_RX_PART)
+                {
+                    // Only answer once the whole message is received
+                    return;
+                }
+                else if (((temp_offset + temp_payload_len) % FRAMED_NODE_REC_SIZ) == 0)
+                {
+                    plugin_return_value = PLUGIN_BYTE_OK;
+                }
+            }
+            else
+            {
+                // Drop the remaining fragments
+                usbFramedRxReset();
+            }
+            break;
+        }
+
         // import media flash contents
         case CMD_IMPORT_MEDIA_START :
         {            
             // Set default addresses
             mediaFlashImportPage = GRAPHIC_ZONE_PAGE_START;
             mediaFlashImportOffset = 0;
+            mediaImportStreamBuffer = 1;
+            mediaImportStreamPackets = 0;
+            mediaImportStreamCrc = 0xFFFF;
             
             // No check if dev comms
             #if defined(DEV_PLUGIN_COMMS) || defined(AVR_BOOTLOADER_PROGRAMMING)
@@ -883,6 +1419,182 @@ void usbProcessIncoming(uint8_t caller_id)
             break;
         }
 
+        // import media flash contents, pipelined: a flash buffer is filled while the other one is programmed
+        case CMD_IMPORT_MEDIA_STREAM :
+        {
+            uint8_t* temp_data_ptr = msg->body.data;
+            uint8_t temp_remaining = datalen;
+            uint16_t temp_chunk_size;
+            
+            // Packets of a refused import aren't answered, the error is reported at the end
+            if (mediaFlashImportApproved == FALSE)
+            {
+                return;
+            }
+            
+            // Check that we don't go over the flash boundaries, a packet can span two pages
+            if ((datalen > PACKET_EXPORT_SIZE) || (mediaFlashImportPage >= GRAPHIC_ZONE_PAGE_END) || ((mediaFlashImportOffset + datalen > BYTES_PER_PAGE) && (mediaFlashImportPage + 1 >= GRAPHIC_ZONE_PAGE_END)))
+            {
+                mediaFlashImportApproved = FALSE;
+                break;
+            }
+            
+            for (uint8_t i = 0; i < datalen; i++)
+            {
+                mediaImportStreamCrc = _crc_ccitt_update(mediaImportStreamCrc, msg->body.data[i]);
+            }
+            
+            while (temp_remaining != 0)
+            {
+                temp_chunk_size = BYTES_PER_PAGE - mediaFlashImportOffset;
+                if (temp_remaining < temp_chunk_size)
+                {
+                    temp_chunk_size = temp_remaining;
+                }
+                flashWriteBufferNb(mediaImportStreamBuffer, temp_data_ptr, mediaFlashImportOffset, temp_chunk_size);
+                mediaFlashImportOffset += temp_chunk_size;
+                temp_data_ptr += temp_chunk_size;
+                temp_remaining -= temp_chunk_size;
+                
+                // If we just filled a page, start programming it and switch to the other buffer
+                if (mediaFlashImportOffset == BYTES_PER_PAGE)
+                {
+                    flashStartBufferToPage(mediaImportStreamBuffer, mediaFlashImportPage);
+                    #if FLASH_NB_BUFFERS == 2
+                    mediaImportStreamBuffer = (mediaImportStreamBuffer == 1)? 2 : 1;
+                    #endif
+                    mediaFlashImportOffset = 0;
+                    mediaFlashImportPage++;
+                }
+            }
+            
+            // Windowed acks: [0x01, number of packets received]
+            if ((++mediaImportStreamPackets % MEDIA_IMPORT_ACK_WINDOW) == 0)
+            {
+                incomingData[0] = PLUGIN_BYTE_OK;
+                incomingData[1] = (uint8_t)mediaImportStreamPackets;
+                incomingData[2] = (uint8_t)(mediaImportStreamPackets >> 8);
+                usbSendMessage(CMD_IMPORT_MEDIA_STREAM, 3, incomingData);
+            }
+            return;
+        }
+
+        // get the CRC32s of graphics zone pages: [first page (2 bytes), number of pages]
+        case CMD_GET_MEDIA_PAGE_HASH :
+        {
+            uint16_t temp_offset = msg->body.data[0] | ((uint16_t)msg->body.data[1] << 8);
+            
+            // Only during an approved media import, range checked before it is turned into a page number
+            if ((mediaFlashImportApproved == FALSE) || (datalen != 3) || (msg->body.data[2] == 0) || (temp_offset >= GRAPHIC_ZONE_PAGE_END - GRAPHIC_ZONE_PAGE_START) || (msg->body.data[2] > GRAPHIC_ZONE_PAGE_END - GRAPHIC_ZONE_PAGE_START - temp_offset))
+            {
+                break;
+            }
+            sendMediaPageHashes(GRAPHIC_ZONE_PAGE_START + temp_offset, msg->body.data[2]);
+            return;
+        }
+        
+        // get the CRC16 of a range of graphics zone pages: [first page (2 bytes), number of pages (2 bytes)]
+        case CMD_GET_MEDIA_ZONE_CRC :
+        {
+            uint16_t temp_offset = msg->body.data[0] | ((uint16_t)msg->body.data[1] << 8);
+            uint16_t temp_nb_pages = msg->body.data[2] | ((uint16_t)msg->body.data[3] << 8);
+            uint16_t temp_crc = 0xFFFF;
+            uint8_t temp_byte;
+            
+            if ((mediaFlashImportApproved == FALSE) || (datalen != 4) || (temp_nb_pages == 0) || (temp_offset >= GRAPHIC_ZONE_PAGE_END - GRAPHIC_ZONE_PAGE_START) || (temp_nb_pages > GRAPHIC_ZONE_PAGE_END - GRAPHIC_ZONE_PAGE_START - temp_offset))
+            {
+                break;
+            }
+            
+            // Independent from the page CRC32s used to select the pages to send, checks the result of a differential import
+            flashStreamReadStartAtPage(GRAPHIC_ZONE_PAGE_START + temp_offset, 0);
+            for (uint32_t i = 0; i < (uint32_t)temp_nb_pages * BYTES_PER_PAGE; i++)
+            {
+                flashStreamRead(&temp_byte, 1);
+                temp_crc = _crc_ccitt_update(temp_crc, temp_byte);
+            }
+            flashStreamReadStop();
+            usbSendMessage(CMD_GET_MEDIA_ZONE_CRC, 2, &temp_crc);
+            return;
+        }
+        
+        // import a single graphics zone page, framed request: [page (2 bytes), page contents]
+        case CMD_IMPORT_MEDIA_PAGE :
+        {
+            uint8_t* temp_payload;
+            uint8_t temp_payload_len;
+            uint16_t temp_offset;
+            uint8_t temp_framed_rx = usbFramedRxProcess(msg, &temp_payload, &temp_payload_len, &temp_offset);
+            
+            if (temp_framed_rx == FRAMED_RX_IGNORE)
+            {
+                // Leftovers of a message we already answered to
+                return;
+            }
+            
+            // The page number is in the first fragment, which is always full
+            if ((temp_framed_rx != FRAMED_RX_ERROR) && (temp_offset == 0) && (temp_payload_len >= 2))
+            {
+                // Range checked before it is turned into a page number
+                mediaFlashImportPage = temp_payload[0] | ((uint16_t)temp_payload[1] << 8);
+                if (mediaFlashImportPage >= GRAPHIC_ZONE_PAGE_END - GRAPHIC_ZONE_PAGE_START)
+                {
+                    mediaFlashImportApproved = FALSE;
+                }
+                mediaFlashImportPage += GRAPHIC_ZONE_PAGE_START;
+                temp_payload += 2;
+                temp_payload_len -= 2;
+                temp_offset = 2;
+            }
+            
+            if ((temp_framed_rx == FRAMED_RX_ERROR) || (mediaFlashImportApproved == FALSE) || (temp_offset < 2) || (temp_offset - 2 + temp_payload_len > BYTES_PER_PAGE))
+            {
+                usbFramedRxReset();
+                mediaFlashImportApproved = FALSE;
+                break;
+            }
+            
+            // Fill the buffer, program the page once complete while the other buffer takes the next page
+            flashWriteBufferNb(mediaImportStreamBuffer, temp_payload, temp_offset - 2, temp_payload_len);
+            if (temp_framed_rx == FRAMED_RX_PART)
+            {
+                return;
+            }
+            else if (temp_offset - 2 + temp_payload_len == BYTES_PER_PAGE)
+            {
+                flashStartBufferToPage(mediaImportStreamBuffer, mediaFlashImportPage);
+                #if FLASH_NB_BUFFERS == 2
+                mediaImportStreamBuffer = (mediaImportStreamBuffer == 1)? 2 : 1;
+                #endif
+                plugin_return_value = PLUGIN_BYTE_OK;
+            }
+            else
+            {
+                mediaFlashImportApproved = FALSE;
+            }
+            break;
+        }
+
+        // end pipelined media flash import: check the CRC
+        case CMD_IMPORT_MEDIA_STREAM_END :
+        {
+            if ((mediaFlashImportApproved == FALSE) || (datalen != 2) || ((msg->body.data[0] | ((uint16_t)msg->body.data[1] << 8)) != mediaImportStreamCrc))
+            {
+                mediaFlashImportApproved = FALSE;
+                waitForFlash();
+                break;
+            }
+            
+            // Program the last page, then end the import as CMD_IMPORT_MEDIA_END does
+            if (mediaFlashImportOffset != 0)
+            {
+                flashStartBufferToPage(mediaImportStreamBuffer, mediaFlashImportPage);
+                mediaFlashImportOffset = 0;
+            }
+            waitForFlash();
+        }
+        // no break
+
         // end media flash import
         case CMD_IMPORT_MEDIA_END :
         {
@@ -893,6 +1605,9 @@ void usbProcessIncoming(uint8_t caller_id)
             plugin_return_value = PLUGIN_BYTE_OK;
             mediaFlashImportApproved = FALSE;
             
+            // The keyboard LUTs may have changed
+            usbKeybLoadParameters();
+            
             #if defined(MINI_PREPRODUCTION_SETUP) || defined(MINI_PREPRODUCTION_SETUP_ACC)
             // At the end of the import media command if the security is set in place, we start the bootloader
             if (eeprom_read_byte((uint8_t*)EEP_BOOT_PWD_SET) == BOOTLOADER_PWDOK_KEY)
@@ -918,6 +1633,7 @@ void usbProcessIncoming(uint8_t caller_id)
                 // Set correct value in eeprom and refresh parameters that need refreshing
                 setMooltipassParameterInEeprom(msg->body.data[0], msg->body.data[1]);
                 mp_timeout_enabled = getMooltipassParameterInEeprom(LOCK_TIMEOUT_ENABLE_PARAM);
+                usbKeybLoadParameters();
                 plugin_return_value = PLUGIN_BYTE_OK;
                 //initTouchSensing();
                 //launchCalibrationCycle();
@@ -1293,8 +2009,84 @@ void usbProcessIncoming(uint8_t caller_id)
         case CMD_STACK_FREE:
         {
             uint16_t freebytes = stackFree();
-            usbSendMessage(CMD_STACK_FREE, sizeof(freebytes), &freebytes);
-            return;
+            
+            if (datalen == 0)
+            {
+                usbSendMessage(CMD_STACK_FREE, sizeof(freebytes), &freebytes);
+                return;
+            }
+            #ifdef ENABLE_STACK_PROFILE
+            else if ((datalen == 1) && (msg->body.data[0] == STACK_PROFILE_RESET))
+            {
+                stackProfileReset();
+                plugin_return_value = PLUGIN_BYTE_OK;
+            }
+            else if ((datalen == 1) && (msg->body.data[0] == STACK_PROFILE_GET))
+            {
+                uint16_t stacksize = stackSize();
+                
+                // Answer: [stack size, free bytes, command entries, screen entries]
+                memcpy((void*)&incomingData[0], (void*)&stacksize, sizeof(stacksize));
+                memcpy((void*)&incomingData[2], (void*)&freebytes, sizeof(freebytes));
+                memcpy((void*)&incomingData[4], (void*)stackProfileGet(STACK_PROFILE_CMD), STACK_PROFILE_NB_SLOTS*sizeof(stackProfileEntry_t));
+                memcpy((void*)&incomingData[4 + STACK_PROFILE_NB_SLOTS*sizeof(stackProfileEntry_t)], (void*)stackProfileGet(STACK_PROFILE_SCREEN), STACK_PROFILE_NB_SLOTS*sizeof(stackProfileEntry_t));
+                usbSendMessage(CMD_STACK_FREE, 4 + 2*STACK_PROFILE_NB_SLOTS*sizeof(stackProfileEntry_t), incomingData);
+                return;
+            }
+            #endif
+            break;
+        }
+#endif
+
+        // Command latency statistics
+#ifdef ENABLE_CMD_LATENCY_STATS
+        case CMD_GET_LATENCY_STATS:
+        {
+            cmdStats_t* stats = cmdStatsGetSlot(msg->body.data[0]);
+            uint16_t overflow = cmdStatsGetOverflow();
+            
+            if ((datalen == 1) && (msg->body.data[0] == CMD_STATS_RESET))
+            {
+                cmdStatsReset();
+                plugin_return_value = PLUGIN_BYTE_OK;
+            }
+            else if ((datalen == 1) && (stats != 0))
+            {
+                // Answer: [nb slots, overflow count, slot contents]
+                incomingData[0] = CMD_STATS_NB_SLOTS;
+                memcpy((void*)&incomingData[1], (void*)&overflow, sizeof(overflow));
+                memcpy((void*)&incomingData[3], (void*)stats, sizeof(cmdStats_t));
+                usbSendMessage(CMD_GET_LATENCY_STATS, 3 + sizeof(cmdStats_t), incomingData);
+                return;
+            }
+            break;
+        }
+#endif
+
+        // Flash activity counters and trace
+#ifdef ENABLE_FLASH_STATS
+        case CMD_GET_FLASH_STATS:
+        {
+            if ((datalen == 1) && (msg->body.data[0] == FLASH_STATS_RESET))
+            {
+                flashStatsReset();
+                plugin_return_value = PLUGIN_BYTE_OK;
+            }
+            else if ((datalen == 1) && (msg->body.data[0] == FLASH_STATS_COUNTERS))
+            {
+                usbSendMessage(CMD_GET_FLASH_STATS, sizeof(flashStats_t), (void*)flashStatsGet());
+                return;
+            }
+            else if ((datalen == 1) && (msg->body.data[0] == FLASH_STATS_TRACE))
+            {
+                // Answer: [nb entries, dropped entries count, oldest entries]
+                uint16_t dropped = flashTraceGetDropped();
+                incomingData[0] = flashTraceRead((flashTraceEntry_t*)&incomingData[3], (PACKET_EXPORT_SIZE-3)/sizeof(flashTraceEntry_t));
+                memcpy((void*)&incomingData[1], (void*)&dropped, sizeof(dropped));
+                usbSendMessage(CMD_GET_FLASH_STATS, 3 + incomingData[0]*sizeof(flashTraceEntry_t), incomingData);
+                return;
+            }
+            break;
         }
 #endif
 
@@ -1309,6 +2101,54 @@ void usbProcessIncoming(uint8_t caller_id)
             break;
         }
 
+        // start streaming the flash or eeprom contents: [region, initial credit]
+        case CMD_EXPORT_STREAM_START :
+        {
+            if ((datalen == 2) && ((msg->body.data[0] == EXPORT_STREAM_FLASH) || (msg->body.data[0] == EXPORT_STREAM_EEPROM)))
+            {
+                exportStreamRegion = msg->body.data[0];
+                exportStreamCredit = msg->body.data[1];
+                exportStreamPage = 0;
+                exportStreamOffset = 0;
+                exportStreamCrc = 0xFFFF;
+                if (exportStreamRegion == EXPORT_STREAM_FLASH)
+                {
+                    exportStreamRemaining = (uint32_t)PAGE_COUNT * BYTES_PER_PAGE;
+                } 
+                else
+                {
+                    exportStreamRemaining = EEPROM_SIZE;
+                }
+                plugin_return_value = PLUGIN_BYTE_OK;
+            }
+            break;
+        }
+
+        // more credit for the export stream, not answered
+        case CMD_EXPORT_STREAM_DATA :
+        {
+            if ((datalen == 1) && (exportStreamRegion != EXPORT_STREAM_NONE))
+            {
+                if (exportStreamCredit > 0xFF - msg->body.data[0])
+                {
+                    exportStreamCredit = 0xFF;
+                } 
+                else
+                {
+                    exportStreamCredit += msg->body.data[0];
+                }
+            }
+            return;
+        }
+
+        // abort the export stream
+        case CMD_EXPORT_STREAM_END :
+        {
+            exportStreamRegion = EXPORT_STREAM_NONE;
+            plugin_return_value = PLUGIN_BYTE_OK;
+            break;
+        }
+
         // erase flash
         case CMD_ERASE_FLASH :
         {
@@ -1414,3 +2254,48 @@ void usbProcessIncoming(uint8_t caller_id)
     usbSendMessage(datacmd, 1, &plugin_return_value);
 }
 
+
+/*! \fn     usbProcessIncoming(uint8_t caller_id)
+*   \brief  Process a possible incoming USB packet
+*   \param  caller_id   UID of the calling function
+*/
+void usbProcessIncoming(uint8_t caller_id)
+{
+    #ifdef ENABLE_FLASH_STATS
+    // Flash accesses made after a nested command go to the outer one again
+    uint8_t outer_flash_cmd = flashStatsGetCmd();
+    #endif
+    
+    #ifdef ENABLE_STACK_PROFILE
+    // Paint the stack below us to measure the usage of the command we may receive
+    uint8_t outer_stack_cmd = stackProfileCmd;
+    uint8_t* outer_stack_low = stackProfileStart();
+    stackProfileCmd = 0;
+    #endif
+    
+    #ifdef ENABLE_CMD_LATENCY_STATS
+    // We may be called while processing another command (PIN entry, confirmations...), keep its measurement
+    uint8_t outer_cmd = cmdStatsCurrentCmd;
+    uint32_t outer_start_time = cmdStatsStartTime;
+    
+    cmdStatsCurrentCmd = CMD_STATS_NO_CMD;
+    usbProcessIncomingMessage(caller_id);
+    if (cmdStatsCurrentCmd != CMD_STATS_NO_CMD)
+    {
+        cmdStatsRecord(cmdStatsCurrentCmd, micros() - cmdStatsStartTime);
+    }
+    cmdStatsCurrentCmd = outer_cmd;
+    cmdStatsStartTime = outer_start_time;
+    #else
+    usbProcessIncomingMessage(caller_id);
+    #endif
+    
+    #ifdef ENABLE_FLASH_STATS
+    flashStatsSetCmd(outer_flash_cmd);
+    #endif
+    
+    #ifdef ENABLE_STACK_PROFILE
+    stackProfileStop(outer_stack_low, (stackProfileCmd != 0)? STACK_PROFILE_CMD : STACK_PROFILE_NONE, stackProfileCmd);
+    stackProfileCmd = outer_stack_cmd;
+    #endif
+}
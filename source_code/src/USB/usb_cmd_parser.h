@@ -91,6 +91,23 @@
 /******* COMMANDS ADDED AFTER v1 firmware *******/
 #define CMD_GET_DESCRIPTION     0xD4
 #define CMD_UNLOCK_WITH_PIN     0xD5
+#define CMD_READ_NODE_IN_DN     0xD6
+#define CMD_CHECK_PASSWORD_BATCH 0xD7
+#define CMD_READ_FLASH_NODES    0xD8    // framed answer, see usb_framing.h
+#define CMD_WRITE_FLASH_NODES   0xD9    // framed request, see usb_framing.h
+#define CMD_GET_CREDENTIAL      0xDA    // framed answer, see usb_framing.h
+#define CMD_STATUS_EVENTS       0xDB
+#define CMD_STATUS_EVENT        0xDC    // unsolicited, only sent after opt-in with CMD_STATUS_EVENTS
+#define CMD_EXPORT_STREAM_START 0xDD    // development builds only
+#define CMD_EXPORT_STREAM_DATA  0xDE    // resp: data packets within the credit granted by the host
+#define CMD_EXPORT_STREAM_END   0xDF    // resp: CRC of the exported data
+#define CMD_IMPORT_MEDIA_STREAM 0xE0    // resp: ack every MEDIA_IMPORT_ACK_WINDOW packets
+#define CMD_IMPORT_MEDIA_STREAM_END 0xE1
+#define CMD_GET_MEDIA_PAGE_HASH 0xE2    // framed answer, see usb_framing.h
+#define CMD_IMPORT_MEDIA_PAGE   0xE3    // framed request, see usb_framing.h
+#define CMD_GET_LATENCY_STATS   0xE4    // only with ENABLE_CMD_LATENCY_STATS
+#define CMD_GET_FLASH_STATS     0xE5    // only with ENABLE_FLASH_STATS
+#define CMD_GET_MEDIA_ZONE_CRC  0xE6
 
 
 /* Packet format defines     */
@@ -104,9 +121,25 @@
 #define PLUGIN_BYTE_NA      0x02
 #define PLUGIN_BYTE_NOCARD  0x03
 
+/* Status events, bitmask in CMD_STATUS_EVENT packets */
+#define STATUS_EVENT_CARD_INSERTED  0x01
+#define STATUS_EVENT_CARD_REMOVED   0x02
+#define STATUS_EVENT_UNLOCKED       0x04
+#define STATUS_EVENT_LOCKED         0x08
+#define STATUS_EVENT_MEMMGMT_LEFT   0x10
+
+/* Export stream regions */
+#define EXPORT_STREAM_NONE          0x00
+#define EXPORT_STREAM_FLASH         0x01
+#define EXPORT_STREAM_EEPROM        0x02
+
+/* Media import stream */
+#define MEDIA_IMPORT_ACK_WINDOW     8
+
 /* Packet defines */
 #define PACKET_EXPORT_SIZE  (RAWHID_TX_SIZE-HID_DATA_START)
 #define DATA_NODE_BLOCK_SIZ 32
+#define FRAMED_NODE_REC_SIZ (2 + NODE_SIZE)
 
 /* function caller IDs */
 #define USB_CALLER_MAIN     0x00
@@ -135,5 +168,6 @@ typedef struct
 RET_TYPE checkTextField(uint8_t* data, uint8_t len, uint8_t max_len);
 void usbProcessIncoming(uint8_t caller_id);
 void leaveMemoryManagementMode(void);
+void usbPostStatusEvent(uint8_t event);
 
 #endif
@@ -0,0 +1,129 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     usb_cmd_stats.c
+*    \brief    Per command latency statistics
+*    Created:  19/10/2026
+*/
+#include "usb_cmd_stats.h"
+#include <string.h>
+
+#ifdef ENABLE_CMD_LATENCY_STATS
+// Statistics slots
+static cmdStats_t cmd_stats[CMD_STATS_NB_SLOTS];
+// Number of commands that couldn't be recorded as all slots were taken
+static uint16_t cmd_stats_overflow = 0;
+
+
+/*! \fn     cmdStatsRecord(uint8_t cmd, uint32_t duration)
+*   \brief  Record the processing time of a command
+*   \param  cmd         Command ID
+*   \param  duration    Processing time in us
+*/
+void cmdStatsRecord(uint8_t cmd, uint32_t duration)
+{
+    cmdStats_t* stats = 0;
+    uint32_t bucket_limit = duration >> CMD_STATS_FIRST_SHIFT;
+    uint8_t bucket = 0;
+    
+    // Find the slot for this command, or the first free one
+    for (uint8_t i = 0; i < CMD_STATS_NB_SLOTS; i++)
+    {
+        if ((cmd_stats[i].cmd == cmd) || (cmd_stats[i].cmd == CMD_STATS_NO_CMD))
+        {
+            stats = &cmd_stats[i];
+            break;
+        }
+    }
+    
+    // All slots taken
+    if (stats == 0)
+    {
+        if (cmd_stats_overflow != UINT16_MAX)
+        {
+            cmd_stats_overflow++;
+        }
+        return;
+    }
+    
+    // First occurrence
+    if (stats->cmd == CMD_STATS_NO_CMD)
+    {
+        stats->cmd = cmd;
+        stats->min_time = UINT32_MAX;
+    }
+    
+    // Log scale bucket
+    while ((bucket_limit != 0) && (bucket < CMD_STATS_NB_BUCKETS - 1))
+    {
+        bucket_limit >>= CMD_STATS_BUCKET_SHIFT;
+        bucket++;
+    }
+    
+    // Counters saturate instead of wrapping
+    if (stats->count != UINT16_MAX)
+    {
+        stats->count++;
+    }
+    if (stats->buckets[bucket] != UINT16_MAX)
+    {
+        stats->buckets[bucket]++;
+    }
+    if (duration < stats->min_time)
+    {
+        stats->min_time = duration;
+    }
+    if (duration > stats->max_time)
+    {
+        stats->max_time = duration;
+    }
+}
+
+/*! \fn     cmdStatsGetSlot(uint8_t slot)
+*   \brief  Get the statistics stored in a given slot
+*   \param  slot    Slot index
+*   \return Pointer to the slot, 0 if the index is out of range
+*/
+cmdStats_t* cmdStatsGetSlot(uint8_t slot)
+{
+    if (slot >= CMD_STATS_NB_SLOTS)
+    {
+        return 0;
+    }
+    return &cmd_stats[slot];
+}
+
+/*! \fn     cmdStatsGetOverflow(void)
+*   \brief  Get the number of commands that weren't recorded because all slots were taken
+*   \return Number of commands
+*/
+uint16_t cmdStatsGetOverflow(void)
+{
+    return cmd_stats_overflow;
+}
+
+/*! \fn     cmdStatsReset(void)
+*   \brief  Clear all the statistics
+*/
+void cmdStatsReset(void)
+{
+    memset((void*)cmd_stats, 0, sizeof(cmd_stats));
+    cmd_stats_overflow = 0;
+}
+#endif
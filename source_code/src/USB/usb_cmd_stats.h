@@ -0,0 +1,63 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     usb_cmd_stats.h
+*    \brief    Per command latency statistics
+*    Created:  19/10/2026
+*/
+
+#ifndef USB_CMD_STATS_H_
+#define USB_CMD_STATS_H_
+
+#include "defines.h"
+#include <stdint.h>
+
+#ifdef ENABLE_CMD_LATENCY_STATS
+
+/*** DEFINES ***/
+// Number of command IDs tracked, taken in order of first use
+#define CMD_STATS_NB_SLOTS      8
+// Histogram buckets: < 256us, then x4 for each bucket (1ms, 4ms, 16ms, 65ms, 262ms, 1s), last one is everything above
+#define CMD_STATS_NB_BUCKETS    8
+#define CMD_STATS_FIRST_SHIFT   8
+#define CMD_STATS_BUCKET_SHIFT  2
+// Command ID for a free slot / no command being measured
+#define CMD_STATS_NO_CMD        0x00
+// CMD_GET_LATENCY_STATS argument to clear the statistics
+#define CMD_STATS_RESET         0xFF
+
+/*** STRUCTS ***/
+typedef struct
+{
+    uint8_t cmd;
+    uint16_t count;
+    uint32_t min_time;
+    uint32_t max_time;
+    uint16_t buckets[CMD_STATS_NB_BUCKETS];
+} cmdStats_t;
+
+/*** PROTOTYPES ***/
+void cmdStatsRecord(uint8_t cmd, uint32_t duration);
+cmdStats_t* cmdStatsGetSlot(uint8_t slot);
+uint16_t cmdStatsGetOverflow(void);
+void cmdStatsReset(void);
+
+#endif
+
+#endif /* USB_CMD_STATS_H_ */
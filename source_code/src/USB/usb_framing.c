@@ -0,0 +1,184 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     usb_framing.c
+*    \brief    Multi-packet message framing for the raw HID protocol
+*    Created:  19/10/2026
+*/
+#include "usb_framing.h"
+#include <string.h>
+#include "usb.h"
+
+/* Framed message currently being received */
+static uint8_t framed_rx_cmd = 0;
+static uint8_t framed_rx_next_seq = 0;
+static uint16_t framed_rx_total_length = 0;
+static uint16_t framed_rx_offset = 0;
+
+
+/*! \fn     usbFramedNextSeq(uint8_t seq)
+*   \brief  Get the sequence number following a given one (0 is only used for the first fragment)
+*   \param  seq     Current sequence number
+*   \return The next sequence number
+*/
+static inline uint8_t usbFramedNextSeq(uint8_t seq)
+{
+    if (seq == 0xFF)
+    {
+        return 1;
+    } 
+    else
+    {
+        return seq + 1;
+    }
+}
+
+/*! \fn     usbFramedRxReset(void)
+*   \brief  Drop the framed message currently being received
+*/
+void usbFramedRxReset(void)
+{
+    framed_rx_cmd = 0;
+    framed_rx_total_length = 0;
+}
+
+/*! \fn     usbFramedRxProcess(usbMsg_t* msg, uint8_t** payload, uint8_t* payload_len, uint16_t* offset)
+*   \brief  Process a received fragment of a framed message
+*   \param  msg         Received packet
+*   \param  payload     Where to store the pointer to the fragment payload
+*   \param  payload_len Where to store the fragment payload length
+*   \param  offset      Where to store the fragment payload offset inside the message
+*   \return FRAMED_RX_PART/LAST when the payload should be consumed, FRAMED_RX_ERROR if the message is invalid (answer needed), FRAMED_RX_IGNORE for leftovers of a dropped message (no answer)
+*   \note   Payloads are handed over as they arrive, there is no reassembly buffer
+*/
+uint8_t usbFramedRxProcess(usbMsg_t* msg, uint8_t** payload, uint8_t* payload_len, uint16_t* offset)
+{
+    uint8_t seq = msg->body.data[FRAMED_SEQ_FIELD];
+    uint16_t total_length = msg->body.data[FRAMED_LENGTH_FIELD] | ((uint16_t)msg->body.data[FRAMED_LENGTH_FIELD+1] << 8);
+    uint8_t fragment_length;
+    
+    // Fragment without a complete header
+    if ((msg->len <= FRAMED_HEADER_SIZE) || (msg->len > PACKET_EXPORT_SIZE))
+    {
+        usbFramedRxReset();
+        return FRAMED_RX_ERROR;
+    }
+    fragment_length = msg->len - FRAMED_HEADER_SIZE;
+    
+    if (seq == 0)
+    {
+        // First fragment: (re)start reception
+        framed_rx_cmd = msg->cmd;
+        framed_rx_next_seq = 0;
+        framed_rx_total_length = total_length;
+        framed_rx_offset = 0;
+    }
+    else if ((framed_rx_total_length == 0) || (framed_rx_cmd != msg->cmd))
+    {
+        // Remaining fragments of a message we already answered to
+        return FRAMED_RX_IGNORE;
+    }
+    
+    // Check the fragment continues the current message
+    if ((seq != framed_rx_next_seq) || (total_length != framed_rx_total_length) || (framed_rx_offset + fragment_length > framed_rx_total_length))
+    {
+        usbFramedRxReset();
+        return FRAMED_RX_ERROR;
+    }
+    
+    *payload = msg->body.data + FRAMED_HEADER_SIZE;
+    *payload_len = fragment_length;
+    *offset = framed_rx_offset;
+    framed_rx_offset += fragment_length;
+    framed_rx_next_seq = usbFramedNextSeq(seq);
+    
+    if (framed_rx_offset == framed_rx_total_length)
+    {
+        usbFramedRxReset();
+        return FRAMED_RX_LAST;
+    } 
+    else
+    {
+        return FRAMED_RX_PART;
+    }
+}
+
+/*! \fn     usbFramedTxStart(usbFramedTx_t* tx, uint8_t cmd, uint16_t length)
+*   \brief  Start sending a framed message, fragments are sent as the payload is appended
+*   \param  tx      Transmit context, usually on the caller stack
+*   \param  cmd     Command ID
+*   \param  length  Total message length, non zero
+*/
+void usbFramedTxStart(usbFramedTx_t* tx, uint8_t cmd, uint16_t length)
+{
+    tx->cmd = cmd;
+    tx->seq = 0;
+    tx->remaining = length;
+    tx->fill = FRAMED_HEADER_SIZE;
+    tx->fragment[FRAMED_SEQ_FIELD] = 0;
+    tx->fragment[FRAMED_LENGTH_FIELD] = (uint8_t)length;
+    tx->fragment[FRAMED_LENGTH_FIELD+1] = (uint8_t)(length >> 8);
+}
+
+/*! \fn     usbFramedTxAppend(usbFramedTx_t* tx, const void* data, uint16_t size)
+*   \brief  Append payload to a framed message, sending each fragment once full
+*   \param  tx      Transmit context
+*   \param  data    Pointer to the payload in RAM
+*   \param  size    Payload size
+*   \retval RETURN_COM_TRANSF_OK success
+*   \retval RETURN_COM_NOK failed to send or more data than announced
+*/
+RET_TYPE usbFramedTxAppend(usbFramedTx_t* tx, const void* data, uint16_t size)
+{
+    const uint8_t* data_ptr = (const uint8_t*)data;
+    uint8_t chunk_size;
+    
+    if (size > tx->remaining)
+    {
+        return RETURN_COM_NOK;
+    }
+    
+    while (size != 0)
+    {
+        chunk_size = PACKET_EXPORT_SIZE - tx->fill;
+        if (size < chunk_size)
+        {
+            chunk_size = (uint8_t)size;
+        }
+        memcpy(tx->fragment + tx->fill, data_ptr, chunk_size);
+        tx->fill += chunk_size;
+        tx->remaining -= chunk_size;
+        data_ptr += chunk_size;
+        size -= chunk_size;
+        
+        // Send the fragment when full or when the message is complete
+        if ((tx->fill == PACKET_EXPORT_SIZE) || (tx->remaining == 0))
+        {
+            if (usbHidSend(tx->cmd, tx->fragment, tx->fill) != RETURN_COM_TRANSF_OK)
+            {
+                return RETURN_COM_NOK;
+            }
+            tx->seq = usbFramedNextSeq(tx->seq);
+            tx->fragment[FRAMED_SEQ_FIELD] = tx->seq;
+            tx->fill = FRAMED_HEADER_SIZE;
+        }
+    }
+    
+    return RETURN_COM_TRANSF_OK;
+}
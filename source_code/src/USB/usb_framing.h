@@ -0,0 +1,69 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     usb_framing.h
+*    \brief    Multi-packet message framing for the raw HID protocol
+*    Created:  19/10/2026
+*/
+
+#ifndef USB_FRAMING_H_
+#define USB_FRAMING_H_
+
+#include "usb_cmd_parser.h"
+#include "defines.h"
+#include <stdint.h>
+
+/*
+ * A framed message is sent as a train of standard [len, cmd, data] packets
+ * sharing the same command ID. The first data bytes of each packet are:
+ *  - data[0]: fragment sequence number, 0 for the first fragment then 1..255, wrapping to 1
+ *  - data[1..2]: total message length (little endian), repeated in each fragment
+ *  - data[3..]: up to FRAMED_PAYLOAD_SIZE bytes of message payload
+ * Only one answer is sent per framed message, once its last fragment is received.
+ */
+
+/*** DEFINES ***/
+#define FRAMED_SEQ_FIELD        0
+#define FRAMED_LENGTH_FIELD     1
+#define FRAMED_HEADER_SIZE      3
+#define FRAMED_PAYLOAD_SIZE     (PACKET_EXPORT_SIZE - FRAMED_HEADER_SIZE)
+
+/* usbFramedRxProcess return values */
+#define FRAMED_RX_ERROR         0x00
+#define FRAMED_RX_PART          0x01
+#define FRAMED_RX_LAST          0x02
+#define FRAMED_RX_IGNORE        0x03
+
+/*** STRUCTS ***/
+typedef struct
+{
+    uint8_t cmd;
+    uint8_t seq;
+    uint8_t fill;
+    uint16_t remaining;
+    uint8_t fragment[PACKET_EXPORT_SIZE];
+} usbFramedTx_t;
+
+/*** PROTOTYPES ***/
+uint8_t usbFramedRxProcess(usbMsg_t* msg, uint8_t** payload, uint8_t* payload_len, uint16_t* offset);
+void usbFramedRxReset(void);
+void usbFramedTxStart(usbFramedTx_t* tx, uint8_t cmd, uint16_t length);
+RET_TYPE usbFramedTxAppend(usbFramedTx_t* tx, const void* data, uint16_t size);
+
+#endif /* USB_FRAMING_H_ */
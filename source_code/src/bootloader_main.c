@@ -113,6 +113,7 @@ int main(void)
     uint8_t firmware_data[SPM_PAGESIZE];                                                                                // One page of firmware data
     aes256_context temp_aes_context;                                                                                    // AES context
     uint8_t cur_cbc_mac[16];                                                                                            // Current CBCMAC val
+    uint8_t fw_start_cbc_mac[16];                                                                                       // CBCMAC val before the firmware data
     uint8_t temp_data[16];                                                                                              // Temporary 16 bytes array
     RET_TYPE flash_init_result;                                                                                         // Flash initialization result
     uint16_t firmware_start_address = UINT16_MAX - MAX_FIRMWARE_SIZE - sizeof(cur_cbc_mac) - sizeof(cur_aes_key) + 1;   // Start address of firmware in external memory
@@ -176,19 +177,34 @@ int main(void)
         while(1);
     }
 
+    /* Init CBCMAC encryption context */
+    eeprom_read_block((void*)cur_aes_key, (void*)EEP_BOOT_PWD, sizeof(cur_aes_key));
+    memset((void*)cur_cbc_mac, 0x00, sizeof(cur_cbc_mac));
+    aes256_init_ecb(&temp_aes_context, cur_aes_key);
+
     for (uint8_t pass_number = 0; pass_number < 2; pass_number++)
     {
-        /* Init CBCMAC encryption context*/
-        eeprom_read_block((void*)cur_aes_key, (void*)EEP_BOOT_PWD, sizeof(cur_aes_key));
-        memset((void*)cur_cbc_mac, 0x00, sizeof(cur_cbc_mac));
-        memset((void*)temp_data, 0x00, sizeof(temp_data));
-        aes256_init_ecb(&temp_aes_context, cur_aes_key);
+        // First pass: verify the CBCMAC from the start of the graphics zone until the max addressing space (65536) - the size of the CBCMAC
+        // Second pass: the data before the firmware was already authenticated, restart from the CBCMAC value we had at the firmware start
+        uint16_t start_address = GRAPHIC_ZONE_START;
+        if (pass_number == 1)
+        {
+            start_address = firmware_start_address;
+            memcpy((void*)cur_cbc_mac, (void*)fw_start_cbc_mac, sizeof(cur_cbc_mac));
+        }
 
-        // Compute CBCMAC for between the start of the graphics zone until the max addressing space (65536) - the size of the CBCMAC
-        for (uint16_t i = GRAPHIC_ZONE_START; i < (UINT16_MAX - sizeof(cur_cbc_mac) + 1); i += sizeof(cur_cbc_mac))
+        // Read the external flash as one stream, the stored CBCMAC directly follows the authenticated data
+        flashStreamReadStart(start_address);
+        for (uint16_t i = start_address; i < (UINT16_MAX - sizeof(cur_cbc_mac) + 1); i += sizeof(cur_cbc_mac))
         {
+            // Store the CBCMAC value checkpoint for the second pass
+            if (i == firmware_start_address)
+            {
+                memcpy((void*)fw_start_cbc_mac, (void*)cur_cbc_mac, sizeof(cur_cbc_mac));
+            }
+
             // Read data from external flash
-            flashRawRead(temp_data, i, sizeof(temp_data));
+            flashStreamRead(temp_data, sizeof(temp_data));
 
             // If we got to the part containing to firmware
             if ((i >= firmware_start_address) && (i < firmware_end_address))
@@ -217,7 +233,8 @@ int main(void)
         }
 
         // Read CBCMAC in memory and compare it with the computed value
-        flashRawRead(temp_data, (UINT16_MAX - sizeof(cur_cbc_mac) + 1), sizeof(cur_cbc_mac));
+        flashStreamRead(temp_data, sizeof(cur_cbc_mac));
+        flashStreamReadStop();
         if (pass_number == 0)
         {
             // First pass, compare CBCMAC and see if we do the next pass or start the firmware
@@ -67,8 +67,10 @@
  *  MINI_PREPRODUCTION_SETUP_ACC
  *  => mooltipass mini pre-production units, with accelerometer
 */
+#ifndef HOST_SETUP
 #define MINI_CLICK_BETATESTERS_SETUP
 //#define POST_KICKSTARTER_UPDATE_SETUP
+#endif
 
 #if defined(BETATESTERS_SETUP)
     #define FLASH_CHIP_4M
@@ -140,6 +142,21 @@
     #define FLASH_CHIP_4M
     #define HARDWARE_MINI_CLICK_V2
     #define ENABLE_MOOLTIPASS_CARD_FORMATTING
+#elif defined(HOST_SETUP)
+    // Native host build (see host/README.md), the flash chip size may be given on the command line
+    #if !defined(FLASH_CHIP_1M) && !defined(FLASH_CHIP_2M) && !defined(FLASH_CHIP_4M) && !defined(FLASH_CHIP_8M) && !defined(FLASH_CHIP_16M) && !defined(FLASH_CHIP_32M)
+        #define FLASH_CHIP_4M
+    #endif
+    // MINI_VERSION on the command line selects the Mooltipass Mini hardware
+    #if defined(MINI_VERSION)
+        #define NO_ACCELEROMETER
+        #define HARDWARE_MINI_CLICK_V2
+    #else
+        #define HARDWARE_OLIVIER_V1
+    #endif
+    #define ENABLE_MOOLTIPASS_CARD_FORMATTING
+    #define ENABLE_FLASH_STATS
+    #define FLASH_TRACE_NB_ENTRIES  255
 #endif
 
 /**************** DEBUG PRINTS ****************/
@@ -207,6 +224,31 @@
 /************** MILLISECOND DEBUG TIMER ***************/
 //#define ENABLE_MILLISECOND_DBG_TIMER
 
+/************** USB COMMAND LATENCY STATISTICS ***************/
+// Per command processing time histograms, read with CMD_GET_LATENCY_STATS
+//#define ENABLE_CMD_LATENCY_STATS
+#ifdef ENABLE_CMD_LATENCY_STATS
+    #define ENABLE_MILLISECOND_DBG_TIMER
+#endif
+
+/************** STACK USAGE PROFILE ***************/
+// Per command and per screen max stack usage, read with CMD_STACK_FREE
+//#define ENABLE_STACK_PROFILE
+#ifdef ENABLE_STACK_PROFILE
+    #define STACK_DEBUG
+#endif
+
+/************** FLASH ACTIVITY STATISTICS ***************/
+// SPI transaction counters and trace, read with CMD_GET_FLASH_STATS
+//#define ENABLE_FLASH_STATS
+#if defined(ENABLE_FLASH_STATS) && defined(BOOTLOADER)
+    // Not in the 4KB boot section
+    #undef ENABLE_FLASH_STATS
+#endif
+#ifdef ENABLE_FLASH_STATS
+    #define ENABLE_MILLISECOND_DBG_TIMER
+#endif
+
 /************** LOW LEVEL MEMORY BOUNDARY CHECKS ***************/
 #define MEMORY_BOUNDARY_CHECKS
 
@@ -64,6 +64,30 @@ uint32_t millis()
 
     return ms;
 }
+
+/*! \fn     micros()
+*   \brief  Return the number of microseconds since power up, using the timer 1 count within the current millisecond
+*   \return the number of microseconds since power up (wraps after 71 minutes)
+*/
+uint32_t micros()
+{
+    uint16_t ticks;
+    uint32_t ms;
+    
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        ms = msecTicks;
+        ticks = TCNT1;
+        // Compare match not serviced yet: the counter already restarted
+        if ((TIFR1 & (1 << OCF1A)) && (ticks < 1000))
+        {
+            ms++;
+        }
+    }
+
+    // Timer 1 runs at 2MHz
+    return ms*1000 + (ticks >> 1);
+}
 #endif
 
 /*! \fn     initIRQ(void)
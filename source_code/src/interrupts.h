@@ -28,8 +28,10 @@
 void initIRQ(void);
 #ifdef ENABLE_MILLISECOND_DBG_TIMER
     uint32_t millis();
+    uint32_t micros();
 #else
     #define millis()    0
+    #define micros()    0
 #endif
 
 #endif /* INTERRUPTS_H_ */
@@ -52,6 +52,7 @@
 #include "defines.h"
 #include "delays.h"
 #include "utils.h"
+#include "stack.h"
 #include "tests.h"
 #include "touch.h"
 #include "anim.h"
@@ -265,6 +266,9 @@ int main(void)
         firstTimeUserHandlingInit();            // Erase # of cards and # of users
     }
     
+    /** KEYBOARD LAYOUT LOADING **/
+    usbKeybLoadParameters();                    // Keyboard LUT stored in flash
+    
     /** TOUCH PANEL INITIALIZATION **/
     #if defined(HARDWARE_OLIVIER_V1)
         touch_init_result = initTouchSensing();
@@ -388,7 +392,15 @@ int main(void)
         // Call GUI routine once the touch input inhibit timer is finished
         if (hasTimerExpired(TIMER_TOUCH_INHIBIT, FALSE) == TIMER_EXPIRED)
         {
+            #ifdef ENABLE_STACK_PROFILE
+            // Stack profile of the screen we are in
+            uint8_t screen = getCurrentScreen();
+            uint8_t* outer_stack_low = stackProfileStart();
+            guiMainLoop();
+            stackProfileStop(outer_stack_low, STACK_PROFILE_SCREEN, screen);
+            #else
             guiMainLoop();
+            #endif
         }
         
         // If we are running the screen saver
@@ -431,6 +443,7 @@ int main(void)
             // Light up the Mooltipass and call the dedicated function
             activityDetectedRoutine();
             handleSmartcardRemoved();
+            usbPostStatusEvent(STATUS_EVENT_CARD_REMOVED);
             
             // Set correct screen
             guiDisplayInformationOnScreenAndWait(ID_STRING_CARD_REMOVED);
@@ -468,5 +481,11 @@ int main(void)
             guiGetBackToCurrentScreen();
             handleSmartcardRemoved();
         }
+        
+        // Wipe the data node the host stopped reading once its credential timer expired
+        if ((getNbDataBlocksLeftInCurrentNode() != 0) && (hasTimerExpired(TIMER_CREDENTIALS, FALSE) == TIMER_EXPIRED))
+        {
+            clearDataNodePlaintextCache();
+        }
     }
 }
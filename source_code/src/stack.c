@@ -23,6 +23,8 @@
 *    Author:   Miguel A. Borrego
 */
 #include "stack.h"
+#include <avr/io.h>
+#include <string.h>
 
 /* External var, end of known static RAM (to be filled by linker) */
 extern uint8_t _end;
@@ -65,19 +67,129 @@ void stackInit(void)
 }
 #endif
 
+#ifdef ENABLE_STACK_PROFILE
+// Max stack usage per command / screen
+static stackProfileEntry_t stack_profile[STACK_PROFILE_NB_KINDS][STACK_PROFILE_NB_SLOTS];
+// Lowest stack address used before the last repaint
+static uint8_t* stack_lowest = &__stack;
+#endif
+
+/*! \fn     stackScan(void)
+*   \brief  Find the first word that isn't STACK_INIT from the end of static RAM
+*   \return Lowest stack address used since the area was painted
+*/
+static uint32_t* stackScan(void)
+{
+    uint32_t *p = (uint32_t*)&_end;
+    while( (p <= (uint32_t*)&__stack) && (*p == STACK_INIT) )
+    {
+        p++;
+    }
+    return p;
+}
+
 /*! \fn     stackFree(void)
 *   \brief  Counts how many bytes of stack have not been overwritten
 *   \return number of bytes not overwritten by stack
 */
 uint16_t stackFree(void)
 {
-    uint32_t *p = (uint32_t*)&_end;
-    uint16_t words  = 0;
-    while( (p <= (uint32_t*)&__stack) && (*p == STACK_INIT) )
+    uint8_t* p = (uint8_t*)stackScan();
+
+    #ifdef ENABLE_STACK_PROFILE
+    // The profiler repaints the stack, take what was used before into account
+    if (stack_lowest < p)
     {
-        p++;
-	words++;
+        p = stack_lowest;
+    }
+    #endif
+    return (uint16_t)(p - &_end);
+}
+
+#ifdef ENABLE_STACK_PROFILE
+/*! \fn     stackSize(void)
+*   \brief  Size of the RAM area between static RAM and the bottom of the stack
+*   \return Number of bytes
+*/
+uint16_t stackSize(void)
+{
+    return (uint16_t)(&__stack - &_end) + 1;
+}
+
+/*! \fn     stackProfileStart(void)
+*   \brief  Start a stack profile checkpoint: paint the stack below us again
+*   \return Lowest stack address used since the previous checkpoint, to give to stackProfileStop()
+*   \note   Interrupts may use the stack while it is painted, their frames are dead once they return
+*/
+uint8_t* stackProfileStart(void)
+{
+    uint32_t* low = stackScan();
+    uint32_t* p = low;
+
+    if ((uint8_t*)low < stack_lowest)
+    {
+        stack_lowest = (uint8_t*)low;
+    }
+    while (p < (uint32_t*)(SP - STACK_PROFILE_MARGIN))
+    {
+        *p++ = STACK_INIT;
+    }
+    return (uint8_t*)low;
+}
+
+/*! \fn     stackProfileStop(uint8_t* outer_low, uint8_t kind, uint8_t id)
+*   \brief  End a stack profile checkpoint and record its usage
+*   \param  outer_low   Value returned by stackProfileStart()
+*   \param  kind        STACK_PROFILE_CMD, STACK_PROFILE_SCREEN or STACK_PROFILE_NONE to record nothing
+*   \param  id          Command or screen ID
+*/
+void stackProfileStop(uint8_t* outer_low, uint8_t kind, uint8_t id)
+{
+    uint8_t* low = (uint8_t*)stackScan();
+    uint16_t used = (uint16_t)(&__stack - low) + 1;
+
+    if (kind < STACK_PROFILE_NB_KINDS)
+    {
+        // Update the entry for this ID, or take the first unused slot
+        for (uint8_t i = 0; i < STACK_PROFILE_NB_SLOTS; i++)
+        {
+            stackProfileEntry_t* entry = &stack_profile[kind][i];
+
+            if ((entry->max_used == 0) || (entry->id == id))
+            {
+                entry->id = id;
+                if (used > entry->max_used)
+                {
+                    entry->max_used = used;
+                }
+                break;
+            }
+        }
+    }
+
+    // Checkpoints may be nested, leave the enclosing one's lowest address unpainted for its own scan
+    if (outer_low < low)
+    {
+        *(uint32_t*)outer_low = 0;
     }
+}
+
+/*! \fn     stackProfileGet(uint8_t kind)
+*   \brief  Get the stack profile entries of a kind
+*   \param  kind    STACK_PROFILE_CMD or STACK_PROFILE_SCREEN
+*   \return STACK_PROFILE_NB_SLOTS entries
+*/
+stackProfileEntry_t* stackProfileGet(uint8_t kind)
+{
+    return stack_profile[kind];
+}
 
-    return words*sizeof(uint32_t);
+/*! \fn     stackProfileReset(void)
+*   \brief  Clear the stack profile
+*/
+void stackProfileReset(void)
+{
+    memset((void*)stack_profile, 0, sizeof(stack_profile));
+    stack_lowest = &__stack;
 }
+#endif
@@ -2,8 +2,33 @@
 #define __STACK_H__
 
 #include <stdio.h>
+#include <stdint.h>
 #include "defines.h"
 
+/* Stack profile checkpoint kinds */
+#define STACK_PROFILE_NONE      0xFF
+#define STACK_PROFILE_CMD       0
+#define STACK_PROFILE_SCREEN    1
+#define STACK_PROFILE_NB_KINDS  2
+/* Number of IDs tracked for each kind */
+#define STACK_PROFILE_NB_SLOTS  8
+/* Bytes left unpainted below the stack pointer when starting a checkpoint */
+#define STACK_PROFILE_MARGIN    16
+/* CMD_STACK_FREE arguments */
+#define STACK_PROFILE_GET       0x01
+#define STACK_PROFILE_RESET     0xFF
+
+typedef struct
+{
+    uint8_t id;             // Command or screen ID
+    uint16_t max_used;      // Max stack usage in bytes, 0 for an unused slot
+} stackProfileEntry_t;
+
 uint16_t stackFree(void);
+uint16_t stackSize(void);
+uint8_t* stackProfileStart(void);
+void stackProfileStop(uint8_t* outer_low, uint8_t kind, uint8_t id);
+stackProfileEntry_t* stackProfileGet(uint8_t kind);
+void stackProfileReset(void);
 
 #endif
@@ -31,16 +31,54 @@ from os import listdir
 from struct import *
 import sys
 import os
+import zlib
 
 def getAesKeyForMooltipass(mpId):
 	return array('B',[0]*32)
 
+def crc16Ccitt(data):
+	# same as the firmware media zone CRC: avr-libc _crc_ccitt_update, initial value 0xFFFF
+	crc = 0xFFFF
+	for byte in data:
+		byte ^= crc & 0xFF
+		byte = (byte ^ (byte << 4)) & 0xFF
+		crc = (((byte << 8) | (crc >> 8)) ^ (byte >> 4) ^ (byte << 3)) & 0xFFFF
+	return crc
+
+def writeDeltaFile(old_data, new_data, page_size, filename):
+	# Delta file: "MPDL" | page size | nb pages | CRC16 of all new pages | CRC32 of each new page | nb records | records (page number | page contents)
+	# The device selects the pages to send with the CRC32s, the CRC16 checks the result
+	# Pages are padded with zeros, a partial last page is therefore always part of the records
+	nb_pages = (len(new_data) + page_size - 1) / page_size
+	new_data = new_data + array('B',[0]*(nb_pages*page_size-len(new_data)))
+	records = []
+	for i in range(0, nb_pages):
+		new_page = new_data[i*page_size:(i+1)*page_size]
+		if (i+1)*page_size > len(old_data) or old_data[i*page_size:(i+1)*page_size] != new_page or i == nb_pages - 1:
+			records.append(i)
+
+	delta = array('B')
+	delta.extend(array('B', "MPDL"))
+	delta.extend(array('B', pack('<HHH', page_size, nb_pages, crc16Ccitt(new_data))))
+	for i in range(0, nb_pages):
+		delta.extend(array('B', pack('<I', zlib.crc32(new_data[i*page_size:(i+1)*page_size].tostring()) & 0xFFFFFFFF)))
+	delta.extend(array('B', pack('<H', len(records))))
+	for i in records:
+		delta.extend(array('B', pack('<H', i)))
+		delta.extend(new_data[i*page_size:(i+1)*page_size])
+
+	data_fd = open(filename, 'wb')
+	data_fd.write(delta)
+	data_fd.close()
+	print "Delta file written:", len(records), "pages out of", nb_pages
+
 def main():
 	# Rather than at the beginning of the files, constants are here
 	HASH_LENGH = 128/8									# Hash length (128 bits)
 	AES_KEY_LENGTH = 256/8								# AES key length (256 bits)
 	FW_MAX_LENGTH = 28672								# Maximum firmware length, depends on size allocated to bootloader
-	FLASH_SECTOR_0_LENGTH = 264*8						# Length in bytes of sector 0a in external flash (to change for 16Mb & 32Mb flash!)
+	FLASH_PAGE_LENGTH = 264								# Length in bytes of an external flash page (to change for 16Mb & 32Mb flash!)
+	FLASH_SECTOR_0_LENGTH = FLASH_PAGE_LENGTH*8			# Length in bytes of sector 0a in external flash
 	STORAGE_SPACE = 65536 - FLASH_SECTOR_0_LENGTH		# Uint16_t addressing space - sector 0a length (dedicated to other storage...)
 	BUNDLE_MAX_LENGTH = STORAGE_SPACE - FW_MAX_LENGTH - HASH_LENGH - AES_KEY_LENGTH
 	
@@ -123,6 +161,13 @@ def main():
 	data_fd.close()
 	print "Update file written!"
 	
+	# If a previous update file is given, generate a delta file to only reprogram the pages that changed
+	if len(sys.argv) > 1:
+		fd = open(sys.argv[1], 'rb')
+		previous_update_file_data = array('B', fd.read())
+		fd.close()
+		writeDeltaFile(previous_update_file_data, update_file_data, FLASH_PAGE_LENGTH, "updatefile.delta")
+	
 	# Re read our file to make sure of its length
 	#fd = open("updatefile.img", 'rb')
 	#update_file = fd.read()
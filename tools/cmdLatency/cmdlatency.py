@@ -0,0 +1,223 @@
+#!/usr/bin/env python
+#
+# CDDL HEADER START
+#
+# The contents of this file are subject to the terms of the
+# Common Development and Distribution License (the "License").
+# You may not use this file except in compliance with the License.
+#
+# You can obtain a copy of the license at src/license_cddl-1.0.txt
+# or http://www.opensolaris.org/os/licensing.
+# See the License for the specific language governing permissions
+# and limitations under the License.
+#
+# When distributing Covered Code, include this CDDL HEADER in each
+# file and include the License file at src/license_cddl-1.0.txt
+# If applicable, add the following below this CDDL HEADER, with the
+# fields enclosed by brackets "[]" replaced with your own identifying
+# information: Portions Copyright [yyyy] [name of copyright owner]
+#
+# CDDL HEADER END
+from array import array
+import platform
+import usb.core
+import usb.util
+import random
+import time
+import struct
+import sys
+import re
+import os
+
+USB_VID                 = 0x16D0
+USB_PID                 = 0x09A0
+
+LEN_INDEX               = 0x00
+CMD_INDEX               = 0x01
+DATA_INDEX              = 0x02
+
+CMD_PING                = 0xA1
+CMD_GET_LATENCY_STATS   = 0xE4
+CMD_STATS_RESET         = 0xFF
+
+# Histogram bucket upper limits in us, the last bucket holds everything above
+BUCKET_LIMITS           = [256, 1024, 4096, 16384, 65536, 262144, 1048576]
+	
+def sendHidPacket(epout, cmd, len, data):
+	# data to send
+	arraytosend = array('B')
+
+	# if command copy it otherwise copy the data
+	if cmd != 0:
+		arraytosend.append(len)
+		arraytosend.append(cmd)
+
+	# add the data
+	if data is not None:
+		arraytosend.extend(data)
+
+	#print arraytosend
+	#print arraytosend
+
+	# send data
+	epout.write(arraytosend)
+	
+def findHIDDevice(vendor_id, product_id, print_debug):
+	# Find our device
+	hid_device = usb.core.find(idVendor=vendor_id, idProduct=product_id)
+
+	# Was it found?
+	if hid_device is None:
+		if print_debug:
+			print "Device not found"
+		return None, None, None, None
+
+	# Device found
+	if print_debug:
+		print "Mooltipass found"
+
+	# Different init codes depending on the platform
+	if platform.system() == "Linux":
+		# Need to do things differently
+		try:
+			hid_device.detach_kernel_driver(0)
+			hid_device.reset()
+		except Exception, e:
+			pass # Probably already detached
+	else:
+		# Set the active configuration. With no arguments, the first configuration will be the active one
+		try:
+			hid_device.set_configuration()
+		except Exception, e:
+			if print_debug:
+				print "Cannot set configuration the device:" , str(e)
+			return None, None, None, None
+
+	#for cfg in hid_device:
+	#	print "configuration val:", str(cfg.bConfigurationValue)
+	#	for intf in cfg:
+	#		print "int num:", str(intf.bInterfaceNumber), ", int alt:", str(intf.bAlternateSetting)
+	#		for ep in intf:
+	#			print "endpoint addr:", str(ep.bEndpointAddress)
+
+	# Get an endpoint instance
+	cfg = hid_device.get_active_configuration()
+	intf = cfg[(0,0)]
+
+	# Match the first OUT endpoint
+	epout = usb.util.find_descriptor(intf, custom_match = lambda e: usb.util.endpoint_direction(e.bEndpointAddress) == usb.util.ENDPOINT_OUT)
+	if epout is None:
+		hid_device.reset()
+		return None, None, None, None
+	#print "Selected OUT endpoint:", epout.bEndpointAddress
+
+	# Match the first IN endpoint
+	epin = usb.util.find_descriptor(intf, custom_match = lambda e: usb.util.endpoint_direction(e.bEndpointAddress) == usb.util.ENDPOINT_IN)
+	if epin is None:
+		hid_device.reset()
+		return None, None, None, None
+	#print "Selected IN endpoint:", epin.bEndpointAddress
+
+	# prepare ping packet
+	byte1 = random.randint(0, 255)
+	byte2 = random.randint(0, 255)
+	ping_packet = array('B')
+	ping_packet.append(2)
+	ping_packet.append(CMD_PING)
+	ping_packet.append(byte1)
+	ping_packet.append(byte2)
+
+	time.sleep(0.5)
+	try:
+		# try to send ping packet
+		epout.write(ping_packet)
+		# try to receive one answer
+		temp_bool = 0
+		while temp_bool == 0:
+			try :
+				# try to receive answer
+				data = epin.read(epin.wMaxPacketSize, timeout=2000)
+				if data[CMD_INDEX] == CMD_PING and data[DATA_INDEX] == byte1 and data[DATA_INDEX+1] == byte2 :
+					temp_bool = 1
+					if print_debug:
+						print "Mooltipass replied to our ping message"
+				else:
+					if print_debug:
+						print "Cleaning remaining input packets"
+				time.sleep(.5)
+			except usb.core.USBError as e:
+				if print_debug:
+					print e
+				return None, None, None, None
+	except usb.core.USBError as e:
+		if print_debug:
+			print e
+		return None, None, None, None
+
+	# Return device & endpoints
+	return hid_device, intf, epin, epout
+
+def getCommandNames():
+	# Command names from the firmware sources, if available
+	names = {}
+	header = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..", "source_code", "src", "USB", "usb_cmd_parser.h")
+	try:
+		for line in open(header):
+			match = re.match(r"#define\s+(CMD_\w+)\s+0x([0-9A-Fa-f]{2})\b", line)
+			if match:
+				names[int(match.group(2), 16)] = match.group(1)
+	except IOError:
+		pass
+	return names
+
+def formatTime(us):
+	if us >= 1000000:
+		return "%.2fs" % (us / 1000000.0)
+	elif us >= 1000:
+		return "%.2fms" % (us / 1000.0)
+	return "%dus" % us
+
+def main():
+	# Search for the mooltipass and read hid data
+	hid_device, intf, epin, epout = findHIDDevice(USB_VID, USB_PID, True)
+	if hid_device is None:
+		sys.exit(0)
+
+	if len(sys.argv) > 1 and sys.argv[1] == "reset":
+		sendHidPacket(epout, CMD_GET_LATENCY_STATS, 1, [CMD_STATS_RESET])
+		data = epin.read(epin.wMaxPacketSize, timeout=2000)
+		print "Statistics cleared" if data[DATA_INDEX] == 0x01 else "Couldn't clear the statistics"
+		return
+
+	names = getCommandNames()
+	headers = ["<" + formatTime(limit) for limit in BUCKET_LIMITS] + [">=" + formatTime(BUCKET_LIMITS[-1])]
+	print "%-26s %6s %9s %9s  " % ("command", "count", "min", "max") + " ".join("%7s" % h for h in headers)
+
+	slot = 0
+	nb_slots = 1
+	while slot < nb_slots:
+		sendHidPacket(epout, CMD_GET_LATENCY_STATS, 1, [slot])
+		try:
+			data = epin.read(epin.wMaxPacketSize, timeout=2000)
+		except usb.core.USBError as e:
+			print "No answer, latency statistics aren't enabled in this firmware (ENABLE_CMD_LATENCY_STATS)"
+			return
+		if data[LEN_INDEX] == 1:
+			print "Couldn't read slot", slot
+			return
+		# [nb slots, overflow, cmd, count, min, max, buckets]
+		nb_slots, overflow, cmd, count, min_time, max_time = struct.unpack("<BHBHII", data[DATA_INDEX:DATA_INDEX+14].tostring())
+		buckets = struct.unpack("<8H", data[DATA_INDEX+14:DATA_INDEX+30].tostring())
+		slot += 1
+		if cmd == 0:
+			break
+		name = names.get(cmd, "0x%02X" % cmd)
+		print "%-26s %6d %9s %9s  " % (name, count, formatTime(min_time), formatTime(max_time)) + " ".join("%7d" % b for b in buckets)
+
+	if slot == 1 and cmd == 0:
+		print "No command recorded yet"
+	if overflow != 0:
+		print overflow, "commands not recorded, all slots taken (use 'reset' to clear)"
+
+if __name__ == "__main__":
+	main()
@@ -0,0 +1,337 @@
+#!/usr/bin/env python
+#
+# CDDL HEADER START
+#
+# The contents of this file are subject to the terms of the
+# Common Development and Distribution License (the "License").
+# You may not use this file except in compliance with the License.
+#
+# You can obtain a copy of the license at src/license_cddl-1.0.txt
+# or http://www.opensolaris.org/os/licensing.
+# See the License for the specific language governing permissions
+# and limitations under the License.
+#
+# When distributing Covered Code, include this CDDL HEADER in each
+# file and include the License file at src/license_cddl-1.0.txt
+# If applicable, add the following below this CDDL HEADER, with the
+# fields enclosed by brackets "[]" replaced with your own identifying
+# information: Portions Copyright [yyyy] [name of copyright owner]
+#
+# CDDL HEADER END
+from array import array
+import platform
+import usb.core
+import usb.util
+import random
+import time
+import struct
+import sys
+import socket
+import re
+import os
+
+USB_VID                 = 0x16D0
+USB_PID                 = 0x09A0
+
+LEN_INDEX               = 0x00
+CMD_INDEX               = 0x01
+DATA_INDEX              = 0x02
+
+CMD_PING                = 0xA1
+CMD_GET_FLASH_STATS     = 0xE5
+FLASH_STATS_COUNTERS    = 0x00
+FLASH_STATS_TRACE       = 0x01
+FLASH_STATS_RESET       = 0xFF
+
+# Wait times are traced in 1 << FLASH_TRACE_TIME_SHIFT us units
+FLASH_TRACE_TIME_SHIFT  = 5
+TRACE_ENTRY_SIZE        = 6
+
+OPCODE_READ_STAT_REG    = 0xD7
+OPCODE_LOWF_READ        = 0x03
+OPCODE_MAINP_TO_BUF     = 0x53
+OPCODE_PROGRAMS         = [0x82, 0x83, 0x86]
+OPCODE_ERASES           = [0x81, 0x50, 0x7C, 0xC7]
+OPCODE_NAMES            = {0xD7: "wait ready", 0x03: "read", 0x53: "page to buffer", 0x82: "program through buffer", 0x83: "buffer 1 to page", 0x86: "buffer 2 to page", 0x84: "buffer 1 write", 0x87: "buffer 2 write", 0x81: "page erase", 0x50: "block erase", 0x7C: "sector erase", 0xC7: "chip erase", 0x9F: "read id"}
+
+class VirtualEndpoint:
+	# Virtual device served over a unix socket by source_code/host/virtual_device.c, one 64B packet per message
+	wMaxPacketSize = 64
+
+	def __init__(self, sock):
+		self.sock = sock
+
+	def read(self, size, timeout=None):
+		self.sock.settimeout(None if timeout is None else timeout / 1000.0)
+		try:
+			return array('B', self.sock.recv(size))
+		except socket.timeout:
+			raise usb.core.USBError("Operation timed out")
+
+	def write(self, data):
+		packet = array('B', data)
+		packet.extend([0] * (self.wMaxPacketSize - len(packet)))
+		self.sock.send(packet.tostring())
+
+def sendHidPacket(epout, cmd, len, data):
+	# data to send
+	arraytosend = array('B')
+
+	# if command copy it otherwise copy the data
+	if cmd != 0:
+		arraytosend.append(len)
+		arraytosend.append(cmd)
+
+	# add the data
+	if data is not None:
+		arraytosend.extend(data)
+
+	#print arraytosend
+	#print arraytosend
+
+	# send data
+	epout.write(arraytosend)
+	
+def findHIDDevice(vendor_id, product_id, print_debug):
+	# Find our device
+	hid_device = usb.core.find(idVendor=vendor_id, idProduct=product_id)
+
+	# Was it found?
+	if hid_device is None:
+		if print_debug:
+			print "Device not found"
+		return None, None, None, None
+
+	# Device found
+	if print_debug:
+		print "Mooltipass found"
+
+	# Different init codes depending on the platform
+	if platform.system() == "Linux":
+		# Need to do things differently
+		try:
+			hid_device.detach_kernel_driver(0)
+			hid_device.reset()
+		except Exception, e:
+			pass # Probably already detached
+	else:
+		# Set the active configuration. With no arguments, the first configuration will be the active one
+		try:
+			hid_device.set_configuration()
+		except Exception, e:
+			if print_debug:
+				print "Cannot set configuration the device:" , str(e)
+			return None, None, None, None
+
+	#for cfg in hid_device:
+	#	print "configuration val:", str(cfg.bConfigurationValue)
+	#	for intf in cfg:
+	#		print "int num:", str(intf.bInterfaceNumber), ", int alt:", str(intf.bAlternateSetting)
+	#		for ep in intf:
+	#			print "endpoint addr:", str(ep.bEndpointAddress)
+
+	# Get an endpoint instance
+	cfg = hid_device.get_active_configuration()
+	intf = cfg[(0,0)]
+
+	# Match the first OUT endpoint
+	epout = usb.util.find_descriptor(intf, custom_match = lambda e: usb.util.endpoint_direction(e.bEndpointAddress) == usb.util.ENDPOINT_OUT)
+	if epout is None:
+		hid_device.reset()
+		return None, None, None, None
+	#print "Selected OUT endpoint:", epout.bEndpointAddress
+
+	# Match the first IN endpoint
+	epin = usb.util.find_descriptor(intf, custom_match = lambda e: usb.util.endpoint_direction(e.bEndpointAddress) == usb.util.ENDPOINT_IN)
+	if epin is None:
+		hid_device.reset()
+		return None, None, None, None
+	#print "Selected IN endpoint:", epin.bEndpointAddress
+
+	# prepare ping packet
+	byte1 = random.randint(0, 255)
+	byte2 = random.randint(0, 255)
+	ping_packet = array('B')
+	ping_packet.append(2)
+	ping_packet.append(CMD_PING)
+	ping_packet.append(byte1)
+	ping_packet.append(byte2)
+
+	time.sleep(0.5)
+	try:
+		# try to send ping packet
+		epout.write(ping_packet)
+		# try to receive one answer
+		temp_bool = 0
+		while temp_bool == 0:
+			try :
+				# try to receive answer
+				data = epin.read(epin.wMaxPacketSize, timeout=2000)
+				if data[CMD_INDEX] == CMD_PING and data[DATA_INDEX] == byte1 and data[DATA_INDEX+1] == byte2 :
+					temp_bool = 1
+					if print_debug:
+						print "Mooltipass replied to our ping message"
+				else:
+					if print_debug:
+						print "Cleaning remaining input packets"
+				time.sleep(.5)
+			except usb.core.USBError as e:
+				if print_debug:
+					print e
+				return None, None, None, None
+	except usb.core.USBError as e:
+		if print_debug:
+			print e
+		return None, None, None, None
+
+	# Return device & endpoints
+	return hid_device, intf, epin, epout
+
+def findVirtualDevice(socket_path, print_debug):
+	# Connect to the socket, the endpoint object is used for both directions
+	sock = socket.socket(socket.AF_UNIX, socket.SOCK_SEQPACKET)
+	try:
+		sock.connect(socket_path)
+	except socket.error as e:
+		if print_debug:
+			print "Cannot connect to the virtual device:", str(e)
+		return None, None, None, None
+	if print_debug:
+		print "Virtual Mooltipass found"
+	endpoint = VirtualEndpoint(sock)
+	return sock, None, endpoint, endpoint
+
+def getCommandNames():
+	# Command names from the firmware sources, if available
+	names = {}
+	header = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..", "source_code", "src", "USB", "usb_cmd_parser.h")
+	try:
+		for line in open(header):
+			match = re.match(r"#define\s+(CMD_\w+)\s+0x([0-9A-Fa-f]{2})\b", line)
+			if match:
+				names[int(match.group(2), 16)] = match.group(1)
+	except IOError:
+		pass
+	return names
+
+def formatTime(us):
+	if us >= 1000000:
+		return "%.2fs" % (us / 1000000.0)
+	elif us >= 1000:
+		return "%.2fms" % (us / 1000.0)
+	return "%dus" % us
+
+def flashStatsRequest(epin, epout, arg):
+	sendHidPacket(epout, CMD_GET_FLASH_STATS, 1, [arg])
+	try:
+		return epin.read(epin.wMaxPacketSize, timeout=2000)
+	except usb.core.USBError as e:
+		print "No answer, flash statistics aren't enabled in this firmware (ENABLE_FLASH_STATS)"
+		sys.exit(1)
+
+def printCounters(epin, epout):
+	data = flashStatsRequest(epin, epout, FLASH_STATS_COUNTERS)
+	if data[LEN_INDEX] != 28:
+		print "Couldn't read the counters"
+		return
+	spi_bytes, busy_time, cs_toggles, page_loads, page_programs, erases, busy_waits = struct.unpack("<7I", data[DATA_INDEX:DATA_INDEX+28].tostring())
+	print "SPI bytes:         ", spi_bytes
+	print "Transactions:      ", cs_toggles
+	print "Page to buffer:    ", page_loads
+	print "Page programs:     ", page_programs
+	print "Erases:            ", erases
+	print "Ready waits:       ", busy_waits, "(" + formatTime(busy_time) + ")"
+
+def readTrace(epin, epout):
+	# Returns the oldest trace entries as (cmd, opcode, page, value) tuples and the dropped entries count
+	data = flashStatsRequest(epin, epout, FLASH_STATS_TRACE)
+	if data[LEN_INDEX] < 3:
+		print "Couldn't read the trace"
+		sys.exit(1)
+	nb_entries, dropped = struct.unpack("<BH", data[DATA_INDEX:DATA_INDEX+3].tostring())
+	entries = []
+	for i in range(nb_entries):
+		offset = DATA_INDEX + 3 + i * TRACE_ENTRY_SIZE
+		entries.append(struct.unpack("<BBHH", data[offset:offset+TRACE_ENTRY_SIZE].tostring()))
+	return entries, dropped
+
+def commandName(names, cmd):
+	if cmd == 0:
+		return "(no command)"
+	return names.get(cmd, "0x%02X" % cmd)
+
+def dumpTrace(epin, epout, names):
+	# Print the trace entries as they come
+	print "%-26s %-24s %6s %9s" % ("command", "operation", "page", "value")
+	while True:
+		entries, dropped = readTrace(epin, epout)
+		for cmd, opcode, page, value in entries:
+			if opcode == OPCODE_READ_STAT_REG:
+				print "%-26s %-24s %6s %9s" % (commandName(names, cmd), OPCODE_NAMES[opcode], "", formatTime(value << FLASH_TRACE_TIME_SHIFT))
+			else:
+				print "%-26s %-24s %6d %8dB" % (commandName(names, cmd), OPCODE_NAMES.get(opcode, "0x%02X" % opcode), page, value)
+		if len(entries) == 0:
+			time.sleep(.1)
+
+def aggregateTrace(epin, epout, names):
+	# Attribute the flash costs to the commands until Ctrl-C
+	costs = {}
+	dropped = 0
+	print "Recording the flash trace, press Ctrl-C to stop"
+	try:
+		while True:
+			entries, dropped = readTrace(epin, epout)
+			for cmd, opcode, page, value in entries:
+				# [transactions, bytes, page loads, programs, erases, waits, wait time]
+				cost = costs.setdefault(cmd, [0, 0, 0, 0, 0, 0, 0])
+				cost[0] += 1
+				if opcode == OPCODE_READ_STAT_REG:
+					cost[5] += 1
+					cost[6] += value << FLASH_TRACE_TIME_SHIFT
+					continue
+				cost[1] += 4 + value
+				if opcode == OPCODE_MAINP_TO_BUF:
+					cost[2] += 1
+				elif opcode in OPCODE_PROGRAMS:
+					cost[3] += 1
+				elif opcode in OPCODE_ERASES:
+					cost[4] += 1
+			if len(entries) == 0:
+				time.sleep(.1)
+	except KeyboardInterrupt:
+		pass
+
+	print ""
+	print "%-26s %8s %10s %8s %8s %7s %7s %10s" % ("command", "trans.", "bytes", "loads", "programs", "erases", "waits", "wait time")
+	for cmd, cost in sorted(costs.items(), key=lambda item: item[1][6], reverse=True):
+		print "%-26s %8d %10d %8d %8d %7d %7d %10s" % (commandName(names, cmd), cost[0], cost[1], cost[2], cost[3], cost[4], cost[5], formatTime(cost[6]))
+	if dropped != 0:
+		print dropped, "trace entries dropped, poll more often or enlarge FLASH_TRACE_NB_ENTRIES"
+
+def main():
+	# Search for the mooltipass, MOOLTIPASS_SOCKET selects a virtual device instead
+	if os.environ.get("MOOLTIPASS_SOCKET") is not None:
+		hid_device, intf, epin, epout = findVirtualDevice(os.environ["MOOLTIPASS_SOCKET"], True)
+	else:
+		hid_device, intf, epin, epout = findHIDDevice(USB_VID, USB_PID, True)
+	if hid_device is None:
+		sys.exit(0)
+
+	mode = sys.argv[1] if len(sys.argv) > 1 else "counters"
+	if mode == "reset":
+		data = flashStatsRequest(epin, epout, FLASH_STATS_RESET)
+		print "Statistics cleared" if data[DATA_INDEX] == 0x01 else "Couldn't clear the statistics"
+	elif mode == "counters":
+		printCounters(epin, epout)
+	elif mode == "trace":
+		aggregateTrace(epin, epout, getCommandNames())
+	elif mode == "dump":
+		try:
+			dumpTrace(epin, epout, getCommandNames())
+		except KeyboardInterrupt:
+			pass
+	else:
+		print "usage: flashstats.py [counters|trace|dump|reset]"
+
+if __name__ == "__main__":
+	main()
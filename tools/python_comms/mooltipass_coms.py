@@ -6,10 +6,12 @@ import usb.core
 import usb.util
 import os.path
 import random
+import socket
 import struct
 import string
 import pickle
 import copy
+import zlib
 import time
 import sys
 import os
@@ -101,6 +103,26 @@ CMD_SET_DN_START_PARENT = 0xD2
 CMD_END_MEMORYMGMT      = 0xD3
 CMD_GET_DESCRIPTION		= 0xD4
 CMD_UNLOCK_WITH_PIN		= 0xD5
+CMD_READ_NODE_IN_DN		= 0xD6
+CMD_CHECK_PASSWORD_BATCH	= 0xD7
+CMD_READ_FLASH_NODES	= 0xD8
+CMD_WRITE_FLASH_NODES	= 0xD9
+CMD_GET_CREDENTIAL		= 0xDA
+CMD_STATUS_EVENTS		= 0xDB
+CMD_STATUS_EVENT		= 0xDC
+CMD_EXPORT_STREAM_START	= 0xDD
+CMD_EXPORT_STREAM_DATA	= 0xDE
+CMD_EXPORT_STREAM_END	= 0xDF
+CMD_IMPORT_MEDIA_STREAM	= 0xE0
+CMD_IMPORT_MEDIA_STREAM_END	= 0xE1
+CMD_GET_MEDIA_PAGE_HASH	= 0xE2
+CMD_IMPORT_MEDIA_PAGE	= 0xE3
+CMD_GET_MEDIA_ZONE_CRC	= 0xE6
+
+MEDIA_IMPORT_ACK_WINDOW	= 8
+
+FRAMED_HEADER_SIZE		= 3
+FRAMED_PAYLOAD_SIZE		= 59
 
 def keyboardSend(epout, data1, data2):
 	packetToSend = array('B')
@@ -275,6 +297,55 @@ def sendHidPacket(epout, cmd, len, data):
 	# send data
 	epout.write(arraytosend)
 
+def sendFramedMessage(epout, cmd, data):
+	# split the message in fragments: seq number, total length, payload
+	seq = 0
+	for i in range(0, len(data), FRAMED_PAYLOAD_SIZE):
+		fragment = array('B', [seq, len(data) & 0xFF, len(data) >> 8])
+		fragment.extend(data[i:i+FRAMED_PAYLOAD_SIZE])
+		sendHidPacket(epout, cmd, len(fragment), fragment)
+		seq = 1 if seq == 255 else seq + 1
+
+def receiveFramedMessage(epin, cmd):
+	# returns the message payload, None if the mooltipass answered with a single byte error
+	data = receiveHidPacket(epin)
+	if data[CMD_INDEX] != cmd or data[LEN_INDEX] <= FRAMED_HEADER_SIZE:
+		return None
+	total_length = data[DATA_INDEX+1] + (data[DATA_INDEX+2] << 8)
+	message = data[DATA_INDEX+FRAMED_HEADER_SIZE:DATA_INDEX+data[LEN_INDEX]]
+	while len(message) < total_length:
+		data = receiveHidPacket(epin)
+		message.extend(data[DATA_INDEX+FRAMED_HEADER_SIZE:DATA_INDEX+data[LEN_INDEX]])
+	return message
+
+def readNodesInBatch(epin, epout):
+	addresses = raw_input("Node addresses (hex, comma separated): ")
+	addresses = [int(x, 16) for x in addresses.split(",")]
+
+	sendHidPacket(epout, CMD_START_MEMORYMGMT, 0, None)
+	print "Please accept memory management mode on the MP"
+	if receiveHidPacket(epin)[DATA_INDEX] != 1:
+		print "Memory management mode refused"
+		return
+
+	# up to 31 addresses per request
+	while len(addresses) > 0:
+		batch = addresses[0:31]
+		addresses = addresses[31:]
+		request = array('B')
+		for addr in batch:
+			request.extend([addr & 0xFF, addr >> 8])
+		sendHidPacket(epout, CMD_READ_FLASH_NODES, len(request), request)
+		nodes = receiveFramedMessage(epin, CMD_READ_FLASH_NODES)
+		if nodes is None:
+			print "Couldn't read nodes"
+			break
+		for i in range(0, len(batch)):
+			print "Node", hex(batch[i]) + ":", ''.join('{:02x}'.format(x) for x in nodes[i*NODE_SIZE:(i+1)*NODE_SIZE])
+
+	sendHidPacket(epout, CMD_END_MEMORYMGMT, 0, None)
+	receiveHidPacket(epin)
+
 def sendCustomPacket(epin, epout):
 	command = raw_input("CMD ID: ")
 	packet = array('B')
@@ -372,7 +443,142 @@ def	uploadBundle(epin, epout):
 		print "likely causes: mooltipass already setup"
 
 	return success_status
+
+def uploadBundleStream(epin, epout):
+	filename = raw_input("Bundle file: ")
+	mp_password = raw_input("Mooltipass password (empty if not set): ")
+
+	# Prepare the password
+	mooltipass_password = array('B', [0] * 62)
+	if mp_password != "":
+		for i in range(62):
+			mooltipass_password[i] = int(mp_password[i*2:i*2+2], 16)
+
+	sendHidPacket(epout, CMD_IMPORT_MEDIA_START, 62, mooltipass_password)
+	if receiveHidPacket(epin)[DATA_INDEX] != 0x01:
+		print "Import refused"
+		return 0
+
+	bundlefile = open(filename, 'rb')
+	bundle = array('B', bundlefile.read())
+	bundlefile.close()
+
+	# Send full packets, only waiting for an ack when two windows are in flight
+	crc = 0xFFFF
+	packets_sent = 0
+	packets_acked = 0
+	start_time = time.time()
+	for i in range(0, len(bundle), 62):
+		chunk = bundle[i:i+62]
+		for byte in chunk:
+			crc = crc16CcittUpdate(crc, byte)
+		sendHidPacket(epout, CMD_IMPORT_MEDIA_STREAM, len(chunk), chunk)
+		packets_sent += 1
+		while packets_sent - packets_acked >= 2 * MEDIA_IMPORT_ACK_WINDOW:
+			data = receiveHidPacket(epin)
+			if data[CMD_INDEX] != CMD_IMPORT_MEDIA_STREAM or data[LEN_INDEX] != 3:
+				print "Error in upload"
+				return 0
+			packets_acked = data[DATA_INDEX+1] + (data[DATA_INDEX+2] << 8)
+
+	# Skip the remaining acks, the end packet tells if everything went well
+	sendHidPacket(epout, CMD_IMPORT_MEDIA_STREAM_END, 2, array('B', [crc & 0xFF, crc >> 8]))
+	data = receiveHidPacket(epin)
+	while data[CMD_INDEX] == CMD_IMPORT_MEDIA_STREAM:
+		data = receiveHidPacket(epin)
+	if data[DATA_INDEX] == 0x01:
+		print "Bundle uploaded in", int(time.time() - start_time), "seconds"
+		return 1
+	else:
+		print "Error in upload"
+		return 0
 	
+def getMediaPageHashes(epin, epout, nb_pages):
+	hashes = []
+	while len(hashes) < nb_pages:
+		count = min(255, nb_pages - len(hashes))
+		sendHidPacket(epout, CMD_GET_MEDIA_PAGE_HASH, 3, array('B', [len(hashes) & 0xFF, len(hashes) >> 8, count]))
+		answer = receiveFramedMessage(epin, CMD_GET_MEDIA_PAGE_HASH)
+		if answer is None:
+			return None
+		hashes.extend(struct.unpack('<' + 'I' * count, answer[0:count*4].tostring()))
+	return hashes
+
+def uploadBundleDelta(epin, epout):
+	filename = raw_input("Delta file (from packAndSign.py) or full update file: ")
+	page_size = input("Flash page size (264 or 528): ")
+	mp_password = raw_input("Mooltipass password (empty if not set): ")
+
+	fd = open(filename, 'rb')
+	file_data = array('B', fd.read())
+	fd.close()
+
+	# Expected page CRC32s, CRC16 of the whole bundle and the pages we have contents for
+	pages = {}
+	if file_data[0:4].tostring() == "MPDL":
+		page_size, nb_pages, zone_crc = struct.unpack('<HHH', file_data[4:10].tostring())
+		expected = list(struct.unpack('<' + 'I' * nb_pages, file_data[10:10+nb_pages*4].tostring()))
+		index = 10 + nb_pages*4
+		nb_records = struct.unpack('<H', file_data[index:index+2].tostring())[0]
+		index += 2
+		for i in range(0, nb_records):
+			page = struct.unpack('<H', file_data[index:index+2].tostring())[0]
+			pages[page] = file_data[index+2:index+2+page_size]
+			index += 2 + page_size
+	else:
+		nb_pages = (len(file_data) + page_size - 1) / page_size
+		file_data.extend([0] * (nb_pages*page_size - len(file_data)))
+		expected = []
+		zone_crc = 0xFFFF
+		for i in range(0, nb_pages):
+			pages[i] = file_data[i*page_size:(i+1)*page_size]
+			expected.append(zlib.crc32(pages[i].tostring()) & 0xFFFFFFFF)
+			for byte in pages[i]:
+				zone_crc = crc16CcittUpdate(zone_crc, byte)
+
+	# Prepare the password
+	mooltipass_password = array('B', [0] * 62)
+	if mp_password != "":
+		for i in range(62):
+			mooltipass_password[i] = int(mp_password[i*2:i*2+2], 16)
+
+	sendHidPacket(epout, CMD_IMPORT_MEDIA_START, 62, mooltipass_password)
+	if receiveHidPacket(epin)[DATA_INDEX] != 0x01:
+		print "Import refused"
+		return 0
+
+	# Only send the pages whose contents differ
+	start_time = time.time()
+	hashes = getMediaPageHashes(epin, epout, nb_pages)
+	if hashes is None:
+		print "Couldn't get page hashes"
+		return 0
+	to_send = [i for i in range(0, nb_pages) if hashes[i] != expected[i]]
+	for i in to_send:
+		if i not in pages:
+			print "Device contents don't match the delta file base, page", i
+			sendHidPacket(epout, CMD_IMPORT_MEDIA_END, 0, None)
+			receiveHidPacket(epin)
+			return 0
+	for i in to_send:
+		message = array('B', [i & 0xFF, i >> 8])
+		message.extend(pages[i])
+		sendFramedMessage(epout, CMD_IMPORT_MEDIA_PAGE, message)
+		if receiveHidPacket(epin)[DATA_INDEX] != 0x01:
+			print "Error in upload, page", i
+			return 0
+
+	# Check the result with the CRC16 of the whole bundle, independent from the page CRC32s used to select the pages
+	sendHidPacket(epout, CMD_GET_MEDIA_ZONE_CRC, 4, array('B', [0, 0, nb_pages & 0xFF, nb_pages >> 8]))
+	data = receiveHidPacket(epin)
+	sendHidPacket(epout, CMD_IMPORT_MEDIA_END, 0, None)
+	receiveHidPacket(epin)
+	if data[LEN_INDEX] != 2 or data[DATA_INDEX] + (data[DATA_INDEX+1] << 8) != zone_crc:
+		print "Bundle CRC doesn't match after upload!"
+		return 0
+	print len(to_send), "pages out of", nb_pages, "updated in", int(time.time() - start_time), "seconds"
+	return 1
+
 def checkSecuritySettings(epin, epout):
 	correct_password = raw_input("Enter mooltipass password: ")
 	correct_key = raw_input("Enter request key: ")
@@ -858,6 +1064,104 @@ def getUsernameDescriptionPassForService(epin, epout):
 		print "Password is:", "".join(map(chr, password[DATA_INDEX:])).split(b"\x00")[0]
 	
 
+def getCredentialInOneRequest(epin, epout):
+	service = raw_input("Service name: ")
+	login = raw_input("Login (empty to pick on the device): ")
+	payload = service + b"\x00"
+	if login != "":
+		payload += login + b"\x00"
+	print "Please accept prompts on the Mooltipass"
+
+	sendHidPacket(epout, CMD_GET_CREDENTIAL, len(payload), array('B', payload))
+	answer = receiveFramedMessage(epin, CMD_GET_CREDENTIAL)
+	if answer is None:
+		print "Request not performed"
+		return
+
+	# [context status] then [status, string] for login, description and password
+	if answer[0] == 0x03:
+		print "No card in the Mooltipass"
+	elif answer[0] != 0x01:
+		print "Service doesn't exist!"
+	index = 1
+	for name in ["Login", "Description", "Password"]:
+		status = answer[index]
+		field = "".join(map(chr, answer[index+1:])).split(b"\x00")[0]
+		index += len(field) + 2
+		if status == 0x01:
+			print name, "is:", field
+		else:
+			print name, "couldn't be fetched"
+
+def listenToStatusEvents(epin, epout):
+	sendHidPacket(epout, CMD_STATUS_EVENTS, 1, array('B', [1]))
+	data = receiveHidPacket(epin)
+	while data[CMD_INDEX] == CMD_STATUS_EVENT:
+		data = receiveHidPacket(epin)
+	if data[DATA_INDEX] != 0x01:
+		print "Status events not supported"
+		return
+
+	print "Listening to status events, ctrl-c to stop"
+	names = ["card inserted", "card removed", "card unlocked", "card locked", "memory management mode left"]
+	try:
+		while True:
+			data = receiveHidPacketWithTimeout(epin)
+			if data is not None and data[CMD_INDEX] == CMD_STATUS_EVENT:
+				print "Events:", ", ".join([names[i] for i in range(0, len(names)) if data[DATA_INDEX] & (1 << i)]), "- status:", hex(data[DATA_INDEX+1])
+	except KeyboardInterrupt:
+		pass
+
+	sendHidPacket(epout, CMD_STATUS_EVENTS, 1, array('B', [0]))
+	receiveHidPacket(epin)
+
+def crc16CcittUpdate(crc, byte):
+	# same as avr-libc _crc_ccitt_update
+	byte ^= crc & 0xFF
+	byte = (byte ^ (byte << 4)) & 0xFF
+	return (((byte << 8) | (crc >> 8)) ^ (byte >> 4) ^ (byte << 3)) & 0xFFFF
+
+def exportStream(epin, epout):
+	region = input("Region to export (1: flash, 2: eeprom): ")
+	filename = raw_input("Output file: ")
+	window = 64
+
+	sendHidPacket(epout, CMD_EXPORT_STREAM_START, 2, array('B', [region, window]))
+	data = receiveHidPacket(epin)
+	if data[CMD_INDEX] != CMD_EXPORT_STREAM_START or data[DATA_INDEX] != 0x01:
+		print "Export not performed (development firmware only)"
+		return
+
+	dump = array('B')
+	crc = 0xFFFF
+	credit = window
+	start_time = time.time()
+	while True:
+		data = receiveHidPacket(epin)
+		if data[CMD_INDEX] == CMD_EXPORT_STREAM_END:
+			break
+		if data[CMD_INDEX] != CMD_EXPORT_STREAM_DATA:
+			continue
+		chunk = data[DATA_INDEX:DATA_INDEX+data[LEN_INDEX]]
+		dump.extend(chunk)
+		for byte in chunk:
+			crc = crc16CcittUpdate(crc, byte)
+		# give back credit by half windows
+		credit -= 1
+		if credit <= window / 2:
+			sendHidPacket(epout, CMD_EXPORT_STREAM_DATA, 1, array('B', [window - credit]))
+			credit = window
+	elapsed = time.time() - start_time
+
+	f = open(filename, 'wb')
+	dump.tofile(f)
+	f.close()
+	print len(dump), "bytes exported in", int(elapsed), "seconds"
+	if crc == data[DATA_INDEX] + (data[DATA_INDEX+1] << 8):
+		print "CRC OK"
+	else:
+		print "CRC mismatch!"
+
 def addServiceAndUser(epin, epout):
 	tempPacket = array('B')
 	service = raw_input("Service name: ")
@@ -927,6 +1231,33 @@ def getDecodedDataForService(epin, epout):
 		answer = receiveHidPacket(epin)
 		time2 = time.time()
 		
+def getDecodedDataNodesForService(epin, epout):
+	service = raw_input("Service name: ")
+	print "Please accept prompts on the Mooltipass"
+
+	# Check that the context exists
+	sendHidPacket(epout, CMD_SET_DATA_SERVICE, len(service)+1, array('B', service + b"\x00"))
+	if receiveHidPacket(epin)[DATA_INDEX] == 0x01:
+		print "Service exists"
+	else:
+		print "Service doesn't exist"
+		return
+
+	# One request per data node, one answer packet per 32 bytes block
+	while True:
+		time1 = time.time()
+		sendHidPacket(epout, CMD_READ_NODE_IN_DN, 0, None)
+		answer = receiveHidPacket(epin)
+		if answer[LEN_INDEX] == 1:
+			return
+		node_data = answer[DATA_INDEX+1:DATA_INDEX+1+32]
+		while answer[DATA_INDEX] != 0:
+			answer = receiveHidPacket(epin)
+			node_data.extend(answer[DATA_INDEX+1:DATA_INDEX+1+32])
+		time2 = time.time()
+		print node_data
+		print "Data node received, took", (time2 - time1)*1000.0, "ms"
+
 def addRandomDataForService(epin, epout):
 	tempPacket = array('B')
 	service = raw_input("Service name: ")
@@ -1009,6 +1340,46 @@ def checkPasswordForService(epin, epout):
 	else:
 		print "Password NOK"
 		
+def checkPasswordsForService(epin, epout):
+	service = raw_input("Service name: ")
+	pairs = []
+	while True:
+		username = raw_input("Username (empty to stop): ")
+		if username == "":
+			break
+		password = raw_input("Password: ")
+		pairs.append((username, password))
+	print "Please accept prompts on the Mooltipass"
+
+	# Set context
+	sendHidPacket(epout, CMD_CONTEXT, len(service)+1, array('B', service + b"\x00"))
+	if receiveHidPacket(epin)[DATA_INDEX] == 0x01:
+		print "Service exists"
+	else:
+		print "Service doesn't exist"
+		return
+
+	# Send as many pairs as fit in each packet
+	while len(pairs) > 0:
+		batch = []
+		payload = ""
+		while len(pairs) > 0 and len(batch) < 15 and len(payload) + len(pairs[0][0]) + len(pairs[0][1]) + 2 <= 62:
+			batch.append(pairs.pop(0))
+			payload += batch[-1][0] + b"\x00" + batch[-1][1] + b"\x00"
+		if len(batch) == 0:
+			print "Login / password pair too long:", pairs.pop(0)[0]
+			continue
+		sendHidPacket(epout, CMD_CHECK_PASSWORD_BATCH, len(payload), array('B', payload))
+		data = receiveHidPacket(epin)
+		if data[LEN_INDEX] == 1:
+			print "Request not performed" if data[DATA_INDEX] == 0x00 else "Request blocked, wrong password timer running"
+			return
+		for i in range(0, len(batch)):
+			if data[DATA_INDEX + (i >> 3)] & (1 << (i & 0x07)):
+				print batch[i][0] + ": password OK"
+			else:
+				print batch[i][0] + ": password NOK"
+
 def credGen(epin, epout):
 	for i in range(0, 40):
 		tempPacket = array('B')
@@ -1653,6 +2024,106 @@ def recoveryProc(epin, epout):
 	sendHidPacket(epout, CMD_END_MEMORYMGMT, 0, None)
 	receiveHidPacket(epin)
 
+class VirtualDevice:
+	# Virtual Mooltipass served over a unix socket by source_code/host/virtual_device.c
+	def __init__(self, sock):
+		self.sock = sock
+
+	def reset(self):
+		self.sock.close()
+
+class VirtualEndpoint:
+	# Same read / write interface as the pyusb endpoints, one 64B packet per socket message
+	wMaxPacketSize = 64
+
+	def __init__(self, sock):
+		self.sock = sock
+
+	def read(self, size, timeout=None):
+		if timeout is None:
+			self.sock.settimeout(None)
+		else:
+			self.sock.settimeout(timeout / 1000.0)
+		try:
+			return array('B', self.sock.recv(size))
+		except socket.timeout:
+			raise usb.core.USBError("Operation timed out")
+
+	def write(self, data):
+		packet = array('B', data)
+		packet.extend([0] * (self.wMaxPacketSize - len(packet)))
+		self.sock.send(packet.tostring())
+
+def findVirtualDevice(socket_path, print_debug):
+	# Connect to the socket, then check that the device answers our ping like findHIDDevice does
+	sock = socket.socket(socket.AF_UNIX, socket.SOCK_SEQPACKET)
+	try:
+		sock.connect(socket_path)
+	except socket.error as e:
+		if print_debug:
+			print "Cannot connect to the virtual device:", str(e)
+		return None, None, None, None
+	epin = VirtualEndpoint(sock)
+	epout = VirtualEndpoint(sock)
+	byte1 = random.randint(0, 255)
+	byte2 = random.randint(0, 255)
+	sendHidPacket(epout, CMD_PING, 2, [byte1, byte2])
+	data = receiveHidPacketWithTimeout(epin)
+	if data is None or data[CMD_INDEX] != CMD_PING or data[DATA_INDEX] != byte1 or data[DATA_INDEX+1] != byte2:
+		if print_debug:
+			print "Virtual device didn't reply to our ping message"
+		return None, None, None, None
+	if print_debug:
+		print "Virtual Mooltipass found"
+	return VirtualDevice(sock), None, epin, epout
+
+class SessionRecorder:
+	# Writes the HID session format read by source_code/host/hid_replay.c, see host/hid_session.h
+	def __init__(self, file_name):
+		self.file = open(file_name, "wb")
+		self.file.write("MPHS" + chr(1) + chr(0) * 3)
+		self.start_time = time.time()
+		self.last_time_us = 0
+
+	def record(self, direction, data):
+		# Time delta in us as a LEB128 varint, then direction / length byte and the report without its trailing zeros
+		packet = array('B', data)
+		while len(packet) > 0 and packet[-1] == 0:
+			packet.pop()
+		time_us = int((time.time() - self.start_time) * 1000000)
+		if time_us < self.last_time_us:
+			time_us = self.last_time_us
+		delta = time_us - self.last_time_us
+		self.last_time_us = time_us
+		header = array('B')
+		while delta >= 0x80:
+			header.append((delta & 0x7F) | 0x80)
+			delta >>= 7
+		header.append(delta)
+		header.append((direction << 7) | len(packet))
+		self.file.write(header.tostring() + packet.tostring())
+		self.file.flush()
+
+class RecordingEndpoint:
+	# Wraps a pyusb or virtual endpoint, records every packet going through it
+	def __init__(self, endpoint, recorder, direction):
+		self.endpoint = endpoint
+		self.recorder = recorder
+		self.direction = direction
+		self.wMaxPacketSize = endpoint.wMaxPacketSize
+
+	def read(self, size, timeout=None):
+		if timeout is None:
+			data = self.endpoint.read(size)
+		else:
+			data = self.endpoint.read(size, timeout)
+		self.recorder.record(self.direction, data)
+		return data
+
+	def write(self, data):
+		self.recorder.record(self.direction, data)
+		return self.endpoint.write(data)
+
 def findHIDDevice(vendor_id, product_id, print_debug):
 	# Find our device
 	hid_device = usb.core.find(idVendor=vendor_id, idProduct=product_id)
@@ -1753,11 +2224,21 @@ if __name__ == '__main__':
 	print ""
 	print "Mooltipass USB client"
 
-	# Search for the mooltipass and read hid data
-	hid_device, intf, epin, epout = findHIDDevice(USB_VID, USB_PID, True)
+	# Search for the mooltipass and read hid data, MOOLTIPASS_SOCKET selects a virtual device instead
+	if os.environ.get("MOOLTIPASS_SOCKET") is not None:
+		hid_device, intf, epin, epout = findVirtualDevice(os.environ["MOOLTIPASS_SOCKET"], True)
+	else:
+		hid_device, intf, epin, epout = findHIDDevice(USB_VID, USB_PID, True)
 
 	if hid_device is None:
 		sys.exit(0)
+
+	# MOOLTIPASS_RECORD records the session for source_code/host/hid_replay.c
+	if os.environ.get("MOOLTIPASS_RECORD") is not None:
+		recorder = SessionRecorder(os.environ["MOOLTIPASS_RECORD"])
+		epin = RecordingEndpoint(epin, recorder, 1)
+		epout = RecordingEndpoint(epout, recorder, 0)
+		print "Recording the session to", os.environ["MOOLTIPASS_RECORD"]
 		
 	# Print Mootipass status
 	sendHidPacket(epout, CMD_MOOLTIPASS_STATUS, 0, None)
@@ -1820,6 +2301,15 @@ if __name__ == '__main__':
 		print "40) Try to unlock device with PIN"
 		print "41) Unknown card: get current CPZ"
 		print "42) Mooltipass mini: set contrast current"
+		print "43) Get decoded data for given service, a node at a time"
+		print "44) Check several passwords for given service"
+		print "45) Type several keys per keyboard report (1: enable, 0: one key per report)"
+		print "46) Read several nodes in one request"
+		print "47) Get username, description, password for service in one request"
+		print "48) Listen to status events"
+		print "49) Export flash / eeprom contents to file (development firmware)"
+		print "50) Upload bundle, pipelined"
+		print "51) Upload bundle, only the pages that changed"
 		choice = input("Make your choice: ")
 		print ""
 
@@ -1943,6 +2433,24 @@ if __name__ == '__main__':
 				print ''.join('{:d} '.format(x) for x in data[DATA_INDEX:DATA_INDEX+data[LEN_INDEX]])
 		elif choice == 42:
 			setGenericParameter(epin, epout, 26)
+		elif choice == 43:
+			getDecodedDataNodesForService(epin, epout)
+		elif choice == 44:
+			checkPasswordsForService(epin, epout)
+		elif choice == 45:
+			setGenericParameter(epin, epout, 27)
+		elif choice == 46:
+			readNodesInBatch(epin, epout)
+		elif choice == 47:
+			getCredentialInOneRequest(epin, epout)
+		elif choice == 48:
+			listenToStatusEvents(epin, epout)
+		elif choice == 49:
+			exportStream(epin, epout)
+		elif choice == 50:
+			uploadBundleStream(epin, epout)
+		elif choice == 51:
+			uploadBundleDelta(epin, epout)
 
 	hid_device.reset()
 
@@ -0,0 +1,178 @@
+#!/usr/bin/env python
+#
+# Copyright (c) 2014 Darran Hunt (darran [at] hunt dot net dot nz)
+# All rights reserved.
+#
+# CDDL HEADER START
+#
+# The contents of this file are subject to the terms of the
+# Common Development and Distribution License (the "License").
+# You may not use this file except in compliance with the License.
+#
+# You can obtain a copy of the license at src/license_cddl-1.0.txt
+# or http://www.opensolaris.org/os/licensing.
+# See the License for the specific language governing permissions
+# and limitations under the License.
+#
+# When distributing Covered Code, include this CDDL HEADER in each
+# file and include the License file at src/license_cddl-1.0.txt
+# If applicable, add the following below this CDDL HEADER, with the
+# fields enclosed by brackets "[]" replaced with your own identifying
+# information: Portions Copyright [yyyy] [name of copyright owner]
+#
+# CDDL HEADER END
+#
+# Static stack depth analysis of the firmware: the frame sizes come from the
+# .su files written by gcc -fstack-usage, the call graph from the disassembly
+# of the ELF file. Indirect calls can't be followed and are only reported.
+import subprocess
+import sys
+import re
+import os
+
+RETURN_ADDRESS_SIZE     = 2
+COMMAND_PARSER          = "usbProcessIncomingMessage"
+
+def readStackUsage(build_dir):
+	# Function name to frame size, from all the .su files of the build folder
+	frames = {}
+	for root, dirs, files in os.walk(build_dir):
+		for name in files:
+			if name.endswith(".su"):
+				for line in open(os.path.join(root, name)):
+					fields = line.rstrip("\n").split("\t")
+					if len(fields) == 3:
+						function = fields[0].split(":")[-1]
+						frames[function] = max(frames.get(function, 0), int(fields[1]))
+	return frames
+
+def readCallGraph(elf_path):
+	# Function name to [(callee, pushes a return address)], and the functions with indirect calls
+	calls = {}
+	indirect = set()
+	current = None
+	output = subprocess.check_output(["avr-objdump", "-d", elf_path])
+	for line in output.splitlines():
+		match = re.match(r"^[0-9a-f]+ <([^>]+)>:", line)
+		if match:
+			current = match.group(1)
+			calls[current] = []
+			continue
+		match = re.search(r"\t(call|rcall|jmp|rjmp)\t.*<([^>+]+)>", line)
+		# A jump to the start of the function is a loop, a call to it a recursion
+		if match and current is not None and (match.group(2) != current or match.group(1) in ["call", "rcall"]):
+			calls[current].append((match.group(2), match.group(1) in ["call", "rcall"]))
+		elif current is not None and re.search(r"\t(e?icall|e?ijmp)", line):
+			indirect.add(current)
+	return calls, indirect
+
+def readSymbol(elf_path, symbol):
+	for line in subprocess.check_output(["avr-nm", elf_path]).splitlines():
+		fields = line.split()
+		if len(fields) == 3 and fields[2] == symbol:
+			return int(fields[0], 16) & 0xFFFF
+	return None
+
+class StackAnalyzer:
+	def __init__(self, frames, calls):
+		self.frames = frames
+		self.calls = calls
+		self.depths = {}
+		self.worst_callee = {}
+		self.recursive = set()
+		self.unknown = set()
+
+	def depth(self, function, stack=()):
+		# Worst case stack depth of a function, including its own frame
+		if function in self.depths:
+			return self.depths[function]
+		if function in stack:
+			self.recursive.add(function)
+			return 0
+		if function not in self.frames:
+			self.unknown.add(function)
+		worst, worst_callee = 0, None
+		for callee, pushes_address in self.calls.get(function, []):
+			callee_depth = self.depth(callee, stack + (function,)) + (RETURN_ADDRESS_SIZE if pushes_address else 0)
+			if callee_depth > worst:
+				worst, worst_callee = callee_depth, callee
+		self.depths[function] = self.frames.get(function, 0) + worst
+		self.worst_callee[function] = worst_callee
+		return self.depths[function]
+
+	def worstPath(self, function):
+		path = []
+		while function is not None and function not in path:
+			path.append(function)
+			function = self.worst_callee.get(function)
+		return path
+
+	def entryDepth(self, root, target):
+		# Worst case stack depth when entering target from root, None if it isn't reachable
+		best = {}
+		def visit(function, depth, stack):
+			if function == target:
+				best[target] = max(best.get(target, 0), depth)
+				return
+			if function in stack or best.get(function, -1) >= depth:
+				return
+			best[function] = depth
+			for callee, pushes_address in self.calls.get(function, []):
+				visit(callee, depth + self.frames.get(function, 0) + (RETURN_ADDRESS_SIZE if pushes_address else 0), stack | set([function]))
+		visit(root, 0, set())
+		return best.get(target)
+
+def main():
+	if len(sys.argv) < 2:
+		print "usage: stackdepth.py mooltipass.elf [build folder]"
+		sys.exit(1)
+	elf_path = sys.argv[1]
+	build_dir = sys.argv[2] if len(sys.argv) > 2 else os.path.join(os.path.dirname(os.path.abspath(elf_path)), "build")
+	frames = readStackUsage(build_dir)
+	if len(frames) == 0:
+		print "No .su file in", build_dir, "- the firmware must be compiled with -fstack-usage"
+		sys.exit(1)
+	calls, indirect = readCallGraph(elf_path)
+	analyzer = StackAnalyzer(frames, calls)
+
+	# Stack area between the end of static RAM and the top of the RAM
+	end = readSymbol(elf_path, "_end")
+	top = readSymbol(elf_path, "__stack")
+	stack_size = top - end + 1 if (end is not None and top is not None) else 0
+
+	# Interrupts don't nest, the deepest one can land on top of any main context frame
+	vectors = sorted([name for name in calls if re.match(r"__vector_\d+$", name)], key=lambda name: analyzer.depth(name), reverse=True)
+	worst_isr = (analyzer.depth(vectors[0]) + RETURN_ADDRESS_SIZE) if vectors else 0
+	main_depth = analyzer.depth("main")
+	print "Stack area:", stack_size, "bytes"
+	print "main():", main_depth, "bytes, with the deepest interrupt:", main_depth + worst_isr, "bytes, left:", stack_size - main_depth - worst_isr
+	print "Worst path:", " > ".join(analyzer.worstPath("main"))
+	print ""
+	print "%-50s %6s" % ("interrupt", "depth")
+	for vector in vectors:
+		print "%-50s %6d" % (vector, analyzer.depth(vector))
+
+	# Commands: the functions called by the command parser, from where it is called the deepest
+	parser_entry = analyzer.entryDepth("main", COMMAND_PARSER)
+	if parser_entry is not None:
+		base = parser_entry + frames.get(COMMAND_PARSER, 0) + worst_isr
+		print ""
+		print COMMAND_PARSER + "() entered with", parser_entry, "bytes used, callees including the deepest interrupt:"
+		print "%-50s %6s %6s" % ("function", "total", "left")
+		callees = set(callee for callee, pushes_address in calls.get(COMMAND_PARSER, []))
+		for callee in sorted(callees, key=lambda name: analyzer.depth(name), reverse=True):
+			total = base + RETURN_ADDRESS_SIZE + analyzer.depth(callee)
+			print "%-50s %6d %6d" % (callee, total, stack_size - total)
+
+	if analyzer.recursive:
+		print ""
+		print "Recursive functions, depth not bounded:", ", ".join(sorted(analyzer.recursive))
+	reachable_indirect = sorted(name for name in indirect if name in analyzer.depths)
+	if reachable_indirect:
+		print "Indirect calls not followed in:", ", ".join(reachable_indirect)
+	unknown = sorted(analyzer.unknown)
+	if unknown:
+		print "No frame size for (library or assembly functions):", ", ".join(unknown)
+
+if __name__ == "__main__":
+	main()
@@ -26,8 +26,11 @@ import platform
 import usb.core
 import usb.util
 import random
+import struct
 import time
 import sys
+import re
+import os
 
 USB_VID                 = 0x16D0
 USB_PID                 = 0x09A0
@@ -45,6 +48,9 @@ NODE_SIZE				= 132
 
 CMD_PING                = 0xA1
 CMD_STACK_FREE 			= 0x9C
+STACK_PROFILE_GET		= 0x01
+STACK_PROFILE_RESET		= 0xFF
+STACK_PROFILE_NB_SLOTS	= 8
 	
 def sendHidPacket(epout, cmd, len, data):
 	# data to send
@@ -160,15 +166,58 @@ def findHIDDevice(vendor_id, product_id, print_debug):
 	# Return device & endpoints
 	return hid_device, intf, epin, epout
 
+def getFirmwareNames(header, prefix):
+	# IDs to names from the firmware sources, the mini and standard versions may share an ID
+	names = {}
+	path = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..", "source_code", "src", header)
+	try:
+		for line in open(path):
+			match = re.match(r"\s*#define\s+(" + prefix + r"\w+)\s+(0x[0-9A-Fa-f]+|\d+)\s*$", line)
+			if match:
+				names.setdefault(int(match.group(2), 0), []).append(match.group(1))
+	except IOError:
+		pass
+	return dict((key, "/".join(value)) for key, value in names.items())
+
+def printProfile(epin, epout):
+	# Commands and screens sorted by stack usage, closest to overflowing first
+	sendHidPacket(epout, CMD_STACK_FREE, 1, [STACK_PROFILE_GET])
+	data = epin.read(epin.wMaxPacketSize, timeout=2000)
+	if data[LEN_INDEX] != 4 + 2 * STACK_PROFILE_NB_SLOTS * 3:
+		print "No stack profile in this firmware (needs ENABLE_STACK_PROFILE)"
+		return
+	stack_size, free_bytes = struct.unpack("<HH", data[DATA_INDEX:DATA_INDEX+4].tostring())
+	print "Stack area:", stack_size, "bytes, never used:", free_bytes, "bytes"
+	print ""
+	entries = []
+	for kind_index, (kind, names) in enumerate([("command", getFirmwareNames(os.path.join("USB", "usb_cmd_parser.h"), "CMD_")), ("screen", getFirmwareNames(os.path.join("GUI", "gui.h"), "SCREEN_"))]):
+		for i in range(STACK_PROFILE_NB_SLOTS):
+			offset = DATA_INDEX + 4 + (kind_index * STACK_PROFILE_NB_SLOTS + i) * 3
+			entry_id, max_used = struct.unpack("<BH", data[offset:offset+3].tostring())
+			entries.append((kind, names.get(entry_id, "0x%02X" % entry_id), max_used))
+	entries = [entry for entry in entries if entry[2] != 0]
+	print "%-8s %-50s %6s %6s" % ("kind", "name", "used", "left")
+	for kind, name, max_used in sorted(entries, key=lambda entry: entry[2], reverse=True):
+		print "%-8s %-50s %6d %6d" % (kind, name, max_used, stack_size - max_used)
+	if len(entries) == 0:
+		print "Nothing recorded yet"
+
 def main():
 	# Search for the mooltipass and read hid data
 	hid_device, intf, epin, epout = findHIDDevice(USB_VID, USB_PID, True)
 	if hid_device is None:
 		sys.exit(0)
 		
-	sendHidPacket(epout, CMD_STACK_FREE, 0, None)
-	data = epin.read(epin.wMaxPacketSize, timeout=2000)
-	print "Stack free:", data[DATA_INDEX] + data[DATA_INDEX+1]*256, "bytes"
+	if len(sys.argv) > 1 and sys.argv[1] == "profile":
+		printProfile(epin, epout)
+	elif len(sys.argv) > 1 and sys.argv[1] == "reset":
+		sendHidPacket(epout, CMD_STACK_FREE, 1, [STACK_PROFILE_RESET])
+		data = epin.read(epin.wMaxPacketSize, timeout=2000)
+		print "Stack profile cleared" if data[DATA_INDEX] == 0x01 else "Couldn't clear the stack profile"
+	else:
+		sendHidPacket(epout, CMD_STACK_FREE, 0, None)
+		data = epin.read(epin.wMaxPacketSize, timeout=2000)
+		print "Stack free:", data[DATA_INDEX] + data[DATA_INDEX+1]*256, "bytes"
 		
 	#hid_device.reset()
 